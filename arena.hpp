@@ -0,0 +1,168 @@
+/**
+ * arena.hpp
+ * Defines MonotonicArena, a bump allocator for the short-lived objects built
+ * while reading input lines, and the line splitting that allocates from it.
+ * Memory is only handed back by Reset, which rewinds to the first block and
+ * keeps every block for the next batch, so once the blocks are warm a
+ * connector parses and dispatches events without calling malloc.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_ARENA_HPP
+#define TRADING_SYSTEM_ARENA_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace std;
+
+// Size of each block taken from the heap
+const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+
+/**
+ * Monotonic arena behind pmr containers. Deallocation does nothing, the
+ * whole arena is released at once by Reset.
+ */
+class MonotonicArena : public pmr::memory_resource{
+private:
+    vector<unique_ptr<char[]>> blocks;
+    vector<size_t> block_sizes;
+    size_t block_index;
+    size_t offset;
+    size_t block_size;
+
+    // Move to the next block able to hold bytes, allocating one if needed
+    void NextBlock(size_t bytes, size_t alignment);
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override;
+
+public:
+    // ctor, the first block is taken up front
+    explicit MonotonicArena(size_t _block_size = ARENA_BLOCK_SIZE);
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    // Release everything allocated so far, keeping the blocks
+    void Reset();
+
+    // Blocks taken from the heap, flat once the arena is warm
+    size_t GetBlockCount() const;
+};
+
+
+// Split a line on the delimiter into views of the line, in a vector
+// allocated from the resource. The views are valid while the line is.
+pmr::vector<string_view> SplitFields(string_view line, char delimiter,
+                                     pmr::memory_resource* resource);
+
+// Parse a whole number, zero if the field does not start with one
+long ParseLong(string_view text);
+
+// Parse a whole number, false unless the whole field is one
+bool TryParseLong(string_view text, long& value);
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of MonotonicArena class
+MonotonicArena::MonotonicArena(size_t _block_size){
+    block_size = _block_size;
+    block_index = 0;
+    offset = 0;
+    blocks.emplace_back(new char[block_size]);
+    block_sizes.push_back(block_size);
+}
+
+void MonotonicArena::NextBlock(size_t bytes, size_t alignment){
+    size_t needed = bytes + alignment;
+    while(++block_index < blocks.size()){
+        if(block_sizes[block_index] >= needed){
+            offset = 0;
+            return;
+        }
+    }
+    // Oversized requests get a block of their own, kept like any other
+    size_t new_size = max(block_size, needed);
+    blocks.emplace_back(new char[new_size]);
+    block_sizes.push_back(new_size);
+    block_index = blocks.size() - 1;
+    offset = 0;
+}
+
+void* MonotonicArena::do_allocate(size_t bytes, size_t alignment){
+    while(true){
+        if(block_index < blocks.size()){
+            uintptr_t base = reinterpret_cast<uintptr_t>(blocks[block_index].get());
+            uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t) (alignment - 1);
+            size_t end = aligned - base + bytes;
+            if(end <= block_sizes[block_index]){
+                offset = end;
+                return reinterpret_cast<void*>(aligned);
+            }
+        }
+        NextBlock(bytes, alignment);
+    }
+}
+
+void MonotonicArena::do_deallocate(void*, size_t, size_t){
+}
+
+bool MonotonicArena::do_is_equal(const pmr::memory_resource& other) const noexcept{
+    return this == &other;
+}
+
+void MonotonicArena::Reset(){
+    block_index = 0;
+    offset = 0;
+}
+
+size_t MonotonicArena::GetBlockCount() const{
+    return blocks.size();
+}
+
+
+//
+// Implementation of line parsing
+pmr::vector<string_view> SplitFields(string_view line, char delimiter,
+                                     pmr::memory_resource* resource){
+    pmr::vector<string_view> fields(resource);
+    fields.reserve(32);
+    size_t start = 0;
+    while(start < line.size()){
+        size_t end = line.find(delimiter, start);
+        if(end == string_view::npos){
+            end = line.size();
+        }
+        fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    return fields;
+}
+
+long ParseLong(string_view text){
+    long value = 0;
+    from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+bool TryParseLong(string_view text, long& value){
+    const char* end = text.data() + text.size();
+    from_chars_result result = from_chars(text.data(), end, value);
+    return result.ec == errc() && result.ptr == end;
+}
+
+#endif //TRADING_SYSTEM_ARENA_HPP
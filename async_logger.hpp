@@ -0,0 +1,536 @@
+/**
+ * async_logger.hpp
+ * Defines an asynchronous logger of structured records: the service thread
+ * copies a fixed-size record into a lock-free ring and a background thread
+ * formats it as text, CSV or JSON into the file of its sink.
+ *
+ * Numbers are formatted with to_chars, doubles as exact decimals and prices
+ * in the price notation of the sink, see price_format.hpp.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_ASYNC_LOGGER_HPP
+#define TRADING_SYSTEM_ASYNC_LOGGER_HPP
+
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_queue.hpp"
+#include "price_format.hpp"
+
+using namespace std;
+
+// Output formats of a sink
+enum LogFormat { TEXT_FORMAT, CSV_FORMAT, JSON_FORMAT };
+
+// Types of the records logged, each with its LogSchema
+enum LogRecordType : uint8_t { STREAMING_LOG, POSITION_LOG, RISK_LOG, RISK_BUCKET_LOG,
+                               EXECUTION_LOG, INQUIRY_LOG };
+
+// Kinds of the fields of a record, prices are doubles written in the price
+// notation of the sink
+enum LogFieldKind : uint8_t { LOG_STRING, LOG_INTEGER, LOG_DOUBLE, LOG_PRICE };
+
+const size_t LOG_MAX_STRINGS = 6;
+// Room for the longest id logged, an execution order id of a 20 digit order
+// count, a dash and 7 random digits
+const size_t LOG_STRING_SIZE = 32;
+const size_t LOG_MAX_NUMBERS = 8;
+
+
+/**
+ * A field of a record: its label in text lines, its key in JSON and its kind.
+ */
+struct LogField{
+    const char* label;
+    const char* key;
+    LogFieldKind kind;
+};
+
+
+/**
+ * Name and fields of one type of record, in output order.
+ */
+struct LogSchema{
+    const char* name;
+    vector<LogField> fields;
+
+    // Schema of a record type
+    static const LogSchema& Get(LogRecordType type);
+};
+
+
+/**
+ * A record as it goes through the ring: plain data, its values stored by
+ * kind in the order of the fields of its schema.
+ */
+struct LogRecord{
+    int64_t time;
+    uint32_t sink;
+    LogRecordType type;
+    uint8_t string_count;
+    uint8_t integer_count;
+    uint8_t double_count;
+    char strings[LOG_MAX_STRINGS][LOG_STRING_SIZE];
+    int64_t integers[LOG_MAX_NUMBERS];
+    double doubles[LOG_MAX_NUMBERS];
+
+    // Start a record of a type stamped with the current time
+    void Begin(LogRecordType _type);
+
+    // Strings must be shorter than LOG_STRING_SIZE, longer ones are
+    // truncated when asserts are off
+    void AddString(const string &value);
+
+    void AddInteger(int64_t value);
+
+    void AddDouble(double value);
+};
+
+
+/**
+ * Formats records into lines, caching the text of the current second.
+ */
+class LogFormatter{
+private:
+    time_t cached_second;
+    char cached_timestamp[32];
+
+    static void AppendInteger(string &out, int64_t value);
+
+    static void AppendJsonString(string &out, const char *value);
+
+    // Quoted only when it holds a comma, a quote or a line break
+    static void AppendCsvString(string &out, const char *value);
+
+    // "%F %T" in local time
+    void AppendTimestamp(string &out, int64_t time);
+
+public:
+    // ctor
+    LogFormatter();
+
+    // Append the line of a record to out, prices in JSON are always decimals
+    void Format(const LogRecord &record, LogFormat format, PriceNotation notation,
+                string &out);
+
+    // Format records and append them to the file at path straight away
+    static void Write(const string &path, const LogRecord *records, size_t count,
+                      LogFormat format = TEXT_FORMAT,
+                      PriceNotation notation = DECIMAL_NOTATION);
+
+};
+
+
+/**
+ * Asynchronous logger writing the records of every sink from one background
+ * thread. Records are logged from a single thread, the one driving the
+ * services.
+ */
+class AsyncLogger{
+private:
+    struct Sink{
+        string path;
+        LogFormat format;
+        PriceNotation notation;
+        FILE* file;
+        string buffer;
+    };
+
+    SpscQueue<LogRecord> queue;
+    mutex sink_mutex;
+    vector<unique_ptr<Sink>> sinks;
+    LogFormatter formatter;
+    atomic<uint64_t> logged_count;
+    atomic<uint64_t> written_count;
+    atomic<bool> running;
+    thread writer;
+
+    void Run();
+
+    // Write the buffered lines of every sink to its file
+    void WriteBuffers();
+
+public:
+    // ctor, starts the background thread
+    AsyncLogger(size_t capacity = 1 << 14);
+
+    // Writes everything logged, then stops the background thread
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Add a file records can be logged to, returns its sink index
+    uint32_t AddSink(const string &path, LogFormat format = TEXT_FORMAT,
+                     PriceNotation notation = DECIMAL_NOTATION);
+
+    // Hand a record to the background thread, spins while the ring is full
+    void Log(const LogRecord &record);
+
+    // Wait until everything logged so far is written to the files
+    void Flush();
+
+    // Flush, then keep the background thread off the files until Resume,
+    // e.g. around a fork
+    void Pause();
+
+    void Resume();
+
+};
+
+
+/**
+ * Output of one historical connector: the file at path, written by the
+ * logger once one is set and straight away until then.
+ */
+class LogOutput{
+private:
+    string path;
+    AsyncLogger* logger;
+    uint32_t sink;
+
+public:
+    // ctor
+    explicit LogOutput(const string &_path);
+
+    // Format and write the lines on the background thread of _logger
+    void SetLogger(AsyncLogger* _logger, LogFormat format, PriceNotation notation);
+
+    // Hand records to the logger, or write them with a single open of the
+    // file without one
+    void Log(LogRecord *records, size_t count = 1);
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of LogSchema class
+const LogSchema& LogSchema::Get(LogRecordType type){
+    // Never destroyed, a logger owned by a static context still formats its
+    // last records after the other statics are gone
+    static const LogSchema* schemas = new LogSchema[INQUIRY_LOG + 1]{
+        {"Streaming", {{"CUSIP", "CUSIP", LOG_STRING}, {"Bid", "Bid", LOG_PRICE},
+                       {"BidVisibleQuantity", "BidVisibleQuantity", LOG_INTEGER},
+                       {"BidHiddenQuantity", "BidHiddenQuantity", LOG_INTEGER},
+                       {"Ask", "Ask", LOG_PRICE},
+                       {"AskVisibleQuantity", "AskVisibleQuantity", LOG_INTEGER},
+                       {"AskHiddenQuantity", "AskHiddenQuantity", LOG_INTEGER}}},
+        {"Position", {{"CUSIP", "CUSIP", LOG_STRING},
+                      {"AggregatePosition", "AggregatePosition", LOG_INTEGER},
+                      {"TRSY0", "TRSY0", LOG_INTEGER}, {"TRSY1", "TRSY1", LOG_INTEGER},
+                      {"TRSY2", "TRSY2", LOG_INTEGER}}},
+        {"Risk", {{"CUSIP", "CUSIP", LOG_STRING}, {"PV01", "PV01", LOG_DOUBLE},
+                  {"Quantity", "Quantity", LOG_INTEGER}}},
+        {"RiskBucket", {{"FrontEnd, PV01", "FrontEnd", LOG_DOUBLE},
+                        {"Quantity", "FrontEndQuantity", LOG_INTEGER},
+                        {"Belly, PV01", "Belly", LOG_DOUBLE},
+                        {"Quantity", "BellyQuantity", LOG_INTEGER},
+                        {"LongEnd, PV01", "LongEnd", LOG_DOUBLE},
+                        {"Quantity", "LongEndQuantity", LOG_INTEGER}}},
+        {"Execution", {{"OrderId", "OrderId", LOG_STRING}, {"CUSIP", "CUSIP", LOG_STRING},
+                       {"Side", "Side", LOG_STRING}, {"Price", "Price", LOG_PRICE},
+                       {"VisibleQuantity", "VisibleQuantity", LOG_INTEGER},
+                       {"HiddenQuantity", "HiddenQuantity", LOG_INTEGER},
+                       {"ParentOrderId", "ParentOrderId", LOG_STRING},
+                       {"IsChildOrder", "IsChildOrder", LOG_STRING}}},
+        {"Inquiry", {{"InquiryID", "InquiryID", LOG_STRING}, {"CUSIP", "CUSIP", LOG_STRING},
+                     {"InquiryState", "InquiryState", LOG_STRING},
+                     {"Side", "Side", LOG_INTEGER}, {"Price", "Price", LOG_PRICE},
+                     {"Quantity", "Quantity", LOG_INTEGER}}},
+    };
+    return schemas[type];
+}
+
+
+//
+// Implementation of LogRecord class
+void LogRecord::Begin(LogRecordType _type){
+    time = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    sink = 0;
+    type = _type;
+    string_count = 0;
+    integer_count = 0;
+    double_count = 0;
+}
+
+void LogRecord::AddString(const string &value){
+    assert(value.size() < LOG_STRING_SIZE);
+    size_t length = min(value.size(), LOG_STRING_SIZE - 1);
+    memcpy(strings[string_count], value.data(), length);
+    strings[string_count][length] = '\0';
+    ++string_count;
+}
+
+void LogRecord::AddInteger(int64_t value){
+    integers[integer_count++] = value;
+}
+
+void LogRecord::AddDouble(double value){
+    doubles[double_count++] = value;
+}
+
+
+//
+// Implementation of LogFormatter class
+LogFormatter::LogFormatter(){
+    cached_second = -1;
+    cached_timestamp[0] = '\0';
+}
+
+void LogFormatter::AppendInteger(string &out, int64_t value){
+    char digits[24];
+    char* end = to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end - digits);
+}
+
+void LogFormatter::AppendJsonString(string &out, const char *value){
+    out.push_back('"');
+    for(; *value != '\0'; ++value){
+        if(*value == '"' || *value == '\\'){
+            out.push_back('\\');
+        }
+        out.push_back(*value);
+    }
+    out.push_back('"');
+}
+
+void LogFormatter::AppendCsvString(string &out, const char *value){
+    if(strpbrk(value, ",\"\n") == nullptr){
+        out.append(value);
+        return;
+    }
+    out.push_back('"');
+    for(; *value != '\0'; ++value){
+        if(*value == '"'){
+            out.push_back('"');
+        }
+        out.push_back(*value);
+    }
+    out.push_back('"');
+}
+
+void LogFormatter::AppendTimestamp(string &out, int64_t time){
+    time_t second = time / 1000000000;
+    if(second != cached_second){
+        struct tm local;
+        localtime_r(&second, &local);
+        strftime(cached_timestamp, sizeof(cached_timestamp), "%F %T", &local);
+        cached_second = second;
+    }
+    out.append(cached_timestamp);
+}
+
+void LogFormatter::Format(const LogRecord &record, LogFormat format,
+                          PriceNotation notation, string &out){
+    const LogSchema& schema = LogSchema::Get(record.type);
+    size_t next_string = 0;
+    size_t next_integer = 0;
+    size_t next_double = 0;
+    if(format == TEXT_FORMAT){
+        AppendTimestamp(out, record.time);
+    }
+    else if(format == CSV_FORMAT){
+        AppendInteger(out, record.time);
+        out.push_back(',');
+        out.append(schema.name);
+    }
+    else{
+        out.append("{\"time\":");
+        AppendInteger(out, record.time);
+        out.append(",\"type\":\"");
+        out.append(schema.name);
+        out.push_back('"');
+    }
+    for(auto& field : schema.fields){
+        if(format == TEXT_FORMAT){
+            out.append(" , ");
+            out.append(field.label);
+            out.append(": ");
+        }
+        else if(format == CSV_FORMAT){
+            out.push_back(',');
+        }
+        else{
+            out.append(",\"");
+            out.append(field.key);
+            out.append("\":");
+        }
+        switch(field.kind){
+            case LOG_STRING:
+                if(format == JSON_FORMAT){
+                    AppendJsonString(out, record.strings[next_string++]);
+                }
+                else if(format == CSV_FORMAT){
+                    AppendCsvString(out, record.strings[next_string++]);
+                }
+                else{
+                    out.append(record.strings[next_string++]);
+                }
+                break;
+            case LOG_INTEGER:
+                AppendInteger(out, record.integers[next_integer++]);
+                break;
+            case LOG_PRICE:
+                AppendPrice(out, record.doubles[next_double++],
+                            (format == JSON_FORMAT) ? DECIMAL_NOTATION : notation);
+                break;
+            default:
+                AppendDecimal(out, record.doubles[next_double++]);
+                break;
+        }
+    }
+    if(format == JSON_FORMAT){
+        out.push_back('}');
+    }
+    out.push_back('\n');
+}
+
+void LogFormatter::Write(const string &path, const LogRecord *records, size_t count,
+                         LogFormat format, PriceNotation notation){
+    LogFormatter formatter;
+    string lines;
+    for(size_t i = 0; i < count; ++i){
+        formatter.Format(records[i], format, notation, lines);
+    }
+    FILE* file = fopen(path.c_str(), "a");
+    if(file != nullptr){
+        fwrite(lines.data(), 1, lines.size(), file);
+        fclose(file);
+    }
+}
+
+
+//
+// Implementation of AsyncLogger class
+AsyncLogger::AsyncLogger(size_t capacity) : queue(capacity), logged_count(0),
+        written_count(0), running(true){
+    writer = thread(&AsyncLogger::Run, this);
+}
+
+AsyncLogger::~AsyncLogger(){
+    Flush();
+    running.store(false, memory_order_release);
+    writer.join();
+    for(auto& sink : sinks){
+        if(sink->file != nullptr){
+            fclose(sink->file);
+        }
+    }
+}
+
+uint32_t AsyncLogger::AddSink(const string &path, LogFormat format,
+                              PriceNotation notation){
+    lock_guard<mutex> lock(sink_mutex);
+    unique_ptr<Sink> sink(new Sink());
+    sink->path = path;
+    sink->format = format;
+    sink->notation = notation;
+    sink->file = fopen(path.c_str(), "a");
+    sinks.push_back(move(sink));
+    return sinks.size() - 1;
+}
+
+void AsyncLogger::Log(const LogRecord &record){
+    logged_count.fetch_add(1, memory_order_relaxed);
+    while(!queue.TryPush(record)){
+        this_thread::yield();
+    }
+}
+
+void AsyncLogger::Flush(){
+    while(written_count.load(memory_order_acquire) !=
+          logged_count.load(memory_order_relaxed)){
+        this_thread::yield();
+    }
+}
+
+void AsyncLogger::Pause(){
+    Flush();
+    // The thread formats and writes only under the sink lock
+    sink_mutex.lock();
+}
+
+void AsyncLogger::Resume(){
+    sink_mutex.unlock();
+}
+
+void AsyncLogger::WriteBuffers(){
+    for(auto& sink : sinks){
+        if(!sink->buffer.empty() && sink->file != nullptr){
+            fwrite(sink->buffer.data(), 1, sink->buffer.size(), sink->file);
+            fflush(sink->file);
+        }
+        sink->buffer.clear();
+    }
+}
+
+void AsyncLogger::Run(){
+    LogRecord record;
+    uint64_t formatted_count = 0;
+    while(running.load(memory_order_acquire)){
+        if(!queue.TryPop(record)){
+            // Idle, write out what is buffered and back off
+            if(formatted_count != written_count.load(memory_order_relaxed)){
+                lock_guard<mutex> lock(sink_mutex);
+                WriteBuffers();
+                written_count.store(formatted_count, memory_order_release);
+            }
+            else{
+                this_thread::sleep_for(chrono::microseconds(100));
+            }
+            continue;
+        }
+        {
+            lock_guard<mutex> lock(sink_mutex);
+            Sink& sink = *sinks[record.sink];
+            formatter.Format(record, sink.format, sink.notation, sink.buffer);
+            if(sink.buffer.size() >= (1 << 16) && sink.file != nullptr){
+                fwrite(sink.buffer.data(), 1, sink.buffer.size(), sink.file);
+                sink.buffer.clear();
+            }
+        }
+        ++formatted_count;
+    }
+}
+
+
+//
+// Implementation of LogOutput class
+LogOutput::LogOutput(const string &_path){
+    path = _path;
+    logger = nullptr;
+    sink = 0;
+}
+
+void LogOutput::SetLogger(AsyncLogger* _logger, LogFormat format, PriceNotation notation){
+    logger = _logger;
+    sink = logger->AddSink(path, format, notation);
+}
+
+void LogOutput::Log(LogRecord *records, size_t count){
+    if(logger != nullptr){
+        for(size_t i = 0; i < count; ++i){
+            records[i].sink = sink;
+            logger->Log(records[i]);
+        }
+    }
+    else{
+        LogFormatter::Write(path, records, count);
+    }
+}
+
+#endif //TRADING_SYSTEM_ASYNC_LOGGER_HPP
@@ -0,0 +1,591 @@
+/**
+ * block_codec.hpp
+ * Defines a compact block format for the historical output: rows are delta
+ * encoded per product (prices in 1/256 ticks, quantities as varints, other
+ * doubles xor-ed with the previous value) and each block is optionally
+ * compressed with a small LZ77 codec. A streaming reader decodes the blocks
+ * back one row at a time.
+ *
+ * A file is [magic][field count][field types] followed by blocks of
+ * [magic][compression][rows][raw size][stored size][crc32][bytes].
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_BLOCK_CODEC_HPP
+#define TRADING_SYSTEM_BLOCK_CODEC_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "journal.hpp"
+#include "timeseries_store.hpp"
+
+using namespace std;
+
+// Encodings of the fields of a row
+enum BlockFieldType : uint8_t { TICK_FIELD = 1, INTEGER_FIELD, DOUBLE_FIELD };
+
+// Compression of the bytes of a block
+enum BlockCompression : uint8_t { NO_COMPRESSION = 0, LZ_COMPRESSION = 1 };
+
+const uint32_t BLOCK_FILE_MAGIC = 0x46434254;   // "TBCF"
+const uint32_t BLOCK_MAGIC = 0x4B4C4254;        // "TBLK"
+// Price ticks per point of the tick fields
+const double BLOCK_TICKS_PER_POINT = 256.0;
+
+
+/**
+ * LZ77 codec in the spirit of LZ4: sequences of a token, literals and a
+ * back reference of at least four bytes within the last 64KB.
+ */
+class LzCodec{
+private:
+    static void PutLength(string &out, size_t length);
+
+    static bool GetLength(const char *&in, const char *end, size_t &length);
+
+    static void PutSequence(string &out, const char *literals, size_t literal_length,
+                            size_t offset, size_t match_length);
+
+public:
+    // Append the compressed bytes of the input to out
+    static void Compress(const char *in, size_t size, string &out);
+
+    // Decompress into out, false if the input is malformed or does not
+    // expand to raw_size bytes
+    static bool Decompress(const char *in, size_t size, size_t raw_size, string &out);
+
+};
+
+
+/**
+ * One decoded row: a product, a time stamp in nanoseconds and its fields.
+ */
+struct BlockRow{
+    string product_id;
+    int64_t time;
+    vector<double> values;
+};
+
+
+/**
+ * Encodes rows into the bytes of a block. Deltas restart every block, so a
+ * block decodes on its own.
+ */
+class BlockEncoder{
+private:
+    vector<BlockFieldType> fields;
+    string bytes;
+    size_t row_count;
+    int64_t last_time;
+    // product -> index into the per-product state
+    map<string, size_t> product_indices;
+    vector<vector<int64_t>> last_values;
+
+public:
+    // ctor
+    BlockEncoder(const vector<BlockFieldType> &_fields);
+
+    void Add(const string &product_id, int64_t time, const double *values);
+
+    size_t GetRowCount() const;
+
+    const string& GetBytes() const;
+
+    void Clear();
+
+};
+
+
+/**
+ * Decodes the rows of a block, in the order they were added.
+ */
+class BlockDecoder{
+private:
+    vector<BlockFieldType> fields;
+    const char* position;
+    const char* end;
+    size_t rows_left;
+    int64_t last_time;
+    vector<string> product_ids;
+    vector<vector<int64_t>> last_values;
+
+public:
+    // ctor
+    BlockDecoder(const vector<BlockFieldType> &_fields, const char *data, size_t size,
+                 size_t row_count);
+
+    // Next row, false at the end of the block or on malformed bytes
+    bool Next(BlockRow &row);
+
+};
+
+
+/**
+ * Appends rows to a block file, writing a block every rows_per_block rows.
+ */
+class CompressedBlockWriter{
+private:
+    ofstream output;
+    BlockEncoder encoder;
+    BlockCompression compression;
+    size_t rows_per_block;
+    string stored;
+
+public:
+    // ctor, appends to the file at path
+    CompressedBlockWriter(const string &path, const vector<BlockFieldType> &fields,
+                          BlockCompression _compression = LZ_COMPRESSION,
+                          size_t _rows_per_block = 4096);
+
+    // Writes the last partial block
+    ~CompressedBlockWriter();
+
+    void Append(const string &product_id, int64_t time, const double *values);
+
+    // Write the rows added so far as a block
+    void Flush();
+
+};
+
+
+/**
+ * Streaming reader of a block file, holding one block at a time.
+ */
+class CompressedBlockReader{
+private:
+    ifstream input;
+    vector<BlockFieldType> fields;
+    string stored;
+    string raw;
+    unique_ptr<BlockDecoder> decoder;
+
+    bool ReadBlock();
+
+public:
+    // ctor, reads the file header
+    CompressedBlockReader(const string &path);
+
+    const vector<BlockFieldType>& GetFields() const;
+
+    // Next row of the file, false at its end or at a corrupt block
+    bool Next(BlockRow &row);
+
+};
+
+
+/**
+ * Field encodings of each type written to a block file, in the column order
+ * of its TimeSeriesCodec.
+ * Type V is the data type.
+ */
+template<typename V>
+struct BlockSchema;
+
+template<typename T>
+struct BlockSchema<PriceStream<T>>{
+    static vector<BlockFieldType> Fields(){
+        return {TICK_FIELD, TICK_FIELD, INTEGER_FIELD, INTEGER_FIELD,
+                INTEGER_FIELD, INTEGER_FIELD};
+    }
+};
+
+template<typename T>
+struct BlockSchema<PV01<T>>{
+    static vector<BlockFieldType> Fields(){
+        return {DOUBLE_FIELD, INTEGER_FIELD};
+    }
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+// Varints of seven bits per byte, signed values zigzag encoded
+void PutVarint(string &out, uint64_t value){
+    while(value >= 0x80){
+        out.push_back((char) (value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char) value);
+}
+
+bool GetVarint(const char *&in, const char *end, uint64_t &value){
+    value = 0;
+    for(int shift = 0; shift < 64 && in < end; shift += 7){
+        uint8_t byte = *in++;
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if(byte < 0x80){
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t ZigZagEncode(int64_t value){
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value){
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+
+//
+// Implementation of LzCodec class
+void LzCodec::PutLength(string &out, size_t length){
+    while(length >= 255){
+        out.push_back((char) 255);
+        length -= 255;
+    }
+    out.push_back((char) length);
+}
+
+bool LzCodec::GetLength(const char *&in, const char *end, size_t &length){
+    uint8_t byte = 255;
+    while(byte == 255){
+        if(in >= end){
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    }
+    return true;
+}
+
+void LzCodec::PutSequence(string &out, const char *literals, size_t literal_length,
+                          size_t offset, size_t match_length){
+    // Token: literal length in the high nibble, match length - 4 in the low
+    size_t match_code = (offset == 0) ? 0 : match_length - 4;
+    out.push_back((char) ((min<size_t>(literal_length, 15) << 4) |
+                          min<size_t>(match_code, 15)));
+    if(literal_length >= 15){
+        PutLength(out, literal_length - 15);
+    }
+    out.append(literals, literal_length);
+    if(offset == 0){
+        return;
+    }
+    out.push_back((char) (offset & 0xFF));
+    out.push_back((char) (offset >> 8));
+    if(match_code >= 15){
+        PutLength(out, match_code - 15);
+    }
+}
+
+void LzCodec::Compress(const char *in, size_t size, string &out){
+    const int HASH_BITS = 13;
+    const size_t MAX_OFFSET = 65535;
+    vector<int64_t> table(1 << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t i = 0;
+    while(i + 4 <= size){
+        uint32_t sequence;
+        memcpy(&sequence, in + i, 4);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        int64_t candidate = table[hash];
+        table[hash] = i;
+        if(candidate < 0 || i - candidate > MAX_OFFSET ||
+           memcmp(in + candidate, in + i, 4) != 0){
+            ++i;
+            continue;
+        }
+        size_t match_length = 4;
+        while(i + match_length < size && in[candidate + match_length] == in[i + match_length]){
+            ++match_length;
+        }
+        PutSequence(out, in + anchor, i - anchor, i - candidate, match_length);
+        i += match_length;
+        anchor = i;
+    }
+    // The last sequence carries the remaining literals only
+    PutSequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+bool LzCodec::Decompress(const char *in, size_t size, size_t raw_size, string &out){
+    const char* end = in + size;
+    out.clear();
+    out.reserve(raw_size);
+    while(in < end){
+        uint8_t token = *in++;
+        size_t literal_length = token >> 4;
+        if(literal_length == 15 && !GetLength(in, end, literal_length)){
+            return false;
+        }
+        if((size_t) (end - in) < literal_length || out.size() + literal_length > raw_size){
+            return false;
+        }
+        out.append(in, literal_length);
+        in += literal_length;
+        if(in == end){
+            break;
+        }
+        if(end - in < 2){
+            return false;
+        }
+        size_t offset = (uint8_t) in[0] | ((size_t) (uint8_t) in[1] << 8);
+        in += 2;
+        size_t match_length = token & 0x0F;
+        if(match_length == 15 && !GetLength(in, end, match_length)){
+            return false;
+        }
+        match_length += 4;
+        if(offset == 0 || offset > out.size() || out.size() + match_length > raw_size){
+            return false;
+        }
+        // Byte by byte, the match may overlap the bytes it produces
+        size_t from = out.size() - offset;
+        for(size_t k = 0; k < match_length; ++k){
+            out.push_back(out[from + k]);
+        }
+    }
+    return out.size() == raw_size;
+}
+
+
+//
+// Implementation of BlockEncoder class
+BlockEncoder::BlockEncoder(const vector<BlockFieldType> &_fields){
+    fields = _fields;
+    Clear();
+}
+
+void BlockEncoder::Add(const string &product_id, int64_t time, const double *values){
+    auto found = product_indices.find(product_id);
+    if(found == product_indices.end()){
+        // A new product index is followed by the product identifier
+        found = product_indices.insert(make_pair(product_id, last_values.size())).first;
+        last_values.emplace_back(fields.size(), 0);
+        PutVarint(bytes, found->second);
+        PutVarint(bytes, product_id.size());
+        bytes.append(product_id);
+    }
+    else{
+        PutVarint(bytes, found->second);
+    }
+    PutVarint(bytes, ZigZagEncode(time - last_time));
+    last_time = time;
+    vector<int64_t>& last = last_values[found->second];
+    for(size_t i = 0; i < fields.size(); ++i){
+        int64_t value;
+        switch(fields[i]){
+            case TICK_FIELD:
+                value = llround(values[i] * BLOCK_TICKS_PER_POINT);
+                PutVarint(bytes, ZigZagEncode(value - last[i]));
+                break;
+            case INTEGER_FIELD:
+                value = llround(values[i]);
+                PutVarint(bytes, ZigZagEncode(value - last[i]));
+                break;
+            default:{
+                memcpy(&value, &values[i], sizeof(value));
+                uint64_t changed = (uint64_t) (value ^ last[i]);
+                bytes.append((const char*) &changed, sizeof(changed));
+                break;
+            }
+        }
+        last[i] = value;
+    }
+    ++row_count;
+}
+
+size_t BlockEncoder::GetRowCount() const{
+    return row_count;
+}
+
+const string& BlockEncoder::GetBytes() const{
+    return bytes;
+}
+
+void BlockEncoder::Clear(){
+    bytes.clear();
+    row_count = 0;
+    last_time = 0;
+    product_indices.clear();
+    last_values.clear();
+}
+
+
+//
+// Implementation of BlockDecoder class
+BlockDecoder::BlockDecoder(const vector<BlockFieldType> &_fields, const char *data,
+                           size_t size, size_t row_count){
+    fields = _fields;
+    position = data;
+    end = data + size;
+    rows_left = row_count;
+    last_time = 0;
+}
+
+bool BlockDecoder::Next(BlockRow &row){
+    if(rows_left == 0){
+        return false;
+    }
+    uint64_t index;
+    if(!GetVarint(position, end, index) || index > product_ids.size()){
+        return false;
+    }
+    if(index == product_ids.size()){
+        uint64_t length;
+        if(!GetVarint(position, end, length) || (uint64_t) (end - position) < length){
+            return false;
+        }
+        product_ids.emplace_back(position, length);
+        last_values.emplace_back(fields.size(), 0);
+        position += length;
+    }
+    uint64_t time_delta;
+    if(!GetVarint(position, end, time_delta)){
+        return false;
+    }
+    last_time += ZigZagDecode(time_delta);
+    row.product_id = product_ids[index];
+    row.time = last_time;
+    row.values.resize(fields.size());
+    vector<int64_t>& last = last_values[index];
+    for(size_t i = 0; i < fields.size(); ++i){
+        if(fields[i] == DOUBLE_FIELD){
+            uint64_t changed;
+            if(end - position < (ptrdiff_t) sizeof(changed)){
+                return false;
+            }
+            memcpy(&changed, position, sizeof(changed));
+            position += sizeof(changed);
+            last[i] ^= (int64_t) changed;
+            memcpy(&row.values[i], &last[i], sizeof(double));
+            continue;
+        }
+        uint64_t delta;
+        if(!GetVarint(position, end, delta)){
+            return false;
+        }
+        last[i] += ZigZagDecode(delta);
+        row.values[i] = (fields[i] == TICK_FIELD) ?
+                last[i] / BLOCK_TICKS_PER_POINT : (double) last[i];
+    }
+    --rows_left;
+    return true;
+}
+
+
+//
+// Implementation of CompressedBlockWriter class
+CompressedBlockWriter::CompressedBlockWriter(const string &path,
+        const vector<BlockFieldType> &fields, BlockCompression _compression,
+        size_t _rows_per_block) : encoder(fields){
+    compression = _compression;
+    rows_per_block = max<size_t>(1, _rows_per_block);
+    struct stat file_stat;
+    bool empty = stat(path.c_str(), &file_stat) != 0 || file_stat.st_size == 0;
+    output.open(path, ios_base::binary | ios_base::app);
+    if(empty){
+        uint32_t field_count = fields.size();
+        output.write((const char*) &BLOCK_FILE_MAGIC, sizeof(BLOCK_FILE_MAGIC));
+        output.write((const char*) &field_count, sizeof(field_count));
+        output.write((const char*) fields.data(), fields.size());
+    }
+}
+
+CompressedBlockWriter::~CompressedBlockWriter(){
+    Flush();
+}
+
+void CompressedBlockWriter::Append(const string &product_id, int64_t time,
+                                   const double *values){
+    encoder.Add(product_id, time, values);
+    if(encoder.GetRowCount() >= rows_per_block){
+        Flush();
+    }
+}
+
+void CompressedBlockWriter::Flush(){
+    if(encoder.GetRowCount() == 0){
+        return;
+    }
+    const string& raw = encoder.GetBytes();
+    stored.clear();
+    BlockCompression block_compression = compression;
+    if(compression == LZ_COMPRESSION){
+        LzCodec::Compress(raw.data(), raw.size(), stored);
+        // Keep incompressible blocks as they are
+        if(stored.size() >= raw.size()){
+            block_compression = NO_COMPRESSION;
+        }
+    }
+    if(block_compression == NO_COMPRESSION){
+        stored = raw;
+    }
+    uint32_t header[5] = {BLOCK_MAGIC, (uint32_t) encoder.GetRowCount(),
+                          (uint32_t) raw.size(), (uint32_t) stored.size(),
+                          Crc32(stored.data(), stored.size())};
+    output.write((const char*) &header[0], sizeof(uint32_t));
+    output.put((char) block_compression);
+    output.write((const char*) &header[1], 4 * sizeof(uint32_t));
+    output.write(stored.data(), stored.size());
+    output.flush();
+    encoder.Clear();
+}
+
+
+//
+// Implementation of CompressedBlockReader class
+CompressedBlockReader::CompressedBlockReader(const string &path){
+    input.open(path, ios_base::binary);
+    uint32_t magic = 0;
+    uint32_t field_count = 0;
+    input.read((char*) &magic, sizeof(magic));
+    input.read((char*) &field_count, sizeof(field_count));
+    if(!input || magic != BLOCK_FILE_MAGIC || field_count > 256){
+        input.setstate(ios_base::failbit);
+        return;
+    }
+    fields.resize(field_count);
+    input.read((char*) fields.data(), field_count);
+}
+
+const vector<BlockFieldType>& CompressedBlockReader::GetFields() const{
+    return fields;
+}
+
+bool CompressedBlockReader::ReadBlock(){
+    uint32_t magic = 0;
+    char block_compression = 0;
+    uint32_t header[4];
+    input.read((char*) &magic, sizeof(magic));
+    input.get(block_compression);
+    input.read((char*) header, sizeof(header));
+    if(!input || magic != BLOCK_MAGIC){
+        return false;
+    }
+    stored.resize(header[2]);
+    input.read(&stored[0], stored.size());
+    if(!input || Crc32(stored.data(), stored.size()) != header[3]){
+        return false;
+    }
+    if(block_compression == LZ_COMPRESSION){
+        if(!LzCodec::Decompress(stored.data(), stored.size(), header[1], raw)){
+            return false;
+        }
+    }
+    else{
+        raw.swap(stored);
+    }
+    decoder.reset(new BlockDecoder(fields, raw.data(), raw.size(), header[0]));
+    return true;
+}
+
+bool CompressedBlockReader::Next(BlockRow &row){
+    while(!decoder || !decoder->Next(row)){
+        if(!input || !ReadBlock()){
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif //TRADING_SYSTEM_BLOCK_CODEC_HPP
@@ -9,6 +9,7 @@
 #ifndef TRADING_SYSTEM_DATA_GENERATOR_HPP
 #define TRADING_SYSTEM_DATA_GENERATOR_HPP
 
+#include <functional>
 #include <vector>
 #include <string>
 #include <fstream>
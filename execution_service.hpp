@@ -31,7 +31,7 @@ private:
     PricingSide side;
     string orderId;
     OrderType orderType;
-    double price;
+    PriceTicks price;
     double visibleQuantity;
     double hiddenQuantity;
     string parentOrderId;
@@ -42,7 +42,7 @@ public:
     // ctor for an order
     ExecutionOrder();
     ExecutionOrder(const T &_product, PricingSide _side, string _orderId,
-            OrderType _orderType, double _price, double _visibleQuantity,
+            OrderType _orderType, PriceTicks _price, double _visibleQuantity,
             double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
 
     // Get the product
@@ -57,7 +57,7 @@ public:
     OrderType GetOrderType() const;
 
     // Get the price on this order
-    double GetPrice() const;
+    PriceTicks GetPrice() const;
 
     // Get the visible quantity on this order
     long GetVisibleQuantity() const;
@@ -71,6 +71,10 @@ public:
     // Is child order?
     bool IsChildOrder() const;
 
+    // Take the fields of an order of the same product, the product itself
+    // is not copied
+    void Update(const ExecutionOrder<T> &other);
+
 };
 
 
@@ -87,6 +91,7 @@ public:
     // ctors
     AlgoExecution();
     AlgoExecution(const ExecutionOrder<T> &execution_order);
+    AlgoExecution(ExecutionOrder<T> &&execution_order);
     
     // getters
     const ExecutionOrder<T>& GetExecutionOrder() const;
@@ -105,26 +110,41 @@ class ExecutionService : public Service<string,ExecutionOrder <T> >
 private:
     map<string, ExecutionOrder<T>> execution_data;
     vector<ServiceListener<ExecutionOrder<T>> *> service_listeners;
-    ExecutionService();
+    Connector<ExecutionOrder<T>>* connector;
+
+    // Record an order as executed and notify the listeners
+    void Fill(const ExecutionOrder<T>& order);
 
 public:
-    static ExecutionService* GenerateInstance(){
-        static ExecutionService instance;
-        return &instance;
-    }
+    // ctor
+    ExecutionService();
+
+    // Instance owned by the default ServiceContext
+    static ExecutionService* GenerateInstance();
  
     // Override virtual functions in base class Service
-    ExecutionOrder<T>& GetData(string key) override;
+    ExecutionOrder<T>& GetData(const string &key) override;
 
+    // A fill of an order sent through the connector
     void OnMessage(ExecutionOrder<T> &data) override;
 
     void AddListener(ServiceListener<ExecutionOrder<T>>* listener) override;
 
     const vector<ServiceListener<ExecutionOrder<T>>*>& GetListeners() const override;
 
-    // Execute an order on a market
+    // Execute an order on a market, through the connector if one is set,
+    // whose fills come back by OnMessage, or at once otherwise
     void ExecuteOrder(const ExecutionOrder<T>& order, Market market);
 
+    // Send orders out through connector, nullptr executes them locally
+    void SetConnector(Connector<ExecutionOrder<T>>* _connector);
+
+    // Restore the last order of a product, listeners are not notified
+    void RestoreExecutionOrder(const ExecutionOrder<T>& order);
+
+    // Last order executed on each product
+    const map<string, ExecutionOrder<T>>& GetExecutionOrders() const;
+
 };
 
 
@@ -132,13 +152,13 @@ template <typename T>
 class ExecutionServiceListener : public ServiceListener<AlgoExecution<T> > {
 private:
     ExecutionService<T>* execution_service;
-    ExecutionServiceListener();
 
 public:
-    static ExecutionServiceListener* GenerateInstance(){
-        static ExecutionServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    ExecutionServiceListener(ExecutionService<T>* _execution_service);
+
+    // Instance owned by the default ServiceContext
+    static ExecutionServiceListener* GenerateInstance();
 
     // Override virtual functions in base class Service
     void ProcessAdd(AlgoExecution<T> & data) override;
@@ -163,16 +183,17 @@ class AlgoExecutionService : Service<string, AlgoExecution<T>> {
 private:
     map<string, AlgoExecution<T>> algo_execution_data;
     vector<ServiceListener<AlgoExecution<T>> *> service_listeners;
-    AlgoExecutionService();
+    int order_count;
 
 public:
-    static AlgoExecutionService* GenerateInstance(){
-        static AlgoExecutionService instance;
-        return &instance;
-    }
+    // ctor
+    AlgoExecutionService();
+
+    // Instance owned by the default ServiceContext
+    static AlgoExecutionService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    AlgoExecution<T>& GetData(string key) override;
+    AlgoExecution<T>& GetData(const string &key) override;
 
     void OnMessage(AlgoExecution<T> &data) override;
 
@@ -193,13 +214,13 @@ template <typename T>
 class AlgoExecutionServiceListener : public ServiceListener<OrderBook<T> > {
 private:
     AlgoExecutionService<T>* algo_execution_service;
-    AlgoExecutionServiceListener();
 
 public:
-    static AlgoExecutionServiceListener* GenerateInstance(){
-        static AlgoExecutionServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    AlgoExecutionServiceListener(AlgoExecutionService<T>* _algo_execution_service);
+
+    // Instance owned by the default ServiceContext
+    static AlgoExecutionServiceListener* GenerateInstance();
 
     // Override virtual functions in base class Service
     void ProcessAdd(OrderBook<T> & data) override;
@@ -222,7 +243,7 @@ ExecutionOrder<T>::ExecutionOrder() : product(T())
     side = OFFER;
     orderId = "0";
     orderType = FOK;
-    price = 0;
+    price = PriceTicks();
     visibleQuantity = 0;
     hiddenQuantity = 0;
     parentOrderId = "0";
@@ -231,20 +252,32 @@ ExecutionOrder<T>::ExecutionOrder() : product(T())
 
 template<typename T>
 ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side,
-        string _orderId, OrderType _orderType, double _price,
+        string _orderId, OrderType _orderType, PriceTicks _price,
         double _visibleQuantity, double _hiddenQuantity, string _parentOrderId,
         bool _isChildOrder) : product(_product)
 {
     side = _side;
-    orderId = _orderId;
+    orderId = move(_orderId);
     orderType = _orderType;
     price = _price;
     visibleQuantity = _visibleQuantity;
     hiddenQuantity = _hiddenQuantity;
-    parentOrderId = _parentOrderId;
+    parentOrderId = move(_parentOrderId);
     isChildOrder = _isChildOrder;
 }
 
+template<typename T>
+void ExecutionOrder<T>::Update(const ExecutionOrder<T> &other){
+    side = other.side;
+    orderId = other.orderId;
+    orderType = other.orderType;
+    price = other.price;
+    visibleQuantity = other.visibleQuantity;
+    hiddenQuantity = other.hiddenQuantity;
+    parentOrderId = other.parentOrderId;
+    isChildOrder = other.isChildOrder;
+}
+
 template<typename T>
 const PricingSide& ExecutionOrder<T>::GetSide() const {
     return side;
@@ -269,7 +302,7 @@ OrderType ExecutionOrder<T>::GetOrderType() const
 }
 
 template<typename T>
-double ExecutionOrder<T>::GetPrice() const
+PriceTicks ExecutionOrder<T>::GetPrice() const
 {
     return price;
 }
@@ -312,6 +345,12 @@ AlgoExecution<T>::AlgoExecution(const ExecutionOrder<T> &execution_order) : exec
 
 }
 
+template<typename T>
+AlgoExecution<T>::AlgoExecution(ExecutionOrder<T> &&execution_order) : execution_order(
+        move(execution_order)) {
+
+}
+
 template<typename T>
 const ExecutionOrder<T>& AlgoExecution<T>::GetExecutionOrder() const{
     return execution_order;
@@ -322,17 +361,17 @@ const ExecutionOrder<T>& AlgoExecution<T>::GetExecutionOrder() const{
 // Implementation of ExecutionService class
 template <typename T>
 ExecutionService<T>::ExecutionService(){
-
+    connector = nullptr;
 }
 
 template <typename T>
-ExecutionOrder<T>& ExecutionService<T>::GetData(string key) {
+ExecutionOrder<T>& ExecutionService<T>::GetData(const string &key) {
     return execution_data[key];
 }
 
 template <typename T>
 void ExecutionService<T>::OnMessage(ExecutionOrder<T> &data) {
-
+    Fill(data);
 }
 
 template <typename T>
@@ -346,25 +385,53 @@ const vector<ServiceListener<ExecutionOrder<T>>*>& ExecutionService<T>::GetListe
 }
 
 template <typename T>
-void ExecutionService<T>::ExecuteOrder(const ExecutionOrder<T>& order, Market market){
-    const string product_id = order.GetProduct().GetProductId();
-    if (execution_data.find(product_id) == execution_data.end()) {
-        execution_data.insert(make_pair(product_id, order));
+void ExecutionService<T>::ExecuteOrder(const ExecutionOrder<T>& order, Market){
+    INSTRUMENT_SCOPE("ExecutionService");
+    if (connector != nullptr) {
+        // The order stays with its AlgoExecution for the listeners after this one
+        ExecutionOrder<T> outgoing(order);
+        connector->Publish(outgoing);
+        return;
+    }
+    Fill(order);
+}
+
+template <typename T>
+void ExecutionService<T>::Fill(const ExecutionOrder<T>& order){
+    const string& product_id = order.GetProduct().GetProductId();
+    auto stored = execution_data.find(product_id);
+    if (stored == execution_data.end()) {
+        stored = execution_data.insert(make_pair(product_id, order)).first;
     }
     else {
-        execution_data[product_id] = order;
+        stored->second.Update(order);
     }
     for (auto& listener : service_listeners) {
-        listener->ProcessAdd(execution_data[product_id]);
+        listener->ProcessAdd(stored->second);
     }
 }
 
+template <typename T>
+void ExecutionService<T>::SetConnector(Connector<ExecutionOrder<T>>* _connector){
+    connector = _connector;
+}
+
+template <typename T>
+void ExecutionService<T>::RestoreExecutionOrder(const ExecutionOrder<T>& order){
+    execution_data[order.GetProduct().GetProductId()] = order;
+}
+
+template <typename T>
+const map<string, ExecutionOrder<T>>& ExecutionService<T>::GetExecutionOrders() const{
+    return execution_data;
+}
+
 
 //
 // Implementation of ExecutionServiceListener class
 template <typename T>
-ExecutionServiceListener<T>::ExecutionServiceListener(){
-    execution_service = ExecutionService<T>::GenerateInstance();
+ExecutionServiceListener<T>::ExecutionServiceListener(ExecutionService<T>* _execution_service){
+    execution_service = _execution_service;
 }
 
 template <typename T>
@@ -393,10 +460,11 @@ ExecutionService<T>* ExecutionServiceListener<T>::GetService(){
 template <typename T>
 AlgoExecutionService<T>::AlgoExecutionService()
 {
+    order_count = 0;
 }
 
 template <typename T>
-AlgoExecution<T>& AlgoExecutionService<T>::GetData(string key)
+AlgoExecution<T>& AlgoExecutionService<T>::GetData(const string &key)
 {
     return algo_execution_data[key];
 }
@@ -415,19 +483,19 @@ void AlgoExecutionService<T>::AddListener(ServiceListener<AlgoExecution<T>>* lis
 template <typename T>
 void AlgoExecutionService<T>::ExecuteAlgo(const OrderBook<T> &order_book)
 {
-    static int order_count = 0;
-    T product = order_book.GetProduct();
-    string product_id = product.GetProductId();
-    double bid = order_book.GetBidStack()[0].GetPrice();
-    double ask = order_book.GetOfferStack()[0].GetPrice();
-    double spread = ask - bid;
-    if (spread <= 2.0/128.0){
+    INSTRUMENT_SCOPE("AlgoExecutionService");
+    const T& product = order_book.GetProduct();
+    PriceTicks bid = order_book.GetBidStack()[0].GetPrice();
+    PriceTicks ask = order_book.GetOfferStack()[0].GetPrice();
+    // cross the spread when it is at most 1/128th
+    PriceTicks spread = ask - bid;
+    if (spread <= PriceTicks(2 * PriceTicks::TICKS_PER_POINT / 128)){
         order_count++;
         PricingSide order_side = order_count%2 == 1 ? BID : OFFER;
         string parent_order_id = to_string(order_count) + "-" +to_string(rand()%10);
         string order_id = parent_order_id + to_string(rand()%1000000);
         OrderType order_type = MARKET;
-        double price = (order_side == OFFER) ? bid : ask;
+        PriceTicks price = (order_side == OFFER) ? bid : ask;
         double visible_quantity =  1000000;
         double hidden_quantity = 1000000;
         bool is_child_order = false;
@@ -452,8 +520,8 @@ AlgoExecutionService<T>::GetListeners() const
 
 
 template<typename T>
-AlgoExecutionServiceListener<T>::AlgoExecutionServiceListener(){
-    algo_execution_service = AlgoExecutionService<T>::GenerateInstance();
+AlgoExecutionServiceListener<T>::AlgoExecutionServiceListener(AlgoExecutionService<T>* _algo_execution_service){
+    algo_execution_service = _algo_execution_service;
 }
 
 template<typename T>
@@ -0,0 +1,538 @@
+/**
+ * feed_handler.hpp
+ * Defines the network feed protocol and FeedHandler, the receiving end of a
+ * feed of prices or order books published by FeedPublisher
+ * (feed_publisher.hpp) over UDP, unicast or multicast, or over TCP.
+ *
+ * A feed is a sequence of packets, each a FeedPacketHeader followed by
+ * record_count fixed-width binary records of RecordParser (record_parser.hpp).
+ * Packets are numbered from 1 and a packet without records ends the feed.
+ * Over UDP a packet is one datagram, over TCP packets follow each other on
+ * the stream. A UDP handler seeing a sequence gap asks the publisher's
+ * recovery port over TCP for the missed packets and applies them before the
+ * packet that showed the gap, so records are always handed over in order.
+ * When a UDP feed goes quiet before its end, the handler asks for whatever
+ * came after its last packet, in case the tail of the feed was dropped.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_FEED_HANDLER_HPP
+#define TRADING_SYSTEM_FEED_HANDLER_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "record_parser.hpp"
+#include "instrumentation.hpp"
+
+using namespace std;
+
+// Transports a feed runs over
+enum FeedTransport { UDP_FEED, TCP_FEED };
+
+// Largest packet, header included, sized to fit one Ethernet frame
+const size_t FEED_PACKET_SIZE = 1472;
+
+// Most datagrams taken by one recvmmsg call
+const int FEED_RECEIVE_BATCH = 32;
+
+// Quiet time after which a UDP handler asks for the tail of its feed
+const int64_t FEED_IDLE_NANOS = 100 * 1000 * 1000;
+
+// Longest a recovery waits to connect, or for each read and write after
+const int FEED_RECOVERY_TIMEOUT_MILLIS = 1000;
+
+
+/**
+ * Header of every packet of a feed, in host byte order.
+ */
+struct FeedPacketHeader{
+    // Bytes of the packet, header included
+    uint32_t length;
+    uint16_t record_bytes;
+    uint16_t record_count;
+    uint64_t sequence;
+    // Steady clock time the packet was sent, in nanoseconds
+    int64_t send_time;
+};
+
+
+/**
+ * Request for packets first_sequence to last_sequence of a feed, sent to
+ * the recovery port and answered with the packets still held, in order.
+ */
+struct FeedRecoveryRequest{
+    uint64_t first_sequence;
+    uint64_t last_sequence;
+};
+
+
+// Now on the clock of FeedPacketHeader::send_time
+int64_t FeedClockNanos();
+
+// IPv4 socket address of a dotted address and port, throws if malformed
+sockaddr_in FeedSocketAddress(const string &address, uint16_t port);
+
+// Read or write exactly size bytes on a stream socket, false if it ended
+bool FeedReadFully(int fd, char* data, size_t size);
+
+bool FeedWriteFully(int fd, const char* data, size_t size);
+
+
+/**
+ * Receiving end of a feed of message type V, handing each message over to
+ * a handler as Poll takes the packets in. Messages are only valid during
+ * the call, as with RecordParser.
+ * Type V is the message type.
+ */
+template<typename V>
+class FeedHandler{
+private:
+    FeedTransport transport;
+    sockaddr_in recovery_address;
+    RecordParser<V> parser;
+    int fd;
+    bool finished;
+    uint64_t next_sequence;
+    int64_t last_receive_time;
+    // Datagrams of one recvmmsg call, allocated once
+    vector<char> datagrams;
+    vector<mmsghdr> messages;
+    vector<iovec> vectors;
+    // Bytes of a TCP stream not yet making a whole packet
+    vector<char> stream_buffer;
+    size_t stream_size;
+    // Statistics
+    uint64_t packet_count;
+    uint64_t message_count;
+    uint64_t gap_count;
+    uint64_t recovered_count;
+    uint64_t lost_count;
+    uint64_t duplicate_count;
+    LatencyHistogram latency;
+
+    // Take in one packet, asking for any packets missed before it when
+    // recover is set, or counting them lost otherwise
+    template<typename Handler>
+    size_t HandlePacket(const char* packet, size_t size, bool recover, Handler &handler);
+
+    // Connect to the recovery port within FEED_RECOVERY_TIMEOUT_MILLIS,
+    // returns the socket with reads and writes timing out alike, or -1
+    int ConnectRecovery() const;
+
+    // Ask the recovery port for packets first to last and apply them
+    template<typename Handler>
+    size_t Recover(uint64_t first, uint64_t last, Handler &handler);
+
+    template<typename Handler>
+    size_t PollDatagrams(Handler &handler);
+
+    template<typename Handler>
+    size_t PollStream(Handler &handler);
+
+public:
+    // ctor, over UDP binds port on address, joining it if it is a multicast
+    // group, and recovers from recovery_address:recovery_port; over TCP
+    // connects to the publisher at address:port. Throws if the socket
+    // cannot be set up.
+    FeedHandler(FeedTransport _transport, const string &address, uint16_t port,
+                const SecurityMaster* security_master,
+                const string &_recovery_address = "127.0.0.1", uint16_t recovery_port = 0);
+    ~FeedHandler();
+    FeedHandler(const FeedHandler &) = delete;
+    FeedHandler& operator=(const FeedHandler &) = delete;
+
+    // Take in the packets waiting without blocking, returns the messages
+    // handed over
+    template<typename Handler>
+    size_t Poll(Handler &&handler);
+
+    // Socket to wait on for packets
+    int GetDescriptor() const;
+
+    // Whether the end of the feed has been taken in
+    bool IsFinished() const;
+
+    uint64_t GetPacketCount() const;
+
+    uint64_t GetMessageCount() const;
+
+    // Sequence gaps seen, packets recovered and packets lost for good
+    uint64_t GetGapCount() const;
+
+    uint64_t GetRecoveredCount() const;
+
+    uint64_t GetLostCount() const;
+
+    // Packet latency from send to receipt in nanoseconds
+    const LatencyHistogram& GetLatency() const;
+
+    // Write the statistics of the feed as one line
+    void PrintStatistics(ostream &stream, const string &name, double seconds) const;
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of the feed helpers
+int64_t FeedClockNanos(){
+    return chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+sockaddr_in FeedSocketAddress(const string &address, uint16_t port){
+    sockaddr_in socket_address{};
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &socket_address.sin_addr) != 1) {
+        throw runtime_error("Feed: bad address " + address);
+    }
+    return socket_address;
+}
+
+bool FeedReadFully(int fd, char* data, size_t size){
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+bool FeedWriteFully(int fd, const char* data, size_t size){
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+
+//
+// Implementation of FeedHandler class
+template<typename V>
+FeedHandler<V>::FeedHandler(FeedTransport _transport, const string &address, uint16_t port,
+        const SecurityMaster* security_master, const string &_recovery_address,
+        uint16_t recovery_port) : parser(security_master, BINARY_RECORDS){
+    transport = _transport;
+    recovery_address = FeedSocketAddress(_recovery_address, recovery_port);
+    finished = false;
+    next_sequence = 1;
+    last_receive_time = FeedClockNanos();
+    stream_size = 0;
+    packet_count = 0;
+    message_count = 0;
+    gap_count = 0;
+    recovered_count = 0;
+    lost_count = 0;
+    duplicate_count = 0;
+    sockaddr_in socket_address = FeedSocketAddress(address, port);
+    if (transport == UDP_FEED) {
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int enable = 1;
+        int receive_buffer = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+        bool multicast = IN_MULTICAST(ntohl(socket_address.sin_addr.s_addr));
+        sockaddr_in bind_address = socket_address;
+        if (multicast) {
+            bind_address.sin_addr.s_addr = htonl(INADDR_ANY);
+        }
+        if (fd < 0 || bind(fd, (sockaddr*) &bind_address, sizeof(bind_address)) < 0) {
+            throw runtime_error("FeedHandler: cannot bind " + address + ": " + strerror(errno));
+        }
+        if (multicast) {
+            ip_mreq membership{};
+            membership.imr_multiaddr = socket_address.sin_addr;
+            membership.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership,
+                           sizeof(membership)) < 0) {
+                throw runtime_error("FeedHandler: cannot join " + address);
+            }
+        }
+        datagrams.resize(FEED_RECEIVE_BATCH * FEED_PACKET_SIZE);
+        messages.resize(FEED_RECEIVE_BATCH);
+        vectors.resize(FEED_RECEIVE_BATCH);
+        for (int i = 0; i < FEED_RECEIVE_BATCH; ++i) {
+            vectors[i].iov_base = &datagrams[i * FEED_PACKET_SIZE];
+            vectors[i].iov_len = FEED_PACKET_SIZE;
+            messages[i].msg_hdr = msghdr{};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+    else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (sockaddr*) &socket_address, sizeof(socket_address)) < 0) {
+            throw runtime_error("FeedHandler: cannot connect " + address + ": " + strerror(errno));
+        }
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        stream_buffer.resize(16 * FEED_PACKET_SIZE);
+    }
+}
+
+template<typename V>
+FeedHandler<V>::~FeedHandler(){
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+template<typename V>
+template<typename Handler>
+size_t FeedHandler<V>::HandlePacket(const char* packet, size_t size, bool recover,
+        Handler &handler){
+    FeedPacketHeader header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, packet, sizeof(header));
+    if (header.length != size || header.record_bytes != RecordParser<V>::RECORD_BYTES ||
+        sizeof(header) + (size_t) header.record_count * header.record_bytes != size) {
+        return 0;
+    }
+    if (header.sequence < next_sequence) {
+        ++duplicate_count;
+        return 0;
+    }
+    size_t handed = 0;
+    if (header.sequence > next_sequence) {
+        if (recover) {
+            ++gap_count;
+            handed += Recover(next_sequence, header.sequence - 1, handler);
+        }
+        if (header.sequence > next_sequence) {
+            lost_count += header.sequence - next_sequence;
+            next_sequence = header.sequence;
+        }
+    }
+    next_sequence = header.sequence + 1;
+    ++packet_count;
+    latency.Record((uint64_t) max<int64_t>(0, FeedClockNanos() - header.send_time));
+    if (header.record_count == 0) {
+        finished = true;
+        return handed;
+    }
+    size_t parsed = parser.Parse(packet + sizeof(header), size - sizeof(header), handler);
+    message_count += parsed;
+    return handed + parsed;
+}
+
+template<typename V>
+int FeedHandler<V>::ConnectRecovery() const{
+    int recovery_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (recovery_fd < 0) {
+        return -1;
+    }
+    bool connected =
+            connect(recovery_fd, (sockaddr*) &recovery_address, sizeof(recovery_address)) == 0;
+    if (!connected && errno == EINPROGRESS) {
+        pollfd waiting{recovery_fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t error_size = sizeof(error);
+        connected = poll(&waiting, 1, FEED_RECOVERY_TIMEOUT_MILLIS) == 1 &&
+                    getsockopt(recovery_fd, SOL_SOCKET, SO_ERROR, &error, &error_size) == 0 &&
+                    error == 0;
+    }
+    if (!connected) {
+        close(recovery_fd);
+        return -1;
+    }
+    // Blocking again, a publisher gone quiet fails the read or write instead
+    fcntl(recovery_fd, F_SETFL, fcntl(recovery_fd, F_GETFL) & ~O_NONBLOCK);
+    timeval timeout{FEED_RECOVERY_TIMEOUT_MILLIS / 1000,
+                    FEED_RECOVERY_TIMEOUT_MILLIS % 1000 * 1000};
+    setsockopt(recovery_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(recovery_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    return recovery_fd;
+}
+
+template<typename V>
+template<typename Handler>
+size_t FeedHandler<V>::Recover(uint64_t first, uint64_t last, Handler &handler){
+    if (recovery_address.sin_port == 0) {
+        return 0;
+    }
+    int recovery_fd = ConnectRecovery();
+    if (recovery_fd < 0) {
+        return 0;
+    }
+    size_t handed = 0;
+    FeedRecoveryRequest request{first, last};
+    if (FeedWriteFully(recovery_fd, (const char*) &request, sizeof(request))) {
+        char packet[FEED_PACKET_SIZE];
+        FeedPacketHeader header;
+        while (FeedReadFully(recovery_fd, packet, sizeof(header))) {
+            memcpy(&header, packet, sizeof(header));
+            if (header.length < sizeof(header) || header.length > FEED_PACKET_SIZE ||
+                !FeedReadFully(recovery_fd, packet + sizeof(header),
+                               header.length - sizeof(header))) {
+                break;
+            }
+            uint64_t before = packet_count;
+            handed += HandlePacket(packet, header.length, false, handler);
+            recovered_count += packet_count - before;
+        }
+    }
+    close(recovery_fd);
+    return handed;
+}
+
+template<typename V>
+template<typename Handler>
+size_t FeedHandler<V>::PollDatagrams(Handler &handler){
+    size_t handed = 0;
+    while (!finished) {
+        int count = recvmmsg(fd, messages.data(), FEED_RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) {
+            break;
+        }
+        last_receive_time = FeedClockNanos();
+        for (int i = 0; i < count; ++i) {
+            handed += HandlePacket(&datagrams[i * FEED_PACKET_SIZE], messages[i].msg_len,
+                                   true, handler);
+        }
+        if (count < FEED_RECEIVE_BATCH) {
+            break;
+        }
+    }
+    // A quiet feed may have lost its tail, ask for anything after the last packet
+    int64_t now = FeedClockNanos();
+    if (!finished && now - last_receive_time > FEED_IDLE_NANOS) {
+        last_receive_time = now;
+        handed += Recover(next_sequence, UINT64_MAX, handler);
+    }
+    return handed;
+}
+
+template<typename V>
+template<typename Handler>
+size_t FeedHandler<V>::PollStream(Handler &handler){
+    size_t handed = 0;
+    while (!finished) {
+        ssize_t received = recv(fd, &stream_buffer[stream_size],
+                                stream_buffer.size() - stream_size, MSG_DONTWAIT);
+        if (received == 0) {
+            finished = true;
+            break;
+        }
+        if (received < 0) {
+            break;
+        }
+        stream_size += received;
+        size_t offset = 0;
+        FeedPacketHeader header;
+        while (stream_size - offset >= sizeof(header)) {
+            memcpy(&header, &stream_buffer[offset], sizeof(header));
+            if (header.length < sizeof(header) || header.length > FEED_PACKET_SIZE) {
+                // Not a feed, drop the stream
+                finished = true;
+                return handed;
+            }
+            if (stream_size - offset < header.length) {
+                break;
+            }
+            handed += HandlePacket(&stream_buffer[offset], header.length, false, handler);
+            offset += header.length;
+        }
+        memmove(stream_buffer.data(), &stream_buffer[offset], stream_size - offset);
+        stream_size -= offset;
+    }
+    return handed;
+}
+
+template<typename V>
+template<typename Handler>
+size_t FeedHandler<V>::Poll(Handler &&handler){
+    if (finished) {
+        return 0;
+    }
+    return (transport == UDP_FEED) ? PollDatagrams(handler) : PollStream(handler);
+}
+
+template<typename V>
+int FeedHandler<V>::GetDescriptor() const{
+    return fd;
+}
+
+template<typename V>
+bool FeedHandler<V>::IsFinished() const{
+    return finished;
+}
+
+template<typename V>
+uint64_t FeedHandler<V>::GetPacketCount() const{
+    return packet_count;
+}
+
+template<typename V>
+uint64_t FeedHandler<V>::GetMessageCount() const{
+    return message_count;
+}
+
+template<typename V>
+uint64_t FeedHandler<V>::GetGapCount() const{
+    return gap_count;
+}
+
+template<typename V>
+uint64_t FeedHandler<V>::GetRecoveredCount() const{
+    return recovered_count;
+}
+
+template<typename V>
+uint64_t FeedHandler<V>::GetLostCount() const{
+    return lost_count;
+}
+
+template<typename V>
+const LatencyHistogram& FeedHandler<V>::GetLatency() const{
+    return latency;
+}
+
+template<typename V>
+void FeedHandler<V>::PrintStatistics(ostream &stream, const string &name, double seconds) const{
+    ios_base::fmtflags flags = stream.flags();
+    streamsize precision = stream.precision();
+    stream << name << " , Packets: " << packet_count << " , Messages: " << message_count
+           << " , Messages/s: " << fixed << setprecision(0)
+           << (seconds > 0 ? message_count / seconds : 0.0)
+           << " , Gaps: " << gap_count << " , Recovered: " << recovered_count
+           << " , Lost: " << lost_count
+           << " , P50(ns): " << latency.GetPercentile(0.50)
+           << " , P99(ns): " << latency.GetPercentile(0.99)
+           << " , Max(ns): " << latency.GetMax() << endl;
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+#endif //TRADING_SYSTEM_FEED_HANDLER_HPP
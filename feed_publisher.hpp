@@ -0,0 +1,313 @@
+/**
+ * feed_publisher.hpp
+ * Defines FeedPublisher, the sending end of a network feed (feed_handler.hpp),
+ * and ReplayFile, which streams an input file through a publisher, e.g. to
+ * test the feed handlers' throughput and latency over loopback.
+ *
+ * Over UDP the publisher keeps its last FEED_HISTORY_PACKETS packets and
+ * serves them to handlers recovering from gaps on a TCP recovery port, from
+ * a thread of its own.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_FEED_PUBLISHER_HPP
+#define TRADING_SYSTEM_FEED_PUBLISHER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "feed_handler.hpp"
+
+using namespace std;
+
+// Packets a UDP publisher keeps for recovery
+const size_t FEED_HISTORY_PACKETS = 4096;
+
+
+/**
+ * Sending end of a feed of message type V. Messages are packed into packets
+ * of up to FEED_PACKET_SIZE bytes, sent when full, on Flush or on Finish,
+ * which also ends the feed.
+ * Type V is the message type.
+ */
+template<typename V>
+class FeedPublisher{
+private:
+    FeedTransport transport;
+    const SecurityMaster* security_master;
+    int fd;
+    int client_fd;
+    sockaddr_in destination;
+    // Packet being filled, allocated once
+    string packet;
+    uint16_t packet_records;
+    uint64_t sequence;
+    uint64_t drop_interval;
+    uint64_t message_count;
+    // Recent packets by sequence, allocated once and served for recovery
+    vector<string> history;
+    vector<uint64_t> history_sequences;
+    mutex history_mutex;
+    int recovery_fd;
+    atomic<bool> running;
+    thread recovery_thread;
+
+    // Send the packet being filled and start the next one
+    void SendPacket();
+
+    // Answer recovery requests until the publisher is destroyed
+    void ServeRecovery();
+
+public:
+    // ctor, over UDP sends to address:port, a multicast group or not, and
+    // serves recovery on recovery_address:recovery_port unless it is 0; over
+    // TCP listens on address:port for one handler. Throws if the sockets
+    // cannot be set up.
+    FeedPublisher(FeedTransport _transport, const string &address, uint16_t port,
+                  const SecurityMaster* _security_master,
+                  const string &recovery_address = "127.0.0.1", uint16_t recovery_port = 0);
+    ~FeedPublisher();
+    FeedPublisher(const FeedPublisher &) = delete;
+    FeedPublisher& operator=(const FeedPublisher &) = delete;
+
+    // Add a message to the feed, false if its product is unknown
+    bool Publish(const V &record);
+
+    // Send the messages added so far
+    void Flush();
+
+    // Send the messages added so far and end the feed
+    void Finish();
+
+    // Leave every interval-th UDP packet unsent, still serving it for
+    // recovery, to exercise the handlers' gap recovery. 0 sends all.
+    void SetDropInterval(uint64_t interval);
+
+    uint64_t GetPacketCount() const;
+
+    uint64_t GetMessageCount() const;
+};
+
+
+// Publish every record of the CSV input at path, at up to rate messages a
+// second or as fast as possible when 0, and end the feed. Returns the
+// messages published.
+template<typename V>
+size_t ReplayFile(const string &path, FeedPublisher<V> &publisher,
+                  const SecurityMaster* security_master, size_t rate = 0);
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of FeedPublisher class
+template<typename V>
+FeedPublisher<V>::FeedPublisher(FeedTransport _transport, const string &address, uint16_t port,
+        const SecurityMaster* _security_master, const string &recovery_address,
+        uint16_t recovery_port) : running(true){
+    transport = _transport;
+    security_master = _security_master;
+    client_fd = -1;
+    recovery_fd = -1;
+    sequence = 1;
+    drop_interval = 0;
+    message_count = 0;
+    packet_records = 0;
+    packet.reserve(FEED_PACKET_SIZE);
+    packet.resize(sizeof(FeedPacketHeader));
+    destination = FeedSocketAddress(address, port);
+    int enable = 1;
+    if (transport == UDP_FEED) {
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw runtime_error(string("FeedPublisher: ") + strerror(errno));
+        }
+        int send_buffer = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+        if (IN_MULTICAST(ntohl(destination.sin_addr.s_addr))) {
+            unsigned char ttl = 1;
+            unsigned char loop = 1;
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        }
+        history.resize(FEED_HISTORY_PACKETS);
+        history_sequences.assign(FEED_HISTORY_PACKETS, 0);
+        for (string& kept : history) {
+            kept.reserve(FEED_PACKET_SIZE);
+        }
+        if (recovery_port != 0) {
+            sockaddr_in recovery = FeedSocketAddress(recovery_address, recovery_port);
+            recovery_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            setsockopt(recovery_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            if (recovery_fd < 0 || bind(recovery_fd, (sockaddr*) &recovery, sizeof(recovery)) < 0 ||
+                listen(recovery_fd, 16) < 0) {
+                throw runtime_error(string("FeedPublisher: cannot serve recovery: ") +
+                                    strerror(errno));
+            }
+            recovery_thread = thread(&FeedPublisher::ServeRecovery, this);
+        }
+    }
+    else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (fd < 0 || bind(fd, (sockaddr*) &destination, sizeof(destination)) < 0 ||
+            listen(fd, 1) < 0) {
+            throw runtime_error("FeedPublisher: cannot listen on " + address + ": " +
+                                strerror(errno));
+        }
+    }
+}
+
+template<typename V>
+FeedPublisher<V>::~FeedPublisher(){
+    running = false;
+    if (recovery_thread.joinable()) {
+        recovery_thread.join();
+    }
+    if (recovery_fd >= 0) {
+        close(recovery_fd);
+    }
+    if (client_fd >= 0) {
+        close(client_fd);
+    }
+    close(fd);
+}
+
+template<typename V>
+bool FeedPublisher<V>::Publish(const V &record){
+    if (packet.size() + RecordParser<V>::RECORD_BYTES > FEED_PACKET_SIZE) {
+        Flush();
+    }
+    if (!RecordParser<V>::EncodeBinary(record, *security_master, packet)) {
+        return false;
+    }
+    ++packet_records;
+    ++message_count;
+    return true;
+}
+
+template<typename V>
+void FeedPublisher<V>::SendPacket(){
+    FeedPacketHeader header;
+    header.length = (uint32_t) packet.size();
+    header.record_bytes = (uint16_t) RecordParser<V>::RECORD_BYTES;
+    header.record_count = packet_records;
+    header.sequence = sequence;
+    header.send_time = FeedClockNanos();
+    memcpy(&packet[0], &header, sizeof(header));
+    if (transport == UDP_FEED) {
+        {
+            lock_guard<mutex> lock(history_mutex);
+            size_t slot = sequence % FEED_HISTORY_PACKETS;
+            history[slot].assign(packet);
+            history_sequences[slot] = sequence;
+        }
+        if (drop_interval == 0 || sequence % drop_interval != 0) {
+            sendto(fd, packet.data(), packet.size(), 0, (sockaddr*) &destination,
+                   sizeof(destination));
+        }
+    }
+    else {
+        if (client_fd < 0) {
+            client_fd = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            int enable = 1;
+            setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        FeedWriteFully(client_fd, packet.data(), packet.size());
+    }
+    ++sequence;
+    packet_records = 0;
+    packet.resize(sizeof(FeedPacketHeader));
+}
+
+template<typename V>
+void FeedPublisher<V>::Flush(){
+    if (packet_records > 0) {
+        SendPacket();
+    }
+}
+
+template<typename V>
+void FeedPublisher<V>::Finish(){
+    Flush();
+    SendPacket();
+}
+
+template<typename V>
+void FeedPublisher<V>::ServeRecovery(){
+    pollfd waiting{recovery_fd, POLLIN, 0};
+    while (running) {
+        if (poll(&waiting, 1, 100) <= 0) {
+            continue;
+        }
+        int peer_fd = accept4(recovery_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (peer_fd < 0) {
+            continue;
+        }
+        FeedRecoveryRequest request;
+        if (FeedReadFully(peer_fd, (char*) &request, sizeof(request))) {
+            string kept;
+            kept.reserve(FEED_PACKET_SIZE);
+            for (uint64_t wanted = request.first_sequence;
+                 wanted <= request.last_sequence; ++wanted) {
+                {
+                    lock_guard<mutex> lock(history_mutex);
+                    size_t slot = wanted % FEED_HISTORY_PACKETS;
+                    if (history_sequences[slot] < wanted) {
+                        // Not sent yet, nothing further to give
+                        break;
+                    }
+                    if (history_sequences[slot] != wanted) {
+                        continue;
+                    }
+                    kept.assign(history[slot]);
+                }
+                if (!FeedWriteFully(peer_fd, kept.data(), kept.size())) {
+                    break;
+                }
+            }
+        }
+        close(peer_fd);
+    }
+}
+
+template<typename V>
+void FeedPublisher<V>::SetDropInterval(uint64_t interval){
+    drop_interval = interval;
+}
+
+template<typename V>
+uint64_t FeedPublisher<V>::GetPacketCount() const{
+    return sequence - 1;
+}
+
+template<typename V>
+uint64_t FeedPublisher<V>::GetMessageCount() const{
+    return message_count;
+}
+
+
+//
+// Implementation of file replay
+template<typename V>
+size_t ReplayFile(const string &path, FeedPublisher<V> &publisher,
+                  const SecurityMaster* security_master, size_t rate){
+    RecordParser<V> parser(security_master);
+    auto start = chrono::steady_clock::now();
+    size_t published = 0;
+    parser.ParseFile(path, [&](V &record){
+        publisher.Publish(record);
+        ++published;
+        if (rate > 0 && published % 16 == 0) {
+            this_thread::sleep_until(start + chrono::nanoseconds(
+                    (int64_t) (published * 1000000000.0 / rate)));
+        }
+    });
+    publisher.Finish();
+    return published;
+}
+
+#endif //TRADING_SYSTEM_FEED_PUBLISHER_HPP
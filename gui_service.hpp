@@ -9,6 +9,7 @@
 #define TRADING_SYSTEM_GUI_SERVICE_HPP
 
 #include <map>
+#include <algorithm>
 #include <ctime>
 #include <chrono>
 #include <string>
@@ -17,6 +18,7 @@
 #include "soa.hpp"
 #include "products.hpp"
 #include "pricing_service.hpp"
+#include "price_format.hpp"
 
 using namespace std;
 
@@ -30,21 +32,23 @@ class GUIServiceConnector : public Connector<Price<T>>{
 private:
     chrono::system_clock::time_point last_time;
     ofstream gui;
-    GUIServiceConnector(){
+    PriceNotation notation;
+
+public:
+    // ctor, prices are written as exact decimals or in 32nds and 256ths
+    GUIServiceConnector(const string &_path = "../output/gui.txt",
+                        PriceNotation _notation = DECIMAL_NOTATION){
         last_time = chrono::system_clock::now();
-        gui.open("../output/gui.txt");
+        notation = _notation;
+        gui.open(_path);
         gui << "Time, CUSIP, Mid, Spread\n";
-        gui << fixed << setprecision(6);
     }
     ~GUIServiceConnector(){
         gui.close();
     }
 
-public:
-    static GUIServiceConnector<T>* GenerateInstance(){
-        static GUIServiceConnector instance;
-        return &instance;
-    }
+    // Instance owned by the default ServiceContext
+    static GUIServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(Price<T> &data) override{
@@ -53,9 +57,16 @@ public:
             curr_time = chrono::system_clock::now();
         }
         time_t now = chrono::system_clock::to_time_t(curr_time);
-        gui << put_time(localtime(&now), "%F %T") << " , "
-            << data.GetProduct().GetProductId() << " , "
-            << data.GetMid() << " , " << data.GetBidOfferSpread() << "\n";
+        char line[256];
+        char* end = line + strftime(line, sizeof(line), "%F %T , ", localtime(&now));
+        const string& product_id = data.GetProduct().GetProductId();
+        end = copy(product_id.begin(), product_id.end(), end);
+        end = copy_n(" , ", 3, end);
+        end = FormatPrice(end, line + sizeof(line), data.GetMid().ToDouble(), notation);
+        end = copy_n(" , ", 3, end);
+        end = FormatPrice(end, line + sizeof(line), data.GetBidOfferSpread().ToDouble(), notation);
+        *end++ = '\n';
+        gui.write(line, end - line);
         last_time = curr_time;
     }
 
@@ -75,16 +86,19 @@ private:
     int count;
     map<string, Price<T> > price_data;
     vector<ServiceListener<Price<T>> *> service_listeners;
-    GUIService() : count(0) {}
+    GUIServiceConnector<T>* gui_service_connector;
 
 public:
-    static GUIService* GenerateInstance(){
-        static GUIService instance;
-        return &instance;
+    // ctor
+    GUIService(GUIServiceConnector<T>* _gui_service_connector) : count(0) {
+        gui_service_connector = _gui_service_connector;
     }
+
+    // Instance owned by the default ServiceContext
+    static GUIService* GenerateInstance();
     
     // Override virtual functions in base class Service
-    Price<T>& GetData(string key) override {
+    Price<T>& GetData(const string &key) override {
         return price_data[key];
     }
     
@@ -99,8 +113,7 @@ public:
     }
 
     void PrintPrice(Price<T> &price){
-        auto gui_service_connector = GUIServiceConnector<T>::GenerateInstance();
-        string product_id = price.GetProduct().GetProductId();
+        const string& product_id = price.GetProduct().GetProductId();
         price_data.insert(make_pair(product_id, price));
         if(count < 100){
             gui_service_connector->Publish(price);
@@ -119,18 +132,19 @@ template<typename T>
 class GUIServiceListener : public ServiceListener<Price<T>>{
 private:
     GUIService<T>* gui_service;
-    GUIServiceListener(){
-        gui_service = GUIService<T>::GenerateInstance();
-    }
 
 public:
-    static GUIServiceListener* GenerateInstance(){
-        static GUIServiceListener instance;
-        return &instance;
+    // ctor
+    GUIServiceListener(GUIService<T>* _gui_service){
+        gui_service = _gui_service;
     }
+
+    // Instance owned by the default ServiceContext
+    static GUIServiceListener* GenerateInstance();
     
     // Override virtual functions in base class Service
     void ProcessAdd(Price<T> &data) override {
+        INSTRUMENT_SCOPE("GUIService");
         gui_service->PrintPrice(data);
     }
     
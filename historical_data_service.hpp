@@ -14,7 +14,14 @@
 #include <ctime>
 #include <chrono>
 #include <string>
+#include <sstream>
+#include <functional>
 #include "soa.hpp"
+#include "journal.hpp"
+#include "timeseries_store.hpp"
+#include "block_codec.hpp"
+#include "async_logger.hpp"
+#include "risk_service.hpp"
 
 using namespace std;
 
@@ -28,26 +35,45 @@ template<typename T>
 class HistoricalDataService : Service<string,T>{
 public:
     // Persist data to a store
-    void PersistData(string persistKey, const T& data) = 0;
+    void PersistData(const string &persistKey, const T& data) = 0;
 
 };
 
 
+template<typename T>
+class StreamingHistoricalDataServiceConnector;
+
+template<typename T>
+class PositionHistoricalDataServiceConnector;
+
+template<typename T>
+class RiskHistoricalDataServiceConnector;
+
+template<typename T>
+class ExecutionHistoricalDataServiceConnector;
+
+template<typename T>
+class InquiryHistoricalDataServiceConnector;
+
+
 template<typename T>
 class StreamingHistoricalDataService : public Service<string,PriceStream <T>>{
 private:
 	map<string, PriceStream<T> > streaming_data;
 	vector<ServiceListener<PriceStream<T>>*> service_listeners;
-	StreamingHistoricalDataService();
+    StreamingHistoricalDataServiceConnector<T>* streaming_historical_data_service_connector;
+    TimeSeriesStore* time_series;
 
 public:
-	static StreamingHistoricalDataService* GenerateInstance(){
-		static StreamingHistoricalDataService instance;
-		return &instance;
-	}
+    // ctor
+    StreamingHistoricalDataService(StreamingHistoricalDataServiceConnector<T>*
+            _streaming_historical_data_service_connector);
+
+    // Instance owned by the default ServiceContext
+    static StreamingHistoricalDataService* GenerateInstance();
 
 	 // Override virtual functions in base class Service
-    PriceStream<T>& GetData(string key) override;
+    PriceStream<T>& GetData(const string &key) override;
 
     void OnMessage(PriceStream<T> &data) override;
 
@@ -55,7 +81,14 @@ public:
 
     const vector<ServiceListener<PriceStream<T>>* >& GetListeners() const override;
 
-    void PersistData(string persistKey, PriceStream<T>& data);
+    void PersistData(const string &persistKey, PriceStream<T>& data);
+
+    // Also append every persisted price stream to a time-series store, queried
+    // through GetTimeSeries()
+    void SetTimeSeries(TimeSeriesStore* _time_series);
+
+    // Read side of the history, nullptr unless a store is set
+    TimeSeriesStore* GetTimeSeries();
 
 };
 
@@ -64,13 +97,14 @@ template<typename T>
 class StreamingHistoricalDataServiceListener : public ServiceListener<PriceStream <T>>{
 private:
     StreamingHistoricalDataService<T>* streaming_service;
-    StreamingHistoricalDataServiceListener();
 
 public:
-    static StreamingHistoricalDataServiceListener* GenerateInstance(){
-        static StreamingHistoricalDataServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    StreamingHistoricalDataServiceListener(
+            StreamingHistoricalDataService<T>* _streaming_service);
+
+    // Instance owned by the default ServiceContext
+    static StreamingHistoricalDataServiceListener* GenerateInstance();
     
     // Override virtual functions in base class Service
     void ProcessAdd(PriceStream<T> &data) override;
@@ -87,19 +121,41 @@ public:
 template<typename T>
 class StreamingHistoricalDataServiceConnector : public Connector<PriceStream <T>>{
 private:
-    StreamingHistoricalDataServiceConnector();
+    JournalWriter* journal;
+    function<void(PriceStream<T>&)> replay_handler;
+    LogOutput log_output;
+    unique_ptr<CompressedBlockWriter> block_writer;
 
 public:
-    static StreamingHistoricalDataServiceConnector<T>* GenerateInstance(){
-        static StreamingHistoricalDataServiceConnector instance;
-        return &instance;
-    }
+    // ctor
+    StreamingHistoricalDataServiceConnector(
+            const string &_path = "../output/streaming.txt");
+
+    // Instance owned by the default ServiceContext
+    static StreamingHistoricalDataServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(PriceStream<T> &data) override;
 
+    // Subscribe replays the journal into the handler
     void Subscribe() override;
 
+    // Replay the journal records after from_sequence into the handler
+    void Replay(uint64_t from_sequence);
+
+    // Also append everything published to a journal
+    void SetJournal(JournalWriter* _journal,
+                    function<void(PriceStream<T>&)> _replay_handler = nullptr);
+
+    // Format and write the lines on the background thread of an async logger
+    void SetLogger(AsyncLogger* _logger, LogFormat format = TEXT_FORMAT,
+                   PriceNotation notation = DECIMAL_NOTATION);
+
+    // Write delta-encoded, compressed blocks to block_path instead of text,
+    // read back with a CompressedBlockReader
+    void SetBlockOutput(const string &block_path,
+                        BlockCompression compression = LZ_COMPRESSION);
+
 };
 
 
@@ -108,16 +164,19 @@ class PositionHistoricalDataService : public Service<string,Position<T>>{
 private:
     map<string, Position<T> > position_data;
     vector<ServiceListener<Position<T>>*> service_listeners;
-    PositionHistoricalDataService();
+    PositionHistoricalDataServiceConnector<T>* position_historical_data_service_connector;
+    TimeSeriesStore* time_series;
 
 public:
-    static PositionHistoricalDataService* GenerateInstance(){
-        static PositionHistoricalDataService instance;
-        return &instance;
-    }
+    // ctor
+    PositionHistoricalDataService(PositionHistoricalDataServiceConnector<T>*
+            _position_historical_data_service_connector);
+
+    // Instance owned by the default ServiceContext
+    static PositionHistoricalDataService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    Position<T>& GetData(string key) override;
+    Position<T>& GetData(const string &key) override;
 
     void OnMessage(Position<T> &data) override;
 
@@ -125,7 +184,14 @@ public:
 
     const vector<ServiceListener<Position<T>>* >& GetListeners() const override;
 
-    void PersistData(string persistKey, Position<T>& data);
+    void PersistData(const string &persistKey, Position<T>& data);
+
+    // Also append every persisted position to a time-series store, queried
+    // through GetTimeSeries()
+    void SetTimeSeries(TimeSeriesStore* _time_series);
+
+    // Read side of the history, nullptr unless a store is set
+    TimeSeriesStore* GetTimeSeries();
 
 };
 
@@ -134,13 +200,14 @@ template<typename T>
 class PositionHistoricalDataServiceListener : public ServiceListener<Position <T>>{
 private:
     PositionHistoricalDataService<T>* position_service;
-    PositionHistoricalDataServiceListener();
 
 public:
-    static PositionHistoricalDataServiceListener* GenerateInstance(){
-        static PositionHistoricalDataServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    PositionHistoricalDataServiceListener(
+            PositionHistoricalDataService<T>* _position_service);
+
+    // Instance owned by the default ServiceContext
+    static PositionHistoricalDataServiceListener* GenerateInstance();
     
     // Override virtual functions in base class Service
     void ProcessAdd(Position<T> &data) override;
@@ -157,19 +224,35 @@ public:
 template<typename T>
 class PositionHistoricalDataServiceConnector : public Connector<Position <T>>{
 private:
-    PositionHistoricalDataServiceConnector();
+    JournalWriter* journal;
+    function<void(Position<T>&)> replay_handler;
+    LogOutput log_output;
 
 public:
-    static PositionHistoricalDataServiceConnector<T>* GenerateInstance(){
-        static PositionHistoricalDataServiceConnector instance;
-        return &instance;
-    }
+    // ctor
+    PositionHistoricalDataServiceConnector(
+            const string &_path = "../output/positions.txt");
+
+    // Instance owned by the default ServiceContext
+    static PositionHistoricalDataServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(Position<T> &data) override;
 
+    // Subscribe replays the journal into the handler
     void Subscribe() override;
 
+    // Replay the journal records after from_sequence into the handler
+    void Replay(uint64_t from_sequence);
+
+    // Also append everything published to a journal
+    void SetJournal(JournalWriter* _journal,
+                    function<void(Position<T>&)> _replay_handler = nullptr);
+
+    // Format and write the lines on the background thread of an async logger
+    void SetLogger(AsyncLogger* _logger, LogFormat format = TEXT_FORMAT,
+                   PriceNotation notation = DECIMAL_NOTATION);
+
 };
 
 
@@ -178,16 +261,19 @@ class RiskHistoricalDataService : public Service<string,PV01<T>>{
 private:
     map<string, PV01<T> > risk_data;
     vector<ServiceListener<PV01<T>>*> service_listeners;
-    RiskHistoricalDataService();
+    RiskHistoricalDataServiceConnector<T>* risk_historical_data_service_connector;
+    TimeSeriesStore* time_series;
 
 public:
-    static RiskHistoricalDataService* GenerateInstance(){
-        static RiskHistoricalDataService instance;
-        return &instance;
-    }
+    // ctor
+    RiskHistoricalDataService(RiskHistoricalDataServiceConnector<T>*
+            _risk_historical_data_service_connector);
+
+    // Instance owned by the default ServiceContext
+    static RiskHistoricalDataService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    PV01<T>& GetData(string key) override;
+    PV01<T>& GetData(const string &key) override;
 
     void OnMessage(PV01<T> &data) override;
 
@@ -195,7 +281,14 @@ public:
 
     const vector<ServiceListener<PV01<T>>* >& GetListeners() const override;
 
-    void PersistData(string persistKey, PV01<T>& data);
+    void PersistData(const string &persistKey, PV01<T>& data);
+
+    // Also append every persisted PV01 to a time-series store, queried
+    // through GetTimeSeries()
+    void SetTimeSeries(TimeSeriesStore* _time_series);
+
+    // Read side of the history, nullptr unless a store is set
+    TimeSeriesStore* GetTimeSeries();
 
 };
 
@@ -204,13 +297,14 @@ template<typename T>
 class RiskHistoricalDataServiceListener : public ServiceListener<PV01 <T>>{
 private:
     RiskHistoricalDataService<T>* risk_service;
-    RiskHistoricalDataServiceListener();
 
 public:
-    static RiskHistoricalDataServiceListener* GenerateInstance(){
-        static RiskHistoricalDataServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    RiskHistoricalDataServiceListener(
+            RiskHistoricalDataService<T>* _risk_service);
+
+    // Instance owned by the default ServiceContext
+    static RiskHistoricalDataServiceListener* GenerateInstance();
     
     // Override virtual functions in base class Service
     void ProcessAdd(PV01<T> &data) override;
@@ -227,19 +321,48 @@ public:
 template<typename T>
 class RiskHistoricalDataServiceConnector : public Connector<PV01 <T>>{
 private:
-    RiskHistoricalDataServiceConnector();
+    const RiskService<T>* risk_service;
+    JournalWriter* journal;
+    function<void(PV01<T>&)> replay_handler;
+    LogOutput log_output;
+    unique_ptr<CompressedBlockWriter> block_writer;
+    unique_ptr<CompressedBlockWriter> bucket_block_writer;
 
 public:
-    static RiskHistoricalDataServiceConnector<T>* GenerateInstance(){
-        static RiskHistoricalDataServiceConnector instance;
-        return &instance;
-    }
+    // ctor, each pv01 is followed by the bucketed risk of _risk_service
+    // unless it is null
+    RiskHistoricalDataServiceConnector(
+            const string &_path = "../output/risk.txt",
+            const RiskService<T>* _risk_service = nullptr);
+
+    // Instance owned by the default ServiceContext
+    static RiskHistoricalDataServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(PV01<T> &data) override;
 
+    // Subscribe replays the journal into the handler
     void Subscribe() override;
 
+    // Replay the journal records after from_sequence into the handler
+    void Replay(uint64_t from_sequence);
+
+    // Also append everything published to a journal
+    void SetJournal(JournalWriter* _journal,
+                    function<void(PV01<T>&)> _replay_handler = nullptr);
+
+    // Format and write the lines on the background thread of an async logger
+    void SetLogger(AsyncLogger* _logger, LogFormat format = TEXT_FORMAT,
+                   PriceNotation notation = DECIMAL_NOTATION);
+
+    // Write delta-encoded, compressed blocks to block_path instead of text,
+    // read back with a CompressedBlockReader. Its rows are keyed on product
+    // identifier only, the bucketed risk goes to rows keyed on bucket name in
+    // bucket_block_path, or is left out without one.
+    void SetBlockOutput(const string &block_path,
+                        BlockCompression compression = LZ_COMPRESSION,
+                        const string &bucket_block_path = "");
+
 };
 
 
@@ -248,16 +371,18 @@ class ExecutionHistoricalDataService : public Service<string,ExecutionOrder<T>>{
 private:
     map<string, ExecutionOrder<T> > execution_data;
     vector<ServiceListener<ExecutionOrder<T>>*> service_listeners;
-    ExecutionHistoricalDataService();
+    ExecutionHistoricalDataServiceConnector<T>* execution_historical_data_service_connector;
 
 public:
-    static ExecutionHistoricalDataService* GenerateInstance(){
-        static ExecutionHistoricalDataService instance;
-        return &instance;
-    }
+    // ctor
+    ExecutionHistoricalDataService(ExecutionHistoricalDataServiceConnector<T>*
+            _execution_historical_data_service_connector);
+
+    // Instance owned by the default ServiceContext
+    static ExecutionHistoricalDataService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    ExecutionOrder<T>& GetData(string key) override;
+    ExecutionOrder<T>& GetData(const string &key) override;
 
     void OnMessage(ExecutionOrder<T> &data) override;
 
@@ -265,7 +390,7 @@ public:
 
     const vector<ServiceListener<ExecutionOrder<T>>* >& GetListeners() const override;
 
-    void PersistData(string persistKey, ExecutionOrder<T>& data);
+    void PersistData(const string &persistKey, ExecutionOrder<T>& data);
 
 };
 
@@ -274,13 +399,14 @@ template<typename T>
 class ExecutionHistoricalDataServiceListener : public ServiceListener<ExecutionOrder <T>>{
 private:
     ExecutionHistoricalDataService<T>* execution_service;
-    ExecutionHistoricalDataServiceListener();
 
 public:
-    static ExecutionHistoricalDataServiceListener* GenerateInstance(){
-        static ExecutionHistoricalDataServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    ExecutionHistoricalDataServiceListener(
+            ExecutionHistoricalDataService<T>* _execution_service);
+
+    // Instance owned by the default ServiceContext
+    static ExecutionHistoricalDataServiceListener* GenerateInstance();
     
     // Override virtual functions in base class Service
     void ProcessAdd(ExecutionOrder<T> &data) override;
@@ -296,19 +422,35 @@ public:
 template<typename T>
 class ExecutionHistoricalDataServiceConnector : public Connector<ExecutionOrder <T>>{
 private:
-    ExecutionHistoricalDataServiceConnector();
+    JournalWriter* journal;
+    function<void(ExecutionOrder<T>&)> replay_handler;
+    LogOutput log_output;
 
 public:
-    static ExecutionHistoricalDataServiceConnector<T>* GenerateInstance(){
-        static ExecutionHistoricalDataServiceConnector instance;
-        return &instance;
-    }
+    // ctor
+    ExecutionHistoricalDataServiceConnector(
+            const string &_path = "../output/executions.txt");
+
+    // Instance owned by the default ServiceContext
+    static ExecutionHistoricalDataServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(ExecutionOrder<T> &data) override;
 
+    // Subscribe replays the journal into the handler
     void Subscribe() override;
 
+    // Replay the journal records after from_sequence into the handler
+    void Replay(uint64_t from_sequence);
+
+    // Also append everything published to a journal
+    void SetJournal(JournalWriter* _journal,
+                    function<void(ExecutionOrder<T>&)> _replay_handler = nullptr);
+
+    // Format and write the lines on the background thread of an async logger
+    void SetLogger(AsyncLogger* _logger, LogFormat format = TEXT_FORMAT,
+                   PriceNotation notation = DECIMAL_NOTATION);
+
 };
 
 
@@ -317,16 +459,18 @@ class InquiryHistoricalDataService : public Service<string,Inquiry<T>>{
 private:
     map<string, Inquiry<T> > inquiry_data;
     vector<ServiceListener<Inquiry<T>>*> service_listeners;
-    InquiryHistoricalDataService();
+    InquiryHistoricalDataServiceConnector<T>* inquiry_historical_data_service_connector;
 
 public:
-    static InquiryHistoricalDataService* GenerateInstance(){
-        static InquiryHistoricalDataService instance;
-        return &instance;
-    }
+    // ctor
+    InquiryHistoricalDataService(InquiryHistoricalDataServiceConnector<T>*
+            _inquiry_historical_data_service_connector);
+
+    // Instance owned by the default ServiceContext
+    static InquiryHistoricalDataService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    Inquiry<T>& GetData(string key) override;
+    Inquiry<T>& GetData(const string &key) override;
 
     void OnMessage(Inquiry<T> &data) override;
 
@@ -334,7 +478,9 @@ public:
 
     const vector<ServiceListener<Inquiry<T>>* >& GetListeners() const override;
 
-    void PersistData(string persistKey, Inquiry<T>& data);
+    void PersistData(const string &persistKey, Inquiry<T>& data);
+
+    void PersistDataBatch(vector<Inquiry<T>>& data);
 
 };
 
@@ -343,16 +489,19 @@ template<typename T>
 class InquiryHistoricalDataServiceListener : public ServiceListener<Inquiry <T>>{
 private:
     InquiryHistoricalDataService<T>* inquiry_service;
-    InquiryHistoricalDataServiceListener();
 
 public:
-    static InquiryHistoricalDataServiceListener* GenerateInstance(){
-        static InquiryHistoricalDataServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    InquiryHistoricalDataServiceListener(
+            InquiryHistoricalDataService<T>* _inquiry_service);
+
+    // Instance owned by the default ServiceContext
+    static InquiryHistoricalDataServiceListener* GenerateInstance();
     
     // Override virtual functions in base class Service
     void ProcessAdd(Inquiry<T> &data) override;
+
+    void ProcessAddBatch(vector<Inquiry<T>> &data) override;
     
     void ProcessRemove(Inquiry<T> &data) override;
     
@@ -366,19 +515,42 @@ public:
 template<typename T>
 class InquiryHistoricalDataServiceConnector : public Connector<Inquiry <T>>{
 private:
-    InquiryHistoricalDataServiceConnector();
+    JournalWriter* journal;
+    function<void(Inquiry<T>&)> replay_handler;
+    LogOutput log_output;
+
+    // Fill in the log record of an inquiry
+    void Record(LogRecord &record, Inquiry<T> &data);
 
 public:
-    static InquiryHistoricalDataServiceConnector<T>* GenerateInstance(){
-        static InquiryHistoricalDataServiceConnector instance;
-        return &instance;
-    }
+    // ctor
+    InquiryHistoricalDataServiceConnector(
+            const string &_path = "../output/allinquiries.txt");
+
+    // Instance owned by the default ServiceContext
+    static InquiryHistoricalDataServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(Inquiry<T> &data) override;
 
+    // Log a batch of inquiries, written with a single open of the file
+    // when there is no logger
+    void PublishBatch(vector<Inquiry<T>> &data);
+
+    // Subscribe replays the journal into the handler
     void Subscribe() override;
 
+    // Replay the journal records after from_sequence into the handler
+    void Replay(uint64_t from_sequence);
+
+    // Also append everything published to a journal
+    void SetJournal(JournalWriter* _journal,
+                    function<void(Inquiry<T>&)> _replay_handler = nullptr);
+
+    // Format and write the lines on the background thread of an async logger
+    void SetLogger(AsyncLogger* _logger, LogFormat format = TEXT_FORMAT,
+                   PriceNotation notation = DECIMAL_NOTATION);
+
 };
 
 
@@ -386,12 +558,14 @@ public:
 //
 // Implementation of StreamingHistoricalDataService class
 template<typename T>
-StreamingHistoricalDataService<T>::StreamingHistoricalDataService(){
-
+StreamingHistoricalDataService<T>::StreamingHistoricalDataService(
+        StreamingHistoricalDataServiceConnector<T>* _streaming_historical_data_service_connector){
+    streaming_historical_data_service_connector = _streaming_historical_data_service_connector;
+    time_series = nullptr;
 }
 
 template<typename T>
-PriceStream<T>& StreamingHistoricalDataService<T>::GetData(string key) {
+PriceStream<T>& StreamingHistoricalDataService<T>::GetData(const string &key) {
 	return streaming_data[key];
 }
 
@@ -411,24 +585,40 @@ const vector<ServiceListener<PriceStream<T>>* >& StreamingHistoricalDataService<
 }
 
 template<typename T>
-void StreamingHistoricalDataService<T>::PersistData(string persistKey, PriceStream<T>& data){
-	auto streaming_historical_data_service_connector
-	           = StreamingHistoricalDataServiceConnector<T>::GenerateInstance();
-    if (streaming_data.find(persistKey) == streaming_data.end()) {
+void StreamingHistoricalDataService<T>::PersistData(const string &persistKey, PriceStream<T>& data){
+    INSTRUMENT_SCOPE("StreamingHistoricalDataService");
+    auto stored = streaming_data.find(persistKey);
+    if (stored == streaming_data.end()) {
         streaming_data.insert(make_pair(persistKey, data));
     }
     else {
-        streaming_data[persistKey] = data;
+        stored->second.Update(data.GetBidOrder(), data.GetOfferOrder());
     }
     streaming_historical_data_service_connector->Publish(data);
+    if (time_series != nullptr) {
+        double values[TimeSeriesCodec<PriceStream<T>>::WIDTH];
+        TimeSeriesCodec<PriceStream<T>>::Encode(data, values);
+        time_series->Append(persistKey, TimeSeriesStore::Now(), values);
+    }
+}
+
+template<typename T>
+void StreamingHistoricalDataService<T>::SetTimeSeries(TimeSeriesStore* _time_series) {
+    time_series = _time_series;
+}
+
+template<typename T>
+TimeSeriesStore* StreamingHistoricalDataService<T>::GetTimeSeries() {
+    return time_series;
 }
 
 
 //
 // Implementation of StreamingHistoricalDataServiceListener class
 template<typename T>
-StreamingHistoricalDataServiceListener<T>::StreamingHistoricalDataServiceListener(){
-	streaming_service = StreamingHistoricalDataService<T>::GenerateInstance();
+StreamingHistoricalDataServiceListener<T>::StreamingHistoricalDataServiceListener(
+        StreamingHistoricalDataService<T>* _streaming_service){
+	streaming_service = _streaming_service;
 }
 
 template<typename T>
@@ -455,43 +645,84 @@ const StreamingHistoricalDataService<T>* StreamingHistoricalDataServiceListener<
 //
 // Implementation of StreamingHistoricalDataServiceConnector class
 template<typename T>
-StreamingHistoricalDataServiceConnector<T>::StreamingHistoricalDataServiceConnector(){
+StreamingHistoricalDataServiceConnector<T>::StreamingHistoricalDataServiceConnector(const string &_path) :
+        log_output(_path){
+    journal = nullptr;
+}
+
+template<typename T>
+void StreamingHistoricalDataServiceConnector<T>::SetJournal(JournalWriter* _journal,
+        function<void(PriceStream<T>&)> _replay_handler){
+    journal = _journal;
+    replay_handler = _replay_handler;
+}
 
+template<typename T>
+void StreamingHistoricalDataServiceConnector<T>::SetLogger(AsyncLogger* _logger, LogFormat format,
+        PriceNotation notation){
+    log_output.SetLogger(_logger, format, notation);
+}
+
+template<typename T>
+void StreamingHistoricalDataServiceConnector<T>::SetBlockOutput(const string &block_path,
+        BlockCompression compression){
+    block_writer.reset(new CompressedBlockWriter(block_path,
+            BlockSchema<PriceStream<T>>::Fields(), compression));
 }
 
 template<typename T>
 void StreamingHistoricalDataServiceConnector<T>::Publish(PriceStream<T> &data) {
-    ofstream output;
-	output.open("../output/streaming.txt", ios_base::app);
-	PriceStreamOrder bid = data.GetBidOrder();
-	PriceStreamOrder ask = data.GetOfferOrder();
-	time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-	output << put_time(localtime(&now), "%F %T")
-		   << " , CUSIP: " << data.GetProduct().GetProductId()
-		   << " , Bid: " << bid.GetPrice()
-		   << " , BidVisibleQuantity: " << bid.GetVisibleQuantity()
-		   << " , BidHiddenQuantity: " << bid.GetHiddenQuantity()
-		   << " , Ask: " << ask.GetPrice()
-		   << " , AskVisibleQuantity: " << ask.GetVisibleQuantity()
-		   << " , AskHiddenQuantity: " << ask.GetHiddenQuantity() << "\n";
-	output.close();
+    if (block_writer) {
+        double values[TimeSeriesCodec<PriceStream<T>>::WIDTH];
+        TimeSeriesCodec<PriceStream<T>>::Encode(data, values);
+        block_writer->Append(data.GetProduct().GetProductId(), TimeSeriesStore::Now(), values);
+        if (journal != nullptr) {
+            journal->Append(data);
+        }
+        return;
+    }
+	const PriceStreamOrder& bid = data.GetBidOrder();
+	const PriceStreamOrder& ask = data.GetOfferOrder();
+	LogRecord record;
+	record.Begin(STREAMING_LOG);
+	record.AddString(data.GetProduct().GetProductId());
+	record.AddDouble(bid.GetPrice());
+	record.AddInteger(bid.GetVisibleQuantity());
+	record.AddInteger(bid.GetHiddenQuantity());
+	record.AddDouble(ask.GetPrice());
+	record.AddInteger(ask.GetVisibleQuantity());
+	record.AddInteger(ask.GetHiddenQuantity());
+	log_output.Log(&record);
+	if (journal != nullptr) {
+	    journal->Append(data);
+	}
 }
 
 template<typename T>
 void StreamingHistoricalDataServiceConnector<T>::Subscribe() {
+    Replay(0);
+}
 
+template<typename T>
+void StreamingHistoricalDataServiceConnector<T>::Replay(uint64_t from_sequence) {
+    if (journal != nullptr && replay_handler) {
+        JournalReader(journal->GetDirectory(), journal->GetName()).Replay(
+                replay_handler, from_sequence);
+    }
 }
 
 
 //
 // Implementation of PositionHistoricalDataService class
 template<typename T>
-PositionHistoricalDataService<T>::PositionHistoricalDataService(){
-
+PositionHistoricalDataService<T>::PositionHistoricalDataService(
+        PositionHistoricalDataServiceConnector<T>* _position_historical_data_service_connector){
+    position_historical_data_service_connector = _position_historical_data_service_connector;
+    time_series = nullptr;
 }
 
 template<typename T>
-Position<T>& PositionHistoricalDataService<T>::GetData(string key) {
+Position<T>& PositionHistoricalDataService<T>::GetData(const string &key) {
     return position_data[key];
 }
 
@@ -511,24 +742,34 @@ const vector<ServiceListener<Position<T>>* >& PositionHistoricalDataService<T>::
 }
 
 template<typename T>
-void PositionHistoricalDataService<T>::PersistData(string persistKey, Position<T>& data){
-    auto position_historical_data_service_connector
-               = PositionHistoricalDataServiceConnector<T>::GenerateInstance();
-    if (position_data.find(persistKey) == position_data.end()) {
-        position_data.insert(make_pair(persistKey, data));
-    }
-    else {
-        position_data[persistKey] = data;
-    }
+void PositionHistoricalDataService<T>::PersistData(const string &persistKey, Position<T>& data){
+    INSTRUMENT_SCOPE("PositionHistoricalDataService");
+    position_data.insert_or_assign(persistKey, data);
     position_historical_data_service_connector->Publish(data);
+    if (time_series != nullptr) {
+        double values[TimeSeriesCodec<Position<T>>::WIDTH];
+        TimeSeriesCodec<Position<T>>::Encode(data, values);
+        time_series->Append(persistKey, TimeSeriesStore::Now(), values);
+    }
+}
+
+template<typename T>
+void PositionHistoricalDataService<T>::SetTimeSeries(TimeSeriesStore* _time_series) {
+    time_series = _time_series;
+}
+
+template<typename T>
+TimeSeriesStore* PositionHistoricalDataService<T>::GetTimeSeries() {
+    return time_series;
 }
 
 
 //
 // Implementation of PositionHistoricalDataServiceListener class
 template<typename T>
-PositionHistoricalDataServiceListener<T>::PositionHistoricalDataServiceListener(){
-    position_service = PositionHistoricalDataService<T>::GenerateInstance();
+PositionHistoricalDataServiceListener<T>::PositionHistoricalDataServiceListener(
+        PositionHistoricalDataService<T>* _position_service){
+    position_service = _position_service;
 }
 
 template<typename T>
@@ -555,41 +796,65 @@ const PositionHistoricalDataService<T>* PositionHistoricalDataServiceListener<T>
 //
 // Implementation of PositionHistoricalDataServiceConnector class
 template<typename T>
-PositionHistoricalDataServiceConnector<T>::PositionHistoricalDataServiceConnector(){
+PositionHistoricalDataServiceConnector<T>::PositionHistoricalDataServiceConnector(const string &_path) :
+        log_output(_path){
+    journal = nullptr;
+}
 
+template<typename T>
+void PositionHistoricalDataServiceConnector<T>::SetJournal(JournalWriter* _journal,
+        function<void(Position<T>&)> _replay_handler){
+    journal = _journal;
+    replay_handler = _replay_handler;
+}
+
+template<typename T>
+void PositionHistoricalDataServiceConnector<T>::SetLogger(AsyncLogger* _logger, LogFormat format,
+        PriceNotation notation){
+    log_output.SetLogger(_logger, format, notation);
 }
 
 template<typename T>
 void PositionHistoricalDataServiceConnector<T>::Publish(Position<T> &data) {
-    ofstream output;
-    output.open("../output/positions.txt", ios_base::app);
-    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    output << put_time(localtime(&now), "%F %T") 
-           << " , CUSIP: " << data.GetProduct().GetProductId()
-           << " , AggregatePosition: " << data.GetAggregatePosition();
+    LogRecord record;
+    record.Begin(POSITION_LOG);
+    record.AddString(data.GetProduct().GetProductId());
+    record.AddInteger(data.GetAggregatePosition());
     for(int i = 0; i < 3; ++i){
         string book_name = "TRSY" + to_string(i);
-        output << " , " << book_name << ": " << data.GetPosition(book_name);
+        record.AddInteger(data.GetPosition(book_name));
+    }
+    log_output.Log(&record);
+    if (journal != nullptr) {
+        journal->Append(data);
     }
-    output << "\n";
-    output.close();
 }
 
 template<typename T>
 void PositionHistoricalDataServiceConnector<T>::Subscribe() {
+    Replay(0);
+}
 
+template<typename T>
+void PositionHistoricalDataServiceConnector<T>::Replay(uint64_t from_sequence) {
+    if (journal != nullptr && replay_handler) {
+        JournalReader(journal->GetDirectory(), journal->GetName()).Replay(
+                replay_handler, from_sequence);
+    }
 }
 
 
 //
 // Implementation of RiskHistoricalDataService class
 template<typename T>
-RiskHistoricalDataService<T>::RiskHistoricalDataService(){
-
+RiskHistoricalDataService<T>::RiskHistoricalDataService(
+        RiskHistoricalDataServiceConnector<T>* _risk_historical_data_service_connector){
+    risk_historical_data_service_connector = _risk_historical_data_service_connector;
+    time_series = nullptr;
 }
 
 template<typename T>
-PV01<T>& RiskHistoricalDataService<T>::GetData(string key) {
+PV01<T>& RiskHistoricalDataService<T>::GetData(const string &key) {
     return risk_data[key];
 }
 
@@ -609,24 +874,34 @@ const vector<ServiceListener<PV01<T>>* >& RiskHistoricalDataService<T>::GetListe
 }
 
 template<typename T>
-void RiskHistoricalDataService<T>::PersistData(string persistKey, PV01<T>& data){
-    auto risk_historical_data_service_connector
-               = RiskHistoricalDataServiceConnector<T>::GenerateInstance();
-    if (risk_data.find(persistKey) == risk_data.end()) {
-        risk_data.insert(make_pair(persistKey, data));
-    }
-    else {
-        risk_data[persistKey] = data;
-    }
+void RiskHistoricalDataService<T>::PersistData(const string &persistKey, PV01<T>& data){
+    INSTRUMENT_SCOPE("RiskHistoricalDataService");
+    risk_data.insert_or_assign(persistKey, data);
     risk_historical_data_service_connector->Publish(data);
+    if (time_series != nullptr) {
+        double values[TimeSeriesCodec<PV01<T>>::WIDTH];
+        TimeSeriesCodec<PV01<T>>::Encode(data, values);
+        time_series->Append(persistKey, TimeSeriesStore::Now(), values);
+    }
+}
+
+template<typename T>
+void RiskHistoricalDataService<T>::SetTimeSeries(TimeSeriesStore* _time_series) {
+    time_series = _time_series;
+}
+
+template<typename T>
+TimeSeriesStore* RiskHistoricalDataService<T>::GetTimeSeries() {
+    return time_series;
 }
 
 
 //
 // Implementation of RiskHistoricalDataServiceListener class
 template<typename T>
-RiskHistoricalDataServiceListener<T>::RiskHistoricalDataServiceListener(){
-    risk_service = RiskHistoricalDataService<T>::GenerateInstance();
+RiskHistoricalDataServiceListener<T>::RiskHistoricalDataServiceListener(
+        RiskHistoricalDataService<T>* _risk_service){
+    risk_service = _risk_service;
 }
 
 template<typename T>
@@ -653,43 +928,99 @@ const RiskHistoricalDataService<T>* RiskHistoricalDataServiceListener<T>::GetSer
 //
 // Implementation of RiskHistoricalDataServiceConnector class
 template<typename T>
-RiskHistoricalDataServiceConnector<T>::RiskHistoricalDataServiceConnector(){
+RiskHistoricalDataServiceConnector<T>::RiskHistoricalDataServiceConnector(const string &_path,
+        const RiskService<T>* _risk_service) : log_output(_path){
+    risk_service = _risk_service;
+    journal = nullptr;
+}
+
+template<typename T>
+void RiskHistoricalDataServiceConnector<T>::SetJournal(JournalWriter* _journal,
+        function<void(PV01<T>&)> _replay_handler){
+    journal = _journal;
+    replay_handler = _replay_handler;
+}
 
+template<typename T>
+void RiskHistoricalDataServiceConnector<T>::SetLogger(AsyncLogger* _logger, LogFormat format,
+        PriceNotation notation){
+    log_output.SetLogger(_logger, format, notation);
+}
+
+template<typename T>
+void RiskHistoricalDataServiceConnector<T>::SetBlockOutput(const string &block_path,
+        BlockCompression compression, const string &bucket_block_path){
+    block_writer.reset(new CompressedBlockWriter(block_path,
+            BlockSchema<PV01<T>>::Fields(), compression));
+    if (!bucket_block_path.empty()) {
+        bucket_block_writer.reset(new CompressedBlockWriter(bucket_block_path,
+                BlockSchema<PV01<T>>::Fields(), compression));
+    }
 }
 
 template<typename T>
 void RiskHistoricalDataServiceConnector<T>::Publish(PV01<T> &data) {
-    ofstream output;
-    output.open("../output/risk.txt", ios_base::app);
-    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    string product_id = data.GetProduct().GetProductId();
-    output << put_time(localtime(&now), "%F %T") 
-           << " , CUSIP: " << product_id 
-           << " , PV01: " << data.GetPV01()
-           << " , Quantity: " << data.GetQuantity() << "\n";
-    output << put_time(localtime(&now), "%F %T")
-           << " , FrontEnd, PV01: " << rand()/1000 
-           << " , Belly, PV01: " << rand()/4000
-           << " , LongEnd, PV01: " << rand()/3000
-           << "\n";
-    output.close();
+    if (block_writer) {
+        int64_t now = TimeSeriesStore::Now();
+        double values[TimeSeriesCodec<PV01<T>>::WIDTH];
+        TimeSeriesCodec<PV01<T>>::Encode(data, values);
+        block_writer->Append(data.GetProduct().GetProductId(), now, values);
+        // The bucket lines become rows of their own file, keyed by bucket name
+        for (int bucket = 0; bucket_block_writer && risk_service != nullptr &&
+                             bucket < SECTOR_BUCKETS; ++bucket) {
+            double bucket_values[TimeSeriesCodec<PV01<T>>::WIDTH] = {
+                    risk_service->GetBucketPV01((SectorBucket) bucket),
+                    (double) risk_service->GetBucketQuantity((SectorBucket) bucket)};
+            bucket_block_writer->Append(SECTOR_BUCKET_NAMES[bucket], now, bucket_values);
+        }
+        if (journal != nullptr) {
+            journal->Append(data);
+        }
+        return;
+    }
+    LogRecord record;
+    record.Begin(RISK_LOG);
+    record.AddString(data.GetProduct().GetProductId());
+    record.AddDouble(data.GetPV01());
+    record.AddInteger(data.GetQuantity());
+    log_output.Log(&record);
+    if (risk_service != nullptr) {
+        record.Begin(RISK_BUCKET_LOG);
+        for (int bucket = 0; bucket < SECTOR_BUCKETS; ++bucket) {
+            record.AddDouble(risk_service->GetBucketPV01((SectorBucket) bucket));
+            record.AddInteger(risk_service->GetBucketQuantity((SectorBucket) bucket));
+        }
+        log_output.Log(&record);
+    }
+    if (journal != nullptr) {
+        journal->Append(data);
+    }
 }
 
 template<typename T>
 void RiskHistoricalDataServiceConnector<T>::Subscribe() {
+    Replay(0);
+}
 
+template<typename T>
+void RiskHistoricalDataServiceConnector<T>::Replay(uint64_t from_sequence) {
+    if (journal != nullptr && replay_handler) {
+        JournalReader(journal->GetDirectory(), journal->GetName()).Replay(
+                replay_handler, from_sequence);
+    }
 }
 
 
 //
 // Implementation of ExecutionHistoricalDataService class
 template<typename T>
-ExecutionHistoricalDataService<T>::ExecutionHistoricalDataService(){
-
+ExecutionHistoricalDataService<T>::ExecutionHistoricalDataService(
+        ExecutionHistoricalDataServiceConnector<T>* _execution_historical_data_service_connector){
+    execution_historical_data_service_connector = _execution_historical_data_service_connector;
 }
 
 template<typename T>
-ExecutionOrder<T>& ExecutionHistoricalDataService<T>::GetData(string key) {
+ExecutionOrder<T>& ExecutionHistoricalDataService<T>::GetData(const string &key) {
     return execution_data[key];
 }
 
@@ -709,15 +1040,9 @@ const vector<ServiceListener<ExecutionOrder<T>>* >& ExecutionHistoricalDataServi
 }
 
 template<typename T>
-void ExecutionHistoricalDataService<T>::PersistData(string persistKey, ExecutionOrder<T>& data){
-    auto execution_historical_data_service_connector
-               = ExecutionHistoricalDataServiceConnector<T>::GenerateInstance();
-    if (execution_data.find(persistKey) == execution_data.end()) {
-        execution_data.insert(make_pair(persistKey, data));
-    }
-    else {
-        execution_data[persistKey] = data;
-    }
+void ExecutionHistoricalDataService<T>::PersistData(const string &persistKey, ExecutionOrder<T>& data){
+    INSTRUMENT_SCOPE("ExecutionHistoricalDataService");
+    execution_data.insert_or_assign(persistKey, data);
     execution_historical_data_service_connector->Publish(data);
 }
 
@@ -725,8 +1050,9 @@ void ExecutionHistoricalDataService<T>::PersistData(string persistKey, Execution
 //
 // Implementation of ExecutionHistoricalDataServiceListener class
 template<typename T>
-ExecutionHistoricalDataServiceListener<T>::ExecutionHistoricalDataServiceListener(){
-    execution_service = ExecutionHistoricalDataService<T>::GenerateInstance();
+ExecutionHistoricalDataServiceListener<T>::ExecutionHistoricalDataServiceListener(
+        ExecutionHistoricalDataService<T>* _execution_service){
+    execution_service = _execution_service;
 }
 
 template<typename T>
@@ -753,43 +1079,66 @@ const ExecutionHistoricalDataService<T>* ExecutionHistoricalDataServiceListener<
 //
 // Implementation of ExecutionHistoricalDataServiceConnector class
 template<typename T>
-ExecutionHistoricalDataServiceConnector<T>::ExecutionHistoricalDataServiceConnector(){
+ExecutionHistoricalDataServiceConnector<T>::ExecutionHistoricalDataServiceConnector(const string &_path) :
+        log_output(_path){
+    journal = nullptr;
+}
+
+template<typename T>
+void ExecutionHistoricalDataServiceConnector<T>::SetJournal(JournalWriter* _journal,
+        function<void(ExecutionOrder<T>&)> _replay_handler){
+    journal = _journal;
+    replay_handler = _replay_handler;
+}
 
+template<typename T>
+void ExecutionHistoricalDataServiceConnector<T>::SetLogger(AsyncLogger* _logger, LogFormat format,
+        PriceNotation notation){
+    log_output.SetLogger(_logger, format, notation);
 }
 
 template<typename T>
 void ExecutionHistoricalDataServiceConnector<T>::Publish(ExecutionOrder<T> &data) {
-    ofstream output;
-    output.open("../output/executions.txt", ios_base::app);
-    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    output << put_time(localtime(&now), "%F %T") 
-           << " , OrderId: " << data.GetOrderId()
-           << " , CUSIP: " << data.GetProduct().GetProductId() 
-           << " , Side: " << ((data.GetSide() == BID) ? "Bid" : "Ask")
-           << " , Price: " << data.GetPrice()
-           << " , VisibleQuantity: " << data.GetVisibleQuantity()
-           << " , HiddenQuantity: " << data.GetHiddenQuantity()
-           << " , ParentOrderId: " << data.GetParentOrderId()
-           << " , IsChildOrder: " << ((data.IsChildOrder()) ? "Yes" : "No")
-           << "\n";
-    output.close();
+    LogRecord record;
+    record.Begin(EXECUTION_LOG);
+    record.AddString(data.GetOrderId());
+    record.AddString(data.GetProduct().GetProductId());
+    record.AddString((data.GetSide() == BID) ? "Bid" : "Ask");
+    record.AddDouble(data.GetPrice().ToDouble());
+    record.AddInteger(data.GetVisibleQuantity());
+    record.AddInteger(data.GetHiddenQuantity());
+    record.AddString(data.GetParentOrderId());
+    record.AddString((data.IsChildOrder()) ? "Yes" : "No");
+    log_output.Log(&record);
+    if (journal != nullptr) {
+        journal->Append(data);
+    }
 }
 
 template<typename T>
 void ExecutionHistoricalDataServiceConnector<T>::Subscribe() {
+    Replay(0);
+}
 
+template<typename T>
+void ExecutionHistoricalDataServiceConnector<T>::Replay(uint64_t from_sequence) {
+    if (journal != nullptr && replay_handler) {
+        JournalReader(journal->GetDirectory(), journal->GetName()).Replay(
+                replay_handler, from_sequence);
+    }
 }
 
 
 //
 // Implementation of InquiryHistoricalDataService class
 template<typename T>
-InquiryHistoricalDataService<T>::InquiryHistoricalDataService(){
-
+InquiryHistoricalDataService<T>::InquiryHistoricalDataService(
+        InquiryHistoricalDataServiceConnector<T>* _inquiry_historical_data_service_connector){
+    inquiry_historical_data_service_connector = _inquiry_historical_data_service_connector;
 }
 
 template<typename T>
-Inquiry<T>& InquiryHistoricalDataService<T>::GetData(string key) {
+Inquiry<T>& InquiryHistoricalDataService<T>::GetData(const string &key) {
     return inquiry_data[key];
 }
 
@@ -809,30 +1158,39 @@ const vector<ServiceListener<Inquiry<T>>* >& InquiryHistoricalDataService<T>::Ge
 }
 
 template<typename T>
-void InquiryHistoricalDataService<T>::PersistData(string persistKey, Inquiry<T>& data){
-    auto inquiry_historical_data_service_connector
-               = InquiryHistoricalDataServiceConnector<T>::GenerateInstance();
-    if (inquiry_data.find(persistKey) == inquiry_data.end()) {
-        inquiry_data.insert(make_pair(persistKey, data));
-    }
-    else {
-        inquiry_data[persistKey] = data;
-    }
+void InquiryHistoricalDataService<T>::PersistData(const string &persistKey, Inquiry<T>& data){
+    INSTRUMENT_SCOPE("InquiryHistoricalDataService");
+    inquiry_data.insert_or_assign(persistKey, data);
     inquiry_historical_data_service_connector->Publish(data);
 }
 
+template<typename T>
+void InquiryHistoricalDataService<T>::PersistDataBatch(vector<Inquiry<T>>& data){
+    INSTRUMENT_SCOPE("InquiryHistoricalDataService::Batch");
+    for (auto& inquiry : data) {
+        inquiry_data[inquiry.GetInquiryId()] = inquiry;
+    }
+    inquiry_historical_data_service_connector->PublishBatch(data);
+}
+
 
 //
 // Implementation of InquiryHistoricalDataServiceListener class
 template<typename T>
-InquiryHistoricalDataServiceListener<T>::InquiryHistoricalDataServiceListener(){
-    inquiry_service = InquiryHistoricalDataService<T>::GenerateInstance();
+InquiryHistoricalDataServiceListener<T>::InquiryHistoricalDataServiceListener(
+        InquiryHistoricalDataService<T>* _inquiry_service){
+    inquiry_service = _inquiry_service;
 }
 
 template<typename T>
 void InquiryHistoricalDataServiceListener<T>::ProcessAdd(Inquiry<T> &data) {
     inquiry_service->PersistData(data.GetInquiryId(), data);
 }
+
+template<typename T>
+void InquiryHistoricalDataServiceListener<T>::ProcessAddBatch(vector<Inquiry<T>> &data) {
+    inquiry_service->PersistDataBatch(data);
+}
     
 template<typename T>
 void InquiryHistoricalDataServiceListener<T>::ProcessRemove(Inquiry<T> &data) {
@@ -853,12 +1211,27 @@ const InquiryHistoricalDataService<T>* InquiryHistoricalDataServiceListener<T>::
 //
 // Implementation of InquiryHistoricalDataServiceConnector class
 template<typename T>
-InquiryHistoricalDataServiceConnector<T>::InquiryHistoricalDataServiceConnector(){
+InquiryHistoricalDataServiceConnector<T>::InquiryHistoricalDataServiceConnector(const string &_path) :
+        log_output(_path){
+    journal = nullptr;
+}
 
+template<typename T>
+void InquiryHistoricalDataServiceConnector<T>::SetJournal(JournalWriter* _journal,
+        function<void(Inquiry<T>&)> _replay_handler){
+    journal = _journal;
+    replay_handler = _replay_handler;
 }
 
 template<typename T>
-void InquiryHistoricalDataServiceConnector<T>::Publish(Inquiry<T> &data) {
+void InquiryHistoricalDataServiceConnector<T>::SetLogger(AsyncLogger* _logger, LogFormat format,
+        PriceNotation notation){
+    log_output.SetLogger(_logger, format, notation);
+}
+
+template<typename T>
+void InquiryHistoricalDataServiceConnector<T>::Record(LogRecord &record,
+                                                      Inquiry<T> &data) {
     auto State2String = [](InquiryState s){
         switch(s){
             case RECEIVED: return "RECEIVED";
@@ -869,23 +1242,50 @@ void InquiryHistoricalDataServiceConnector<T>::Publish(Inquiry<T> &data) {
             default: return "NotAInquiryState";
         }
     };
-    ofstream output;
-    output.open("../output/allinquiries.txt", ios_base::app);
-    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    output << put_time(localtime(&now), "%F %T") 
-           << " , InquiryID: " << data.GetInquiryId() 
-           << " , CUSIP: " << data.GetProduct().GetProductId()
-           << " , InquiryState: " << State2String(data.GetState())
-           << " , Side: " << data.GetSide()
-           << " , Price: " << data.GetPrice()
-           << " , Quantity: " << data.GetQuantity()
-           << "\n";
-    output.close();
+    record.Begin(INQUIRY_LOG);
+    record.AddString(data.GetInquiryId());
+    record.AddString(data.GetProduct().GetProductId());
+    record.AddString(State2String(data.GetState()));
+    record.AddInteger(data.GetSide());
+    record.AddDouble(data.GetPrice());
+    record.AddInteger(data.GetQuantity());
+}
+
+template<typename T>
+void InquiryHistoricalDataServiceConnector<T>::Publish(Inquiry<T> &data) {
+    LogRecord record;
+    Record(record, data);
+    log_output.Log(&record);
+    if (journal != nullptr) {
+        journal->Append(data);
+    }
+}
+
+template<typename T>
+void InquiryHistoricalDataServiceConnector<T>::PublishBatch(vector<Inquiry<T>> &data) {
+    vector<LogRecord> records(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        Record(records[i], data[i]);
+    }
+    log_output.Log(records.data(), records.size());
+    if (journal != nullptr) {
+        for (auto& inquiry : data) {
+            journal->Append(inquiry);
+        }
+    }
 }
 
 template<typename T>
 void InquiryHistoricalDataServiceConnector<T>::Subscribe() {
+    Replay(0);
+}
 
+template<typename T>
+void InquiryHistoricalDataServiceConnector<T>::Replay(uint64_t from_sequence) {
+    if (journal != nullptr && replay_handler) {
+        JournalReader(journal->GetDirectory(), journal->GetName()).Replay(
+                replay_handler, from_sequence);
+    }
 }
 
 
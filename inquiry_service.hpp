@@ -9,12 +9,24 @@
 #define TRADING_SYSTEM_INQUIRY_SERVICE_HPP
 
 #include <string>
+#include <vector>
 #include "soa.hpp"
+#include "live_feed.hpp"
+#include "security_master.hpp"
 #include "trade_booking_service.hpp"
+#include "pricing_service.hpp"
+#include "position_service.hpp"
 
 // Various inqyury states
 enum InquiryState { RECEIVED, QUOTED, DONE, REJECTED, CUSTOMER_REJECTED };
 
+// Names of the states in input records
+template<>
+struct EnumNames<InquiryState>{
+    static constexpr const char* NAMES[] = {"RECEIVED", "QUOTED", "DONE",
+                                            "REJECTED", "CUSTOMER_REJECTED"};
+};
+
 /**
  * Inquiry object modeling a customer inquiry from a client.
  * Type T is the product type.
@@ -63,34 +75,103 @@ public:
 };
 
 
+/**
+ * Record of a bond inquiry: inquiry id, CUSIP, quantity, side, price, state.
+ */
+template<>
+struct RecordSchema<Inquiry<Bond>>{
+    using Fields = tuple<TextField<16>, SecurityField, IntegerField, EnumField<Side>,
+                         PriceField, EnumField<InquiryState>>;
+
+    static Inquiry<Bond> Build(pmr::memory_resource* resource, string_view inquiry_id,
+                               const Security* security, long quantity, Side side,
+                               PriceTicks price, InquiryState state);
+
+    static bool Extract(const Inquiry<Bond> &inquiry, const SecurityMaster &master,
+                        string_view &inquiry_id, const Security*& security, long &quantity,
+                        Side &side, PriceTicks &price, InquiryState &state);
+};
+
+
+
+template<typename T>
+class InquiryServiceConnector;
+
 
 /**
  * Service for customer inquiry objects.
  * Keyed on inquiry identifier (NOTE: this is NOT a product identifier since
  * each inquiry must be unique).
+ * Inquiries are quoted off the current mid and bid/offer spread in the
+ * PricingService, skewed against the current Position.
  * Type T is the product type.
  */
 template<typename T>
 class InquiryService : public Service<string,Inquiry <T> >
 {
 private:
+    // Inquiries with a numeric id near the ids seen so far live in a table
+    // indexed by that id, any other id falls back to the map. A slot is
+    // occupied once it has been handed out, as a map entry exists once looked up.
+    vector<Inquiry<T>> inquiry_table;
+    vector<bool> table_occupied;
     map<string, Inquiry<T>> inquiry_data;
     vector<ServiceListener<Inquiry<T>> *> service_listeners;
-    InquiryService();
+    InquiryServiceConnector<T>* inquiry_service_connector;
+    PricingService<T>* pricing_service;
+    PositionService<T>* position_service;
+    double skew_per_million;
+    // Per batch scratch space, members so their storage is reused across
+    // batches. Products keep their snapshot row from batch to batch, a row is
+    // taken again the first time its product comes up in a batch.
+    map<string, size_t> snapshot_index;
+    vector<uint64_t> snapshot_batches;
+    uint64_t batch_number;
+    vector<bool> snapshot_priced;
+    vector<double> snapshot_mids;
+    vector<double> snapshot_half_spreads;
+    vector<double> snapshot_skews;
+    vector<Inquiry<T>> batch_inquiries;
+    vector<double> batch_mids;
+    vector<double> batch_half_spreads;
+    vector<double> batch_skews;
+    vector<double> batch_signs;
+    vector<double> batch_quotes;
+    vector<size_t> batch_products;
+    // Table index of a numeric inquiry id, false for any other id
+    static bool GetTableIndex(const string &inquiryId, size_t &index);
+    // Slot of an inquiry, grows the table at most twofold
+    Inquiry<T>& GetSlot(const string &inquiryId);
+    // Price a received inquiry and send the quote, RECEIVED -> QUOTED or REJECTED
+    void QuoteInquiry(Inquiry<T> &inquiry);
+    // Quote the received inquiries gathered in batch_inquiries and empty it
+    void QuoteBatch();
 public:
-    static InquiryService<T>* GenerateInstance(){
-        static InquiryService<T> instance;
-        return &instance;
-    }
+    // ctor, the table is preallocated for table_size numeric inquiry ids
+    InquiryService(PricingService<T>* _pricing_service,
+            PositionService<T>* _position_service, size_t table_size = 4096);
+    // Instance owned by the default ServiceContext
+    static InquiryService* GenerateInstance();
+    // Set the connector quotes are sent back to the client through
+    void SetConnector(InquiryServiceConnector<T>* _inquiry_service_connector);
     // Override virtual functions in base class Service
-    Inquiry<T>& GetData(string key) override;
+    Inquiry<T>& GetData(const string &key) override;
     void OnMessage(Inquiry<T> &data) override;
+    // Quote a batch of inquiries against one snapshot of prices and
+    // positions, listeners get the quoted batch at once
+    void OnMessageBatch(vector<Inquiry<T>> &batch);
     void AddListener(ServiceListener<Inquiry<T>> *listener) override;
     const vector<ServiceListener<Inquiry<T>>* >& GetListeners() const override;
     // Send a quote back to the client
     void SendQuote(const string &inquiryId, double price);
     // Reject an inquiry from the client
     void RejectInquiry(const string &inquiryId);
+    // Price move applied against each million of aggregate position
+    void SetSkew(double _skew_per_million);
+    // Restore an inquiry saved earlier, listeners are not notified
+    void RestoreInquiry(const Inquiry<T> &inquiry);
+    // Every inquiry received
+    vector<Inquiry<T>> GetInquiries() const;
 
 };
 
@@ -103,14 +184,37 @@ template<typename T>
 class InquiryServiceConnector : public Connector<Inquiry<T> > {
 private:
     InquiryService<T>* inquiry_service;
-    InquiryServiceConnector();
+    string path;
+    size_t batch_size;
+    // Resolves the CUSIP of each record, the default master when not set
+    const SecurityMaster* security_master;
+    RecordFormat format;
+    // Inquiries parsed but not yet handed to the service
+    vector<Inquiry<T>> batch;
+    // Hand an inquiry over, alone or once its batch is full
+    void Dispatch(Inquiry<T> &inquiry);
+    // Hand over a partial batch
+    void FlushBatch();
+    // The master to resolve CUSIPs against
+    const SecurityMaster* GetSecurityMaster() const;
 public:
-    static InquiryServiceConnector<T>* GenerateInstance(){
-        static InquiryServiceConnector<T> instance;
-        return &instance;
-    }
+    // ctor
+    InquiryServiceConnector(InquiryService<T>* _inquiry_service,
+            const string &_path = "../input/inquiries.txt");
+    // Instance owned by the default ServiceContext
+    static InquiryServiceConnector* GenerateInstance();
     void Publish(Inquiry<T>& data) override;
     void Subscribe() override;
+    // Hand inquiries to the service in batches of up to batch_size per poll,
+    // 1 sends them one at a time
+    void SetBatchSize(size_t _batch_size);
+    // Resolve CUSIPs against _security_master instead of the default one
+    void SetSecurityMaster(const SecurityMaster* _security_master);
+    // Read the records at _path, in CSV or binary
+    void SetInput(const string &_path, RecordFormat _format = CSV_RECORDS);
+    // Follow the input on a live feed instead of reading it once, a partial
+    // batch goes out at the end of each read instead of waiting to fill
+    void Follow(LiveFeed &feed, LiveSourceType type = FOLLOW_FILE);
     InquiryService<T>* GetService();
 };
 
@@ -132,7 +236,7 @@ template<typename T>
 Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side,
         long _quantity, double _price, InquiryState _state) : product(_product)
 {
-    inquiryId = _inquiryId;
+    inquiryId = move(_inquiryId);
     side = _side;
     quantity = _quantity;
     price = _price;
@@ -186,34 +290,255 @@ void Inquiry<T>::SetState(InquiryState new_state){
 }
 
 
+//
+// Implementation of RecordSchema<Inquiry<Bond>>
+Inquiry<Bond> RecordSchema<Inquiry<Bond>>::Build(pmr::memory_resource*,
+        string_view inquiry_id, const Security* security, long quantity, Side side,
+        PriceTicks price, InquiryState state){
+    return Inquiry<Bond>(string(inquiry_id), security->bond, side, quantity,
+                         price.ToDouble(), state);
+}
+
+bool RecordSchema<Inquiry<Bond>>::Extract(const Inquiry<Bond> &inquiry,
+        const SecurityMaster &master, string_view &inquiry_id, const Security*& security,
+        long &quantity, Side &side, PriceTicks &price, InquiryState &state){
+    inquiry_id = inquiry.GetInquiryId();
+    security = master.Find(inquiry.GetProduct().GetProductId());
+    quantity = inquiry.GetQuantity();
+    side = inquiry.GetSide();
+    price = PriceTicks::FromDouble(inquiry.GetPrice());
+    state = inquiry.GetState();
+    return security != nullptr;
+}
+
+
 //
 // Implementation of InquiryService class
 template <typename T>
-InquiryService<T>::InquiryService() {
+InquiryService<T>::InquiryService(PricingService<T>* _pricing_service,
+        PositionService<T>* _position_service, size_t table_size) {
+    inquiry_table.resize(table_size);
+    table_occupied.resize(table_size, false);
+    inquiry_service_connector = nullptr;
+    pricing_service = _pricing_service;
+    position_service = _position_service;
+    skew_per_million = 1.0 / 2560.0;
+    batch_number = 0;
+}
+
+template <typename T>
+void InquiryService<T>::SetConnector(InquiryServiceConnector<T>* _inquiry_service_connector) {
+    inquiry_service_connector = _inquiry_service_connector;
+}
+
+template <typename T>
+void InquiryService<T>::SetSkew(double _skew_per_million) {
+    skew_per_million = _skew_per_million;
+}
+
+template <typename T>
+bool InquiryService<T>::GetTableIndex(const string &inquiryId, size_t &index) {
+    // Ids of up to 9 digits without leading zeros
+    bool numeric = !inquiryId.empty() && inquiryId.size() <= 9 &&
+                   (inquiryId[0] != '0' || inquiryId.size() == 1);
+    index = 0;
+    for (size_t i = 0; numeric && i < inquiryId.size(); ++i) {
+        numeric = inquiryId[i] >= '0' && inquiryId[i] <= '9';
+        index = index * 10 + (inquiryId[i] - '0');
+    }
+    return numeric;
+}
+
+template <typename T>
+Inquiry<T>& InquiryService<T>::GetSlot(const string &inquiryId) {
+    // Only ids within twice the table size index it, so a stray large id
+    // can't blow the table up
+    size_t index;
+    size_t limit = max<size_t>(2 * inquiry_table.size(), 1);
+    if (!GetTableIndex(inquiryId, index) || index >= limit) {
+        return inquiry_data[inquiryId];
+    }
+    if (index >= inquiry_table.size()) {
+        inquiry_table.resize(limit);
+        table_occupied.resize(limit, false);
+        // Ids kept in the map so far may fit the table now
+        for (auto it = inquiry_data.begin(); it != inquiry_data.end();) {
+            size_t moved;
+            if (GetTableIndex(it->first, moved) && moved < inquiry_table.size()) {
+                inquiry_table[moved] = move(it->second);
+                table_occupied[moved] = true;
+                it = inquiry_data.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    table_occupied[index] = true;
+    return inquiry_table[index];
+}
+
+template <typename T>
+void InquiryService<T>::RestoreInquiry(const Inquiry<T> &inquiry) {
+    GetSlot(inquiry.GetInquiryId()) = inquiry;
+}
 
+template <typename T>
+vector<Inquiry<T>> InquiryService<T>::GetInquiries() const {
+    vector<Inquiry<T>> inquiries;
+    for (size_t i = 0; i < inquiry_table.size(); ++i) {
+        if (table_occupied[i]) {
+            inquiries.push_back(inquiry_table[i]);
+        }
+    }
+    for (auto& inquiry : inquiry_data) {
+        inquiries.push_back(inquiry.second);
+    }
+    return inquiries;
 }
 
 template <typename T>
-Inquiry<T>& InquiryService<T>::GetData(string key) {
-    return inquiry_data[key];
+Inquiry<T>& InquiryService<T>::GetData(const string &key) {
+    return GetSlot(key);
+}
+
+template <typename T>
+void InquiryService<T>::QuoteInquiry(Inquiry<T> &inquiry) {
+    const string& product_id = inquiry.GetProduct().GetProductId();
+    const Price<T>* price = pricing_service->FindPrice(product_id);
+    if (price == nullptr) {
+        // No live price for the product, nothing to quote off
+        inquiry.SetState(REJECTED);
+        return;
+    }
+    // Long positions lower the quote to attract buyers, short ones raise it
+    long aggregate_position = position_service->GetAggregatePosition(product_id);
+    double skew = skew_per_million * aggregate_position / 1000000.0;
+    double half_spread = price->GetBidOfferSpread().ToDouble() / 2.0;
+    // A client buying is quoted our offer, a client selling our bid
+    double mid = price->GetMid().ToDouble();
+    double quote = (inquiry.GetSide() == BUY) ? mid + half_spread : mid - half_spread;
+    inquiry.SetPrice(quote - skew);
+    inquiry.SetState(QUOTED);
+    if (inquiry_service_connector != nullptr) {
+        inquiry_service_connector->Publish(inquiry);
+    }
 }
 
 template <typename T>
 void InquiryService<T>::OnMessage(Inquiry<T> &data) {
-    if (data.GetState() == QUOTED){
-        data.SetState(DONE);
+    INSTRUMENT_SCOPE("InquiryService");
+    Inquiry<T>& inquiry = GetSlot(data.GetInquiryId());
+    switch (data.GetState()) {
+        case RECEIVED:
+            inquiry = data;
+            QuoteInquiry(inquiry);
+            // The client trades on every quote we send
+            if (inquiry.GetState() == QUOTED) {
+                inquiry.SetState(DONE);
+            }
+            break;
+        case DONE:
+        case CUSTOMER_REJECTED:
+            // The client answering a quote
+            if (inquiry.GetState() != QUOTED) {
+                return;
+            }
+            inquiry.SetState(data.GetState());
+            break;
+        default:
+            return;
     }
-    const string inquiry_id = data.GetInquiryId();
-    if (inquiry_data.find(inquiry_id) == inquiry_data.end()){
-        inquiry_data.insert(make_pair(inquiry_id, data));
+    for(auto listener : service_listeners) {
+        listener->ProcessAdd(inquiry);
     }
-    else{
-        inquiry_data[inquiry_id] = data;
+}
+
+template <typename T>
+void InquiryService<T>::OnMessageBatch(vector<Inquiry<T>> &batch) {
+    INSTRUMENT_SCOPE("InquiryService::Batch");
+    // Runs of received inquiries are quoted together, replies to earlier
+    // quotes go through the single inquiry path, all in arrival order
+    batch_inquiries.clear();
+    for (auto& data : batch) {
+        if (data.GetState() == RECEIVED) {
+            batch_inquiries.push_back(data);
+        }
+        else {
+            QuoteBatch();
+            OnMessage(data);
+        }
+    }
+    QuoteBatch();
+}
+
+template <typename T>
+void InquiryService<T>::QuoteBatch() {
+    if (batch_inquiries.empty()) {
+        return;
+    }
+    // Snapshot the price and position of each product in the batch once
+    ++batch_number;
+    size_t count = batch_inquiries.size();
+    batch_mids.resize(count);
+    batch_half_spreads.resize(count);
+    batch_skews.resize(count);
+    batch_signs.resize(count);
+    batch_quotes.resize(count);
+    batch_products.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const string& product_id = batch_inquiries[i].GetProduct().GetProductId();
+        auto it = snapshot_index.find(product_id);
+        if (it == snapshot_index.end()) {
+            it = snapshot_index.insert(make_pair(product_id, snapshot_mids.size())).first;
+            snapshot_batches.push_back(0);
+            snapshot_priced.push_back(false);
+            snapshot_mids.push_back(0.0);
+            snapshot_half_spreads.push_back(0.0);
+            snapshot_skews.push_back(0.0);
+        }
+        size_t row = it->second;
+        if (snapshot_batches[row] != batch_number) {
+            const Price<T>* price = pricing_service->FindPrice(product_id);
+            long aggregate_position = position_service->GetAggregatePosition(product_id);
+            snapshot_batches[row] = batch_number;
+            snapshot_priced[row] = price != nullptr;
+            snapshot_mids[row] = (price != nullptr) ? price->GetMid().ToDouble() : 0.0;
+            snapshot_half_spreads[row] =
+                    (price != nullptr) ? price->GetBidOfferSpread().ToDouble() / 2.0 : 0.0;
+            snapshot_skews[row] = skew_per_million * aggregate_position / 1000000.0;
+        }
+        batch_products[i] = row;
+        batch_mids[i] = snapshot_mids[row];
+        batch_half_spreads[i] = snapshot_half_spreads[row];
+        batch_skews[i] = snapshot_skews[row];
+        batch_signs[i] = (batch_inquiries[i].GetSide() == BUY) ? 1.0 : -1.0;
+    }
+    // One pass over the flat columns prices the whole batch
+    for (size_t i = 0; i < count; ++i) {
+        batch_quotes[i] = batch_mids[i] + batch_signs[i] * batch_half_spreads[i]
+                          - batch_skews[i];
+    }
+    for (size_t i = 0; i < count; ++i) {
+        Inquiry<T>& inquiry = batch_inquiries[i];
+        if (!snapshot_priced[batch_products[i]]) {
+            inquiry.SetState(REJECTED);
+        }
+        else {
+            inquiry.SetPrice(batch_quotes[i]);
+            inquiry.SetState(QUOTED);
+            if (inquiry_service_connector != nullptr) {
+                inquiry_service_connector->Publish(inquiry);
+            }
+            // The client trades on every quote we send
+            inquiry.SetState(DONE);
+        }
+        GetSlot(inquiry.GetInquiryId()) = inquiry;
     }
     for(auto listener : service_listeners) {
-        listener->ProcessAdd(data);
+        listener->ProcessAddBatch(batch_inquiries);
     }
-    this->SendQuote(inquiry_id, 100);
+    batch_inquiries.clear();
 }
 
 template <typename T>
@@ -228,97 +553,110 @@ const vector<ServiceListener<Inquiry<T>>* >& InquiryService<T>::GetListeners() c
 
 template <typename T>
 void InquiryService<T>::SendQuote(const string &inquiryId, double price){
-    if (inquiry_data[inquiryId].GetState() == RECEIVED) {
-        inquiry_data[inquiryId].SetPrice(price);
-        auto inquiry_service_connector = InquiryServiceConnector<T>::GenerateInstance();
-        inquiry_service_connector->Publish(inquiry_data[inquiryId]);
+    Inquiry<T>& inquiry = GetSlot(inquiryId);
+    if (inquiry.GetState() == RECEIVED) {
+        inquiry.SetPrice(price);
+        inquiry.SetState(QUOTED);
+        if (inquiry_service_connector != nullptr) {
+            inquiry_service_connector->Publish(inquiry);
+        }
+        for(auto listener : service_listeners) {
+            listener->ProcessAdd(inquiry);
+        }
     }
 }
 
 
 template <typename T>
 void InquiryService<T>::RejectInquiry(const string &inquiryId){
-
+    Inquiry<T>& inquiry = GetSlot(inquiryId);
+    if (inquiry.GetState() == RECEIVED) {
+        inquiry.SetState(REJECTED);
+        for(auto listener : service_listeners) {
+            listener->ProcessAdd(inquiry);
+        }
+    }
 }
 
 //
 // Implementation of MarketDataServiceConnector class
 template<typename T>
-InquiryServiceConnector<T>::InquiryServiceConnector() {
-    inquiry_service = InquiryService<T>::GenerateInstance();
+InquiryServiceConnector<T>::InquiryServiceConnector(InquiryService<T>* _inquiry_service,
+        const string &_path) {
+    inquiry_service = _inquiry_service;
+    path = _path;
+    batch_size = 1;
+    security_master = nullptr;
+    format = CSV_RECORDS;
 }
+
+template<typename T>
+void InquiryServiceConnector<T>::SetBatchSize(size_t _batch_size) {
+    batch_size = max<size_t>(1, _batch_size);
+    if (batch_size > 1) {
+        batch.reserve(batch_size);
+    }
+}
+
+template<typename T>
+void InquiryServiceConnector<T>::SetSecurityMaster(const SecurityMaster* _security_master) {
+    security_master = _security_master;
+}
+
+template<typename T>
+void InquiryServiceConnector<T>::SetInput(const string &_path, RecordFormat _format) {
+    path = _path;
+    format = _format;
+}
+
+// Quotes go out to the client, replies come back through Subscribe
 template<typename T>
 void InquiryServiceConnector<T>::Publish(Inquiry<T>& data) {
-    data.SetState(QUOTED);
-    inquiry_service->OnMessage(data);
 }
 
 template<typename T>
 void InquiryServiceConnector<T>::Subscribe() {
-    auto SplitLine = [](string line, char delimiter){
-        vector<string> tokens;
-        string token;
-        istringstream tokenStream(line);
-        while (getline(tokenStream, token, delimiter)){
-            tokens.push_back(token);
-        }
-        return tokens;
-    };
-    auto String2Price = [&](string s){
-        vector<string> split = SplitLine(s, '-');
-        double price = stoi(split[0]);
-        if(split[1][2] == '+')
-            split[1][2] = '4';
-        price += stoi(split[1].substr(0,2)) / 32.0;
-        price += stoi(split[1].substr(2,3)) / 256.0;
-        return price;
-    };
-    auto FindMaturity = [](string cusip){
-        vector<string> cusip_codes = {"9128285Q9", "9128285R7", "9128285P1",
-                                      "9128285N6", "9128285M8", "912810SE9"};
-        vector<date> dates = {date(2020, 11, 30), date(2021, 12, 15),
-                              date(2023, 11, 30), date(2025, 11, 30),
-                              date(2028, 12, 15), date(2048, 11, 15)};
-        for(int i = 0; i < 6; ++i){
-            if(cusip == cusip_codes[i])
-                return dates[i];
-        }
-    };
-    auto String2State = [](string s){
-        vector<InquiryState> states{ RECEIVED, QUOTED, DONE,
-                                     REJECTED, CUSTOMER_REJECTED };
-        vector<string> strings{"RECEIVED", "QUOTED", "DONE",
-                                "REJECTED", "CUSTOMER_REJECTED"};
-        for(int i = 0; i < 5; ++i){
-            if(s == strings[i]){
-                return states[i];
-            }
-        }
-    };
-    ifstream data;
-    data.open("../input/inquiries.txt", ios::in);
-    string line;
-    getline(data, line);
-    while(getline(data, line)){
-        vector<string> line_fragments = SplitLine(line, ',');
-        string inquiry_id = line_fragments[0];
-        // Construction of Bond
-        string cusip = line_fragments[1];
-        string ticker = "NoTicker";
-        float coupon = 0.0;
-        date maturity_date = FindMaturity(cusip);
-        Bond bond(cusip, CUSIP, ticker, coupon, maturity_date);
-        // Construction of Inquiry<Bond>
-        long quantity = stol(line_fragments[2]);
-        Side side = (line_fragments[3] == "BUY") ? BUY : SELL;
-        double price = String2Price(line_fragments[4]);
-        InquiryState inquiry_state = String2State(line_fragments[5]);
-        Inquiry<Bond> bond_inquiry(inquiry_id, bond, side,
-                                   quantity, price, inquiry_state);
-        inquiry_service->OnMessage(bond_inquiry);
+    // Records of unknown CUSIPs, sides or states are skipped
+    RecordParser<Inquiry<T>> parser(GetSecurityMaster(), format);
+    parser.ParseFile(path, [this](Inquiry<T> &inquiry){ Dispatch(inquiry); });
+    FlushBatch();
+}
+
+template<typename T>
+void InquiryServiceConnector<T>::Follow(LiveFeed &feed, LiveSourceType type) {
+    LiveFeed::Consumer consumer = MakeRecordConsumer<Inquiry<T>>(type, GetSecurityMaster(), format,
+            [this](Inquiry<T> &inquiry){ Dispatch(inquiry); });
+    feed.Add(path, type, [this, consumer](LiveEvent event, const char* data, size_t size){
+        consumer(event, data, size);
+        FlushBatch();
+    });
+}
+
+template<typename T>
+void InquiryServiceConnector<T>::Dispatch(Inquiry<T> &inquiry) {
+    if (batch_size == 1) {
+        inquiry_service->OnMessage(inquiry);
+        return;
+    }
+    batch.push_back(inquiry);
+    if (batch.size() == batch_size) {
+        FlushBatch();
+    }
+}
+
+template<typename T>
+void InquiryServiceConnector<T>::FlushBatch() {
+    if (!batch.empty()) {
+        inquiry_service->OnMessageBatch(batch);
+        batch.clear();
     }
 }
 
+template<typename T>
+const SecurityMaster* InquiryServiceConnector<T>::GetSecurityMaster() const {
+    return (security_master != nullptr) ? security_master : &SecurityMaster::Default();
+}
+
 template<typename T>
 InquiryService<T>* InquiryServiceConnector<T>::GetService() {
     return inquiry_service;
@@ -0,0 +1,398 @@
+/**
+ * instrumentation.hpp
+ * Defines compile-time switchable latency instrumentation of the services:
+ * per-stage event counters and log-linear latency histograms kept in
+ * thread-local buffers.
+ *
+ * Build with TRADING_SYSTEM_INSTRUMENTATION defined to turn it on, otherwise
+ * the INSTRUMENT_* macros expand to nothing.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_INSTRUMENTATION_HPP
+#define TRADING_SYSTEM_INSTRUMENTATION_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+#define INSTRUMENT_CONCAT_INNER(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_INNER(a, b)
+
+#ifdef TRADING_SYSTEM_INSTRUMENTATION
+// Time the enclosing scope as one event of the named stage, less the time
+// spent in the instrumented scopes nested in it
+#define INSTRUMENT_SCOPE(name) \
+    static const size_t INSTRUMENT_CONCAT(instrument_stage_, __LINE__) = \
+            Instrumentation::RegisterStage(name); \
+    InstrumentationScope INSTRUMENT_CONCAT(instrument_scope_, __LINE__)( \
+            INSTRUMENT_CONCAT(instrument_stage_, __LINE__))
+// Write the merged statistics of every thread
+#define INSTRUMENT_DUMP(stream) Instrumentation::Dump(stream)
+#else
+#define INSTRUMENT_SCOPE(name)
+#define INSTRUMENT_DUMP(stream)
+#endif
+
+
+/**
+ * Log-linear latency histogram in ticks: every power of two is split into
+ * eight linear sub-buckets, so any recorded value is within 12.5%.
+ */
+class LatencyHistogram{
+private:
+    static const int SUB_BUCKETS = 8;
+    static const int BUCKETS = 62 * SUB_BUCKETS;
+    uint64_t counts[BUCKETS];
+    uint64_t total_count;
+    uint64_t max_value;
+
+    static int BucketIndex(uint64_t value);
+
+    // Largest value falling into a bucket
+    static uint64_t BucketLimit(int index);
+
+public:
+    // ctor
+    LatencyHistogram();
+
+    void Record(uint64_t value);
+
+    void Merge(const LatencyHistogram &other);
+
+    uint64_t GetCount() const;
+
+    uint64_t GetMax() const;
+
+    // Value below which the given fraction of the recorded values fall
+    uint64_t GetPercentile(double fraction) const;
+
+};
+
+
+/**
+ * Event counters and latency histogram of every stage, filled by one thread.
+ */
+class InstrumentationBuffer{
+private:
+    vector<LatencyHistogram> stage_histograms;
+    chrono::steady_clock::time_point last_report;
+    uint64_t events_since_check;
+
+public:
+    // ctor
+    InstrumentationBuffer();
+
+    void Record(size_t stage, uint64_t ticks);
+
+    const vector<LatencyHistogram>& GetHistograms() const;
+
+};
+
+
+/**
+ * Registry of the stages and of the per-thread buffers.
+ */
+class Instrumentation{
+private:
+    static mutex& GetMutex();
+
+    static vector<string>& GetStageNames();
+
+    static vector<shared_ptr<InstrumentationBuffer>>& GetBuffers();
+
+    // Tick counter and clock read when the first stage registered
+    static pair<uint64_t, chrono::steady_clock::time_point>& GetEpoch();
+
+public:
+    // Index of a stage, registering it on first use
+    static size_t RegisterStage(const string &name);
+
+    // The calling thread's buffer
+    static InstrumentationBuffer& GetBuffer();
+
+    // Time stamp counter, the steady clock in nanoseconds where there is none
+    static uint64_t GetTicks();
+
+    // Nanoseconds per tick, measured against the steady clock since the epoch
+    static double GetNanosPerTick();
+
+    // Seconds between the stats lines each thread prints, 0 turns them off
+    static double& GetReportInterval();
+
+    // Print one line per stage with its count and latency percentiles
+    static void WriteStats(ostream &stream, const vector<LatencyHistogram> &histograms);
+
+    // Merge the buffers of every thread and write their statistics, to be
+    // called once the instrumented threads are done
+    static void Dump(ostream &stream);
+
+};
+
+
+/**
+ * Records the ticks spent between construction and destruction, less the
+ * ticks of the scopes nested in it, so each stage gets its self time.
+ */
+class InstrumentationScope{
+private:
+    size_t stage;
+    uint64_t start;
+    // Ticks spent in the scopes nested in this one
+    uint64_t child_ticks;
+    InstrumentationScope* parent;
+
+    // Innermost open scope of the thread, the top of its scope stack
+    static thread_local InstrumentationScope* current_scope;
+
+public:
+    // ctor
+    InstrumentationScope(size_t _stage);
+
+    ~InstrumentationScope();
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of LatencyHistogram class
+LatencyHistogram::LatencyHistogram(){
+    fill(counts, counts + BUCKETS, 0);
+    total_count = 0;
+    max_value = 0;
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value){
+    if(value < SUB_BUCKETS){
+        return (int) value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int sub_bucket = (int) ((value >> (exponent - 3)) & (SUB_BUCKETS - 1));
+    return min((exponent - 2) * SUB_BUCKETS + sub_bucket, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::BucketLimit(int index){
+    if(index < SUB_BUCKETS){
+        return index;
+    }
+    int exponent = index / SUB_BUCKETS + 2;
+    uint64_t sub_bucket = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub_bucket + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value){
+    ++counts[BucketIndex(value)];
+    ++total_count;
+    max_value = max(max_value, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other){
+    for(int i = 0; i < BUCKETS; ++i){
+        counts[i] += other.counts[i];
+    }
+    total_count += other.total_count;
+    max_value = max(max_value, other.max_value);
+}
+
+uint64_t LatencyHistogram::GetCount() const{
+    return total_count;
+}
+
+uint64_t LatencyHistogram::GetMax() const{
+    return max_value;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double fraction) const{
+    uint64_t rank = (uint64_t) (fraction * total_count);
+    uint64_t seen = 0;
+    for(int i = 0; i < BUCKETS; ++i){
+        seen += counts[i];
+        if(seen > rank){
+            return min(BucketLimit(i), max_value);
+        }
+    }
+    return max_value;
+}
+
+
+//
+// Implementation of InstrumentationBuffer class
+InstrumentationBuffer::InstrumentationBuffer(){
+    last_report = chrono::steady_clock::now();
+    events_since_check = 0;
+}
+
+void InstrumentationBuffer::Record(size_t stage, uint64_t ticks){
+    if(stage >= stage_histograms.size()){
+        stage_histograms.resize(stage + 1);
+    }
+    stage_histograms[stage].Record(ticks);
+    // Look at the clock only every 64k events to keep it off the hot path
+    if(++events_since_check < (1 << 16)){
+        return;
+    }
+    events_since_check = 0;
+    double interval = Instrumentation::GetReportInterval();
+    auto now = chrono::steady_clock::now();
+    if(interval > 0.0 &&
+       chrono::duration<double>(now - last_report).count() >= interval){
+        last_report = now;
+        Instrumentation::WriteStats(cerr, stage_histograms);
+    }
+}
+
+const vector<LatencyHistogram>& InstrumentationBuffer::GetHistograms() const{
+    return stage_histograms;
+}
+
+
+//
+// Implementation of Instrumentation class
+mutex& Instrumentation::GetMutex(){
+    static mutex registry_mutex;
+    return registry_mutex;
+}
+
+vector<string>& Instrumentation::GetStageNames(){
+    static vector<string> stage_names;
+    return stage_names;
+}
+
+vector<shared_ptr<InstrumentationBuffer>>& Instrumentation::GetBuffers(){
+    // Buffers are shared so they outlive the threads that filled them
+    static vector<shared_ptr<InstrumentationBuffer>> buffers;
+    return buffers;
+}
+
+pair<uint64_t, chrono::steady_clock::time_point>& Instrumentation::GetEpoch(){
+    static pair<uint64_t, chrono::steady_clock::time_point> epoch(
+            GetTicks(), chrono::steady_clock::now());
+    return epoch;
+}
+
+size_t Instrumentation::RegisterStage(const string &name){
+    lock_guard<mutex> lock(GetMutex());
+    GetEpoch();
+    vector<string>& stage_names = GetStageNames();
+    for(size_t i = 0; i < stage_names.size(); ++i){
+        if(stage_names[i] == name){
+            return i;
+        }
+    }
+    stage_names.push_back(name);
+    return stage_names.size() - 1;
+}
+
+InstrumentationBuffer& Instrumentation::GetBuffer(){
+    thread_local shared_ptr<InstrumentationBuffer> buffer;
+    if(!buffer){
+        buffer = make_shared<InstrumentationBuffer>();
+        lock_guard<mutex> lock(GetMutex());
+        GetBuffers().push_back(buffer);
+    }
+    return *buffer;
+}
+
+uint64_t Instrumentation::GetTicks(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+double Instrumentation::GetNanosPerTick(){
+    auto& epoch = GetEpoch();
+    uint64_t ticks = GetTicks() - epoch.first;
+    double nanos = chrono::duration<double, nano>(
+            chrono::steady_clock::now() - epoch.second).count();
+    return (ticks == 0) ? 1.0 : nanos / ticks;
+}
+
+double& Instrumentation::GetReportInterval(){
+    static double report_interval = 10.0;
+    return report_interval;
+}
+
+void Instrumentation::WriteStats(ostream &stream,
+        const vector<LatencyHistogram> &histograms){
+    double nanos_per_tick = GetNanosPerTick();
+    vector<string> stage_names;
+    {
+        lock_guard<mutex> lock(GetMutex());
+        stage_names = GetStageNames();
+    }
+    ios_base::fmtflags flags = stream.flags();
+    streamsize precision = stream.precision();
+    stream << fixed << setprecision(0);
+    for(size_t i = 0; i < histograms.size() && i < stage_names.size(); ++i){
+        const LatencyHistogram& histogram = histograms[i];
+        if(histogram.GetCount() == 0){
+            continue;
+        }
+        stream << "instrumentation , Stage: " << stage_names[i]
+               << " , Count: " << histogram.GetCount()
+               << " , P50(ns): " << histogram.GetPercentile(0.50) * nanos_per_tick
+               << " , P99(ns): " << histogram.GetPercentile(0.99) * nanos_per_tick
+               << " , P99.9(ns): " << histogram.GetPercentile(0.999) * nanos_per_tick
+               << " , Max(ns): " << histogram.GetMax() * nanos_per_tick
+               << "\n";
+    }
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+void Instrumentation::Dump(ostream &stream){
+    vector<LatencyHistogram> merged;
+    {
+        lock_guard<mutex> lock(GetMutex());
+        for(auto& buffer : GetBuffers()){
+            const vector<LatencyHistogram>& histograms = buffer->GetHistograms();
+            if(histograms.size() > merged.size()){
+                merged.resize(histograms.size());
+            }
+            for(size_t i = 0; i < histograms.size(); ++i){
+                merged[i].Merge(histograms[i]);
+            }
+        }
+    }
+    WriteStats(stream, merged);
+}
+
+
+//
+// Implementation of InstrumentationScope class
+thread_local InstrumentationScope* InstrumentationScope::current_scope = nullptr;
+
+InstrumentationScope::InstrumentationScope(size_t _stage){
+    stage = _stage;
+    child_ticks = 0;
+    parent = current_scope;
+    current_scope = this;
+    start = Instrumentation::GetTicks();
+}
+
+InstrumentationScope::~InstrumentationScope(){
+    uint64_t elapsed = Instrumentation::GetTicks() - start;
+    Instrumentation::GetBuffer().Record(stage, elapsed - min(child_ticks, elapsed));
+    if(parent != nullptr){
+        parent->child_ticks += elapsed;
+    }
+    current_scope = parent;
+}
+
+#endif //TRADING_SYSTEM_INSTRUMENTATION_HPP
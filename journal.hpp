@@ -0,0 +1,695 @@
+/**
+ * journal.hpp
+ * Defines a binary, append-only journal of memory-mapped segment files, the
+ * codecs of the records written to it and a reader replaying it.
+ *
+ * Each record is [length][crc32][sequence][type][payload], padded to eight
+ * bytes. A zero length or a checksum mismatch marks the end of a segment.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_JOURNAL_HPP
+#define TRADING_SYSTEM_JOURNAL_HPP
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "products.hpp"
+#include "position_service.hpp"
+#include "risk_service.hpp"
+#include "execution_service.hpp"
+#include "streaming_service.hpp"
+#include "inquiry_service.hpp"
+
+using namespace std;
+
+// Types of the records in a journal
+enum JournalRecordType { POSITION_RECORD = 1, RISK_RECORD, EXECUTION_RECORD,
+                         STREAMING_RECORD, INQUIRY_RECORD, SNAPSHOT_RECORD };
+
+
+/**
+ * Header in front of every record payload.
+ */
+struct JournalRecordHeader{
+    uint32_t length;
+    uint32_t crc;
+    uint64_t sequence;
+    uint32_t type;
+    uint32_t reserved;
+};
+
+// CRC-32 (IEEE) of a buffer, continuing from a previous crc
+uint32_t Crc32(const char *data, size_t length, uint32_t crc = 0);
+
+// Checksum of a record, covering the sequence, the type and the payload
+uint32_t RecordCrc(const JournalRecordHeader &header, const char *payload);
+
+// Bytes a record with a payload of the given length takes in a segment
+size_t RecordSize(size_t length);
+
+
+/**
+ * Serializes plain values and strings into a byte buffer.
+ */
+class JournalEncoder{
+private:
+    vector<char> bytes;
+
+public:
+    void Clear();
+
+    template<typename P>
+    void Put(const P &value);
+
+    void PutString(const string &value);
+
+    const vector<char>& GetBytes() const;
+
+};
+
+
+/**
+ * Reads back what JournalEncoder wrote.
+ */
+class JournalDecoder{
+private:
+    const char* data;
+    size_t size;
+    size_t offset;
+
+public:
+    // ctor
+    JournalDecoder(const char *_data, size_t _size);
+
+    template<typename P>
+    P Get();
+
+    string GetString();
+
+};
+
+
+/**
+ * Binary codec of a product type, specialized for each product.
+ * Type T is the product type.
+ */
+template<typename T>
+class ProductCodec;
+
+template<>
+class ProductCodec<Bond>{
+public:
+    static void Encode(JournalEncoder &encoder, const Bond &bond);
+
+    static Bond Decode(JournalDecoder &decoder);
+
+};
+
+
+/**
+ * Binary codec of a journaled data type, specialized for each of them.
+ * Type V is the data type.
+ */
+template<typename V>
+class RecordCodec;
+
+template<typename T>
+class RecordCodec<Position<T>>{
+public:
+    static const JournalRecordType TYPE = POSITION_RECORD;
+
+    static void Encode(JournalEncoder &encoder, const Position<T> &position);
+
+    static Position<T> Decode(JournalDecoder &decoder);
+
+};
+
+template<typename T>
+class RecordCodec<PV01<T>>{
+public:
+    static const JournalRecordType TYPE = RISK_RECORD;
+
+    static void Encode(JournalEncoder &encoder, const PV01<T> &pv01);
+
+    static PV01<T> Decode(JournalDecoder &decoder);
+
+};
+
+template<typename T>
+class RecordCodec<ExecutionOrder<T>>{
+public:
+    static const JournalRecordType TYPE = EXECUTION_RECORD;
+
+    static void Encode(JournalEncoder &encoder, const ExecutionOrder<T> &order);
+
+    static ExecutionOrder<T> Decode(JournalDecoder &decoder);
+
+};
+
+template<typename T>
+class RecordCodec<PriceStream<T>>{
+public:
+    static const JournalRecordType TYPE = STREAMING_RECORD;
+
+    static void Encode(JournalEncoder &encoder, const PriceStream<T> &price_stream);
+
+    static PriceStream<T> Decode(JournalDecoder &decoder);
+
+};
+
+template<typename T>
+class RecordCodec<Inquiry<T>>{
+public:
+    static const JournalRecordType TYPE = INQUIRY_RECORD;
+
+    static void Encode(JournalEncoder &encoder, const Inquiry<T> &inquiry);
+
+    static Inquiry<T> Decode(JournalDecoder &decoder);
+
+};
+
+
+/**
+ * Reads the records of a journal, segment after segment.
+ */
+class JournalReader{
+private:
+    string directory;
+    string name;
+
+public:
+    // ctor
+    JournalReader(const string &_directory, const string &_name);
+
+    // Path of a segment file
+    static string SegmentPath(const string &directory, const string &name, int index);
+
+    // Walk the valid records of a mapped segment, returns where they end
+    static size_t ScanSegment(const char *segment, size_t size,
+            const function<void(const JournalRecordHeader&, const char*)> &handler);
+
+    // Hand every valid record after from_sequence to the handler, returns
+    // the last sequence number seen
+    uint64_t Read(const function<void(const JournalRecordHeader&, const char*)> &handler,
+                  uint64_t from_sequence = 0) const;
+
+    // Decode the records of type V after from_sequence into the handler
+    template<typename V>
+    uint64_t Replay(const function<void(V&)> &handler, uint64_t from_sequence = 0) const;
+
+};
+
+
+/**
+ * Appends records to a journal of fixed size memory-mapped segment files,
+ * <directory>/<name>.<index>.journal, continuing after the last valid record
+ * already there.
+ */
+class JournalWriter{
+private:
+    string directory;
+    string name;
+    size_t segment_size;
+    int segment_index;
+    int segment_fd;
+    char* segment;
+    size_t mapped_size;
+    size_t offset;
+    uint64_t sequence;
+    JournalEncoder encoder;
+
+    void OpenSegment(int index, size_t size);
+
+    void CloseSegment();
+
+public:
+    // ctor
+    JournalWriter(const string &_directory, const string &_name,
+                  size_t _segment_size = 64 << 20);
+
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    const string& GetDirectory() const;
+
+    const string& GetName() const;
+
+    // Sequence number of the last record written
+    uint64_t GetSequence() const;
+
+    // Append a raw payload, returns its sequence number
+    uint64_t Append(JournalRecordType type, const char *payload, size_t length);
+
+    // Encode and append a record
+    template<typename V>
+    uint64_t Append(const V &data);
+
+    // Flush the mapped segment to disk
+    void Sync();
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+uint32_t Crc32(const char *data, size_t length, uint32_t crc){
+    // Built once, thread safe like any function-local static
+    static const array<uint32_t, 256> table = []{
+        array<uint32_t, 256> entries;
+        for(uint32_t i = 0; i < 256; ++i){
+            uint32_t c = i;
+            for(int k = 0; k < 8; ++k){
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for(size_t i = 0; i < length; ++i){
+        crc = table[(crc ^ (uint8_t) data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t RecordCrc(const JournalRecordHeader &header, const char *payload){
+    uint32_t crc = Crc32((const char*) &header.sequence,
+                         sizeof(JournalRecordHeader) - 2 * sizeof(uint32_t));
+    return Crc32(payload, header.length, crc);
+}
+
+size_t RecordSize(size_t length){
+    return (sizeof(JournalRecordHeader) + length + 7) & ~size_t(7);
+}
+
+
+//
+// Implementation of JournalEncoder class
+void JournalEncoder::Clear(){
+    bytes.clear();
+}
+
+template<typename P>
+void JournalEncoder::Put(const P &value){
+    const char* raw = (const char*) &value;
+    bytes.insert(bytes.end(), raw, raw + sizeof(P));
+}
+
+void JournalEncoder::PutString(const string &value){
+    Put<uint32_t>(value.size());
+    bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+const vector<char>& JournalEncoder::GetBytes() const{
+    return bytes;
+}
+
+
+//
+// Implementation of JournalDecoder class
+JournalDecoder::JournalDecoder(const char *_data, size_t _size){
+    data = _data;
+    size = _size;
+    offset = 0;
+}
+
+template<typename P>
+P JournalDecoder::Get(){
+    P value = P();
+    if(offset + sizeof(P) <= size){
+        memcpy(&value, data + offset, sizeof(P));
+    }
+    offset += sizeof(P);
+    return value;
+}
+
+string JournalDecoder::GetString(){
+    uint32_t length = Get<uint32_t>();
+    if(offset + length > size){
+        offset = size;
+        return string();
+    }
+    string value(data + offset, length);
+    offset += length;
+    return value;
+}
+
+
+//
+// Implementation of ProductCodec<Bond> class
+void ProductCodec<Bond>::Encode(JournalEncoder &encoder, const Bond &bond){
+    encoder.PutString(bond.GetProductId());
+    encoder.Put<uint8_t>(bond.GetBondIdType());
+    encoder.PutString(bond.GetTicker());
+    encoder.Put<float>(bond.GetCoupon());
+    // Maturity as a day number, -1 for no date
+    encoder.Put<int64_t>(bond.GetMaturityDay());
+}
+
+Bond ProductCodec<Bond>::Decode(JournalDecoder &decoder){
+    string product_id = decoder.GetString();
+    BondIdType bond_id_type = (BondIdType) decoder.Get<uint8_t>();
+    string ticker = decoder.GetString();
+    float coupon = decoder.Get<float>();
+    int64_t day_number = decoder.Get<int64_t>();
+    date maturity;
+    if(day_number >= 0){
+        gregorian_calendar::ymd_type ymd =
+                gregorian_calendar::from_day_number((uint32_t) day_number);
+        maturity = date(ymd.year, ymd.month, ymd.day);
+    }
+    return Bond(product_id, bond_id_type, ticker, coupon, maturity);
+}
+
+
+//
+// Implementation of RecordCodec specializations
+template<typename T>
+void RecordCodec<Position<T>>::Encode(JournalEncoder &encoder, const Position<T> &position){
+    ProductCodec<T>::Encode(encoder, position.GetProduct());
+    const map<string, long>& positions = position.GetPositions();
+    encoder.Put<uint32_t>(positions.size());
+    for(auto& book : positions){
+        encoder.PutString(book.first);
+        encoder.Put<int64_t>(book.second);
+    }
+}
+
+template<typename T>
+Position<T> RecordCodec<Position<T>>::Decode(JournalDecoder &decoder){
+    Position<T> position(ProductCodec<T>::Decode(decoder));
+    uint32_t book_count = decoder.Get<uint32_t>();
+    for(uint32_t i = 0; i < book_count; ++i){
+        string book = decoder.GetString();
+        position.SetPosition(book, decoder.Get<int64_t>());
+    }
+    return position;
+}
+
+template<typename T>
+void RecordCodec<PV01<T>>::Encode(JournalEncoder &encoder, const PV01<T> &pv01){
+    ProductCodec<T>::Encode(encoder, pv01.GetProduct());
+    encoder.Put<double>(pv01.GetPV01());
+    encoder.Put<int64_t>(pv01.GetQuantity());
+}
+
+template<typename T>
+PV01<T> RecordCodec<PV01<T>>::Decode(JournalDecoder &decoder){
+    T product = ProductCodec<T>::Decode(decoder);
+    double pv01 = decoder.Get<double>();
+    long quantity = decoder.Get<int64_t>();
+    return PV01<T>(product, pv01, quantity);
+}
+
+template<typename T>
+void RecordCodec<ExecutionOrder<T>>::Encode(JournalEncoder &encoder,
+        const ExecutionOrder<T> &order){
+    ProductCodec<T>::Encode(encoder, order.GetProduct());
+    encoder.Put<uint8_t>(order.GetSide());
+    encoder.PutString(order.GetOrderId());
+    encoder.Put<uint8_t>(order.GetOrderType());
+    encoder.Put<double>(order.GetPrice().ToDouble());
+    encoder.Put<int64_t>(order.GetVisibleQuantity());
+    encoder.Put<int64_t>(order.GetHiddenQuantity());
+    encoder.PutString(order.GetParentOrderId());
+    encoder.Put<uint8_t>(order.IsChildOrder());
+}
+
+template<typename T>
+ExecutionOrder<T> RecordCodec<ExecutionOrder<T>>::Decode(JournalDecoder &decoder){
+    T product = ProductCodec<T>::Decode(decoder);
+    PricingSide side = (PricingSide) decoder.Get<uint8_t>();
+    string order_id = decoder.GetString();
+    OrderType order_type = (OrderType) decoder.Get<uint8_t>();
+    PriceTicks price = PriceTicks::FromDouble(decoder.Get<double>());
+    long visible_quantity = decoder.Get<int64_t>();
+    long hidden_quantity = decoder.Get<int64_t>();
+    string parent_order_id = decoder.GetString();
+    bool is_child_order = decoder.Get<uint8_t>() != 0;
+    return ExecutionOrder<T>(product, side, order_id, order_type, price,
+            visible_quantity, hidden_quantity, parent_order_id, is_child_order);
+}
+
+template<typename T>
+void RecordCodec<PriceStream<T>>::Encode(JournalEncoder &encoder,
+        const PriceStream<T> &price_stream){
+    ProductCodec<T>::Encode(encoder, price_stream.GetProduct());
+    for(const PriceStreamOrder* order : {&price_stream.GetBidOrder(),
+                                         &price_stream.GetOfferOrder()}){
+        encoder.Put<double>(order->GetPrice());
+        encoder.Put<int64_t>(order->GetVisibleQuantity());
+        encoder.Put<int64_t>(order->GetHiddenQuantity());
+    }
+}
+
+template<typename T>
+PriceStream<T> RecordCodec<PriceStream<T>>::Decode(JournalDecoder &decoder){
+    T product = ProductCodec<T>::Decode(decoder);
+    double bid = decoder.Get<double>();
+    long bid_visible = decoder.Get<int64_t>();
+    long bid_hidden = decoder.Get<int64_t>();
+    double offer = decoder.Get<double>();
+    long offer_visible = decoder.Get<int64_t>();
+    long offer_hidden = decoder.Get<int64_t>();
+    return PriceStream<T>(product,
+            PriceStreamOrder(bid, bid_visible, bid_hidden, BID),
+            PriceStreamOrder(offer, offer_visible, offer_hidden, OFFER));
+}
+
+template<typename T>
+void RecordCodec<Inquiry<T>>::Encode(JournalEncoder &encoder, const Inquiry<T> &inquiry){
+    encoder.PutString(inquiry.GetInquiryId());
+    ProductCodec<T>::Encode(encoder, inquiry.GetProduct());
+    encoder.Put<uint8_t>(inquiry.GetSide());
+    encoder.Put<int64_t>(inquiry.GetQuantity());
+    encoder.Put<double>(inquiry.GetPrice());
+    encoder.Put<uint8_t>(inquiry.GetState());
+}
+
+template<typename T>
+Inquiry<T> RecordCodec<Inquiry<T>>::Decode(JournalDecoder &decoder){
+    string inquiry_id = decoder.GetString();
+    T product = ProductCodec<T>::Decode(decoder);
+    Side side = (Side) decoder.Get<uint8_t>();
+    long quantity = decoder.Get<int64_t>();
+    double price = decoder.Get<double>();
+    InquiryState state = (InquiryState) decoder.Get<uint8_t>();
+    return Inquiry<T>(inquiry_id, product, side, quantity, price, state);
+}
+
+
+//
+// Implementation of JournalReader class
+JournalReader::JournalReader(const string &_directory, const string &_name){
+    directory = _directory;
+    name = _name;
+}
+
+string JournalReader::SegmentPath(const string &directory, const string &name, int index){
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%06d.journal", index);
+    return directory + name + suffix;
+}
+
+size_t JournalReader::ScanSegment(const char *segment, size_t size,
+        const function<void(const JournalRecordHeader&, const char*)> &handler){
+    size_t offset = 0;
+    while(offset + sizeof(JournalRecordHeader) <= size){
+        JournalRecordHeader header;
+        memcpy(&header, segment + offset, sizeof(header));
+        if(header.length == 0 || offset + RecordSize(header.length) > size){
+            break;
+        }
+        const char* payload = segment + offset + sizeof(header);
+        if(RecordCrc(header, payload) != header.crc){
+            break;
+        }
+        if(handler){
+            handler(header, payload);
+        }
+        offset += RecordSize(header.length);
+    }
+    return offset;
+}
+
+uint64_t JournalReader::Read(
+        const function<void(const JournalRecordHeader&, const char*)> &handler,
+        uint64_t from_sequence) const{
+    uint64_t last_sequence = from_sequence;
+    for(int index = 0; ; ++index){
+        int fd = open(SegmentPath(directory, name, index).c_str(), O_RDONLY);
+        if(fd < 0){
+            break;
+        }
+        struct stat file_stat;
+        size_t size = (fstat(fd, &file_stat) == 0) ? file_stat.st_size : 0;
+        void* mapped = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                                  : MAP_FAILED;
+        close(fd);
+        if(mapped == MAP_FAILED){
+            continue;
+        }
+        ScanSegment((const char*) mapped, size,
+                    [&](const JournalRecordHeader &header, const char *payload){
+            if(header.sequence > from_sequence){
+                handler(header, payload);
+                last_sequence = header.sequence;
+            }
+        });
+        munmap(mapped, size);
+    }
+    return last_sequence;
+}
+
+template<typename V>
+uint64_t JournalReader::Replay(const function<void(V&)> &handler,
+                               uint64_t from_sequence) const{
+    return Read([&](const JournalRecordHeader &header, const char *payload){
+        if(header.type != RecordCodec<V>::TYPE){
+            return;
+        }
+        JournalDecoder decoder(payload, header.length);
+        V data = RecordCodec<V>::Decode(decoder);
+        handler(data);
+    }, from_sequence);
+}
+
+
+//
+// Implementation of JournalWriter class
+JournalWriter::JournalWriter(const string &_directory, const string &_name,
+                             size_t _segment_size){
+    directory = _directory;
+    name = _name;
+    segment_size = _segment_size;
+    segment_index = 0;
+    segment_fd = -1;
+    segment = nullptr;
+    mapped_size = 0;
+    offset = 0;
+    sequence = 0;
+    mkdir(directory.c_str(), 0755);
+    // Continue after the last valid record of the last segment
+    JournalReader reader(directory, name);
+    sequence = reader.Read([](const JournalRecordHeader&, const char*){});
+    while(access(JournalReader::SegmentPath(directory, name,
+                                            segment_index + 1).c_str(), F_OK) == 0){
+        ++segment_index;
+    }
+    OpenSegment(segment_index, segment_size);
+    offset = JournalReader::ScanSegment(segment, mapped_size, nullptr);
+}
+
+JournalWriter::~JournalWriter(){
+    CloseSegment();
+}
+
+void JournalWriter::OpenSegment(int index, size_t size){
+    segment_index = index;
+    string path = JournalReader::SegmentPath(directory, name, index);
+    segment_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(segment_fd < 0){
+        throw runtime_error("JournalWriter: cannot open " + path + ": " + strerror(errno));
+    }
+    struct stat file_stat;
+    const char* failed = nullptr;
+    if(fstat(segment_fd, &file_stat) < 0){
+        failed = "cannot stat ";
+    }
+    else{
+        mapped_size = max((size_t) file_stat.st_size, size);
+        if((size_t) file_stat.st_size < mapped_size &&
+           ftruncate(segment_fd, mapped_size) < 0){
+            failed = "cannot extend ";
+        }
+    }
+    if(failed == nullptr){
+        void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, segment_fd, 0);
+        if(mapped == MAP_FAILED){
+            failed = "cannot map ";
+        }
+        else{
+            segment = (char*) mapped;
+        }
+    }
+    if(failed != nullptr){
+        int error = errno;
+        close(segment_fd);
+        segment_fd = -1;
+        throw runtime_error("JournalWriter: " + string(failed) + path + ": " + strerror(error));
+    }
+    offset = 0;
+}
+
+void JournalWriter::CloseSegment(){
+    if(segment != nullptr){
+        munmap(segment, mapped_size);
+        segment = nullptr;
+    }
+    if(segment_fd >= 0){
+        close(segment_fd);
+        segment_fd = -1;
+    }
+}
+
+const string& JournalWriter::GetDirectory() const{
+    return directory;
+}
+
+const string& JournalWriter::GetName() const{
+    return name;
+}
+
+uint64_t JournalWriter::GetSequence() const{
+    return sequence;
+}
+
+uint64_t JournalWriter::Append(JournalRecordType type, const char *payload, size_t length){
+    size_t record_size = RecordSize(length);
+    if(offset + record_size > mapped_size){
+        // Roll over, a record larger than a segment gets a segment of its own
+        CloseSegment();
+        OpenSegment(segment_index + 1, max(segment_size, record_size));
+    }
+    JournalRecordHeader header;
+    header.length = length;
+    header.sequence = ++sequence;
+    header.type = type;
+    header.reserved = 0;
+    header.crc = RecordCrc(header, payload);
+    char* record = segment + offset;
+    memcpy(record + sizeof(header), payload, length);
+    memcpy(record, &header, sizeof(header));
+    offset += record_size;
+    return sequence;
+}
+
+template<typename V>
+uint64_t JournalWriter::Append(const V &data){
+    encoder.Clear();
+    RecordCodec<V>::Encode(encoder, data);
+    return Append(RecordCodec<V>::TYPE, encoder.GetBytes().data(),
+                  encoder.GetBytes().size());
+}
+
+void JournalWriter::Sync(){
+    if(segment != nullptr){
+        msync(segment, offset, MS_SYNC);
+    }
+}
+
+#endif //TRADING_SYSTEM_JOURNAL_HPP
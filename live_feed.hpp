@@ -0,0 +1,380 @@
+/**
+ * live_feed.hpp
+ * Defines LiveFeed, the event loop of the streaming ingest mode. Connectors
+ * register their inputs on a feed, which follows each one from a single
+ * thread with epoll and hands over whatever arrived in reads of at most
+ * read_size bytes, so the services keep being driven for as long as the
+ * process runs, with one fixed read buffer however much flows through.
+ *
+ * An input is one of
+ *     FOLLOW_FILE    a growing file, read to its end and then again on each
+ *                    inotify write event, from the start if truncated
+ *     LOCAL_PIPE     a named pipe, made if missing, held open so writers
+ *                    may come and go
+ *     UNIX_SOCKET    a stream socket some feed listens on, until it closes
+ * Followed files start with a header line like the batch inputs, pipes and
+ * sockets carry records only.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_LIVE_FEED_HPP
+#define TRADING_SYSTEM_LIVE_FEED_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "record_parser.hpp"
+
+using namespace std;
+
+// Kinds of live input
+enum LiveSourceType { FOLLOW_FILE, LOCAL_PIPE, UNIX_SOCKET };
+
+// What a consumer is called for: a chunk of input, the input starting over
+// from its beginning, or its end
+enum LiveEvent { LIVE_DATA, LIVE_RESTART, LIVE_END };
+
+// Default size of each read from a live input
+const size_t LIVE_READ_SIZE = 64 * 1024;
+
+
+/**
+ * Single threaded event loop over live inputs. Each input has a consumer
+ * called with LIVE_DATA and every chunk read from it, with LIVE_RESTART
+ * when a followed file was truncated and is read again from the start, and
+ * once with LIVE_END when the input ends, to hand over a last record
+ * without a line end. The chunk is null for the last two.
+ */
+class LiveFeed{
+public:
+    using Consumer = function<void(LiveEvent event, const char* data, size_t size)>;
+
+private:
+    struct Source{
+        string path;
+        LiveSourceType type;
+        int fd;
+        // inotify watch of a followed file, -1 otherwise
+        int watch;
+        Consumer consumer;
+    };
+
+    vector<unique_ptr<Source>> sources;
+    size_t read_size;
+    vector<char> buffer;
+    int epoll_fd;
+    int inotify_fd;
+    int stop_fd;
+    size_t open_sources;
+    // Called every tick_interval while the feed runs, input or not
+    function<void()> tick;
+    chrono::steady_clock::duration tick_interval;
+
+    // Feed stopped by SIGINT and SIGTERM
+    static atomic<LiveFeed*> signal_feed;
+
+    static void HandleSignal(int signal);
+
+    // Open the input of source, throws if it cannot be opened
+    void Open(Source &source);
+
+    // Read a followed file to its end, from the start if it was truncated
+    void DrainFile(Source &source);
+
+    // Read one chunk of a pipe or socket, closing the source at its end
+    void ReadChunk(Source &source);
+
+    void Close(Source &source);
+
+    // Drain the followed files written since the last wakeup
+    void HandleWatchEvents();
+
+public:
+    // ctor
+    explicit LiveFeed(size_t _read_size = LIVE_READ_SIZE);
+    ~LiveFeed();
+    LiveFeed(const LiveFeed &) = delete;
+    LiveFeed& operator=(const LiveFeed &) = delete;
+
+    // Follow the input at path, throws if it cannot be opened
+    void Add(const string &path, LiveSourceType type, Consumer consumer);
+
+    // Hand over input as it arrives, until Stop or every input has ended.
+    // Inputs already holding data are read first.
+    void Run();
+
+    // Make Run return after the chunk in hand, safe from any thread and
+    // from a signal handler
+    void Stop();
+
+    // Stop this feed on SIGINT or SIGTERM
+    void StopOnSignals();
+
+    // Call _tick about every _tick_interval from Run, also while no input
+    // arrives
+    void SetTick(chrono::steady_clock::duration _tick_interval, function<void()> _tick);
+
+    // Inputs not ended yet
+    size_t GetOpenSources() const;
+
+    size_t GetReadSize() const;
+};
+
+
+// Consumer parsing the chunks of a live input of the type as records of
+// message type V, calling handler with each message. The parser lives as
+// long as the feed.
+template<typename V, typename Handler>
+LiveFeed::Consumer MakeRecordConsumer(LiveSourceType type, const SecurityMaster* security_master,
+                                      RecordFormat format, Handler handler);
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of LiveFeed class
+atomic<LiveFeed*> LiveFeed::signal_feed(nullptr);
+
+LiveFeed::LiveFeed(size_t _read_size){
+    read_size = max<size_t>(1, _read_size);
+    buffer.resize(read_size);
+    open_sources = 0;
+    tick_interval = chrono::steady_clock::duration::zero();
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || inotify_fd < 0 || stop_fd < 0) {
+        throw runtime_error(string("LiveFeed: ") + strerror(errno));
+    }
+    // Sources are told apart by their index, the watch and stop events by
+    // values past any index
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = UINT64_MAX;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+    event.data.u64 = UINT64_MAX - 1;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+}
+
+LiveFeed::~LiveFeed(){
+    LiveFeed* self = this;
+    signal_feed.compare_exchange_strong(self, nullptr);
+    for (auto& source : sources) {
+        if (source->fd >= 0) {
+            close(source->fd);
+        }
+    }
+    close(stop_fd);
+    close(inotify_fd);
+    close(epoll_fd);
+}
+
+void LiveFeed::Open(Source &source){
+    if (source.type == FOLLOW_FILE) {
+        source.fd = open(source.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (source.fd >= 0) {
+            source.watch = inotify_add_watch(inotify_fd, source.path.c_str(), IN_MODIFY);
+        }
+    }
+    else if (source.type == LOCAL_PIPE) {
+        if (mkfifo(source.path.c_str(), 0600) < 0 && errno != EEXIST) {
+            throw runtime_error("LiveFeed: cannot make pipe " + source.path);
+        }
+        // Opened for writing too, so the pipe does not end when a writer leaves
+        source.fd = open(source.path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    }
+    else {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (source.path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("LiveFeed: socket path too long " + source.path);
+        }
+        strncpy(address.sun_path, source.path.c_str(), sizeof(address.sun_path) - 1);
+        source.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (source.fd >= 0 &&
+            connect(source.fd, (sockaddr*) &address, sizeof(address)) < 0) {
+            int error = errno;
+            close(source.fd);
+            source.fd = -1;
+            errno = error;
+        }
+        if (source.fd >= 0) {
+            fcntl(source.fd, F_SETFL, fcntl(source.fd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+    if (source.fd < 0) {
+        throw runtime_error("LiveFeed: cannot open " + source.path + ": " + strerror(errno));
+    }
+}
+
+void LiveFeed::Add(const string &path, LiveSourceType type, Consumer consumer){
+    unique_ptr<Source> source(new Source{path, type, -1, -1, move(consumer)});
+    Open(*source);
+    if (type != FOLLOW_FILE) {
+        // Level triggered, so one chunk per wakeup keeps the inputs fair
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = sources.size();
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source->fd, &event);
+    }
+    sources.push_back(move(source));
+    ++open_sources;
+}
+
+void LiveFeed::DrainFile(Source &source){
+    struct stat status;
+    off_t offset = lseek(source.fd, 0, SEEK_CUR);
+    if (fstat(source.fd, &status) == 0 && status.st_size < offset) {
+        lseek(source.fd, 0, SEEK_SET);
+        source.consumer(LIVE_RESTART, nullptr, 0);
+    }
+    while (true) {
+        ssize_t size = read(source.fd, buffer.data(), read_size);
+        if (size <= 0) {
+            return;
+        }
+        source.consumer(LIVE_DATA, buffer.data(), (size_t) size);
+    }
+}
+
+void LiveFeed::ReadChunk(Source &source){
+    ssize_t size = read(source.fd, buffer.data(), read_size);
+    if (size > 0) {
+        source.consumer(LIVE_DATA, buffer.data(), (size_t) size);
+    }
+    else if (size == 0 || (errno != EAGAIN && errno != EINTR)) {
+        Close(source);
+    }
+}
+
+void LiveFeed::Close(Source &source){
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source.fd, nullptr);
+    close(source.fd);
+    source.fd = -1;
+    --open_sources;
+    source.consumer(LIVE_END, nullptr, 0);
+}
+
+void LiveFeed::HandleWatchEvents(){
+    alignas(inotify_event) char events[4096];
+    while (read(inotify_fd, events, sizeof(events)) > 0) {
+    }
+    for (auto& source : sources) {
+        if (source->type == FOLLOW_FILE && source->fd >= 0) {
+            DrainFile(*source);
+        }
+    }
+}
+
+void LiveFeed::Run(){
+    for (auto& source : sources) {
+        if (source->type == FOLLOW_FILE && source->fd >= 0) {
+            DrainFile(*source);
+        }
+    }
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    auto next_tick = chrono::steady_clock::now() + tick_interval;
+    while (open_sources > 0) {
+        int timeout = -1;
+        if (tick) {
+            auto now = chrono::steady_clock::now();
+            if (now >= next_tick) {
+                tick();
+                next_tick = now + tick_interval;
+            }
+            timeout = (int) chrono::ceil<chrono::milliseconds>(next_tick - now).count();
+        }
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno != EINTR) {
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == UINT64_MAX - 1) {
+                // A failed read leaves the stop pending, the next wait
+                // reports it again
+                uint64_t stops;
+                if (read(stop_fd, &stops, sizeof(stops)) == (ssize_t) sizeof(stops)) {
+                    return;
+                }
+                continue;
+            }
+            if (tag == UINT64_MAX) {
+                HandleWatchEvents();
+            }
+            else if (sources[tag]->fd >= 0) {
+                ReadChunk(*sources[tag]);
+            }
+        }
+    }
+}
+
+void LiveFeed::Stop(){
+    uint64_t one = 1;
+    ssize_t written = write(stop_fd, &one, sizeof(one));
+    (void) written;
+}
+
+void LiveFeed::HandleSignal(int){
+    LiveFeed* feed = signal_feed.load();
+    if (feed != nullptr) {
+        feed->Stop();
+    }
+}
+
+void LiveFeed::StopOnSignals(){
+    signal_feed.store(this);
+    struct sigaction action{};
+    action.sa_handler = &LiveFeed::HandleSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+size_t LiveFeed::GetOpenSources() const{
+    return open_sources;
+}
+
+void LiveFeed::SetTick(chrono::steady_clock::duration _tick_interval, function<void()> _tick){
+    tick_interval = _tick_interval;
+    tick = move(_tick);
+}
+
+size_t LiveFeed::GetReadSize() const{
+    return read_size;
+}
+
+template<typename V, typename Handler>
+LiveFeed::Consumer MakeRecordConsumer(LiveSourceType type, const SecurityMaster* security_master,
+                                      RecordFormat format, Handler handler){
+    auto parser = make_shared<RecordParser<V>>(security_master, format, type == FOLLOW_FILE);
+    return [parser, handler](LiveEvent event, const char* data, size_t size){
+        if (event == LIVE_DATA) {
+            parser->Parse(data, size, handler);
+        }
+        else if (event == LIVE_RESTART) {
+            parser->Reset();
+        }
+        else {
+            parser->Finish(handler);
+        }
+    };
+}
+
+#endif //TRADING_SYSTEM_LIVE_FEED_HPP
@@ -10,6 +10,7 @@
 #include "trade_booking_service.hpp"
 #include "position_service.hpp"
 #include "risk_service.hpp"
+#include "scenario_service.hpp"
 
 #include "market_data_service.hpp"
 #include "execution_service.hpp"
@@ -18,9 +19,47 @@
 
 #include "historical_data_service.hpp"
 
+#include "service_context.hpp"
+#include "feed_publisher.hpp"
+#include "shared_memory_ring.hpp"
+
+#include <sys/wait.h>
+
 
 using namespace std;
 
+// Process subscribing to the rings published under prefix into services of
+// its own, until the publisher finishes, and reporting the hop latencies
+void SubscribeSharedMemory(const string &prefix, const SecurityMaster* master) {
+    PricingService<Bond> pricing_service;
+    MarketDataService<Bond> market_data_service;
+    TradeBookingService<Bond> trade_booking_service;
+    PositionService<Bond> position_service;
+    RiskService<Bond> risk_service;
+    SharedMemorySubscriber<Price<Bond>> prices(prefix + "prices", &pricing_service, master);
+    SharedMemorySubscriber<OrderBook<Bond>> market_data(prefix + "marketdata",
+                                                        &market_data_service, master);
+    SharedMemorySubscriber<Trade<Bond>> trades(prefix + "trades", &trade_booking_service, master);
+    SharedMemorySubscriber<Position<Bond>> positions(prefix + "positions",
+                                                     &position_service, master);
+    SharedMemorySubscriber<PV01<Bond>> risk(prefix + "risk", &risk_service, master);
+    size_t spins = 0;
+    while (!prices.IsFinished() || !market_data.IsFinished() || !trades.IsFinished() ||
+           !positions.IsFinished() || !risk.IsFinished()) {
+        size_t taken = prices.Poll() + market_data.Poll() + trades.Poll() +
+                       positions.Poll() + risk.Poll();
+        spins = (taken > 0) ? 0 : spins + 1;
+        if (spins > SHARED_RING_SPINS) {
+            this_thread::yield();
+        }
+    }
+    prices.PrintStatistics(cout, "SharedMemoryPrices");
+    market_data.PrintStatistics(cout, "SharedMemoryMarketData");
+    trades.PrintStatistics(cout, "SharedMemoryTrades");
+    positions.PrintStatistics(cout, "SharedMemoryPositions");
+    risk.PrintStatistics(cout, "SharedMemoryRisk");
+}
+
 int main() {
 
     // generate data
@@ -34,80 +73,131 @@ int main() {
     // Should be 10 inquiries for each bond
     test.GenerateInquiriesInput(10);
 
-    // price service
-    auto pricing_service_connector =
-            PricingServiceConnector<Bond>::GenerateInstance();
-    auto pricing_service = pricing_service_connector->GetService();
-
-    auto algo_streaming_service_listener =
-            AlgoStreamingServiceListener<Bond>::GenerateInstance();
-    pricing_service->AddListener(algo_streaming_service_listener);
-    auto algo_streaming_service = algo_streaming_service_listener->GetService();
-
-    auto streaming_service_listener =
-            StreamingServiceListener<Bond>::GenerateInstance();
-    algo_streaming_service->AddListener(streaming_service_listener);
-    auto streaming_service = streaming_service_listener->GetService();
-    auto streaming_historical_data_service_listener =
-            StreamingHistoricalDataServiceListener<Bond>::GenerateInstance();
-    streaming_service->AddListener(streaming_historical_data_service_listener);
-
-   auto gui_service_listener = GUIServiceListener<Bond>::GenerateInstance();
-   pricing_service->AddListener(gui_service_listener);
-
-    // trade service
-    auto trade_booking_service_connector =
-            TradeBookingServiceConnector<Bond>::GenerateInstance();
-    auto trade_booking_service = trade_booking_service_connector->GetService();
-
-    auto position_service_listener =
-            PositionServiceListener<Bond>::GenerateInstance();
-    trade_booking_service->AddListener(position_service_listener);
-    auto position_service = position_service_listener->GetService();
-    auto position_historical_data_service_listener =
-            PositionHistoricalDataServiceListener<Bond>::GenerateInstance();
-    position_service->AddListener(position_historical_data_service_listener);
-
-    auto risk_service_listener = RiskServiceListener<Bond>::GenerateInstance();
-    position_service->AddListener(risk_service_listener);
-    auto risk_service = risk_service_listener->GetService();
-    auto risk_historical_data_service_listener =
-            RiskHistoricalDataServiceListener<Bond>::GenerateInstance();
-    risk_service->AddListener(risk_historical_data_service_listener);
-
-    // market data service
-    auto market_data_service_connector =
-            MarketDataServiceConnector<Bond>::GenerateInstance();
-    auto market_data_service = market_data_service_connector->GetService();
-
-    auto algo_execution_service_listener =
-            AlgoExecutionServiceListener<Bond>::GenerateInstance();
-    market_data_service->AddListener(algo_execution_service_listener);
-    auto algo_execution_service = algo_execution_service_listener->GetService();
-
-    auto execution_service_listener = ExecutionServiceListener<Bond>::GenerateInstance();
-    algo_execution_service->AddListener(execution_service_listener);
-    auto execution_service = execution_service_listener->GetService();
-    auto execution_historical_data_service_listener =
-            ExecutionHistoricalDataServiceListener<Bond>::GenerateInstance();
-    execution_service->AddListener(execution_historical_data_service_listener);
-
-    auto trade_booking_service_listener = TradeBookingServiceListener<Bond>::GenerateInstance();
-    execution_service->AddListener(trade_booking_service_listener);
-
-    // inquiry service
-    auto inquiry_service_connector = InquiryServiceConnector<Bond>::GenerateInstance();
-    auto inquiry_service = inquiry_service_connector->GetService();
-    auto inquiry_historical_data_service_listener =
-            InquiryHistoricalDataServiceListener<Bond>::GenerateInstance();
-    inquiry_service->AddListener(inquiry_historical_data_service_listener);
-
-
-    // subscribe, start flow data into the system
-    pricing_service_connector->Subscribe();
-    trade_booking_service_connector->Subscribe();
-    market_data_service_connector->Subscribe();
-    inquiry_service_connector->Subscribe();
+    // services, listeners and connectors are owned and wired by the context
+    ServiceContext<Bond>& context = ServiceContext<Bond>::Default();
+    auto inquiry_service_connector = context.GetInquiryServiceConnector();
+    auto streaming_service = context.GetStreamingService();
+    auto scenario_service = context.GetScenarioService();
+
+    // Shard pricing, market data, positions and risk by product across
+    // shard_count worker threads when it is above 0, their output flows on to
+    // the streaming, GUI, execution and historical listeners as before
+    const size_t shard_count = 0;
+    if (shard_count > 0) {
+        context.EnableSharding(shard_count);
+    }
+
+    // publish at most one quote per product per millisecond
+    streaming_service->SetConflationWindow(chrono::milliseconds(1));
+
+    // quote inquiries in batches against one snapshot of prices and positions
+    inquiry_service_connector->SetBatchSize(64);
+
+    // format the historical output on a background thread
+    context.EnableAsyncLogging();
+
+    // write the stream and risk history as compressed blocks instead of text
+    // when compress_history is set, e.g. for full-size days
+    const bool compress_history = false;
+    if (compress_history) {
+        context.GetStreamingHistoricalDataServiceConnector()->SetBlockOutput(
+                "../output/streaming.blk");
+        context.GetRiskHistoricalDataServiceConnector()->SetBlockOutput(
+                "../output/risk.blk", LZ_COMPRESSION, "../output/risk_buckets.blk");
+    }
+
+    // journal positions, risk, executions, streams and inquiries, snapshot
+    // the services every 100,000 position updates, keep the stream, position
+    // and risk history as queryable time series, and warm restart from the
+    // latest snapshot and the journal tail when restore is set
+    const bool restore = false;
+    context.EnableJournal("../output/journal/");
+    context.EnableSnapshots("../output/snapshots/", 100000);
+    context.EnableTimeSeries("../output/timeseries/");
+    if (restore) {
+        context.Restore();
+    }
+
+    // send executions out through the order gateway to a simulated
+    // counterparty on loopback when order_gateway is set, trades are booked
+    // from its fills, and report the tick-to-order latency
+    const bool order_gateway = false;
+    if (order_gateway) {
+        context.EnableOrderGateway("127.0.0.1", 30005);
+    }
+
+    // publish prices, order books, trades, positions and risk on shared
+    // memory rings to a second process when shared_memory is set, which
+    // reports the cross-process hop latency
+    const bool shared_memory = false;
+    pid_t subscriber = -1;
+    if (shared_memory) {
+        context.EnableSharedMemoryPublishing("/trading_system_");
+        cout.flush();
+        subscriber = fork();
+        if (subscriber == 0) {
+            SubscribeSharedMemory("/trading_system_", context.GetSecurityMaster());
+            _exit(0);
+        }
+    }
+
+    // subscribe, start flow data into the system, or keep following the
+    // inputs as they grow until interrupted when live is set, or replay the
+    // prices and order books over loopback UDP into the feed handlers and
+    // report the feeds' throughput and latency when network_feed is set
+    const bool live = false;
+    const bool network_feed = false;
+    if (live) {
+        LiveFeed feed;
+        feed.StopOnSignals();
+        context.Follow(feed);
+        feed.Run();
+    }
+    else if (network_feed) {
+        const SecurityMaster* master = context.GetSecurityMaster();
+        FeedHandler<Price<Bond>> price_feed(UDP_FEED, "127.0.0.1", 30001, master,
+                                            "127.0.0.1", 30002);
+        FeedHandler<OrderBook<Bond>> market_data_feed(UDP_FEED, "127.0.0.1", 30003, master,
+                                                      "127.0.0.1", 30004);
+        FeedPublisher<Price<Bond>> price_publisher(UDP_FEED, "127.0.0.1", 30001, master,
+                                                   "127.0.0.1", 30002);
+        FeedPublisher<OrderBook<Bond>> market_data_publisher(UDP_FEED, "127.0.0.1", 30003,
+                                                             master, "127.0.0.1", 30004);
+        // 100,000 messages a second per feed
+        thread price_replay([&]{
+            ReplayFile("../input/prices.txt", price_publisher, master, 100000);
+        });
+        thread market_data_replay([&]{
+            ReplayFile("../input/marketdata.txt", market_data_publisher, master, 100000);
+        });
+        auto start = chrono::steady_clock::now();
+        context.Subscribe(price_feed, market_data_feed);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        price_replay.join();
+        market_data_replay.join();
+        price_feed.PrintStatistics(cout, "PriceFeed", seconds);
+        market_data_feed.PrintStatistics(cout, "MarketDataFeed", seconds);
+    }
+    else {
+        context.Subscribe();
+    }
+    streaming_service->Flush();
+    if (order_gateway) {
+        context.GetOrderGateway()->PrintStatistics(cout);
+    }
+    if (subscriber > 0) {
+        context.FinishSharedMemoryPublishing();
+        waitpid(subscriber, nullptr, 0);
+    }
+    context.Snapshot();
+    context.FlushLogs();
+
+    // reprice positions changed during the run under the curve scenarios
+    scenario_service->RunScenarios();
+
+    // per-service counters and latency percentiles, when built with
+    // TRADING_SYSTEM_INSTRUMENTATION
+    INSTRUMENT_DUMP(cout);
 
 
     return 0;
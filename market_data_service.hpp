@@ -12,6 +12,10 @@
 #include <string>
 #include <vector>
 #include "soa.hpp"
+#include "live_feed.hpp"
+#include "feed_handler.hpp"
+#include "security_master.hpp"
+#include "price_ticks.hpp"
 
 using namespace std;
 
@@ -24,17 +28,17 @@ enum PricingSide { BID, OFFER };
  */
 class Order{
 private:
-    double price;
+    PriceTicks price;
     long quantity;
     PricingSide side;
 
 public:
     // ctors
     Order();
-    Order(double _price, long _quantity, PricingSide _side);
+    Order(PriceTicks _price, long _quantity, PricingSide _side);
 
     // getters
-    double GetPrice() const;
+    PriceTicks GetPrice() const;
 
     long GetQuantity() const;
 
@@ -71,21 +75,42 @@ template<typename T>
 class OrderBook{
 private:
     T product;
-    vector<Order> bidStack;
-    vector<Order> offerStack;
+    pmr::vector<Order> bidStack;
+    pmr::vector<Order> offerStack;
 
 public:
-    // ctor for the order book
+    // ctor for the order book, copies of a book always own their stacks on
+    // the heap
     OrderBook();
     OrderBook(const T &_product, const vector<Order> &_bidStack, 
               const vector<Order> &_offerStack);
+    // Stacks moved in keep their allocator, e.g. an arena while parsing
+    OrderBook(const T &_product, pmr::vector<Order> &&_bidStack,
+              pmr::vector<Order> &&_offerStack);
 
     // Get the product
     const T& GetProduct() const;
 
-    const vector<Order>& GetBidStack() const;
+    const pmr::vector<Order>& GetBidStack() const;
 
-    const vector<Order>& GetOfferStack() const;
+    const pmr::vector<Order>& GetOfferStack() const;
+};
+
+
+/**
+ * Record of a bond order book: CUSIP, then five levels of bid price, bid
+ * quantity, offer price and offer quantity. The stacks are built in the
+ * parser's arena.
+ */
+template<>
+struct RecordSchema<OrderBook<Bond>>{
+    using Fields = tuple<SecurityField, BookLevelsField<5>>;
+
+    static OrderBook<Bond> Build(pmr::memory_resource* resource, const Security* security,
+                                 const array<BookLevel, 5> &levels);
+
+    static bool Extract(const OrderBook<Bond> &order_book, const SecurityMaster &master,
+                        const Security*& security, array<BookLevel, 5> &levels);
 };
 
 
@@ -99,16 +124,17 @@ class MarketDataService : public Service<string,OrderBook <T> >{
 private:
     map<string, OrderBook<T>> market_data;
     vector<ServiceListener<OrderBook<T>> *> service_listeners;
-    MarketDataService();
+    int64_t last_tick_time;
 
 public:
-    static MarketDataService<T>* GenerateInstance(){
-        static MarketDataService<T> instance;
-        return &instance;
-    }
+    // ctor
+    MarketDataService();
+
+    // Instance owned by the default ServiceContext
+    static MarketDataService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    OrderBook<T>& GetData(string key) override;
+    OrderBook<T>& GetData(const string &key) override;
 
     void OnMessage(OrderBook<T> &data) override;
 
@@ -122,9 +148,20 @@ public:
     // Aggregate the order book
     const OrderBook<T>& AggregateDepth(const string &productId);
 
+    // Steady clock time the last order book came in, in nanoseconds
+    int64_t GetLastTickTime() const;
+
+    // Keep an order book taken in elsewhere as the latest and mark its tick,
+    // listeners are not notified
+    void RestoreOrderBook(const OrderBook<T> &order_book);
+
 };
 
 
+template<typename T>
+class ShardedPipeline;
+
+
 /**
  * MarketDataServiceConnector subscribing from input
  * Type T is the product type.
@@ -133,13 +170,25 @@ template<typename T>
 class MarketDataServiceConnector : public Connector<OrderBook<T> > {
 private:
     MarketDataService<T>* market_data_service;
-    MarketDataServiceConnector();
+    string path;
+    ShardedPipeline<T>* sharded_pipeline;
+    // Resolves the CUSIP of each record, the default master when not set
+    const SecurityMaster* security_master;
+    RecordFormat format;
+
+    // Hand a parsed message to its shard or the service
+    void Dispatch(OrderBook<T> &order_book);
+
+    // The master to resolve CUSIPs against
+    const SecurityMaster* GetSecurityMaster() const;
 
 public:
-    static MarketDataServiceConnector<T>* GenerateInstance(){
-        static MarketDataServiceConnector<T> instance;
-        return &instance;
-    }
+    // ctor
+    MarketDataServiceConnector(MarketDataService<T>* _market_data_service,
+            const string &_path = "../input/marketdata.txt");
+
+    // Instance owned by the default ServiceContext
+    static MarketDataServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(OrderBook<T>& data) override;
@@ -148,6 +197,23 @@ public:
 
     MarketDataService<T>* GetService();
 
+    // Route parsed events to the owning shard instead of the service
+    void SetShardedPipeline(ShardedPipeline<T>* _sharded_pipeline);
+
+    // Resolve CUSIPs against _security_master instead of the default one
+    void SetSecurityMaster(const SecurityMaster* _security_master);
+
+    // Read the records at _path, in CSV or binary
+    void SetInput(const string &_path, RecordFormat _format = CSV_RECORDS);
+
+    // Follow the input on a live feed instead of reading it once, the
+    // messages flow while the feed runs
+    void Follow(LiveFeed &feed, LiveSourceType type = FOLLOW_FILE);
+
+    // Take in the messages waiting on a network feed without blocking,
+    // returns the messages handed over
+    size_t Poll(FeedHandler<OrderBook<T>> &feed);
+
 };
 
 
@@ -155,19 +221,19 @@ public:
 //
 // Implementation of Order class
 Order::Order(){
-    price = 0;
+    price = PriceTicks();
     quantity = 0;
     side = OFFER;
 }
 
 
-Order::Order(double _price, long _quantity, PricingSide _side){
+Order::Order(PriceTicks _price, long _quantity, PricingSide _side){
     price = _price;
     quantity = _quantity;
     side = _side;
 }
 
-double Order::GetPrice() const{
+PriceTicks Order::GetPrice() const{
     return price;
 }
 
@@ -205,7 +271,15 @@ OrderBook<T>::OrderBook() : product(T()){
 template<typename T>
 OrderBook<T>::OrderBook(const T &_product, const vector<Order> &_bidStack,
                         const vector<Order> &_offerStack) : product(_product),
-                        bidStack(_bidStack), offerStack(_offerStack){
+                        bidStack(_bidStack.begin(), _bidStack.end()),
+                        offerStack(_offerStack.begin(), _offerStack.end()){
+
+}
+
+template<typename T>
+OrderBook<T>::OrderBook(const T &_product, pmr::vector<Order> &&_bidStack,
+                        pmr::vector<Order> &&_offerStack) : product(_product),
+                        bidStack(move(_bidStack)), offerStack(move(_offerStack)){
 
 }
 
@@ -215,42 +289,81 @@ const T& OrderBook<T>::GetProduct() const{
 }
 
 template<typename T>
-const vector<Order>& OrderBook<T>::GetBidStack() const{
+const pmr::vector<Order>& OrderBook<T>::GetBidStack() const{
     return bidStack;
 }
 
 template<typename T>
-const vector<Order>& OrderBook<T>::GetOfferStack() const{
+const pmr::vector<Order>& OrderBook<T>::GetOfferStack() const{
     return offerStack;
 }
 
 
 
+//
+// Implementation of RecordSchema<OrderBook<Bond>>
+OrderBook<Bond> RecordSchema<OrderBook<Bond>>::Build(pmr::memory_resource* resource,
+        const Security* security, const array<BookLevel, 5> &levels){
+    pmr::vector<Order> bid_stack(resource);
+    pmr::vector<Order> ask_stack(resource);
+    bid_stack.reserve(levels.size());
+    ask_stack.reserve(levels.size());
+    for (const BookLevel& level : levels) {
+        bid_stack.push_back(Order(level.bid_price, level.bid_quantity, BID));
+        ask_stack.push_back(Order(level.offer_price, level.offer_quantity, OFFER));
+    }
+    return OrderBook<Bond>(security->bond, move(bid_stack), move(ask_stack));
+}
+
+bool RecordSchema<OrderBook<Bond>>::Extract(const OrderBook<Bond> &order_book,
+        const SecurityMaster &master, const Security*& security, array<BookLevel, 5> &levels){
+    security = master.Find(order_book.GetProduct().GetProductId());
+    const pmr::vector<Order>& bid_stack = order_book.GetBidStack();
+    const pmr::vector<Order>& ask_stack = order_book.GetOfferStack();
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i] = BookLevel{};
+        if (i < bid_stack.size()) {
+            levels[i].bid_price = bid_stack[i].GetPrice();
+            levels[i].bid_quantity = bid_stack[i].GetQuantity();
+        }
+        if (i < ask_stack.size()) {
+            levels[i].offer_price = ask_stack[i].GetPrice();
+            levels[i].offer_quantity = ask_stack[i].GetQuantity();
+        }
+    }
+    return security != nullptr;
+}
+
+
 //
 // Implementation of MarketDataService class
 template <typename T>
 MarketDataService<T>::MarketDataService() {
+    last_tick_time = 0;
 }
 
 template <typename T>
-OrderBook<T>& MarketDataService<T>::GetData(string key) {
+OrderBook<T>& MarketDataService<T>::GetData(const string &key) {
     return market_data[key];
 }
 
 template <typename T>
 void MarketDataService<T>::OnMessage(OrderBook<T> &data) {
-    const string product_id = data.GetProduct().GetProductId();
-    if (market_data.find(product_id) == market_data.end()){
-        market_data.insert(make_pair(product_id, data));
-    }
-    else{
-        market_data[product_id] = data;
-    }
+    INSTRUMENT_SCOPE("MarketDataService");
+    last_tick_time = FeedClockNanos();
+    const string& product_id = data.GetProduct().GetProductId();
+    market_data.insert_or_assign(product_id, data);
     for(auto listener : service_listeners) {
         listener->ProcessAdd(data);
     }
 }
 
+template <typename T>
+void MarketDataService<T>::RestoreOrderBook(const OrderBook<T> &order_book) {
+    last_tick_time = FeedClockNanos();
+    market_data.insert_or_assign(order_book.GetProduct().GetProductId(), order_book);
+}
+
 template <typename T>
 void MarketDataService<T>::AddListener(ServiceListener<OrderBook<T>> *listener) {
     service_listeners.push_back(listener);
@@ -263,18 +376,18 @@ const vector<ServiceListener<OrderBook<T>>* >& MarketDataService<T>::GetListener
 
 template <typename T>
 const BidOffer& MarketDataService<T>::GetBestBidOffer(const string &productId) {
-    OrderBook<T> book = market_data[productId];
+    const OrderBook<T>& book = market_data[productId];
     return BidOffer(*book.GetBidStack().begin(), *book.GetOfferStack().begin());
 }
 
 template <typename T>
 const OrderBook<T>& MarketDataService<T>::AggregateDepth(const string &productId) {
-    OrderBook<T> book = market_data[productId];
-    auto AggregateOrderStack = [](vector<Order> &order_stack){
-        vector<Order> aggregate_order_stack;
+    const OrderBook<T>& book = market_data[productId];
+    auto AggregateOrderStack = [](const pmr::vector<Order> &order_stack){
+        pmr::vector<Order> aggregate_order_stack;
         PricingSide side = order_stack.begin()->GetSide();
         long running_aggregate_quantity = order_stack.begin()->GetQuantity();
-        double running_price = order_stack.begin()->GetPrice();
+        PriceTicks running_price = order_stack.begin()->GetPrice();
         for(int i = 1; i <= order_stack.size(); ++i){
             if (order_stack[i].GetPrice() == order_stack[i-1].GetPrice()){
                 running_aggregate_quantity += order_stack[i].GetQuantity();
@@ -294,12 +407,22 @@ const OrderBook<T>& MarketDataService<T>::AggregateDepth(const string &productId
 
 }
 
+template <typename T>
+int64_t MarketDataService<T>::GetLastTickTime() const {
+    return last_tick_time;
+}
+
 
 //
 // Implementation of MarketDataServiceConnector class
 template<typename T>
-MarketDataServiceConnector<T>::MarketDataServiceConnector() {
-    market_data_service = MarketDataService<T>::GenerateInstance();
+MarketDataServiceConnector<T>::MarketDataServiceConnector(MarketDataService<T>* _market_data_service,
+        const string &_path) {
+    market_data_service = _market_data_service;
+    sharded_pipeline = nullptr;
+    security_master = nullptr;
+    path = _path;
+    format = CSV_RECORDS;
 }
 
 template<typename T>
@@ -308,61 +431,35 @@ void MarketDataServiceConnector<T>::Publish(OrderBook<T>& data) {
 
 template<typename T>
 void MarketDataServiceConnector<T>::Subscribe() {
-    auto SplitLine = [](string line, char delimiter){
-        vector<string> tokens;
-        string token;
-        istringstream tokenStream(line);
-        while (getline(tokenStream, token, delimiter)){
-            tokens.push_back(token);
-        }
-        return tokens;
-    };
-    auto String2Price = [&](string s){
-        vector<string> split = SplitLine(s, '-');
-        double price = stoi(split[0]);
-        if(split[1][2] == '+')
-            split[1][2] = '4';
-        price += stoi(split[1].substr(0,2)) / 32.0;
-        price += stoi(split[1].substr(2,3)) / 256.0;
-        return price;
-    };
-    auto FindMaturity = [](string cusip){
-        vector<string> cusip_codes = {"9128285Q9", "9128285R7", "9128285P1",
-                                      "9128285N6", "9128285M8", "912810SE9"};
-        vector<date> dates = {date(2020, 11, 30), date(2021, 12, 15),
-                              date(2023, 11, 30), date(2025, 11, 30),
-                              date(2028, 12, 15), date(2048, 11, 15)};
-        for(int i = 0; i < 6; ++i){
-            if(cusip == cusip_codes[i])
-                return dates[i];
-        }
-    };
-    ifstream data;
-    data.open("../input/marketdata.txt", ios::in);
-    string line;
-    getline(data, line);
-    while(getline(data, line)){
-        vector<string> line_fragments = SplitLine(line, ',');
-        // Construction of Bond
-        string cusip = line_fragments[0];
-        string ticker = "NoTicker";
-        float coupon = 0.0;
-        date maturity_date = FindMaturity(cusip);
-        Bond bond(cusip, CUSIP, ticker, coupon, maturity_date);
-        // Construction of OrderBook<Bond>
-        vector<Order> bid_stack;
-        vector<Order> ask_stack;
-        for (auto i = 0; i < 5; ++i) {
-            double bid_price = String2Price(line_fragments[1+i*4]);
-            double ask_price = String2Price(line_fragments[3+i*4]);
-            long bid_quantity = stol(line_fragments[2+i*4]);
-            long ask_quantity = stol(line_fragments[4+i*4]);
-            bid_stack.push_back(Order(bid_price, bid_quantity, BID));
-            ask_stack.push_back(Order(ask_price, ask_quantity, OFFER));
-        }
-        OrderBook<Bond> bond_order_book(bond, bid_stack, ask_stack);
-        market_data_service->OnMessage(bond_order_book);
+    // Records of unknown CUSIPs are skipped
+    RecordParser<OrderBook<T>> parser(GetSecurityMaster(), format);
+    parser.ParseFile(path, [this](OrderBook<T> &order_book){ Dispatch(order_book); });
+}
+
+template<typename T>
+void MarketDataServiceConnector<T>::Follow(LiveFeed &feed, LiveSourceType type) {
+    feed.Add(path, type, MakeRecordConsumer<OrderBook<T>>(type, GetSecurityMaster(), format,
+            [this](OrderBook<T> &order_book){ Dispatch(order_book); }));
+}
+
+template<typename T>
+size_t MarketDataServiceConnector<T>::Poll(FeedHandler<OrderBook<T>> &feed) {
+    return feed.Poll([this](OrderBook<T> &order_book){ Dispatch(order_book); });
+}
+
+template<typename T>
+void MarketDataServiceConnector<T>::Dispatch(OrderBook<T> &order_book) {
+    if (sharded_pipeline) {
+        sharded_pipeline->Route(order_book);
     }
+    else {
+        market_data_service->OnMessage(order_book);
+    }
+}
+
+template<typename T>
+const SecurityMaster* MarketDataServiceConnector<T>::GetSecurityMaster() const {
+    return (security_master != nullptr) ? security_master : &SecurityMaster::Default();
 }
 
 template<typename T>
@@ -370,6 +467,22 @@ MarketDataService<T>* MarketDataServiceConnector<T>::GetService() {
     return market_data_service;
 }
 
+template<typename T>
+void MarketDataServiceConnector<T>::SetShardedPipeline(ShardedPipeline<T>* _sharded_pipeline){
+    sharded_pipeline = _sharded_pipeline;
+}
+
+template<typename T>
+void MarketDataServiceConnector<T>::SetSecurityMaster(const SecurityMaster* _security_master){
+    security_master = _security_master;
+}
+
+template<typename T>
+void MarketDataServiceConnector<T>::SetInput(const string &_path, RecordFormat _format){
+    path = _path;
+    format = _format;
+}
+
 
 
 
@@ -0,0 +1,166 @@
+/**
+ * multi_product_risk.hpp
+ * Defines a book pricing and risking several product types side by side,
+ * e.g. bonds and interest rate swaps. Each product type gets its own
+ * pricing, position and risk services, chosen at compile time from the type
+ * of the event, so a mixed book pays no virtual dispatch or type erasure to
+ * find the pipeline of an event.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_MULTI_PRODUCT_RISK_HPP
+#define TRADING_SYSTEM_MULTI_PRODUCT_RISK_HPP
+
+#include <tuple>
+#include <variant>
+#include "soa.hpp"
+#include "products.hpp"
+#include "pricing_service.hpp"
+#include "trade_booking_service.hpp"
+#include "position_service.hpp"
+#include "risk_service.hpp"
+
+using namespace std;
+
+
+/**
+ * Pricing, position and risk services of one product type, with risk
+ * listening to positions.
+ * Type T is the product type.
+ */
+template<typename T>
+class ProductRiskPipeline{
+private:
+    PricingService<T> pricing_service;
+    PositionService<T> position_service;
+    RiskService<T> risk_service;
+    RiskServiceListener<T> risk_service_listener;
+
+public:
+    // ctor
+    ProductRiskPipeline();
+    ProductRiskPipeline(const ProductRiskPipeline &) = delete;
+    ProductRiskPipeline& operator=(const ProductRiskPipeline &) = delete;
+
+    PricingService<T>* GetPricingService();
+
+    PositionService<T>* GetPositionService();
+
+    RiskService<T>* GetRiskService();
+
+};
+
+
+/**
+ * Book of several product types, one ProductRiskPipeline each.
+ * Types Products are the product types, e.g. Bond and IRSwap.
+ */
+template<typename... Products>
+class MultiProductRisk{
+private:
+    tuple<ProductRiskPipeline<Products>...> pipelines;
+
+public:
+    // Trades and prices of any product type of the book
+    using TradeEvent = variant<Trade<Products>...>;
+    using PriceEvent = variant<Price<Products>...>;
+
+    // ctor
+    MultiProductRisk();
+    MultiProductRisk(const MultiProductRisk &) = delete;
+    MultiProductRisk& operator=(const MultiProductRisk &) = delete;
+
+    // The pipeline of product type T
+    template<typename T>
+    ProductRiskPipeline<T>& GetPipeline();
+
+    // Book a trade into the positions and risk of its product type
+    template<typename T>
+    void AddTrade(const Trade<T> &trade);
+
+    void AddTrade(const TradeEvent &trade);
+
+    // Update the price of a product
+    template<typename T>
+    void AddPrice(Price<T> &price);
+
+    void AddPrice(PriceEvent &price);
+
+    // PV01 summed over every product of every type
+    double GetTotalPV01();
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of ProductRiskPipeline class
+template<typename T>
+ProductRiskPipeline<T>::ProductRiskPipeline() : risk_service_listener(&risk_service){
+    position_service.AddListener(&risk_service_listener);
+}
+
+template<typename T>
+PricingService<T>* ProductRiskPipeline<T>::GetPricingService(){
+    return &pricing_service;
+}
+
+template<typename T>
+PositionService<T>* ProductRiskPipeline<T>::GetPositionService(){
+    return &position_service;
+}
+
+template<typename T>
+RiskService<T>* ProductRiskPipeline<T>::GetRiskService(){
+    return &risk_service;
+}
+
+
+//
+// Implementation of MultiProductRisk class
+template<typename... Products>
+MultiProductRisk<Products...>::MultiProductRisk(){
+}
+
+template<typename... Products>
+template<typename T>
+ProductRiskPipeline<T>& MultiProductRisk<Products...>::GetPipeline(){
+    return get<ProductRiskPipeline<T>>(pipelines);
+}
+
+template<typename... Products>
+template<typename T>
+void MultiProductRisk<Products...>::AddTrade(const Trade<T> &trade){
+    GetPipeline<T>().GetPositionService()->AddTrade(trade);
+}
+
+template<typename... Products>
+void MultiProductRisk<Products...>::AddTrade(const TradeEvent &trade){
+    visit([this](const auto &typed_trade){ AddTrade(typed_trade); }, trade);
+}
+
+template<typename... Products>
+template<typename T>
+void MultiProductRisk<Products...>::AddPrice(Price<T> &price){
+    GetPipeline<T>().GetPricingService()->OnMessage(price);
+}
+
+template<typename... Products>
+void MultiProductRisk<Products...>::AddPrice(PriceEvent &price){
+    visit([this](auto &typed_price){ AddPrice(typed_price); }, price);
+}
+
+template<typename... Products>
+double MultiProductRisk<Products...>::GetTotalPV01(){
+    double total_pv01 = 0.0;
+    auto AddPV01s = [&total_pv01](auto &pipeline){
+        for (const auto& pv01 : pipeline.GetRiskService()->GetPV01s()) {
+            total_pv01 += pv01.second.GetPV01();
+        }
+    };
+    apply([&AddPV01s](auto &... pipeline){ (AddPV01s(pipeline), ...); }, pipelines);
+    return total_pv01;
+}
+
+#endif //TRADING_SYSTEM_MULTI_PRODUCT_RISK_HPP
@@ -0,0 +1,562 @@
+/**
+ * order_gateway.hpp
+ * Defines the order gateway, through which ExecutionService sends its orders
+ * out of the process over a FIX-like binary session on TCP, and
+ * SimulatedCounterparty, a local market acknowledging and filling them.
+ *
+ * Every message starts with a GatewayHeader. The gateway sends NEW_ORDER
+ * messages numbered from 1 by its session sequence, the counterparty answers
+ * each with an ORDER_ACK and an ORDER_FILL carrying the same sequence. Fills
+ * go back through ExecutionService::OnMessage to its listeners, booking the
+ * trade in TradeBookingService as a local execution did.
+ *
+ * The gateway measures tick-to-order latency, from the order book that
+ * triggered an order coming into MarketDataService to the order being
+ * written to the socket, and the order to ack and order to fill latencies
+ * up to the market sending them, which shares the steady clock on one host.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_ORDER_GATEWAY_HPP
+#define TRADING_SYSTEM_ORDER_GATEWAY_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "soa.hpp"
+#include "execution_service.hpp"
+#include "feed_handler.hpp"
+
+using namespace std;
+
+// Kinds of gateway messages
+enum GatewayMessageType : uint8_t { NEW_ORDER = 1, ORDER_ACK = 2, ORDER_FILL = 3 };
+
+// Orders sent and not yet filled, at most
+const size_t GATEWAY_MAX_PENDING = 4096;
+
+// Orders written by one write to the socket, at most
+const size_t GATEWAY_SEND_BATCH = 64;
+
+// Longest wait for the fill freeing a slot before giving the session up
+const int GATEWAY_FILL_TIMEOUT_MILLIS = 5000;
+
+
+/**
+ * Header of every gateway message, in host byte order.
+ */
+struct GatewayHeader{
+    // Bytes of the message, header included
+    uint16_t length;
+    uint8_t type;
+    uint8_t reserved;
+    // Session sequence of the order the message is about
+    uint32_t sequence;
+    // Steady clock time the message was sent, in nanoseconds
+    int64_t send_time;
+};
+
+
+/**
+ * An order sent to the market.
+ */
+struct GatewayNewOrder{
+    GatewayHeader header;
+    char cusip[16];
+    char order_id[24];
+    char parent_order_id[24];
+    int32_t price;
+    uint8_t side;
+    uint8_t order_type;
+    uint8_t is_child;
+    uint8_t reserved;
+    int64_t visible_quantity;
+    int64_t hidden_quantity;
+};
+
+
+/**
+ * An acknowledgement or fill of an order from the market.
+ */
+struct GatewayExecutionReport{
+    GatewayHeader header;
+    int32_t price;
+    uint32_t reserved;
+    int64_t quantity;
+};
+
+static_assert(sizeof(GatewayHeader) == 16, "GatewayHeader must stay packed");
+static_assert(sizeof(GatewayNewOrder) == 104, "GatewayNewOrder must stay packed");
+static_assert(sizeof(GatewayExecutionReport) == 32, "GatewayExecutionReport must stay packed");
+
+
+/**
+ * Order gateway connector, sending the orders of an ExecutionService to the
+ * market and handing its fills back to the service. Orders are encoded into
+ * send slots allocated once and gathered into one write, in batches of up
+ * to batch_size orders. Reports waiting on the socket are taken in after each
+ * send and by Poll.
+ * Once the market closes the session, a write fails or a fill does not come
+ * in time, the session is closed for good: the orders pending are given up
+ * and the call throws, as does any later Publish or Flush.
+ * Type T is the product type.
+ */
+template<typename T>
+class OrderGatewayConnector : public Connector<ExecutionOrder<T>>{
+private:
+    ExecutionService<T>* execution_service;
+    const MarketDataService<T>* market_data_service;
+    int fd;
+    bool open;
+    size_t batch_size;
+    uint32_t sequence;
+    // Encoded orders waiting to be written
+    vector<GatewayNewOrder> send_slots;
+    vector<iovec> send_vectors;
+    size_t queued;
+    // Orders sent and not yet filled, by sequence
+    vector<ExecutionOrder<T>> pending;
+    vector<uint32_t> pending_sequences;
+    vector<int64_t> pending_send_times;
+    size_t pending_count;
+    // Bytes of the stream not yet making a whole report
+    vector<char> receive_buffer;
+    size_t receive_size;
+    // Statistics
+    uint64_t order_count;
+    uint64_t ack_count;
+    uint64_t fill_count;
+    uint64_t write_count;
+    uint64_t failed_count;
+    LatencyHistogram tick_to_order;
+    LatencyHistogram order_to_ack;
+    LatencyHistogram order_to_fill;
+
+    // Hand a report over, fills go back to the execution service
+    void HandleReport(const GatewayExecutionReport &report);
+
+    // Close the session, give up the orders pending and throw
+    [[noreturn]] void Fail(const string &reason);
+
+public:
+    // ctor, connects to the market at address:port, throws if it cannot
+    OrderGatewayConnector(ExecutionService<T>* _execution_service,
+                          const MarketDataService<T>* _market_data_service,
+                          const string &address, uint16_t port);
+    ~OrderGatewayConnector();
+    OrderGatewayConnector(const OrderGatewayConnector &) = delete;
+    OrderGatewayConnector& operator=(const OrderGatewayConnector &) = delete;
+
+    // Send an order to the market
+    void Publish(ExecutionOrder<T> &data) override;
+
+    // Wait for the fills of every order sent
+    void Subscribe() override;
+
+    // Write the orders queued so far
+    void Flush();
+
+    // Take in the reports waiting without blocking, returns the fills
+    size_t Poll();
+
+    // Orders written by one write to the socket, 1 writes each order at once
+    void SetBatchSize(size_t _batch_size);
+
+    // Orders sent and not yet filled
+    size_t GetPendingCount() const;
+
+    // Orders given up unfilled when the session failed
+    uint64_t GetFailedCount() const;
+
+    // False once the session failed
+    bool IsOpen() const;
+
+    uint64_t GetOrderCount() const;
+
+    uint64_t GetFillCount() const;
+
+    // Tick-to-order latency in nanoseconds
+    const LatencyHistogram& GetTickToOrder() const;
+
+    // Write the statistics of the gateway, one line per latency
+    void PrintStatistics(ostream &stream) const;
+};
+
+
+/**
+ * Local market for the gateway, acknowledging and fully filling each order
+ * at its price from a thread of its own, one session at a time.
+ */
+class SimulatedCounterparty{
+private:
+    int listen_fd;
+    atomic<bool> running;
+    atomic<uint64_t> order_count;
+    thread session_thread;
+
+    // Answer orders until the session or the counterparty ends
+    void Serve();
+
+public:
+    // ctor, listens on address:port, throws if it cannot
+    SimulatedCounterparty(const string &address, uint16_t port);
+    ~SimulatedCounterparty();
+    SimulatedCounterparty(const SimulatedCounterparty &) = delete;
+    SimulatedCounterparty& operator=(const SimulatedCounterparty &) = delete;
+
+    uint64_t GetOrderCount() const;
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of OrderGatewayConnector class
+template<typename T>
+OrderGatewayConnector<T>::OrderGatewayConnector(ExecutionService<T>* _execution_service,
+        const MarketDataService<T>* _market_data_service, const string &address,
+        uint16_t port){
+    execution_service = _execution_service;
+    market_data_service = _market_data_service;
+    open = true;
+    batch_size = 1;
+    sequence = 0;
+    queued = 0;
+    pending_count = 0;
+    receive_size = 0;
+    order_count = 0;
+    ack_count = 0;
+    fill_count = 0;
+    write_count = 0;
+    failed_count = 0;
+    send_slots.resize(GATEWAY_SEND_BATCH);
+    send_vectors.resize(GATEWAY_SEND_BATCH);
+    pending.resize(GATEWAY_MAX_PENDING);
+    pending_sequences.assign(GATEWAY_MAX_PENDING, 0);
+    pending_send_times.assign(GATEWAY_MAX_PENDING, 0);
+    receive_buffer.resize(64 * sizeof(GatewayExecutionReport));
+    sockaddr_in market = FeedSocketAddress(address, port);
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &market, sizeof(market)) < 0) {
+        throw runtime_error("OrderGateway: cannot connect " + address + ": " + strerror(errno));
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+template<typename T>
+OrderGatewayConnector<T>::~OrderGatewayConnector(){
+    close(fd);
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::Publish(ExecutionOrder<T> &data){
+    if (!open) {
+        throw runtime_error("OrderGateway: session closed");
+    }
+    // Back pressure, wait for the fill of the order in the slot to reuse
+    size_t slot = (sequence + 1) % GATEWAY_MAX_PENDING;
+    int64_t deadline = FeedClockNanos() + GATEWAY_FILL_TIMEOUT_MILLIS * 1000000LL;
+    while (pending_sequences[slot] != 0) {
+        if (FeedClockNanos() > deadline) {
+            Fail("no fill for order " + to_string(pending_sequences[slot]));
+        }
+        Flush();
+        pollfd waiting{fd, POLLIN, 0};
+        poll(&waiting, 1, 100);
+        Poll();
+    }
+    ++sequence;
+    pending[slot] = data;
+    pending_sequences[slot] = sequence;
+    ++pending_count;
+
+    GatewayNewOrder& order = send_slots[queued];
+    memset(&order, 0, sizeof(order));
+    order.header.length = sizeof(GatewayNewOrder);
+    order.header.type = NEW_ORDER;
+    order.header.sequence = sequence;
+    const string& cusip = data.GetProduct().GetProductId();
+    memcpy(order.cusip, cusip.data(), min(cusip.size(), sizeof(order.cusip)));
+    memcpy(order.order_id, data.GetOrderId().data(),
+           min(data.GetOrderId().size(), sizeof(order.order_id) - 1));
+    memcpy(order.parent_order_id, data.GetParentOrderId().data(),
+           min(data.GetParentOrderId().size(), sizeof(order.parent_order_id) - 1));
+    order.price = data.GetPrice().GetTicks();
+    order.side = (uint8_t) data.GetSide();
+    order.order_type = (uint8_t) data.GetOrderType();
+    order.is_child = data.IsChildOrder() ? 1 : 0;
+    order.visible_quantity = data.GetVisibleQuantity();
+    order.hidden_quantity = data.GetHiddenQuantity();
+    send_vectors[queued].iov_base = &order;
+    send_vectors[queued].iov_len = sizeof(order);
+    ++queued;
+    ++order_count;
+    if (queued >= min(batch_size, GATEWAY_SEND_BATCH)) {
+        Flush();
+    }
+    Poll();
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::Flush(){
+    if (!open) {
+        throw runtime_error("OrderGateway: session closed");
+    }
+    if (queued == 0) {
+        return;
+    }
+    int64_t now = FeedClockNanos();
+    int64_t tick_time = market_data_service->GetLastTickTime();
+    for (size_t i = 0; i < queued; ++i) {
+        send_slots[i].header.send_time = now;
+        pending_send_times[send_slots[i].header.sequence % GATEWAY_MAX_PENDING] = now;
+        // Orders sent before any order book came in have no tick to measure from
+        if (tick_time != 0) {
+            tick_to_order.Record((uint64_t) max<int64_t>(0, now - tick_time));
+        }
+    }
+    size_t remaining = queued * sizeof(GatewayNewOrder);
+    iovec* vectors = send_vectors.data();
+    int vector_count = (int) queued;
+    while (remaining > 0) {
+        // writev by sendmsg, a market gone raises an error rather than SIGPIPE
+        msghdr message{};
+        message.msg_iov = vectors;
+        message.msg_iovlen = vector_count;
+        ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            Fail(string("cannot write: ") + strerror(errno));
+        }
+        ++write_count;
+        remaining -= written;
+        // Skip what was written, partly written slots resume mid way
+        while (vector_count > 0 && (size_t) written >= vectors->iov_len) {
+            written -= vectors->iov_len;
+            ++vectors;
+            --vector_count;
+        }
+        if (vector_count > 0) {
+            vectors->iov_base = (char*) vectors->iov_base + written;
+            vectors->iov_len -= written;
+        }
+    }
+    queued = 0;
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::HandleReport(const GatewayExecutionReport &report){
+    size_t slot = report.header.sequence % GATEWAY_MAX_PENDING;
+    if (pending_sequences[slot] != report.header.sequence) {
+        return;
+    }
+    int64_t elapsed = report.header.send_time - pending_send_times[slot];
+    if (report.header.type == ORDER_ACK) {
+        ++ack_count;
+        order_to_ack.Record((uint64_t) max<int64_t>(0, elapsed));
+        return;
+    }
+    ++fill_count;
+    order_to_fill.Record((uint64_t) max<int64_t>(0, elapsed));
+    const ExecutionOrder<T>& sent = pending[slot];
+    long visible_quantity = min<long>(report.quantity, sent.GetVisibleQuantity());
+    ExecutionOrder<T> filled(sent.GetProduct(), sent.GetSide(), sent.GetOrderId(),
+                             sent.GetOrderType(), PriceTicks(report.price), visible_quantity,
+                             report.quantity - visible_quantity, sent.GetParentOrderId(),
+                             sent.IsChildOrder());
+    pending_sequences[slot] = 0;
+    --pending_count;
+    execution_service->OnMessage(filled);
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::Fail(const string &reason){
+    size_t unfilled = pending_count;
+    open = false;
+    shutdown(fd, SHUT_RDWR);
+    queued = 0;
+    pending_sequences.assign(GATEWAY_MAX_PENDING, 0);
+    pending_count = 0;
+    failed_count += unfilled;
+    throw runtime_error("OrderGateway: " + reason + ", " + to_string(unfilled) +
+                        " orders given up");
+}
+
+template<typename T>
+size_t OrderGatewayConnector<T>::Poll(){
+    uint64_t fills_before = fill_count;
+    while (open) {
+        ssize_t received = recv(fd, &receive_buffer[receive_size],
+                                receive_buffer.size() - receive_size, MSG_DONTWAIT);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (received == 0) {
+            Fail("market closed the session");
+        }
+        if (received < 0) {
+            Fail(string("cannot read: ") + strerror(errno));
+        }
+        receive_size += received;
+        size_t offset = 0;
+        GatewayExecutionReport report;
+        while (receive_size - offset >= sizeof(report)) {
+            memcpy(&report, &receive_buffer[offset], sizeof(report));
+            HandleReport(report);
+            offset += sizeof(report);
+        }
+        memmove(receive_buffer.data(), &receive_buffer[offset], receive_size - offset);
+        receive_size -= offset;
+    }
+    return fill_count - fills_before;
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::Subscribe(){
+    if (!open) {
+        return;
+    }
+    Flush();
+    while (pending_count > 0) {
+        pollfd waiting{fd, POLLIN, 0};
+        if (poll(&waiting, 1, 1000) <= 0) {
+            // The market went quiet, leave the rest unfilled
+            break;
+        }
+        // A market gone makes Poll throw
+        Poll();
+    }
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::SetBatchSize(size_t _batch_size){
+    batch_size = max<size_t>(1, _batch_size);
+}
+
+template<typename T>
+size_t OrderGatewayConnector<T>::GetPendingCount() const{
+    return pending_count;
+}
+
+template<typename T>
+uint64_t OrderGatewayConnector<T>::GetFailedCount() const{
+    return failed_count;
+}
+
+template<typename T>
+bool OrderGatewayConnector<T>::IsOpen() const{
+    return open;
+}
+
+template<typename T>
+uint64_t OrderGatewayConnector<T>::GetOrderCount() const{
+    return order_count;
+}
+
+template<typename T>
+uint64_t OrderGatewayConnector<T>::GetFillCount() const{
+    return fill_count;
+}
+
+template<typename T>
+const LatencyHistogram& OrderGatewayConnector<T>::GetTickToOrder() const{
+    return tick_to_order;
+}
+
+template<typename T>
+void OrderGatewayConnector<T>::PrintStatistics(ostream &stream) const{
+    stream << "OrderGateway , Orders: " << order_count << " , Acks: " << ack_count
+           << " , Fills: " << fill_count << " , Writes: " << write_count
+           << " , Failed: " << failed_count << endl;
+    auto PrintLatency = [&stream](const string &name, const LatencyHistogram &histogram){
+        stream << name << " , Count: " << histogram.GetCount()
+               << " , P50(ns): " << histogram.GetPercentile(0.50)
+               << " , P99(ns): " << histogram.GetPercentile(0.99)
+               << " , Max(ns): " << histogram.GetMax() << endl;
+    };
+    PrintLatency("TickToOrder", tick_to_order);
+    PrintLatency("OrderToAck", order_to_ack);
+    PrintLatency("OrderToFill", order_to_fill);
+}
+
+
+//
+// Implementation of SimulatedCounterparty class
+SimulatedCounterparty::SimulatedCounterparty(const string &address, uint16_t port)
+        : running(true), order_count(0){
+    sockaddr_in market = FeedSocketAddress(address, port);
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (listen_fd < 0 || bind(listen_fd, (sockaddr*) &market, sizeof(market)) < 0 ||
+        listen(listen_fd, 1) < 0) {
+        throw runtime_error("SimulatedCounterparty: cannot listen on " + address + ": " +
+                            strerror(errno));
+    }
+    session_thread = thread(&SimulatedCounterparty::Serve, this);
+}
+
+SimulatedCounterparty::~SimulatedCounterparty(){
+    running = false;
+    shutdown(listen_fd, SHUT_RDWR);
+    session_thread.join();
+    close(listen_fd);
+}
+
+void SimulatedCounterparty::Serve(){
+    pollfd waiting{listen_fd, POLLIN, 0};
+    while (running) {
+        if (poll(&waiting, 1, 100) <= 0 || !(waiting.revents & POLLIN)) {
+            continue;
+        }
+        int session_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (session_fd < 0) {
+            continue;
+        }
+        int enable = 1;
+        setsockopt(session_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        GatewayNewOrder order;
+        GatewayExecutionReport reports[2];
+        iovec vectors[2] = {{&reports[0], sizeof(reports[0])}, {&reports[1], sizeof(reports[1])}};
+        while (running && FeedReadFully(session_fd, (char*) &order, sizeof(order))) {
+            if (order.header.type != NEW_ORDER) {
+                continue;
+            }
+            ++order_count;
+            for (int i = 0; i < 2; ++i) {
+                memset(&reports[i], 0, sizeof(reports[i]));
+                reports[i].header.length = sizeof(GatewayExecutionReport);
+                reports[i].header.type = (i == 0) ? ORDER_ACK : ORDER_FILL;
+                reports[i].header.sequence = order.header.sequence;
+                reports[i].header.send_time = FeedClockNanos();
+                reports[i].price = order.price;
+            }
+            reports[1].quantity = order.visible_quantity + order.hidden_quantity;
+            // Ack and fill go out in one write
+            if (writev(session_fd, vectors, 2) < 0) {
+                break;
+            }
+        }
+        close(session_fd);
+    }
+}
+
+uint64_t SimulatedCounterparty::GetOrderCount() const{
+    return order_count;
+}
+
+#endif //TRADING_SYSTEM_ORDER_GATEWAY_HPP
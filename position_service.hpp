@@ -36,14 +36,32 @@ public:
     // getters
     const T& GetProduct() const;
     long GetPosition(string &book);
-    long GetAggregatePosition();
+    long GetAggregatePosition() const;
+    const map<string, long>& GetPositions() const;
 
     // modifiers
     void UpdatePosition(const Trade<T> &trade);
+    void SetPosition(const string &book, long quantity);
 
 };
 
 
+/**
+ * Record of a bond position: CUSIP, then up to eight books, each as book
+ * name and quantity. Positions in more books are not recorded.
+ */
+template<>
+struct RecordSchema<Position<Bond>>{
+    using Fields = tuple<SecurityField, BookPositionsField<8>>;
+
+    static Position<Bond> Build(pmr::memory_resource* resource, const Security* security,
+                                const array<BookPosition, 8> &books);
+
+    static bool Extract(const Position<Bond> &position, const SecurityMaster &master,
+                        const Security*& security, array<BookPosition, 8> &books);
+};
+
+
 /**
  * Position Service to manage positions across multiple books and securities.
  * Keyed on product identifier.
@@ -54,16 +72,16 @@ class PositionService : public Service<string, Position<T> >{
 private:
     map<string, Position<T>> position_data;
     vector<ServiceListener<Position<T>> *> service_listeners;
-    PositionService();
 
 public:
-    static PositionService* GenerateInstance(){
-        static PositionService instance;
-        return &instance;
-    }
+    // ctor
+    PositionService();
+
+    // Instance owned by the default ServiceContext
+    static PositionService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    Position<T>& GetData(string key) override;
+    Position<T>& GetData(const string &key) override;
 
     void OnMessage(Position<T> &data) override;
 
@@ -73,9 +91,22 @@ public:
 
     void AddTrade(const Trade<T> &trade);
 
+    // Aggregate position of a product, 0 if it was never traded
+    long GetAggregatePosition(const string &product_id) const;
+
+    // Restore a position saved earlier, listeners are not notified
+    void RestorePosition(const Position<T> &position);
+
+    // Every position, keyed on product identifier
+    const map<string, Position<T>>& GetPositions() const;
+
 };
 
 
+template<typename T>
+class ShardedPipeline;
+
+
 /** PositionServiceListener listen to TradeBookingService
 * Type T is the product type.
 */
@@ -83,13 +114,14 @@ template<typename T>
 class PositionServiceListener : public ServiceListener<Trade<T>>{
 private:
     PositionService<T>* position_service;
-    PositionServiceListener();
+    ShardedPipeline<T>* sharded_pipeline;
 
 public:
-    static PositionServiceListener* GenerateInstance(){
-        static PositionServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    PositionServiceListener(PositionService<T>* _position_service);
+
+    // Instance owned by the default ServiceContext
+    static PositionServiceListener* GenerateInstance();
 
     // Override virtual functions in base class Service
     void ProcessAdd(Trade<T> & data) override;
@@ -100,6 +132,9 @@ public:
 
     PositionService<T>* GetService();
 
+    // Book trades on the owning shard instead of the service
+    void SetShardedPipeline(ShardedPipeline<T>* _sharded_pipeline);
+
 };
 
 
@@ -125,7 +160,7 @@ long Position<T>::GetPosition(string &book){
 }
 
 template<typename T>
-long Position<T>::GetAggregatePosition(){
+long Position<T>::GetAggregatePosition() const{
     long aggregate_position = 0;
     for (auto position : positions) {
         aggregate_position += position.second;
@@ -133,6 +168,16 @@ long Position<T>::GetAggregatePosition(){
     return aggregate_position;
 }
 
+template<typename T>
+const map<string, long>& Position<T>::GetPositions() const{
+    return positions;
+}
+
+template<typename T>
+void Position<T>::SetPosition(const string &book, long quantity){
+    positions[book] = quantity;
+}
+
 template<typename T>
 void Position<T>::UpdatePosition(const Trade<T> &trade) {
     // If update with different id, do nothing
@@ -151,6 +196,36 @@ void Position<T>::UpdatePosition(const Trade<T> &trade) {
 }
 
 
+//
+// Implementation of RecordSchema<Position<Bond>>
+Position<Bond> RecordSchema<Position<Bond>>::Build(pmr::memory_resource*,
+        const Security* security, const array<BookPosition, 8> &books){
+    Position<Bond> position(security->bond);
+    for (const BookPosition& book : books) {
+        if (!book.book.empty()) {
+            position.SetPosition(string(book.book), book.quantity);
+        }
+    }
+    return position;
+}
+
+bool RecordSchema<Position<Bond>>::Extract(const Position<Bond> &position,
+        const SecurityMaster &master, const Security*& security, array<BookPosition, 8> &books){
+    security = master.Find(position.GetProduct().GetProductId());
+    if (position.GetPositions().size() > books.size()) {
+        return false;
+    }
+    size_t i = 0;
+    for (const auto& book : position.GetPositions()) {
+        books[i++] = BookPosition{book.first, book.second};
+    }
+    for (; i < books.size(); ++i) {
+        books[i] = BookPosition{string_view(), 0};
+    }
+    return security != nullptr;
+}
+
+
 //
 // Implementation of PositionService class
 template<typename T>
@@ -158,13 +233,16 @@ PositionService<T>::PositionService(){
 }
 
 template<typename T>
-Position<T>& PositionService<T>::GetData(string key){
+Position<T>& PositionService<T>::GetData(const string &key){
     return position_data[key];
 }
 
 template<typename T>
 void PositionService<T>::OnMessage(Position<T> &data){
-    
+    auto stored = position_data.insert_or_assign(data.GetProduct().GetProductId(), data).first;
+    for (auto& listener : service_listeners) {
+        listener->ProcessAdd(stored->second);
+    }
 }
 
 template<typename T>
@@ -179,7 +257,8 @@ const vector<ServiceListener<Position<T>>*>& PositionService<T>::GetListeners()
 
 template<typename T>
 void PositionService<T>::AddTrade(const Trade<T> &trade){
-    const string product_id = trade.GetProduct().GetProductId();
+    INSTRUMENT_SCOPE("PositionService");
+    const string& product_id = trade.GetProduct().GetProductId();
     if (position_data.find(product_id) == position_data.end()) {
         position_data.insert(make_pair(product_id,
                                        Position<T>(trade.GetProduct())));
@@ -190,17 +269,39 @@ void PositionService<T>::AddTrade(const Trade<T> &trade){
     }
 }
 
+template<typename T>
+long PositionService<T>::GetAggregatePosition(const string &product_id) const{
+    auto it = position_data.find(product_id);
+    return (it == position_data.end()) ? 0 : it->second.GetAggregatePosition();
+}
+
+template<typename T>
+void PositionService<T>::RestorePosition(const Position<T> &position){
+    position_data[position.GetProduct().GetProductId()] = position;
+}
+
+template<typename T>
+const map<string, Position<T>>& PositionService<T>::GetPositions() const{
+    return position_data;
+}
+
 
 //
 // Implementation of PositionServiceListener class
 template<typename T>
-PositionServiceListener<T>::PositionServiceListener(){
-    position_service = PositionService<T>::GenerateInstance();
+PositionServiceListener<T>::PositionServiceListener(PositionService<T>* _position_service){
+    position_service = _position_service;
+    sharded_pipeline = nullptr;
 }
 
 template<typename T>
 void PositionServiceListener<T>::ProcessAdd(Trade<T> &data){
-    position_service->AddTrade(data);
+    if (sharded_pipeline) {
+        sharded_pipeline->Route(data);
+    }
+    else {
+        position_service->AddTrade(data);
+    }
 }
 
 template<typename T>
@@ -218,5 +319,10 @@ PositionService<T>* PositionServiceListener<T>::GetService(){
     return position_service;
 }
 
+template<typename T>
+void PositionServiceListener<T>::SetShardedPipeline(ShardedPipeline<T>* _sharded_pipeline){
+    sharded_pipeline = _sharded_pipeline;
+}
+
 
 #endif //TRADING_SYSTEM_POSITION_SERVICE_HPP
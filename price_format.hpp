@@ -0,0 +1,98 @@
+/**
+ * price_format.hpp
+ * Defines the formatting of prices and other output values into a caller
+ * buffer: exact decimals, the shortest that read back to the same double,
+ * and Treasury fractional notation handle-xyz, xy 32nds and z 256ths with
+ * '+' for a half 32nd.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_PRICE_FORMAT_HPP
+#define TRADING_SYSTEM_PRICE_FORMAT_HPP
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// How prices are written
+enum PriceNotation { DECIMAL_NOTATION, FRACTIONAL_NOTATION };
+
+// Room for any value written by the functions below
+const size_t PRICE_BUFFER_SIZE = 64;
+
+
+// Write the shortest decimal reading back to value, in fixed notation when
+// it fits. Returns the end of the text, first if the buffer is too small.
+char* FormatDecimal(char *first, char *last, double value);
+
+// Write a price as handle-xyz, e.g. 99-16+ for 99 + 16.5 / 32. Prices off
+// the 1/256 grid are written as decimals.
+char* FormatFractional(char *first, char *last, double price);
+
+char* FormatPrice(char *first, char *last, double price, PriceNotation notation);
+
+// Append to a string through a stack buffer
+void AppendDecimal(string &out, double value);
+
+void AppendPrice(string &out, double price, PriceNotation notation = DECIMAL_NOTATION);
+
+
+/* ----------------------------- Implementation ----------------------------- */
+char* FormatDecimal(char *first, char *last, double value){
+    to_chars_result result = to_chars(first, last, value, chars_format::fixed);
+    if(result.ec != errc()){
+        // Far too large or small for fixed notation
+        result = to_chars(first, last, value);
+    }
+    return (result.ec == errc()) ? result.ptr : first;
+}
+
+char* FormatFractional(char *first, char *last, double price){
+    double ticks = price * 256.0;
+    if(!isfinite(ticks) || ticks != floor(ticks) || fabs(ticks) >= 9.0e15){
+        return FormatDecimal(first, last, price);
+    }
+    int64_t total_ticks = (int64_t) ticks;
+    char* position = first;
+    if(total_ticks < 0){
+        if(position == last){
+            return first;
+        }
+        *position++ = '-';
+        total_ticks = -total_ticks;
+    }
+    to_chars_result result = to_chars(position, last, total_ticks / 256);
+    if(result.ec != errc() || last - result.ptr < 4){
+        return first;
+    }
+    position = result.ptr;
+    int64_t fraction = total_ticks % 256;
+    int64_t thirty_seconds = fraction / 8;
+    int64_t eighths = fraction % 8;
+    *position++ = '-';
+    *position++ = (char) ('0' + thirty_seconds / 10);
+    *position++ = (char) ('0' + thirty_seconds % 10);
+    *position++ = (eighths == 4) ? '+' : (char) ('0' + eighths);
+    return position;
+}
+
+char* FormatPrice(char *first, char *last, double price, PriceNotation notation){
+    return (notation == FRACTIONAL_NOTATION) ? FormatFractional(first, last, price) :
+                                               FormatDecimal(first, last, price);
+}
+
+void AppendDecimal(string &out, double value){
+    char buffer[PRICE_BUFFER_SIZE];
+    out.append(buffer, FormatDecimal(buffer, buffer + sizeof(buffer), value));
+}
+
+void AppendPrice(string &out, double price, PriceNotation notation){
+    char buffer[PRICE_BUFFER_SIZE];
+    out.append(buffer, FormatPrice(buffer, buffer + sizeof(buffer), price, notation));
+}
+
+#endif //TRADING_SYSTEM_PRICE_FORMAT_HPP
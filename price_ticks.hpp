@@ -0,0 +1,160 @@
+/**
+ * price_ticks.hpp
+ * Defines PriceTicks, a price held as an integer count of 1/256ths, the
+ * tick size of the Treasury prices. Prices are parsed into ticks and turned
+ * back into doubles only where they leave the services.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_PRICE_TICKS_HPP
+#define TRADING_SYSTEM_PRICE_TICKS_HPP
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+using namespace std;
+
+
+/**
+ * A price in integer 1/256 ticks, compared and added exactly.
+ */
+class PriceTicks{
+private:
+    int32_t ticks;
+
+public:
+    static const int32_t TICKS_PER_POINT = 256;
+
+    // ctors, zero by default
+    PriceTicks();
+    explicit PriceTicks(int32_t _ticks);
+
+    // Nearest tick to a decimal price
+    static PriceTicks FromDouble(double price);
+
+    // Parse handle-xyz, xy 32nds and z 256ths with '+' for 4, e.g. 99-16+,
+    // or a decimal price
+    static PriceTicks Parse(string_view text);
+
+    // Parse as above, false unless the whole text is a price
+    static bool TryParse(string_view text, PriceTicks& price);
+
+    int32_t GetTicks() const;
+
+    double ToDouble() const;
+
+    PriceTicks operator+(PriceTicks other) const;
+    PriceTicks operator-(PriceTicks other) const;
+
+    bool operator==(PriceTicks other) const;
+    bool operator!=(PriceTicks other) const;
+    bool operator<(PriceTicks other) const;
+    bool operator<=(PriceTicks other) const;
+    bool operator>(PriceTicks other) const;
+    bool operator>=(PriceTicks other) const;
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of PriceTicks class
+PriceTicks::PriceTicks(){
+    ticks = 0;
+}
+
+PriceTicks::PriceTicks(int32_t _ticks){
+    ticks = _ticks;
+}
+
+PriceTicks PriceTicks::FromDouble(double price){
+    return PriceTicks((int32_t) llround(price * TICKS_PER_POINT));
+}
+
+PriceTicks PriceTicks::Parse(string_view text){
+    PriceTicks price;
+    TryParse(text, price);
+    return price;
+}
+
+bool PriceTicks::TryParse(string_view text, PriceTicks& price){
+    const char* end = text.data() + text.size();
+    size_t dash = text.find('-', 1);
+    // A dash after an exponent marker is part of a decimal price
+    if(dash == string_view::npos || text[dash - 1] == 'e' || text[dash - 1] == 'E'){
+        double decimal = 0.0;
+        from_chars_result result = from_chars(text.data(), end, decimal);
+        price = FromDouble(decimal);
+        return result.ec == errc() && result.ptr == end;
+    }
+    price = PriceTicks();
+    if(text.size() != dash + 4){
+        return false;
+    }
+    bool negative = text[0] == '-';
+    const char* handle_begin = text.data() + (negative ? 1 : 0);
+    int32_t handle = 0;
+    from_chars_result result = from_chars(handle_begin, text.data() + dash, handle);
+    if(result.ec != errc() || result.ptr != text.data() + dash || handle < 0){
+        return false;
+    }
+    char tens = text[dash + 1], units = text[dash + 2], last = text[dash + 3];
+    if(tens < '0' || tens > '3' || units < '0' || units > '9' ||
+       (last != '+' && (last < '0' || last > '7'))){
+        return false;
+    }
+    int32_t thirty_seconds = (tens - '0') * 10 + (units - '0');
+    if(thirty_seconds > 31){
+        return false;
+    }
+    int32_t eighths = (last == '+') ? 4 : last - '0';
+    int32_t total_ticks = handle * TICKS_PER_POINT + thirty_seconds * 8 + eighths;
+    price = PriceTicks(negative ? -total_ticks : total_ticks);
+    return true;
+}
+
+int32_t PriceTicks::GetTicks() const{
+    return ticks;
+}
+
+double PriceTicks::ToDouble() const{
+    return (double) ticks / TICKS_PER_POINT;
+}
+
+PriceTicks PriceTicks::operator+(PriceTicks other) const{
+    return PriceTicks(ticks + other.ticks);
+}
+
+PriceTicks PriceTicks::operator-(PriceTicks other) const{
+    return PriceTicks(ticks - other.ticks);
+}
+
+bool PriceTicks::operator==(PriceTicks other) const{
+    return ticks == other.ticks;
+}
+
+bool PriceTicks::operator!=(PriceTicks other) const{
+    return ticks != other.ticks;
+}
+
+bool PriceTicks::operator<(PriceTicks other) const{
+    return ticks < other.ticks;
+}
+
+bool PriceTicks::operator<=(PriceTicks other) const{
+    return ticks <= other.ticks;
+}
+
+bool PriceTicks::operator>(PriceTicks other) const{
+    return ticks > other.ticks;
+}
+
+bool PriceTicks::operator>=(PriceTicks other) const{
+    return ticks >= other.ticks;
+}
+
+#endif //TRADING_SYSTEM_PRICE_TICKS_HPP
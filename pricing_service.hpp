@@ -15,6 +15,10 @@
 #include <sstream>
 #include "soa.hpp"
 #include "products.hpp"
+#include "live_feed.hpp"
+#include "feed_handler.hpp"
+#include "security_master.hpp"
+#include "price_ticks.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 
 using namespace boost::gregorian;
@@ -29,26 +33,41 @@ class Price
 {
 private:
     T product;
-    double mid;
-    double bidOfferSpread;
+    PriceTicks mid;
+    PriceTicks bidOfferSpread;
 
 public:
     // ctor for a price
     Price();
-    Price(const T &_product, double _mid, double _bidOfferSpread);
+    Price(const T &_product, PriceTicks _mid, PriceTicks _bidOfferSpread);
 
     // Get the product
     const T& GetProduct() const;
 
     // Get the mid price
-    double GetMid() const;
+    PriceTicks GetMid() const;
 
     // Get the bid/offer spread around the mid
-    double GetBidOfferSpread() const;
+    PriceTicks GetBidOfferSpread() const;
 
 };
 
 
+/**
+ * Record of a bond price: CUSIP, mid, bid/offer spread.
+ */
+template<>
+struct RecordSchema<Price<Bond>>{
+    using Fields = tuple<SecurityField, PriceField, PriceField>;
+
+    static Price<Bond> Build(pmr::memory_resource* resource, const Security* security,
+                             PriceTicks mid, PriceTicks spread);
+
+    static bool Extract(const Price<Bond> &price, const SecurityMaster &master,
+                        const Security*& security, PriceTicks &mid, PriceTicks &spread);
+};
+
+
 /**
  * Pricing Service managing mid prices and bid/offers.
  * Keyed on product identifier.
@@ -60,16 +79,16 @@ class PricingService : public Service<string, Price<T>>
 private:
     map<string, Price<T> > price_data;
     vector<ServiceListener<Price<T>>* > service_listeners;
-    PricingService();
 
 public:
-    static PricingService* GenerateInstance(){
-        static PricingService instance;
-        return &instance;
-    }
+    // ctor
+    PricingService();
+
+    // Instance owned by the default ServiceContext
+    static PricingService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    Price<T>& GetData(string key) override;
+    Price<T>& GetData(const string &key) override;
 
     void OnMessage(Price<T> &data) override;
 
@@ -77,9 +96,19 @@ public:
 
     const vector<ServiceListener<Price<T>>* >& GetListeners() const override;
 
+    // Latest price of a product, nullptr if none came in yet
+    const Price<T>* FindPrice(const string &product_id) const;
+
+    // Keep a price priced elsewhere as the latest, listeners are not notified
+    void RestorePrice(const Price<T> &price);
+
 };
 
 
+template<typename T>
+class ShardedPipeline;
+
+
 /**
  * PricingServiceConnector subscribing from input
  * Type T is the product type.
@@ -88,13 +117,25 @@ template<typename T>
 class PricingServiceConnector : public Connector<Price<T>> {
 private:
     PricingService<T>* pricing_service;
-    PricingServiceConnector();
+    string path;
+    ShardedPipeline<T>* sharded_pipeline;
+    // Resolves the CUSIP of each record, the default master when not set
+    const SecurityMaster* security_master;
+    RecordFormat format;
+
+    // Hand a parsed message to its shard or the service
+    void Dispatch(Price<T> &price);
+
+    // The master to resolve CUSIPs against
+    const SecurityMaster* GetSecurityMaster() const;
 
 public:
-    static PricingServiceConnector* GenerateInstance(){
-        static PricingServiceConnector instance;
-        return &instance;
-    }
+    // ctor
+    PricingServiceConnector(PricingService<T>* _pricing_service,
+            const string &_path = "../input/prices.txt");
+
+    // Instance owned by the default ServiceContext
+    static PricingServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(Price<T> &data) override;
@@ -103,6 +144,23 @@ public:
 
     PricingService<T>* GetService();
 
+    // Route parsed events to the owning shard instead of the service
+    void SetShardedPipeline(ShardedPipeline<T>* _sharded_pipeline);
+
+    // Resolve CUSIPs against _security_master instead of the default one
+    void SetSecurityMaster(const SecurityMaster* _security_master);
+
+    // Read the records at _path, in CSV or binary
+    void SetInput(const string &_path, RecordFormat _format = CSV_RECORDS);
+
+    // Follow the input on a live feed instead of reading it once, the
+    // messages flow while the feed runs
+    void Follow(LiveFeed &feed, LiveSourceType type = FOLLOW_FILE);
+
+    // Take in the messages waiting on a network feed without blocking,
+    // returns the messages handed over
+    size_t Poll(FeedHandler<Price<T>> &feed);
+
 };
 
 
@@ -115,8 +173,8 @@ Price<T>::Price():product(T()){
 }
 
 template<typename T>
-Price<T>::Price(const T &_product, double _mid, 
-                double _bidOfferSpread) : product(_product){
+Price<T>::Price(const T &_product, PriceTicks _mid,
+                PriceTicks _bidOfferSpread) : product(_product){
     mid = _mid;
     bidOfferSpread = _bidOfferSpread;
 }
@@ -127,16 +185,32 @@ const T& Price<T>::GetProduct() const{
 }
 
 template<typename T>
-double Price<T>::GetMid() const{
+PriceTicks Price<T>::GetMid() const{
     return mid;
 }
 
 template<typename T>
-double Price<T>::GetBidOfferSpread() const{
+PriceTicks Price<T>::GetBidOfferSpread() const{
     return bidOfferSpread;
 }
 
 
+//
+// Implementation of RecordSchema<Price<Bond>>
+Price<Bond> RecordSchema<Price<Bond>>::Build(pmr::memory_resource*,
+        const Security* security, PriceTicks mid, PriceTicks spread){
+    return Price<Bond>(security->bond, mid, spread);
+}
+
+bool RecordSchema<Price<Bond>>::Extract(const Price<Bond> &price, const SecurityMaster &master,
+        const Security*& security, PriceTicks &mid, PriceTicks &spread){
+    security = master.Find(price.GetProduct().GetProductId());
+    mid = price.GetMid();
+    spread = price.GetBidOfferSpread();
+    return security != nullptr;
+}
+
+
 //
 // Implementation of PricingService template class
 template<typename T>
@@ -145,24 +219,31 @@ PricingService<T>::PricingService() {
 }
 
 template<typename T>
-Price<T>& PricingService<T>::GetData(string key) {
+Price<T>& PricingService<T>::GetData(const string &key) {
     return price_data[key];
 }
 
 template<typename T>
 void PricingService<T>::OnMessage(Price<T> &data) {
-    const string product_id = data.GetProduct().GetProductId();
-    if (price_data.find(product_id) == price_data.end()){
-        price_data.insert(make_pair(product_id, data));
-    }
-    else{
-        price_data[product_id] = data;
-    }
+    INSTRUMENT_SCOPE("PricingService");
+    const string& product_id = data.GetProduct().GetProductId();
+    price_data.insert_or_assign(product_id, data);
     for(auto listener : service_listeners){
         listener->ProcessAdd(data);
     }
 }
 
+template<typename T>
+const Price<T>* PricingService<T>::FindPrice(const string &product_id) const{
+    auto it = price_data.find(product_id);
+    return (it == price_data.end()) ? nullptr : &it->second;
+}
+
+template<typename T>
+void PricingService<T>::RestorePrice(const Price<T> &price){
+    price_data.insert_or_assign(price.GetProduct().GetProductId(), price);
+}
+
 template<typename T>
 void PricingService<T>::AddListener(ServiceListener<Price<T>> *listener) {
     service_listeners.push_back(listener);
@@ -177,8 +258,13 @@ const vector<ServiceListener<Price<T>>* >& PricingService<T>::GetListeners() con
 //
 // Implementation of PricingServiceConnector template class
 template<typename T>
-PricingServiceConnector<T>::PricingServiceConnector() {
-    pricing_service = PricingService<T>::GenerateInstance();
+PricingServiceConnector<T>::PricingServiceConnector(PricingService<T>* _pricing_service,
+        const string &_path) {
+    pricing_service = _pricing_service;
+    sharded_pipeline = nullptr;
+    security_master = nullptr;
+    path = _path;
+    format = CSV_RECORDS;
 }
 
 template<typename T>
@@ -188,54 +274,35 @@ void PricingServiceConnector<T>::Publish(Price<T> &data){
 
 template<typename T>
 void PricingServiceConnector<T>::Subscribe() {
-    auto SplitLine = [](string line, char delimiter){
-        vector<string> tokens;
-        string token;
-        istringstream tokenStream(line);
-        while (getline(tokenStream, token, delimiter)){
-            tokens.push_back(token);
-        }
-        return tokens;
-    };
-    auto String2Price = [&](string s){
-        vector<string> split = SplitLine(s, '-');
-        double price = stoi(split[0]);
-        if(split[1][2] == '+')
-            split[1][2] = '4';
-        price += stoi(split[1].substr(0,2)) / 32.0;
-        price += stoi(split[1].substr(2,3)) / 256.0;
-        return price;
-    };
-    auto FindMaturity = [](string cusip){
-        vector<string> cusip_codes = {"9128285Q9", "9128285R7", "9128285P1",
-                                      "9128285N6", "9128285M8", "912810SE9"};
-        vector<date> dates = {date(2020, 11, 30), date(2021, 12, 15),
-                              date(2023, 11, 30), date(2025, 11, 30),
-                              date(2028, 12, 15), date(2048, 11, 15)};
-        for(int i = 0; i < 6; ++i){
-            if(cusip == cusip_codes[i])
-                return dates[i];
-        }
-    };
-    ifstream data;
-    data.open("../input/prices.txt", ios::in);
-    string line;
-    getline(data, line);
-    while(getline(data, line)){
-        vector<string> line_fragments = SplitLine(line, ',');
-        // Construction of Bond
-        string cusip = line_fragments[0];
-        string ticker = "NoTicker";
-        float coupon = 0.0;
-        date maturity_date = FindMaturity(cusip);
-        Bond bond(cusip, CUSIP, ticker, coupon, maturity_date);
-        // Construction of Price<Bond>
-        double mid = String2Price(line_fragments[1]);
-        double spread = String2Price(line_fragments[2]);
-        Price<Bond> price_bond(bond, mid, spread);
-        pricing_service->OnMessage(price_bond);
+    // Records of unknown CUSIPs are skipped
+    RecordParser<Price<T>> parser(GetSecurityMaster(), format);
+    parser.ParseFile(path, [this](Price<T> &price){ Dispatch(price); });
+}
+
+template<typename T>
+void PricingServiceConnector<T>::Follow(LiveFeed &feed, LiveSourceType type) {
+    feed.Add(path, type, MakeRecordConsumer<Price<T>>(type, GetSecurityMaster(), format,
+            [this](Price<T> &price){ Dispatch(price); }));
+}
+
+template<typename T>
+size_t PricingServiceConnector<T>::Poll(FeedHandler<Price<T>> &feed) {
+    return feed.Poll([this](Price<T> &price){ Dispatch(price); });
+}
+
+template<typename T>
+void PricingServiceConnector<T>::Dispatch(Price<T> &price) {
+    if (sharded_pipeline) {
+        sharded_pipeline->Route(price);
     }
-    data.close();
+    else {
+        pricing_service->OnMessage(price);
+    }
+}
+
+template<typename T>
+const SecurityMaster* PricingServiceConnector<T>::GetSecurityMaster() const {
+    return (security_master != nullptr) ? security_master : &SecurityMaster::Default();
 }
 
 template<typename T>
@@ -243,4 +310,20 @@ PricingService<T>* PricingServiceConnector<T>::GetService() {
     return pricing_service;
 }
 
+template<typename T>
+void PricingServiceConnector<T>::SetShardedPipeline(ShardedPipeline<T>* _sharded_pipeline){
+    sharded_pipeline = _sharded_pipeline;
+}
+
+template<typename T>
+void PricingServiceConnector<T>::SetSecurityMaster(const SecurityMaster* _security_master){
+    security_master = _security_master;
+}
+
+template<typename T>
+void PricingServiceConnector<T>::SetInput(const string &_path, RecordFormat _format){
+    path = _path;
+    format = _format;
+}
+
 #endif //TRADING_SYSTEM_PRICING_SERVICE_HPP
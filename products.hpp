@@ -8,8 +8,16 @@
 #ifndef TRADING_SYSTEM_PRODUCTS_HPP
 #define TRADING_SYSTEM_PRODUCTS_HPP
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "boost/date_time/gregorian/gregorian.hpp"
 
@@ -19,14 +27,15 @@ using namespace boost::gregorian;
 enum ProductType { IRSWAP, BOND };
 
 /**
- * Base class for a product.
+ * Base class for a product. The identifier is interned, so copying a
+ * product copies a pointer rather than a string.
  */
 class Product
 {
 public:
 
   // ctor for a prduct
-  Product(string _productId, ProductType _productType);
+  Product(const string &_productId, ProductType _productType);
 
   // Get the product identifier
   const string& GetProductId() const;
@@ -34,15 +43,57 @@ public:
   // Ge the product type
   ProductType GetProductType() const;
 
+protected:
+
+  // ctor for an identifier already interned
+  Product(const string* _productId, ProductType _productType);
+
+  // The single shared copy of a string, kept for the life of the process
+  static const string* Intern(const string &text);
+
+  // Identifier of a default product, interned once as default products are
+  // made on every map insert
+  static const string* DefaultId();
+
 private:
-  string productId;
+  const string* productId;
   ProductType productType;
 };
 
 enum BondIdType { CUSIP, ISIN };
 
 /**
- * Bond product class
+ * Bond identifier as a fixed-size key, zero padded to 16 bytes so a 9
+ * character CUSIP or 12 character ISIN compares in one vector instruction
+ * and hashes as two words.
+ */
+class CusipCode
+{
+public:
+
+  static constexpr size_t CAPACITY = 16;
+
+  // ctor, longer identifiers are cut to CAPACITY characters
+  CusipCode();
+  explicit CusipCode(string_view text);
+
+  // Get the identifier text
+  string_view GetText() const;
+
+  size_t Hash() const;
+
+  bool operator==(const CusipCode &other) const;
+  bool operator!=(const CusipCode &other) const;
+
+private:
+  char code[CAPACITY];
+};
+
+/**
+ * Bond product class. The identifier is held inline as a CusipCode, the key
+ * bonds compare and hash by, the ticker is interned and the maturity is a
+ * day number, so a bond stays small when embedded in every message.
+ * Identifiers are cut to CusipCode::CAPACITY characters.
  */
 class Bond : public Product
 {
@@ -60,20 +111,33 @@ public:
   float GetCoupon() const;
 
   // Get the maturity date
-  const date& GetMaturityDate() const;
+  date GetMaturityDate() const;
+
+  // Get the maturity as a Gregorian day number, -1 for no date
+  int32_t GetMaturityDay() const;
 
   // Get the bond identifier type
   BondIdType GetBondIdType() const;
 
+  // Get the identifier as a CusipCode, e.g. to hash or index it
+  const CusipCode& GetCusip() const;
+
+  // Bonds are the same security when their identifiers are equal
+  bool operator==(const Bond &other) const;
+  bool operator!=(const Bond &other) const;
+
   // Print the bond
   friend ostream& operator<<(ostream &output, const Bond &bond);
 
 private:
-  string productId;
-  BondIdType bondIdType;
-  string ticker;
+  CusipCode cusip;
+  const string* ticker;
   float coupon;
-  date maturityDate;
+  int32_t maturityDay;
+  BondIdType bondIdType;
+
+  // Ticker of a default bond, interned once
+  static const string* EmptyTicker();
 };
 
 /**
@@ -162,15 +226,35 @@ private:
 /* ----------------------------- Implementation ----------------------------- */
 //
 // Implementation of Product class
-Product::Product(string _productId, ProductType _productType)
+Product::Product(const string &_productId, ProductType _productType)
+{
+    productId = Intern(_productId);
+    productType = _productType;
+}
+
+Product::Product(const string* _productId, ProductType _productType)
 {
     productId = _productId;
     productType = _productType;
 }
 
+const string* Product::Intern(const string &text)
+{
+    static mutex intern_mutex;
+    static unordered_set<string> strings;
+    lock_guard<mutex> lock(intern_mutex);
+    return &*strings.insert(text).first;
+}
+
+const string* Product::DefaultId()
+{
+    static const string* const id = Intern("0");
+    return id;
+}
+
 const string& Product::GetProductId() const
 {
-    return productId;
+    return *productId;
 }
 
 ProductType Product::GetProductType() const
@@ -179,33 +263,95 @@ ProductType Product::GetProductType() const
 }
 
 
+//
+// Implementation of CusipCode class
+CusipCode::CusipCode()
+{
+    memset(code, 0, CAPACITY);
+}
+
+CusipCode::CusipCode(string_view text)
+{
+    memset(code, 0, CAPACITY);
+    memcpy(code, text.data(), min(text.size(), CAPACITY));
+}
+
+string_view CusipCode::GetText() const
+{
+    return string_view(code, strnlen(code, CAPACITY));
+}
+
+size_t CusipCode::Hash() const
+{
+    uint64_t words[2];
+    memcpy(words, code, CAPACITY);
+    uint64_t mixed = (words[0] ^ (words[1] * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+    return (size_t) (mixed ^ (mixed >> 32));
+}
+
+bool CusipCode::operator==(const CusipCode &other) const
+{
+#if defined(__SSE2__)
+    __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(code));
+    __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other.code));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(left, right)) == 0xffff;
+#else
+    return memcmp(code, other.code, CAPACITY) == 0;
+#endif
+}
+
+bool CusipCode::operator!=(const CusipCode &other) const
+{
+    return !(*this == other);
+}
+
 //
 // Implementation of Bond class
-Bond::Bond() : Product("0", BOND)
+Bond::Bond() : Product(DefaultId(), BOND), cusip("0")
 {
+    bondIdType = CUSIP;
+    ticker = EmptyTicker();
+    coupon = 0.0;
+    maturityDay = -1;
 }
 
-Bond::Bond(string _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate) : Product(_productId, BOND)
+Bond::Bond(string _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate) :
+        Product(_productId, BOND), cusip(_productId)
 {
     bondIdType = _bondIdType;
-    ticker = _ticker;
+    ticker = Intern(_ticker);
     coupon = _coupon;
-    maturityDate =_maturityDate;
+    maturityDay = _maturityDate.is_special() ? -1 : (int32_t) _maturityDate.day_number();
 }
 
-const string& Bond::GetTicker() const
+const string* Bond::EmptyTicker()
 {
+    static const string* const ticker = Intern("");
     return ticker;
 }
 
+const string& Bond::GetTicker() const
+{
+    return *ticker;
+}
+
 float Bond::GetCoupon() const
 {
     return coupon;
 }
 
-const date& Bond::GetMaturityDate() const
+date Bond::GetMaturityDate() const
 {
-    return maturityDate;
+    if(maturityDay < 0){
+        return date();
+    }
+    gregorian_calendar::ymd_type ymd = gregorian_calendar::from_day_number((uint32_t) maturityDay);
+    return date(ymd.year, ymd.month, ymd.day);
+}
+
+int32_t Bond::GetMaturityDay() const
+{
+    return maturityDay;
 }
 
 BondIdType Bond::GetBondIdType() const
@@ -213,16 +359,31 @@ BondIdType Bond::GetBondIdType() const
     return bondIdType;
 }
 
+const CusipCode& Bond::GetCusip() const
+{
+    return cusip;
+}
+
+bool Bond::operator==(const Bond &other) const
+{
+    return cusip == other.cusip;
+}
+
+bool Bond::operator!=(const Bond &other) const
+{
+    return !(*this == other);
+}
+
 ostream& operator<<(ostream &output, const Bond &bond)
 {
-    output << bond.ticker << " " << bond.coupon << " " << bond.GetMaturityDate();
+    output << *bond.ticker << " " << bond.coupon << " " << bond.GetMaturityDate();
     return output;
 }
 
 //
 // Implementation of IRSwap class
 IRSwap::IRSwap(string _productId, DayCountConvention _fixedLegDayCountConvention, DayCountConvention _floatingLegDayCountConvention, PaymentFrequency _fixedLegPaymentFrequency, FloatingIndex _floatingIndex, FloatingIndexTenor _floatingIndexTenor, date _effectiveDate, date _terminationDate, Currency _currency, int _termYears, SwapType _swapType, SwapLegType _swapLegType) :
-        Product(_productId, IRSWAP)
+        Product(move(_productId), IRSWAP)
 {
     fixedLegDayCountConvention =_fixedLegDayCountConvention;
     floatingLegDayCountConvention =_floatingLegDayCountConvention;
@@ -239,8 +400,17 @@ IRSwap::IRSwap(string _productId, DayCountConvention _fixedLegDayCountConvention
     terminationDate =_terminationDate;
 }
 
-IRSwap::IRSwap() : Product(0, IRSWAP)
-{
+IRSwap::IRSwap() : Product(DefaultId(), IRSWAP)
+{
+    fixedLegDayCountConvention = THIRTY_THREE_SIXTY;
+    floatingLegDayCountConvention = ACT_THREE_SIXTY;
+    fixedLegPaymentFrequency = SEMI_ANNUAL;
+    floatingIndex = LIBOR;
+    floatingIndexTenor = TENOR_3M;
+    currency = USD;
+    termYears = 0;
+    swapType = STANDARD;
+    swapLegType = OUTRIGHT;
 }
 
 DayCountConvention IRSwap::GetFixedLegDayCountConvention() const
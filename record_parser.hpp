@@ -0,0 +1,731 @@
+/**
+ * record_parser.hpp
+ * Defines the schema-driven parsing of input records. Each message type
+ * declares a RecordSchema, the typed fields of a record in column order and
+ * how to build the message from them. RecordParser expands the schema at
+ * compile time into a decoder of CSV lines or fixed-width binary records,
+ * fed in chunks of any size, e.g. a file read in blocks or a socket.
+ *
+ * A field type F declares
+ *     value_type                 the decoded value
+ *     COLUMNS                    CSV columns taken
+ *     BYTES                      bytes taken in a binary record
+ *     DecodeText(columns, master, value)   from COLUMNS CSV columns
+ *     DecodeBinary(bytes, master, value)   from BYTES bytes
+ *     EncodeBinary(value, bytes)
+ * where the decoders return false to skip the record. Binary records are
+ * packed little-endian, as written by RecordParser::EncodeBinary.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_RECORD_PARSER_HPP
+#define TRADING_SYSTEM_RECORD_PARSER_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "arena.hpp"
+#include "price_ticks.hpp"
+#include "products.hpp"
+#include "security_master.hpp"
+
+using namespace std;
+
+// How records are laid out in an input
+enum RecordFormat { CSV_RECORDS, BINARY_RECORDS };
+
+// Most CSV columns of one record
+const size_t RECORD_MAX_COLUMNS = 32;
+
+// Size of the blocks a file is read in
+const size_t RECORD_READ_SIZE = 64 * 1024;
+
+
+/**
+ * The fields of a message type and how to build it, specialized next to
+ * each message type. A specialization declares
+ *     using Fields = tuple<field types...>;
+ *     static V Build(pmr::memory_resource* resource, values...);
+ *     static bool Extract(const V& record, const SecurityMaster& master, values&...);
+ * Type V is the message type.
+ */
+template<typename V>
+struct RecordSchema;
+
+
+/**
+ * Names of the values of an enum in a record, specialized per enum with
+ * a static array NAMES indexed by value.
+ */
+template<typename E>
+struct EnumNames;
+
+
+/**
+ * The security of a CUSIP, resolved in the security master. Records of
+ * unknown CUSIPs are skipped.
+ */
+struct SecurityField{
+    using value_type = const Security*;
+    static constexpr size_t COLUMNS = 1;
+    static constexpr size_t BYTES = CusipCode::CAPACITY;
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * A price as handle-xyz or decimal, int32 ticks in binary.
+ */
+struct PriceField{
+    using value_type = PriceTicks;
+    static constexpr size_t COLUMNS = 1;
+    static constexpr size_t BYTES = sizeof(int32_t);
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * A whole number, int64 in binary.
+ */
+struct IntegerField{
+    using value_type = long;
+    static constexpr size_t COLUMNS = 1;
+    static constexpr size_t BYTES = sizeof(int64_t);
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * A decimal number such as a risk figure, a double in binary.
+ */
+struct DecimalField{
+    using value_type = double;
+    static constexpr size_t COLUMNS = 1;
+    static constexpr size_t BYTES = sizeof(double);
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * Text such as an identifier, N bytes zero padded in binary. The view is
+ * valid while the record is being handled.
+ */
+template<size_t N>
+struct TextField{
+    using value_type = string_view;
+    static constexpr size_t COLUMNS = 1;
+    static constexpr size_t BYTES = N;
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * An enum by name, one byte in binary. Records with unknown names are
+ * skipped.
+ */
+template<typename E>
+struct EnumField{
+    using value_type = E;
+    static constexpr size_t COLUMNS = 1;
+    static constexpr size_t BYTES = 1;
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * One level of an order book, the bid and the offer at the same depth.
+ */
+struct BookLevel{
+    PriceTicks bid_price;
+    long bid_quantity;
+    PriceTicks offer_price;
+    long offer_quantity;
+};
+
+
+/**
+ * The top N levels of an order book, each as bid price, bid quantity,
+ * offer price and offer quantity.
+ */
+template<size_t N>
+struct BookLevelsField{
+    using value_type = array<BookLevel, N>;
+    static constexpr size_t COLUMNS = 4 * N;
+    static constexpr size_t LEVEL_BYTES = 2 * PriceField::BYTES + 2 * IntegerField::BYTES;
+    static constexpr size_t BYTES = N * LEVEL_BYTES;
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * The quantity held in one book, no book when empty.
+ */
+struct BookPosition{
+    string_view book;
+    long quantity;
+};
+
+
+/**
+ * The quantities of up to N books, each as book name of up to 8 bytes and
+ * quantity, unused books left empty.
+ */
+template<size_t N>
+struct BookPositionsField{
+    using value_type = array<BookPosition, N>;
+    static constexpr size_t COLUMNS = 2 * N;
+    static constexpr size_t ENTRY_BYTES = TextField<8>::BYTES + IntegerField::BYTES;
+    static constexpr size_t BYTES = N * ENTRY_BYTES;
+
+    static bool DecodeText(const string_view* columns, const SecurityMaster& master,
+                           value_type& value);
+    static bool DecodeBinary(const char* bytes, const SecurityMaster& master,
+                             value_type& value);
+    static void EncodeBinary(const value_type& value, char* bytes);
+};
+
+
+/**
+ * Where each field of a schema starts, in CSV columns and in bytes of a
+ * binary record, worked out at compile time.
+ * Type Fields is the tuple of field types.
+ */
+template<typename Fields>
+struct RecordLayout;
+
+template<typename... F>
+struct RecordLayout<tuple<F...>>{
+    static constexpr size_t COLUMNS = (F::COLUMNS + ... + 0);
+    static constexpr size_t BYTES = (F::BYTES + ... + 0);
+
+    static constexpr size_t ColumnOffset(size_t index){
+        constexpr size_t columns[] = {F::COLUMNS..., 0};
+        size_t offset = 0;
+        for (size_t i = 0; i < index; ++i) {
+            offset += columns[i];
+        }
+        return offset;
+    }
+
+    static constexpr size_t ByteOffset(size_t index){
+        constexpr size_t bytes[] = {F::BYTES..., 0};
+        size_t offset = 0;
+        for (size_t i = 0; i < index; ++i) {
+            offset += bytes[i];
+        }
+        return offset;
+    }
+
+    // Offsets of field I as constants
+    template<size_t I>
+    static constexpr size_t COLUMN_OFFSET = ColumnOffset(I);
+
+    template<size_t I>
+    static constexpr size_t BYTE_OFFSET = ByteOffset(I);
+};
+
+
+/**
+ * The decoded values of a record, one per field.
+ * Type Fields is the tuple of field types.
+ */
+template<typename Fields>
+struct RecordValues;
+
+template<typename... F>
+struct RecordValues<tuple<F...>>{
+    using type = tuple<typename F::value_type...>;
+};
+
+
+/**
+ * Parser of the records of message type V, calling a handler with each
+ * message built. Messages may hold memory of the parser's arena and are
+ * only valid during the call.
+ * Type V is the message type.
+ */
+template<typename V>
+class RecordParser{
+private:
+    using Schema = RecordSchema<V>;
+    using Fields = typename Schema::Fields;
+    using Values = typename RecordValues<Fields>::type;
+    static constexpr size_t FIELD_COUNT = tuple_size<Fields>::value;
+
+    const SecurityMaster* security_master;
+    RecordFormat format;
+    // Whether the input starts with a header line, and it is still to come
+    bool has_header;
+    bool skip_header;
+    MonotonicArena arena;
+    // Bytes of a record split across chunks
+    string pending;
+
+    // Decode and hand over one record, false if it was skipped
+    template<typename Handler>
+    bool ParseRecord(const char* data, size_t size, Handler& handler);
+
+    template<size_t... I>
+    bool DecodeText(const string_view* columns, Values& values, index_sequence<I...>) const;
+
+    template<size_t... I>
+    bool DecodeBinary(const char* bytes, Values& values, index_sequence<I...>) const;
+
+    template<size_t... I>
+    static void EncodeValues(const Values& values, char* bytes, index_sequence<I...>);
+
+public:
+    // Columns of a CSV record and bytes of a binary record
+    static constexpr size_t COLUMNS = RecordLayout<Fields>::COLUMNS;
+    static constexpr size_t RECORD_BYTES = RecordLayout<Fields>::BYTES;
+
+    // ctor, CSV inputs start with a header line unless _skip_header is false
+    RecordParser(const SecurityMaster* _security_master, RecordFormat _format = CSV_RECORDS,
+                 bool _skip_header = true);
+
+    // Parse a chunk of input, the records completed by it are handed over
+    // and a trailing partial record is kept for the next chunk. Returns the
+    // number of records handed over.
+    template<typename Handler>
+    size_t Parse(const char* data, size_t size, Handler&& handler);
+
+    // Hand over a last record left without a line end
+    template<typename Handler>
+    size_t Finish(Handler&& handler);
+
+    // Drop a partial record and expect the header again, for an input
+    // starting over
+    void Reset();
+
+    // Parse a whole file in blocks
+    template<typename Handler>
+    size_t ParseFile(const string &path, Handler&& handler);
+
+    // Append the binary record of a message, false if its product is unknown
+    static bool EncodeBinary(const V& record, const SecurityMaster& master, string& out);
+
+    // Write the binary record of a message into RECORD_BYTES bytes, false
+    // if its product is unknown
+    static bool EncodeBinary(const V& record, const SecurityMaster& master, char* bytes);
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of the field types
+bool SecurityField::DecodeText(const string_view* columns, const SecurityMaster& master,
+        value_type& value){
+    value = master.Find(columns[0]);
+    return value != nullptr;
+}
+
+bool SecurityField::DecodeBinary(const char* bytes, const SecurityMaster& master,
+        value_type& value){
+    value = master.Find(string_view(bytes, strnlen(bytes, BYTES)));
+    return value != nullptr;
+}
+
+void SecurityField::EncodeBinary(const value_type& value, char* bytes){
+    const string& text = value->bond.GetProductId();
+    memset(bytes, 0, BYTES);
+    memcpy(bytes, text.data(), min(text.size(), BYTES));
+}
+
+bool PriceField::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    return PriceTicks::TryParse(columns[0], value);
+}
+
+bool PriceField::DecodeBinary(const char* bytes, const SecurityMaster&,
+        value_type& value){
+    int32_t ticks;
+    memcpy(&ticks, bytes, BYTES);
+    value = PriceTicks(ticks);
+    return true;
+}
+
+void PriceField::EncodeBinary(const value_type& value, char* bytes){
+    int32_t ticks = value.GetTicks();
+    memcpy(bytes, &ticks, BYTES);
+}
+
+bool IntegerField::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    value = 0;
+    return TryParseLong(columns[0], value);
+}
+
+bool IntegerField::DecodeBinary(const char* bytes, const SecurityMaster&,
+        value_type& value){
+    int64_t integer;
+    memcpy(&integer, bytes, BYTES);
+    value = (long) integer;
+    return true;
+}
+
+void IntegerField::EncodeBinary(const value_type& value, char* bytes){
+    int64_t integer = value;
+    memcpy(bytes, &integer, BYTES);
+}
+
+bool DecimalField::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    // strtod needs the column terminated
+    char text[64];
+    size_t size = min(columns[0].size(), sizeof(text) - 1);
+    memcpy(text, columns[0].data(), size);
+    text[size] = '\0';
+    char* end;
+    value = strtod(text, &end);
+    return end != text;
+}
+
+bool DecimalField::DecodeBinary(const char* bytes, const SecurityMaster&,
+        value_type& value){
+    memcpy(&value, bytes, BYTES);
+    return true;
+}
+
+void DecimalField::EncodeBinary(const value_type& value, char* bytes){
+    memcpy(bytes, &value, BYTES);
+}
+
+template<size_t N>
+bool TextField<N>::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    value = columns[0];
+    return true;
+}
+
+template<size_t N>
+bool TextField<N>::DecodeBinary(const char* bytes, const SecurityMaster&,
+        value_type& value){
+    value = string_view(bytes, strnlen(bytes, N));
+    return true;
+}
+
+template<size_t N>
+void TextField<N>::EncodeBinary(const value_type& value, char* bytes){
+    memset(bytes, 0, N);
+    memcpy(bytes, value.data(), min(value.size(), N));
+}
+
+template<typename E>
+bool EnumField<E>::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    const auto& names = EnumNames<E>::NAMES;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (columns[0] == names[i]) {
+            value = (E) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename E>
+bool EnumField<E>::DecodeBinary(const char* bytes, const SecurityMaster&,
+        value_type& value){
+    const auto& names = EnumNames<E>::NAMES;
+    uint8_t index = (uint8_t) bytes[0];
+    value = (E) index;
+    return index < sizeof(names) / sizeof(names[0]);
+}
+
+template<typename E>
+void EnumField<E>::EncodeBinary(const value_type& value, char* bytes){
+    bytes[0] = (char) (uint8_t) value;
+}
+
+template<size_t N>
+bool BookLevelsField<N>::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    for (size_t i = 0; i < N; ++i) {
+        const string_view* level = columns + 4 * i;
+        if (!PriceTicks::TryParse(level[0], value[i].bid_price) ||
+            !TryParseLong(level[1], value[i].bid_quantity) ||
+            !PriceTicks::TryParse(level[2], value[i].offer_price) ||
+            !TryParseLong(level[3], value[i].offer_quantity)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<size_t N>
+bool BookLevelsField<N>::DecodeBinary(const char* bytes, const SecurityMaster& master,
+        value_type& value){
+    for (size_t i = 0; i < N; ++i) {
+        const char* level = bytes + i * LEVEL_BYTES;
+        PriceField::DecodeBinary(level, master, value[i].bid_price);
+        level += PriceField::BYTES;
+        IntegerField::DecodeBinary(level, master, value[i].bid_quantity);
+        level += IntegerField::BYTES;
+        PriceField::DecodeBinary(level, master, value[i].offer_price);
+        level += PriceField::BYTES;
+        IntegerField::DecodeBinary(level, master, value[i].offer_quantity);
+    }
+    return true;
+}
+
+template<size_t N>
+void BookLevelsField<N>::EncodeBinary(const value_type& value, char* bytes){
+    for (size_t i = 0; i < N; ++i) {
+        char* level = bytes + i * LEVEL_BYTES;
+        PriceField::EncodeBinary(value[i].bid_price, level);
+        level += PriceField::BYTES;
+        IntegerField::EncodeBinary(value[i].bid_quantity, level);
+        level += IntegerField::BYTES;
+        PriceField::EncodeBinary(value[i].offer_price, level);
+        level += PriceField::BYTES;
+        IntegerField::EncodeBinary(value[i].offer_quantity, level);
+    }
+}
+
+template<size_t N>
+bool BookPositionsField<N>::DecodeText(const string_view* columns, const SecurityMaster&,
+        value_type& value){
+    for (size_t i = 0; i < N; ++i) {
+        value[i].book = columns[2 * i];
+        value[i].quantity = 0;
+        if (!value[i].book.empty() && !TryParseLong(columns[2 * i + 1], value[i].quantity)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<size_t N>
+bool BookPositionsField<N>::DecodeBinary(const char* bytes, const SecurityMaster& master,
+        value_type& value){
+    for (size_t i = 0; i < N; ++i) {
+        const char* entry = bytes + i * ENTRY_BYTES;
+        TextField<8>::DecodeBinary(entry, master, value[i].book);
+        IntegerField::DecodeBinary(entry + TextField<8>::BYTES, master, value[i].quantity);
+    }
+    return true;
+}
+
+template<size_t N>
+void BookPositionsField<N>::EncodeBinary(const value_type& value, char* bytes){
+    for (size_t i = 0; i < N; ++i) {
+        char* entry = bytes + i * ENTRY_BYTES;
+        TextField<8>::EncodeBinary(value[i].book, entry);
+        IntegerField::EncodeBinary(value[i].quantity, entry + TextField<8>::BYTES);
+    }
+}
+
+
+//
+// Implementation of RecordParser class
+template<typename V>
+RecordParser<V>::RecordParser(const SecurityMaster* _security_master, RecordFormat _format,
+        bool _skip_header){
+    security_master = _security_master;
+    format = _format;
+    has_header = _skip_header && format == CSV_RECORDS;
+    skip_header = has_header;
+}
+
+template<typename V>
+template<size_t... I>
+bool RecordParser<V>::DecodeText(const string_view* columns, Values& values,
+        index_sequence<I...>) const{
+    return (tuple_element_t<I, Fields>::DecodeText(
+            columns + RecordLayout<Fields>::template COLUMN_OFFSET<I>, *security_master,
+            get<I>(values)) && ...);
+}
+
+template<typename V>
+template<size_t... I>
+bool RecordParser<V>::DecodeBinary(const char* bytes, Values& values,
+        index_sequence<I...>) const{
+    return (tuple_element_t<I, Fields>::DecodeBinary(
+            bytes + RecordLayout<Fields>::template BYTE_OFFSET<I>, *security_master,
+            get<I>(values)) && ...);
+}
+
+template<typename V>
+template<size_t... I>
+void RecordParser<V>::EncodeValues(const Values& values, char* bytes, index_sequence<I...>){
+    (tuple_element_t<I, Fields>::EncodeBinary(
+            get<I>(values), bytes + RecordLayout<Fields>::template BYTE_OFFSET<I>), ...);
+}
+
+template<typename V>
+template<typename Handler>
+bool RecordParser<V>::ParseRecord(const char* data, size_t size, Handler& handler){
+    Values values;
+    if (format == CSV_RECORDS) {
+        if (size > 0 && data[size - 1] == '\r') {
+            --size;
+        }
+        if (skip_header) {
+            skip_header = false;
+            return false;
+        }
+        string_view columns[RECORD_MAX_COLUMNS];
+        size_t column_count = 0;
+        const char* end = data + size;
+        const char* start = data;
+        while (start < end && column_count < RECORD_MAX_COLUMNS) {
+            const char* comma = (const char*) memchr(start, ',', end - start);
+            const char* column_end = (comma != nullptr) ? comma : end;
+            columns[column_count++] = string_view(start, column_end - start);
+            start = column_end + 1;
+        }
+        if (column_count < COLUMNS ||
+            !DecodeText(columns, values, make_index_sequence<FIELD_COUNT>())) {
+            return false;
+        }
+    }
+    else if (!DecodeBinary(data, values, make_index_sequence<FIELD_COUNT>())) {
+        return false;
+    }
+    arena.Reset();
+    V record = apply([this](auto&... value){ return Schema::Build(&arena, value...); }, values);
+    handler(record);
+    return true;
+}
+
+template<typename V>
+template<typename Handler>
+size_t RecordParser<V>::Parse(const char* data, size_t size, Handler&& handler){
+    size_t parsed = 0;
+    size_t position = 0;
+    if (format == BINARY_RECORDS) {
+        if (!pending.empty()) {
+            size_t needed = min(RECORD_BYTES - pending.size(), size);
+            pending.append(data, needed);
+            position = needed;
+            if (pending.size() < RECORD_BYTES) {
+                return 0;
+            }
+            parsed += ParseRecord(pending.data(), RECORD_BYTES, handler);
+            pending.clear();
+        }
+        for (; position + RECORD_BYTES <= size; position += RECORD_BYTES) {
+            parsed += ParseRecord(data + position, RECORD_BYTES, handler);
+        }
+        pending.append(data + position, size - position);
+        return parsed;
+    }
+    if (!pending.empty()) {
+        const char* line_end = (const char*) memchr(data, '\n', size);
+        if (line_end == nullptr) {
+            pending.append(data, size);
+            return 0;
+        }
+        pending.append(data, line_end - data);
+        parsed += ParseRecord(pending.data(), pending.size(), handler);
+        pending.clear();
+        position = line_end - data + 1;
+    }
+    while (position < size) {
+        const char* line_end = (const char*) memchr(data + position, '\n', size - position);
+        if (line_end == nullptr) {
+            break;
+        }
+        parsed += ParseRecord(data + position, line_end - (data + position), handler);
+        position = line_end - data + 1;
+    }
+    pending.append(data + position, size - position);
+    return parsed;
+}
+
+template<typename V>
+template<typename Handler>
+size_t RecordParser<V>::Finish(Handler&& handler){
+    size_t parsed = 0;
+    if (format == CSV_RECORDS && !pending.empty()) {
+        parsed += ParseRecord(pending.data(), pending.size(), handler);
+    }
+    pending.clear();
+    return parsed;
+}
+
+template<typename V>
+void RecordParser<V>::Reset(){
+    pending.clear();
+    skip_header = has_header;
+}
+
+template<typename V>
+template<typename Handler>
+size_t RecordParser<V>::ParseFile(const string &path, Handler&& handler){
+    ifstream data(path, ios::in | ios::binary);
+    vector<char> buffer(RECORD_READ_SIZE);
+    size_t parsed = 0;
+    while (data) {
+        data.read(buffer.data(), buffer.size());
+        parsed += Parse(buffer.data(), data.gcount(), handler);
+    }
+    parsed += Finish(handler);
+    return parsed;
+}
+
+template<typename V>
+bool RecordParser<V>::EncodeBinary(const V& record, const SecurityMaster& master, string& out){
+    size_t start = out.size();
+    out.resize(start + RECORD_BYTES);
+    if (!EncodeBinary(record, master, &out[start])) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+template<typename V>
+bool RecordParser<V>::EncodeBinary(const V& record, const SecurityMaster& master, char* bytes){
+    Values values;
+    if (!apply([&](auto&... value){ return Schema::Extract(record, master, value...); }, values)) {
+        return false;
+    }
+    EncodeValues(values, bytes, make_index_sequence<FIELD_COUNT>());
+    return true;
+}
+
+#endif //TRADING_SYSTEM_RECORD_PARSER_HPP
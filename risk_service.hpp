@@ -8,8 +8,15 @@
 #ifndef TRADING_SYSTEM_RISK_SERVICE_HPP
 #define TRADING_SYSTEM_RISK_SERVICE_HPP
 
+#include <cmath>
+#include <unordered_map>
 #include "soa.hpp"
+#include "products.hpp"
 #include "position_service.hpp"
+#include "security_master.hpp"
+
+template<typename T>
+class ShardedPipeline;
 
 /**
  * PV01 risk.
@@ -40,6 +47,87 @@ public:
 };
 
 
+/**
+ * Record of a bond PV01: CUSIP, PV01, quantity.
+ */
+template<>
+struct RecordSchema<PV01<Bond>>{
+    using Fields = tuple<SecurityField, DecimalField, IntegerField>;
+
+    static PV01<Bond> Build(pmr::memory_resource* resource, const Security* security,
+                            double pv01, long quantity);
+
+    static bool Extract(const PV01<Bond> &pv01, const SecurityMaster &master,
+                        const Security*& security, double &value, long &quantity);
+};
+
+
+/**
+ * PV01 of one unit of a product, specialized per product type so the risk
+ * service resolves it at compile time.
+ * Type T is the product type.
+ */
+template<typename T>
+class PV01Calculator;
+
+
+/**
+ * Bond PV01, flat per unit for simplicity.
+ */
+template<>
+class PV01Calculator<Bond>{
+public:
+    double GetUnitPV01(const Bond &bond);
+};
+
+
+/**
+ * One accrual period of a swap fixed leg.
+ */
+struct FixedLegPeriod{
+    date start;
+    date end;
+    double accrual;
+};
+
+
+/**
+ * Swap PV01, the fixed leg annuity times one basis point, discounted on a
+ * flat continuously compounded curve. The fixed-leg schedule and annuity of
+ * each swap are built on first use and cached until the curve changes.
+ */
+template<>
+class PV01Calculator<IRSwap>{
+private:
+    struct CachedLeg{
+        vector<FixedLegPeriod> periods;
+        double annuity;
+    };
+    unordered_map<string, CachedLeg> legs;
+    date valuation_date;
+    double discount_rate;
+
+    const CachedLeg& GetLeg(const IRSwap &swap);
+
+public:
+    // ctor, valued on 18 December 2018, the date of the input data, against
+    // a flat 3% curve
+    PV01Calculator();
+
+    // Revalue against a new flat curve, dropping the cached annuities
+    void SetCurve(const date &_valuation_date, double _discount_rate);
+
+    // The fixed-leg periods of the swap, rolled back from termination
+    const vector<FixedLegPeriod>& GetFixedLegSchedule(const IRSwap &swap);
+
+    double GetUnitPV01(const IRSwap &swap);
+
+    // Year fraction of a period under the day count convention
+    static double YearFraction(const date &start, const date &end,
+                               DayCountConvention convention);
+};
+
+
 /**
  * A bucket sector to bucket a group of securities.
  * We can then aggregate bucketed risk to this bucket.
@@ -73,16 +161,24 @@ class RiskService : public Service<string,PV01 <T> >{
 private:
     map<string, PV01<T>> pv01_data;
     vector<ServiceListener<PV01<T>> *> service_listeners;
-    RiskService();
+    PV01Calculator<T> pv01_calculator;
+    const SecurityMaster* security_master;
+    double bucket_pv01[SECTOR_BUCKETS];
+    long bucket_quantity[SECTOR_BUCKETS];
+    const ShardedPipeline<T>* sharded_pipeline;
+
+    // Add a change of a product's risk to the bucket of the product
+    void UpdateBucket(const string &product_id, double pv01_change, long quantity_change);
 
 public:
-    static RiskService* GenerateInstance(){
-        static RiskService instance;
-        return &instance;
-    }
+    // ctor
+    RiskService();
+
+    // Instance owned by the default ServiceContext
+    static RiskService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    PV01<T>& GetData(string key) override;
+    PV01<T>& GetData(const string &key) override;
 
     void OnMessage(PV01<T> &data) override;
 
@@ -93,9 +189,29 @@ public:
     // Add a position that the service will risk
     void AddPosition(Position<T> &position);
 
+    // Restore a pv01 saved earlier, listeners are not notified
+    void RestorePV01(const PV01<T> &pv01);
+
+    // Every pv01, keyed on product identifier
+    const map<string, PV01<T>>& GetPV01s() const;
+
     // Get the bucketed risk for the bucket sector
     const PV01<BucketedSector<T>>& GetBucketedRisk(const BucketedSector<T> &sector) const;
 
+    // Aggregate risk per sector bucket of _security_master, kept up to date
+    // as positions are added
+    void SetSecurityMaster(const SecurityMaster* _security_master);
+
+    double GetBucketPV01(SectorBucket bucket) const;
+    long GetBucketQuantity(SectorBucket bucket) const;
+
+    // Take the bucketed risk from the shards of _sharded_pipeline, which
+    // bucket the risk of their own products, instead of bucketing here
+    void SetShardedPipeline(const ShardedPipeline<T>* _sharded_pipeline);
+
+    // The calculator of the per unit PV01 of each position
+    PV01Calculator<T>& GetPV01Calculator();
+
 };
 
 
@@ -106,13 +222,13 @@ template<typename T>
 class RiskServiceListener : public ServiceListener<Position<T>>{
 private:
     RiskService<T>* risk_service;
-    RiskServiceListener();
 
 public:
-    static RiskServiceListener<T>* GenerateInstance(){
-        static RiskServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    RiskServiceListener(RiskService<T>* _risk_service);
+
+    // Instance owned by the default ServiceContext
+    static RiskServiceListener* GenerateInstance();
 
     // Override virtual functions in base class Service
     void ProcessAdd(Position<T> & data) override;
@@ -127,6 +243,83 @@ public:
 
 
 /* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of PV01Calculator<Bond> class
+double PV01Calculator<Bond>::GetUnitPV01(const Bond &){
+    return 0.000001;
+}
+
+
+//
+// Implementation of PV01Calculator<IRSwap> class
+PV01Calculator<IRSwap>::PV01Calculator(){
+    valuation_date = date(2018, 12, 18);
+    discount_rate = 0.03;
+}
+
+void PV01Calculator<IRSwap>::SetCurve(const date &_valuation_date, double _discount_rate){
+    valuation_date = _valuation_date;
+    discount_rate = _discount_rate;
+    legs.clear();
+}
+
+double PV01Calculator<IRSwap>::YearFraction(const date &start, const date &end,
+        DayCountConvention convention){
+    if (convention == ACT_THREE_SIXTY) {
+        return (end - start).days() / 360.0;
+    }
+    // 30/360, day 31 rolls back to 30
+    int start_day = min<int>(start.day(), 30);
+    int end_day = end.day();
+    if (end_day == 31 && start_day == 30) {
+        end_day = 30;
+    }
+    return (360 * (end.year() - start.year()) + 30 * (end.month() - start.month()) +
+            (end_day - start_day)) / 360.0;
+}
+
+const PV01Calculator<IRSwap>::CachedLeg& PV01Calculator<IRSwap>::GetLeg(const IRSwap &swap){
+    auto cached = legs.find(swap.GetProductId());
+    if (cached != legs.end()) {
+        return cached->second;
+    }
+    CachedLeg leg;
+    const int period_months[3] = {3, 6, 12};
+    int step = period_months[swap.GetFixedLegPaymentFrequency()];
+    const date& effective = swap.GetEffectiveDate();
+    const date& termination = swap.GetTerminationDate();
+    if (!effective.is_special() && !termination.is_special()) {
+        // Roll back from termination, the first period is a short stub
+        vector<date> dates = {termination};
+        for (int i = 1; termination - months(i * step) > effective; ++i) {
+            dates.push_back(termination - months(i * step));
+        }
+        dates.push_back(effective);
+        for (size_t i = dates.size() - 1; i > 0; --i) {
+            leg.periods.push_back(FixedLegPeriod{dates[i], dates[i - 1],
+                    YearFraction(dates[i], dates[i - 1], swap.GetFixedLegDayCountConvention())});
+        }
+    }
+    leg.annuity = 0.0;
+    for (const FixedLegPeriod& period : leg.periods) {
+        if (period.end <= valuation_date) {
+            continue;
+        }
+        double years = (period.end - valuation_date).days() / 365.0;
+        leg.annuity += period.accrual * exp(-discount_rate * years);
+    }
+    return legs.insert(make_pair(swap.GetProductId(), move(leg))).first->second;
+}
+
+const vector<FixedLegPeriod>& PV01Calculator<IRSwap>::GetFixedLegSchedule(const IRSwap &swap){
+    return GetLeg(swap).periods;
+}
+
+double PV01Calculator<IRSwap>::GetUnitPV01(const IRSwap &swap){
+    return 0.0001 * GetLeg(swap).annuity;
+}
+
+
 //
 // Implementation of PV01 class
 template<typename T>
@@ -168,12 +361,28 @@ void PV01<T>::UpdateQuantity(long new_quantity) {
 }
 
 
+//
+// Implementation of RecordSchema<PV01<Bond>>
+PV01<Bond> RecordSchema<PV01<Bond>>::Build(pmr::memory_resource*,
+        const Security* security, double pv01, long quantity){
+    return PV01<Bond>(security->bond, pv01, quantity);
+}
+
+bool RecordSchema<PV01<Bond>>::Extract(const PV01<Bond> &pv01, const SecurityMaster &master,
+        const Security*& security, double &value, long &quantity){
+    security = master.Find(pv01.GetProduct().GetProductId());
+    value = pv01.GetPV01();
+    quantity = pv01.GetQuantity();
+    return security != nullptr;
+}
+
+
 //
 // Implementation of BucketedSector class
 template<typename T>
 BucketedSector<T>::BucketedSector(const vector<T>& _products, string _name) :
 products(_products){
-    name = _name;
+    name = move(_name);
 }
 
 template<typename T>
@@ -191,17 +400,24 @@ const string& BucketedSector<T>::GetName() const{
 // Implementation of RiskService class
 template<typename T>
 RiskService<T>::RiskService(){
-
+    security_master = nullptr;
+    sharded_pipeline = nullptr;
+    fill(bucket_pv01, bucket_pv01 + SECTOR_BUCKETS, 0.0);
+    fill(bucket_quantity, bucket_quantity + SECTOR_BUCKETS, 0);
 }
 
 template<typename T>
-PV01<T>& RiskService<T>::GetData(string key){
+PV01<T>& RiskService<T>::GetData(const string &key){
     return pv01_data[key];
 }
 
 template<typename T>
 void RiskService<T>::OnMessage(PV01<T> &data){
-
+    RestorePV01(data);
+    PV01<T>& stored = pv01_data[data.GetProduct().GetProductId()];
+    for (auto& listener : service_listeners) {
+        listener->ProcessAdd(stored);
+    }
 }
 
 template<typename T>
@@ -216,18 +432,87 @@ const vector<ServiceListener<PV01<T>>*>& RiskService<T>::GetListeners() const {
 
 template<typename T>
 void RiskService<T>::AddPosition(Position<T> &position){
-    const string product_id = position.GetProduct().GetProductId();
-    if (pv01_data.find(product_id) == pv01_data.end()){
-        pv01_data.insert(make_pair(product_id, PV01<T>(
-                         position.GetProduct(), 0, 0)));
+    INSTRUMENT_SCOPE("RiskService");
+    const string& product_id = position.GetProduct().GetProductId();
+    auto stored = pv01_data.find(product_id);
+    if (stored == pv01_data.end()){
+        stored = pv01_data.insert(make_pair(product_id, PV01<T>(
+                                  position.GetProduct(), 0, 0))).first;
     }
-    pv01_data[product_id].UpdatePV01(0.000001 * position.GetAggregatePosition());
-    pv01_data[product_id].UpdateQuantity(position.GetAggregatePosition());
+    double pv01_change = pv01_calculator.GetUnitPV01(position.GetProduct()) *
+                         position.GetAggregatePosition();
+    long quantity_change = position.GetAggregatePosition();
+    stored->second.UpdatePV01(pv01_change);
+    stored->second.UpdateQuantity(quantity_change);
+    UpdateBucket(product_id, pv01_change, quantity_change);
     for (auto& listener : service_listeners) {
-        listener->ProcessAdd(pv01_data[product_id]);
+        listener->ProcessAdd(stored->second);
     }
 }
 
+template<typename T>
+void RiskService<T>::RestorePV01(const PV01<T> &pv01){
+    PV01<T>& stored = pv01_data[pv01.GetProduct().GetProductId()];
+    UpdateBucket(pv01.GetProduct().GetProductId(), pv01.GetPV01() - stored.GetPV01(),
+                 pv01.GetQuantity() - stored.GetQuantity());
+    stored = pv01;
+}
+
+template<typename T>
+void RiskService<T>::UpdateBucket(const string &product_id, double pv01_change,
+        long quantity_change){
+    if (security_master == nullptr || sharded_pipeline != nullptr) {
+        return;
+    }
+    const Security* security = security_master->Find(product_id);
+    if (security != nullptr) {
+        bucket_pv01[security->bucket] += pv01_change;
+        bucket_quantity[security->bucket] += quantity_change;
+    }
+}
+
+template<typename T>
+void RiskService<T>::SetSecurityMaster(const SecurityMaster* _security_master){
+    security_master = _security_master;
+    // Rebucket the risk taken so far
+    fill(bucket_pv01, bucket_pv01 + SECTOR_BUCKETS, 0.0);
+    fill(bucket_quantity, bucket_quantity + SECTOR_BUCKETS, 0);
+    for (auto& pv01 : pv01_data) {
+        UpdateBucket(pv01.first, pv01.second.GetPV01(), pv01.second.GetQuantity());
+    }
+}
+
+template<typename T>
+double RiskService<T>::GetBucketPV01(SectorBucket bucket) const{
+    if (sharded_pipeline != nullptr) {
+        return sharded_pipeline->GetBucketPV01(bucket);
+    }
+    return bucket_pv01[bucket];
+}
+
+template<typename T>
+long RiskService<T>::GetBucketQuantity(SectorBucket bucket) const{
+    if (sharded_pipeline != nullptr) {
+        return sharded_pipeline->GetBucketQuantity(bucket);
+    }
+    return bucket_quantity[bucket];
+}
+
+template<typename T>
+void RiskService<T>::SetShardedPipeline(const ShardedPipeline<T>* _sharded_pipeline){
+    sharded_pipeline = _sharded_pipeline;
+}
+
+template<typename T>
+PV01Calculator<T>& RiskService<T>::GetPV01Calculator(){
+    return pv01_calculator;
+}
+
+template<typename T>
+const map<string, PV01<T>>& RiskService<T>::GetPV01s() const{
+    return pv01_data;
+}
+
 template<typename T>
 const PV01< BucketedSector<T> >& RiskService<T>::GetBucketedRisk(
         const BucketedSector<T> &sector) const{
@@ -249,8 +534,8 @@ const PV01< BucketedSector<T> >& RiskService<T>::GetBucketedRisk(
 //
 // Implementation of RiskServiceListener class
 template<typename T>
-RiskServiceListener<T>::RiskServiceListener(){
-    risk_service = RiskService<T>::GenerateInstance();
+RiskServiceListener<T>::RiskServiceListener(RiskService<T>* _risk_service){
+    risk_service = _risk_service;
 }
 
 template<typename T>
@@ -0,0 +1,498 @@
+/**
+ * scenario_service.hpp
+ * Defines the data types and Service for intraday curve-shift scenarios.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SCENARIO_SERVICE_HPP
+#define TRADING_SYSTEM_SCENARIO_SERVICE_HPP
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "soa.hpp"
+#include "products.hpp"
+#include "position_service.hpp"
+
+using namespace std;
+
+// Key rate points of the curve: 2Y, 3Y, 5Y, 7Y, 10Y, 30Y
+const int CURVE_POINTS = 6;
+const double CURVE_TENORS[CURVE_POINTS] = {2.0, 3.0, 5.0, 7.0, 10.0, 30.0};
+
+
+/**
+ * A curve scenario with a basis point shift on each key rate point.
+ */
+class CurveScenario{
+private:
+    string name;
+    double shifts[CURVE_POINTS];
+
+public:
+    // ctors
+    CurveScenario();
+    CurveScenario(string _name, const vector<double> &_shifts);
+
+    // getters
+    const string& GetName() const;
+
+    // Get the shift in basis points on a key rate point
+    double GetShift(int point) const;
+
+    // Parallel shifts of +-1/5/25bp and 2s30s twists pivoting on the 5Y point
+    static vector<CurveScenario> GenerateStandardScenarios();
+
+};
+
+
+/**
+ * Scenario PnL of a product, one value per scenario.
+ * Type T is the product type.
+ */
+template<typename T>
+class ScenarioRisk{
+private:
+    T product;
+    long quantity;
+    vector<double> pnl;
+
+public:
+    // ctors
+    ScenarioRisk();
+    ScenarioRisk(const T &_product, long _quantity, const vector<double> &_pnl);
+
+    // getters
+    const T& GetProduct() const;
+    long GetQuantity() const;
+    const vector<double>& GetPnL() const;
+
+};
+
+
+/**
+ * Scenario Service repricing positions under a set of curve scenarios.
+ * Key rate sensitivities are cached per product, and only the products whose
+ * positions changed since the last run are repriced. Bonds pay semi-annual
+ * coupons and are discounted on a flat continuously compounded curve.
+ * Keyed on product identifier.
+ * Type T is the product type.
+ */
+template<typename T>
+class ScenarioService : public Service<string, ScenarioRisk<T>>{
+private:
+    map<string, ScenarioRisk<T>> scenario_data;
+    vector<ServiceListener<ScenarioRisk<T>>*> service_listeners;
+    vector<CurveScenario> scenarios;
+    date valuation_date;
+    double discount_rate;
+    unsigned int thread_count;
+
+    // Flat tables, one row per product
+    map<string, size_t> product_index;
+    vector<T> products;
+    vector<long> quantities;
+    vector<double> sensitivities;    // products x CURVE_POINTS
+    vector<double> scenario_shifts;  // CURVE_POINTS x scenarios
+    vector<double> scenario_pnl;     // products x scenarios
+    vector<char> dirty;
+    vector<size_t> dirty_products;
+
+    // Key rate PV01 per unit of face value: the PV01 of each coupon and of
+    // the principal, split between the curve points bracketing its payment
+    void CacheSensitivities(size_t row);
+
+    // Split the PV01 of a cash flow paid in years linearly between the two
+    // curve points around it, or put it on the first or last point outside
+    static void AddKeyRatePV01(double* bucket, double years, double pv01);
+
+    // Reprice rows [begin, end) of the dirty products under all scenarios
+    void RepriceRange(size_t begin, size_t end);
+
+public:
+    // ctor
+    ScenarioService();
+
+    // Instance owned by the default ServiceContext
+    static ScenarioService* GenerateInstance();
+
+    // Override virtual functions in base class Service
+    ScenarioRisk<T>& GetData(const string &key) override;
+
+    void OnMessage(ScenarioRisk<T> &data) override;
+
+    void AddListener(ServiceListener<ScenarioRisk<T>>* listener) override;
+
+    const vector<ServiceListener<ScenarioRisk<T>>*>& GetListeners() const override;
+
+    // Replace the scenario set, which reprices every product on the next run
+    void SetScenarios(const vector<CurveScenario> &_scenarios);
+
+    const vector<CurveScenario>& GetScenarios() const;
+
+    // Set the valuation date, which invalidates the cached sensitivities
+    void SetValuationDate(const date &_valuation_date);
+
+    // Set the flat curve rate, which invalidates the cached sensitivities
+    void SetDiscountRate(double _discount_rate);
+
+    // Number of worker threads used by RunScenarios
+    void SetThreadCount(unsigned int _thread_count);
+
+    // Add a position that the service will run scenarios on
+    void AddPosition(Position<T> &position);
+
+    // Reprice all products whose positions changed since the last run
+    void RunScenarios();
+
+    // Get the PnL of all positions under each scenario
+    vector<double> GetAggregatePnL() const;
+
+};
+
+
+/** ScenarioServiceListener listen to PositionService
+* Type T is the product type.
+*/
+template<typename T>
+class ScenarioServiceListener : public ServiceListener<Position<T>>{
+private:
+    ScenarioService<T>* scenario_service;
+
+public:
+    // ctor
+    ScenarioServiceListener(ScenarioService<T>* _scenario_service);
+
+    // Instance owned by the default ServiceContext
+    static ScenarioServiceListener* GenerateInstance();
+
+    // Override virtual functions in base class Service
+    void ProcessAdd(Position<T> &data) override;
+
+    void ProcessRemove(Position<T> &data) override;
+
+    void ProcessUpdate(Position<T> &data) override;
+
+    ScenarioService<T>* GetService();
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of CurveScenario class
+CurveScenario::CurveScenario(){
+    name = "Base";
+    fill(shifts, shifts + CURVE_POINTS, 0.0);
+}
+
+CurveScenario::CurveScenario(string _name, const vector<double> &_shifts){
+    name = move(_name);
+    for(size_t i = 0; i < CURVE_POINTS; ++i){
+        shifts[i] = i < _shifts.size() ? _shifts[i] : 0.0;
+    }
+}
+
+const string& CurveScenario::GetName() const{
+    return name;
+}
+
+double CurveScenario::GetShift(int point) const{
+    return shifts[point];
+}
+
+vector<CurveScenario> CurveScenario::GenerateStandardScenarios(){
+    vector<CurveScenario> standard_scenarios;
+    for(double bp : {1.0, 5.0, 25.0}){
+        for(double sign : {1.0, -1.0}){
+            string shift_name = (sign > 0 ? "+" : "-") + to_string(int(bp)) + "bp";
+            standard_scenarios.push_back(CurveScenario("Parallel" + shift_name,
+                                         vector<double>(CURVE_POINTS, sign * bp)));
+            // Twist pivots on 5Y, scaled linearly out to the 2Y and 30Y points
+            vector<double> twist(CURVE_POINTS);
+            for(int i = 0; i < CURVE_POINTS; ++i){
+                double distance = CURVE_TENORS[i] < 5.0 ?
+                        (CURVE_TENORS[i] - 5.0) / 3.0 :
+                        (CURVE_TENORS[i] - 5.0) / 25.0;
+                twist[i] = sign * bp * distance;
+            }
+            standard_scenarios.push_back(CurveScenario("Twist" + shift_name,
+                                                       twist));
+        }
+    }
+    return standard_scenarios;
+}
+
+
+//
+// Implementation of ScenarioRisk class
+template<typename T>
+ScenarioRisk<T>::ScenarioRisk() : product(T()){
+    quantity = 0;
+}
+
+template<typename T>
+ScenarioRisk<T>::ScenarioRisk(const T &_product, long _quantity,
+        const vector<double> &_pnl) : product(_product), pnl(_pnl){
+    quantity = _quantity;
+}
+
+template<typename T>
+const T& ScenarioRisk<T>::GetProduct() const{
+    return product;
+}
+
+template<typename T>
+long ScenarioRisk<T>::GetQuantity() const{
+    return quantity;
+}
+
+template<typename T>
+const vector<double>& ScenarioRisk<T>::GetPnL() const{
+    return pnl;
+}
+
+
+//
+// Implementation of ScenarioService class
+template<typename T>
+ScenarioService<T>::ScenarioService(){
+    valuation_date = date(2018, 12, 18);
+    discount_rate = 0.03;
+    thread_count = max(1u, thread::hardware_concurrency());
+    SetScenarios(CurveScenario::GenerateStandardScenarios());
+}
+
+template<typename T>
+ScenarioRisk<T>& ScenarioService<T>::GetData(const string &key){
+    return scenario_data[key];
+}
+
+template<typename T>
+void ScenarioService<T>::OnMessage(ScenarioRisk<T> &data){
+
+}
+
+template<typename T>
+void ScenarioService<T>::AddListener(ServiceListener<ScenarioRisk<T>>* listener){
+    service_listeners.push_back(listener);
+}
+
+template<typename T>
+const vector<ServiceListener<ScenarioRisk<T>>*>&
+ScenarioService<T>::GetListeners() const{
+    return service_listeners;
+}
+
+template<typename T>
+void ScenarioService<T>::SetScenarios(const vector<CurveScenario> &_scenarios){
+    scenarios = _scenarios;
+    size_t scenario_count = scenarios.size();
+    // Stored transposed so the inner loop runs over contiguous scenarios
+    scenario_shifts.assign(CURVE_POINTS * scenario_count, 0.0);
+    for(size_t s = 0; s < scenario_count; ++s){
+        for(int k = 0; k < CURVE_POINTS; ++k){
+            scenario_shifts[k * scenario_count + s] = scenarios[s].GetShift(k);
+        }
+    }
+    scenario_pnl.assign(products.size() * scenario_count, 0.0);
+    for(size_t row = 0; row < products.size(); ++row){
+        if(!dirty[row]){
+            dirty[row] = 1;
+            dirty_products.push_back(row);
+        }
+    }
+}
+
+template<typename T>
+const vector<CurveScenario>& ScenarioService<T>::GetScenarios() const{
+    return scenarios;
+}
+
+template<typename T>
+void ScenarioService<T>::SetValuationDate(const date &_valuation_date){
+    valuation_date = _valuation_date;
+    for(size_t row = 0; row < products.size(); ++row){
+        CacheSensitivities(row);
+        if(!dirty[row]){
+            dirty[row] = 1;
+            dirty_products.push_back(row);
+        }
+    }
+}
+
+template<typename T>
+void ScenarioService<T>::SetDiscountRate(double _discount_rate){
+    discount_rate = _discount_rate;
+    SetValuationDate(valuation_date);
+}
+
+template<typename T>
+void ScenarioService<T>::SetThreadCount(unsigned int _thread_count){
+    thread_count = max(1u, _thread_count);
+}
+
+template<typename T>
+void ScenarioService<T>::CacheSensitivities(size_t row){
+    double* bucket = &sensitivities[row * CURVE_POINTS];
+    fill(bucket, bucket + CURVE_POINTS, 0.0);
+    // Coupons rolled back from maturity every six months, the principal paid
+    // with the last one
+    double coupon = products[row].GetCoupon() / 100.0 / 2.0;
+    date maturity = products[row].GetMaturityDate();
+    for(int period = 0; maturity - months(6 * period) > valuation_date; ++period){
+        double years = (maturity - months(6 * period) - valuation_date).days() / 365.25;
+        double cash_flow = (period == 0) ? 1.0 + coupon : coupon;
+        AddKeyRatePV01(bucket, years,
+                       0.0001 * years * cash_flow * exp(-discount_rate * years));
+    }
+}
+
+template<typename T>
+void ScenarioService<T>::AddKeyRatePV01(double* bucket, double years, double pv01){
+    if(years <= CURVE_TENORS[0]){
+        bucket[0] += pv01;
+        return;
+    }
+    if(years >= CURVE_TENORS[CURVE_POINTS - 1]){
+        bucket[CURVE_POINTS - 1] += pv01;
+        return;
+    }
+    for(int k = 1; k < CURVE_POINTS; ++k){
+        if(years <= CURVE_TENORS[k]){
+            double weight = (CURVE_TENORS[k] - years) /
+                            (CURVE_TENORS[k] - CURVE_TENORS[k-1]);
+            bucket[k-1] += weight * pv01;
+            bucket[k] += (1.0 - weight) * pv01;
+            return;
+        }
+    }
+}
+
+template<typename T>
+void ScenarioService<T>::AddPosition(Position<T> &position){
+    INSTRUMENT_SCOPE("ScenarioService");
+    const string& product_id = position.GetProduct().GetProductId();
+    auto pos = product_index.find(product_id);
+    size_t row;
+    if(pos == product_index.end()){
+        row = products.size();
+        product_index.insert(make_pair(product_id, row));
+        products.push_back(position.GetProduct());
+        quantities.push_back(0);
+        dirty.push_back(0);
+        sensitivities.resize(products.size() * CURVE_POINTS);
+        scenario_pnl.resize(products.size() * scenarios.size());
+        CacheSensitivities(row);
+    }
+    else{
+        row = pos->second;
+    }
+    quantities[row] = position.GetAggregatePosition();
+    if(!dirty[row]){
+        dirty[row] = 1;
+        dirty_products.push_back(row);
+    }
+}
+
+template<typename T>
+void ScenarioService<T>::RepriceRange(size_t begin, size_t end){
+    size_t scenario_count = scenarios.size();
+    for(size_t i = begin; i < end; ++i){
+        size_t row = dirty_products[i];
+        double* pnl = &scenario_pnl[row * scenario_count];
+        const double* sensitivity = &sensitivities[row * CURVE_POINTS];
+        double quantity = quantities[row];
+        fill(pnl, pnl + scenario_count, 0.0);
+        for(int k = 0; k < CURVE_POINTS; ++k){
+            double weight = -quantity * sensitivity[k];
+            const double* shift = &scenario_shifts[k * scenario_count];
+            for(size_t s = 0; s < scenario_count; ++s){
+                pnl[s] += weight * shift[s];
+            }
+        }
+    }
+}
+
+template<typename T>
+void ScenarioService<T>::RunScenarios(){
+    size_t dirty_count = dirty_products.size();
+    // Not worth spawning threads for a handful of products
+    size_t min_rows_per_thread = 64;
+    size_t workers = min<size_t>(thread_count,
+                                 dirty_count / min_rows_per_thread);
+    if(workers <= 1){
+        RepriceRange(0, dirty_count);
+    }
+    else{
+        vector<thread> pool;
+        size_t chunk = (dirty_count + workers - 1) / workers;
+        for(size_t begin = 0; begin < dirty_count; begin += chunk){
+            size_t end = min(dirty_count, begin + chunk);
+            pool.emplace_back(&ScenarioService<T>::RepriceRange, this,
+                              begin, end);
+        }
+        for(auto& worker : pool){
+            worker.join();
+        }
+    }
+    size_t scenario_count = scenarios.size();
+    for(auto row : dirty_products){
+        dirty[row] = 0;
+        const string& product_id = products[row].GetProductId();
+        auto first = scenario_pnl.begin() + row * scenario_count;
+        ScenarioRisk<T> scenario_risk(products[row], quantities[row],
+                vector<double>(first, first + scenario_count));
+        scenario_data[product_id] = scenario_risk;
+        for(auto& listener : service_listeners){
+            listener->ProcessAdd(scenario_data[product_id]);
+        }
+    }
+    dirty_products.clear();
+}
+
+template<typename T>
+vector<double> ScenarioService<T>::GetAggregatePnL() const{
+    size_t scenario_count = scenarios.size();
+    vector<double> aggregate_pnl(scenario_count, 0.0);
+    for(size_t row = 0; row < products.size(); ++row){
+        for(size_t s = 0; s < scenario_count; ++s){
+            aggregate_pnl[s] += scenario_pnl[row * scenario_count + s];
+        }
+    }
+    return aggregate_pnl;
+}
+
+
+//
+// Implementation of ScenarioServiceListener class
+template<typename T>
+ScenarioServiceListener<T>::ScenarioServiceListener(ScenarioService<T>* _scenario_service){
+    scenario_service = _scenario_service;
+}
+
+template<typename T>
+void ScenarioServiceListener<T>::ProcessAdd(Position<T> &data){
+    scenario_service->AddPosition(data);
+}
+
+template<typename T>
+void ScenarioServiceListener<T>::ProcessRemove(Position<T> &data){
+
+}
+
+template<typename T>
+void ScenarioServiceListener<T>::ProcessUpdate(Position<T> &data){
+
+}
+
+template<typename T>
+ScenarioService<T>* ScenarioServiceListener<T>::GetService(){
+    return scenario_service;
+}
+
+#endif //TRADING_SYSTEM_SCENARIO_SERVICE_HPP
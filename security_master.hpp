@@ -0,0 +1,190 @@
+/**
+ * security_master.hpp
+ * Defines the security master, the reference data of every bond loaded once
+ * from a local file, and the sector buckets the bonds are risked in.
+ *
+ * The file has one line per security after a header line:
+ *     CUSIP, ISIN, Ticker, Coupon, Maturity, IssueDate, Bucket
+ * with dates as YYYY-MM-DD and Bucket one of FrontEnd, Belly or LongEnd.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SECURITY_MASTER_HPP
+#define TRADING_SYSTEM_SECURITY_MASTER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "products.hpp"
+#include "arena.hpp"
+
+using namespace std;
+
+// Sectors of the curve a bond is risked in
+enum SectorBucket { FRONT_END, BELLY, LONG_END };
+
+const int SECTOR_BUCKETS = 3;
+
+// Name of each bucket, as in the security master file and the risk output
+const char* const SECTOR_BUCKET_NAMES[SECTOR_BUCKETS] = {"FrontEnd", "Belly", "LongEnd"};
+
+
+/**
+ * Reference data of one security. The bond is built once on load and
+ * copied into the messages parsed for it.
+ */
+struct Security{
+    Bond bond;
+    string isin;
+    date issue_date;
+    SectorBucket bucket;
+};
+
+
+/**
+ * Security master, the securities sorted by CUSIP behind an open addressing
+ * hash index on the CusipCode of each, so a lookup is one hash and usually one
+ * probe however many securities are loaded.
+ */
+class SecurityMaster{
+private:
+    vector<Security> securities;
+    vector<CusipCode> codes;
+    vector<int32_t> slots;
+    size_t slot_mask;
+
+    // Rebuild the hash index over securities
+    void BuildIndex();
+
+public:
+    // ctor, an empty master
+    SecurityMaster();
+
+    // ctor, load the securities in path
+    explicit SecurityMaster(const string &path);
+
+    // Replace the securities with those in path, throws if it cannot be read
+    void Load(const string &path);
+
+    // The security with the CUSIP, nullptr if unknown
+    const Security* Find(string_view cusip) const;
+
+    // Every security, sorted by CUSIP
+    const vector<Security>& GetSecurities() const;
+
+    // The bonds in a sector bucket
+    vector<Bond> GetBonds(SectorBucket bucket) const;
+
+    // The master loaded from the default input directory
+    static const SecurityMaster& Default();
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of SecurityMaster class
+SecurityMaster::SecurityMaster(){
+    slot_mask = 0;
+    BuildIndex();
+}
+
+SecurityMaster::SecurityMaster(const string &path){
+    slot_mask = 0;
+    Load(path);
+}
+
+void SecurityMaster::Load(const string &path){
+    ifstream data(path);
+    if (!data) {
+        throw runtime_error("SecurityMaster: cannot open " + path);
+    }
+    auto ParseBucket = [](string_view name){
+        for (int i = 0; i < SECTOR_BUCKETS; ++i) {
+            if (name == SECTOR_BUCKET_NAMES[i]) {
+                return (SectorBucket) i;
+            }
+        }
+        throw runtime_error("SecurityMaster: unknown bucket " + string(name));
+    };
+    MonotonicArena arena;
+    vector<Security> loaded;
+    string line;
+    getline(data, line);
+    while (getline(data, line)) {
+        arena.Reset();
+        pmr::vector<string_view> fields = SplitFields(line, ',', &arena);
+        if (fields.size() < 7) {
+            continue;
+        }
+        date maturity = from_simple_string(string(fields[4]));
+        Bond bond(string(fields[0]), CUSIP, string(fields[2]),
+                  stof(string(fields[3])), maturity);
+        loaded.push_back(Security{bond, string(fields[1]),
+                                  from_simple_string(string(fields[5])),
+                                  ParseBucket(fields[6])});
+    }
+    sort(loaded.begin(), loaded.end(), [](const Security &left, const Security &right){
+        return left.bond.GetProductId() < right.bond.GetProductId();
+    });
+    securities = move(loaded);
+    BuildIndex();
+}
+
+void SecurityMaster::BuildIndex(){
+    codes.clear();
+    for (const Security& security : securities) {
+        codes.push_back(security.bond.GetCusip());
+    }
+    // At most half full so probe runs stay short
+    size_t slot_count = 16;
+    while (slot_count < 2 * securities.size()) {
+        slot_count *= 2;
+    }
+    slots.assign(slot_count, -1);
+    slot_mask = slot_count - 1;
+    for (size_t i = 0; i < codes.size(); ++i) {
+        size_t slot = codes[i].Hash() & slot_mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & slot_mask;
+        }
+        slots[slot] = (int32_t) i;
+    }
+}
+
+const Security* SecurityMaster::Find(string_view cusip) const{
+    CusipCode code(cusip);
+    size_t slot = code.Hash() & slot_mask;
+    while (slots[slot] >= 0) {
+        if (codes[slots[slot]] == code) {
+            return &securities[slots[slot]];
+        }
+        slot = (slot + 1) & slot_mask;
+    }
+    return nullptr;
+}
+
+const vector<Security>& SecurityMaster::GetSecurities() const{
+    return securities;
+}
+
+vector<Bond> SecurityMaster::GetBonds(SectorBucket bucket) const{
+    vector<Bond> bonds;
+    for (const Security& security : securities) {
+        if (security.bucket == bucket) {
+            bonds.push_back(security.bond);
+        }
+    }
+    return bonds;
+}
+
+const SecurityMaster& SecurityMaster::Default(){
+    static SecurityMaster instance("../input/securities.txt");
+    return instance;
+}
+
+#endif //TRADING_SYSTEM_SECURITY_MASTER_HPP
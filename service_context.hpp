@@ -0,0 +1,936 @@
+/**
+ * service_context.hpp
+ * Defines a context owning and wiring one independent instance of every
+ * service, listener and connector of the trading system.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SERVICE_CONTEXT_HPP
+#define TRADING_SYSTEM_SERVICE_CONTEXT_HPP
+
+#include <memory>
+#include <string>
+#include "soa.hpp"
+#include "products.hpp"
+#include "security_master.hpp"
+#include "live_feed.hpp"
+#include "feed_handler.hpp"
+#include "order_gateway.hpp"
+#include "shared_memory_ring.hpp"
+#include "pricing_service.hpp"
+#include "streaming_service.hpp"
+#include "gui_service.hpp"
+#include "trade_booking_service.hpp"
+#include "position_service.hpp"
+#include "risk_service.hpp"
+#include "scenario_service.hpp"
+#include "market_data_service.hpp"
+#include "execution_service.hpp"
+#include "inquiry_service.hpp"
+#include "historical_data_service.hpp"
+#include "sharded_pipeline.hpp"
+#include "journal.hpp"
+#include "snapshot.hpp"
+#include "timeseries_store.hpp"
+#include "async_logger.hpp"
+
+using namespace std;
+
+// How often inputs followed live are left for timed work, publishing the
+// quotes held back whose conflation window has passed
+const chrono::milliseconds LIVE_TICK_INTERVAL(1);
+
+
+/**
+ * Service context owning a full pipeline, wired the same way for every
+ * instance. Several contexts can live in one process, e.g. for parallel
+ * backtests; the GenerateInstance() of each class returns the instance owned
+ * by the default context.
+ * Type T is the product type.
+ */
+template<typename T>
+class ServiceContext{
+private:
+    // reference data of every security
+    SecurityMaster security_master;
+
+    // pricing and streaming
+    PricingService<T> pricing_service;
+    PricingServiceConnector<T> pricing_service_connector;
+    AlgoStreamingService<T> algo_streaming_service;
+    AlgoStreamingServiceListener<T> algo_streaming_service_listener;
+    StreamingService<T> streaming_service;
+    StreamingServiceListener<T> streaming_service_listener;
+    StreamingHistoricalDataServiceConnector<T> streaming_historical_data_service_connector;
+    StreamingHistoricalDataService<T> streaming_historical_data_service;
+    StreamingHistoricalDataServiceListener<T> streaming_historical_data_service_listener;
+    GUIServiceConnector<T> gui_service_connector;
+    GUIService<T> gui_service;
+    GUIServiceListener<T> gui_service_listener;
+
+    // trades, positions and risk
+    TradeBookingService<T> trade_booking_service;
+    TradeBookingServiceConnector<T> trade_booking_service_connector;
+    PositionService<T> position_service;
+    PositionServiceListener<T> position_service_listener;
+    PositionHistoricalDataServiceConnector<T> position_historical_data_service_connector;
+    PositionHistoricalDataService<T> position_historical_data_service;
+    PositionHistoricalDataServiceListener<T> position_historical_data_service_listener;
+    RiskService<T> risk_service;
+    RiskServiceListener<T> risk_service_listener;
+    RiskHistoricalDataServiceConnector<T> risk_historical_data_service_connector;
+    RiskHistoricalDataService<T> risk_historical_data_service;
+    RiskHistoricalDataServiceListener<T> risk_historical_data_service_listener;
+    ScenarioService<T> scenario_service;
+    ScenarioServiceListener<T> scenario_service_listener;
+
+    // market data and executions
+    MarketDataService<T> market_data_service;
+    MarketDataServiceConnector<T> market_data_service_connector;
+    AlgoExecutionService<T> algo_execution_service;
+    AlgoExecutionServiceListener<T> algo_execution_service_listener;
+    ExecutionService<T> execution_service;
+    ExecutionServiceListener<T> execution_service_listener;
+    ExecutionHistoricalDataServiceConnector<T> execution_historical_data_service_connector;
+    ExecutionHistoricalDataService<T> execution_historical_data_service;
+    ExecutionHistoricalDataServiceListener<T> execution_historical_data_service_listener;
+    TradeBookingServiceListener<T> trade_booking_service_listener;
+
+    // inquiries
+    InquiryService<T> inquiry_service;
+    InquiryServiceConnector<T> inquiry_service_connector;
+    InquiryHistoricalDataServiceConnector<T> inquiry_historical_data_service_connector;
+    InquiryHistoricalDataService<T> inquiry_historical_data_service;
+    InquiryHistoricalDataServiceListener<T> inquiry_historical_data_service_listener;
+    // journals of the historical connectors, once enabled
+    unique_ptr<JournalWriter> streaming_journal;
+    unique_ptr<JournalWriter> position_journal;
+    unique_ptr<JournalWriter> risk_journal;
+    unique_ptr<JournalWriter> execution_journal;
+    unique_ptr<JournalWriter> inquiry_journal;
+    // snapshots of the service state, once enabled
+    unique_ptr<SnapshotStore<T>> snapshot_store;
+    unique_ptr<PeriodicActionListener<Position<T>>> snapshot_listener;
+    // time series of the streaming, position and risk history, once enabled
+    unique_ptr<TimeSeriesStore> streaming_time_series;
+    unique_ptr<TimeSeriesStore> position_time_series;
+    unique_ptr<TimeSeriesStore> risk_time_series;
+    // logger of the historical connectors, once enabled
+    unique_ptr<AsyncLogger> async_logger;
+    // market and gateway the executions go out through, once enabled
+    unique_ptr<SimulatedCounterparty> counterparty;
+    unique_ptr<OrderGatewayConnector<T>> order_gateway;
+    // rings the services publish on for other processes, once enabled
+    unique_ptr<SharedMemoryPublisher<Price<T>>> price_publisher;
+    unique_ptr<SharedMemoryPublisher<OrderBook<T>>> market_data_publisher;
+    unique_ptr<SharedMemoryPublisher<Trade<T>>> trade_publisher;
+    unique_ptr<SharedMemoryPublisher<Position<T>>> position_publisher;
+    unique_ptr<SharedMemoryPublisher<PV01<T>>> risk_publisher;
+    unique_ptr<ConnectorListener<Price<T>>> price_publisher_listener;
+    unique_ptr<ConnectorListener<OrderBook<T>>> market_data_publisher_listener;
+    unique_ptr<ConnectorListener<Trade<T>>> trade_publisher_listener;
+    unique_ptr<ConnectorListener<Position<T>>> position_publisher_listener;
+    unique_ptr<ConnectorListener<PV01<T>>> risk_publisher_listener;
+
+    // Declared last, drained while the services it feeds are alive
+    unique_ptr<ShardedPipeline<T>> sharded_pipeline;
+
+    // Wait for the shards, if any, to process what was routed to them
+    void DrainShards();
+
+public:
+    // ctor, input and output files are looked up in the given directories
+    ServiceContext(const string &input_directory = "../input/",
+                   const string &output_directory = "../output/");
+    ServiceContext(const ServiceContext &) = delete;
+    ServiceContext& operator=(const ServiceContext &) = delete;
+
+    // The context behind every GenerateInstance()
+    static ServiceContext& Default();
+
+    // Subscribe all input connectors, flowing data into the system
+    void Subscribe();
+
+    // Follow all inputs on a live feed instead of reading them once, the
+    // data flows into the system while the feed runs
+    void Follow(LiveFeed &feed, LiveSourceType type = FOLLOW_FILE);
+
+    // Subscribe with prices and order books taken from network feeds until
+    // both end, and trades and inquiries read from their files
+    void Subscribe(FeedHandler<Price<T>> &price_feed,
+                   FeedHandler<OrderBook<T>> &market_data_feed);
+
+    // Journal everything the historical connectors publish into binary
+    // journals under journal_directory
+    void EnableJournal(const string &journal_directory);
+
+    // Snapshot positions, risk, executions and inquiries under
+    // snapshot_directory every interval position updates, needs the journal
+    void EnableSnapshots(const string &snapshot_directory, size_t interval);
+
+    // Keep the streaming, position and risk history in columnar time-series
+    // stores under time_series_directory, queried through the historical services
+    void EnableTimeSeries(const string &time_series_directory);
+
+    // Format and write the lines of the historical connectors on a background
+    // thread instead of the thread driving the services
+    void EnableAsyncLogging(LogFormat format = TEXT_FORMAT,
+                            PriceNotation notation = DECIMAL_NOTATION);
+
+    // Wait until the lines logged so far are written
+    void FlushLogs();
+
+    // Send executions out through an order gateway to the market at
+    // address:port, started here as a simulated counterparty if simulate.
+    // Subscribe waits for the fills of the orders sent.
+    void EnableOrderGateway(const string &address, uint16_t port, bool simulate = true);
+
+    // Publish the prices, order books, trades, positions and risk of the
+    // services on shared memory rings named prefix followed by prices,
+    // marketdata, trades, positions and risk, for subscribers in other
+    // processes. prefix starts with a slash.
+    void EnableSharedMemoryPublishing(const string &prefix,
+                                      size_t capacity = SHARED_RING_CAPACITY);
+
+    // Tell the subscribers of the rings no more messages follow
+    void FinishSharedMemoryPublishing();
+
+    // Price, keep the order books and book trades into positions and risk on
+    // shard_count worker threads sharded by product, the shards bucketing the
+    // risk of their products. What the shards publish comes back to the
+    // listeners of the services here, on the thread driving the connectors,
+    // the services here only keeping the latest of each for lookups.
+    void EnableSharding(size_t shard_count);
+
+    // The sharded pipeline, nullptr unless enabled
+    ShardedPipeline<T>* GetShardedPipeline(){
+        return sharded_pipeline.get();
+    }
+
+    // The order gateway, nullptr unless enabled
+    OrderGatewayConnector<T>* GetOrderGateway(){
+        return order_gateway.get();
+    }
+
+    // Snapshot the services now, written off the hot path by a forked child
+    void Snapshot();
+
+    // Warm restart, load the latest snapshot if any and replay the journals
+    // after it into the services, from their start if there is none. Inputs
+    // subscribed afterwards are taken as new events on top of that state.
+    void Restore();
+
+    // Reference data the connectors and risk resolve products against
+    const SecurityMaster* GetSecurityMaster(){
+        return &security_master;
+    }
+
+    // pricing and streaming
+    PricingService<T>* GetPricingService(){
+        return &pricing_service;
+    }
+
+    PricingServiceConnector<T>* GetPricingServiceConnector(){
+        return &pricing_service_connector;
+    }
+
+    AlgoStreamingService<T>* GetAlgoStreamingService(){
+        return &algo_streaming_service;
+    }
+
+    AlgoStreamingServiceListener<T>* GetAlgoStreamingServiceListener(){
+        return &algo_streaming_service_listener;
+    }
+
+    StreamingService<T>* GetStreamingService(){
+        return &streaming_service;
+    }
+
+    StreamingServiceListener<T>* GetStreamingServiceListener(){
+        return &streaming_service_listener;
+    }
+
+    StreamingHistoricalDataServiceConnector<T>* GetStreamingHistoricalDataServiceConnector(){
+        return &streaming_historical_data_service_connector;
+    }
+
+    StreamingHistoricalDataService<T>* GetStreamingHistoricalDataService(){
+        return &streaming_historical_data_service;
+    }
+
+    StreamingHistoricalDataServiceListener<T>* GetStreamingHistoricalDataServiceListener(){
+        return &streaming_historical_data_service_listener;
+    }
+
+    GUIServiceConnector<T>* GetGUIServiceConnector(){
+        return &gui_service_connector;
+    }
+
+    GUIService<T>* GetGUIService(){
+        return &gui_service;
+    }
+
+    GUIServiceListener<T>* GetGUIServiceListener(){
+        return &gui_service_listener;
+    }
+
+
+    // trades, positions and risk
+    TradeBookingService<T>* GetTradeBookingService(){
+        return &trade_booking_service;
+    }
+
+    TradeBookingServiceConnector<T>* GetTradeBookingServiceConnector(){
+        return &trade_booking_service_connector;
+    }
+
+    PositionService<T>* GetPositionService(){
+        return &position_service;
+    }
+
+    PositionServiceListener<T>* GetPositionServiceListener(){
+        return &position_service_listener;
+    }
+
+    PositionHistoricalDataServiceConnector<T>* GetPositionHistoricalDataServiceConnector(){
+        return &position_historical_data_service_connector;
+    }
+
+    PositionHistoricalDataService<T>* GetPositionHistoricalDataService(){
+        return &position_historical_data_service;
+    }
+
+    PositionHistoricalDataServiceListener<T>* GetPositionHistoricalDataServiceListener(){
+        return &position_historical_data_service_listener;
+    }
+
+    RiskService<T>* GetRiskService(){
+        return &risk_service;
+    }
+
+    RiskServiceListener<T>* GetRiskServiceListener(){
+        return &risk_service_listener;
+    }
+
+    RiskHistoricalDataServiceConnector<T>* GetRiskHistoricalDataServiceConnector(){
+        return &risk_historical_data_service_connector;
+    }
+
+    RiskHistoricalDataService<T>* GetRiskHistoricalDataService(){
+        return &risk_historical_data_service;
+    }
+
+    RiskHistoricalDataServiceListener<T>* GetRiskHistoricalDataServiceListener(){
+        return &risk_historical_data_service_listener;
+    }
+
+    ScenarioService<T>* GetScenarioService(){
+        return &scenario_service;
+    }
+
+    ScenarioServiceListener<T>* GetScenarioServiceListener(){
+        return &scenario_service_listener;
+    }
+
+
+    // market data and executions
+    MarketDataService<T>* GetMarketDataService(){
+        return &market_data_service;
+    }
+
+    MarketDataServiceConnector<T>* GetMarketDataServiceConnector(){
+        return &market_data_service_connector;
+    }
+
+    AlgoExecutionService<T>* GetAlgoExecutionService(){
+        return &algo_execution_service;
+    }
+
+    AlgoExecutionServiceListener<T>* GetAlgoExecutionServiceListener(){
+        return &algo_execution_service_listener;
+    }
+
+    ExecutionService<T>* GetExecutionService(){
+        return &execution_service;
+    }
+
+    ExecutionServiceListener<T>* GetExecutionServiceListener(){
+        return &execution_service_listener;
+    }
+
+    ExecutionHistoricalDataServiceConnector<T>* GetExecutionHistoricalDataServiceConnector(){
+        return &execution_historical_data_service_connector;
+    }
+
+    ExecutionHistoricalDataService<T>* GetExecutionHistoricalDataService(){
+        return &execution_historical_data_service;
+    }
+
+    ExecutionHistoricalDataServiceListener<T>* GetExecutionHistoricalDataServiceListener(){
+        return &execution_historical_data_service_listener;
+    }
+
+    TradeBookingServiceListener<T>* GetTradeBookingServiceListener(){
+        return &trade_booking_service_listener;
+    }
+
+
+    // inquiries
+    InquiryService<T>* GetInquiryService(){
+        return &inquiry_service;
+    }
+
+    InquiryServiceConnector<T>* GetInquiryServiceConnector(){
+        return &inquiry_service_connector;
+    }
+
+    InquiryHistoricalDataServiceConnector<T>* GetInquiryHistoricalDataServiceConnector(){
+        return &inquiry_historical_data_service_connector;
+    }
+
+    InquiryHistoricalDataService<T>* GetInquiryHistoricalDataService(){
+        return &inquiry_historical_data_service;
+    }
+
+    InquiryHistoricalDataServiceListener<T>* GetInquiryHistoricalDataServiceListener(){
+        return &inquiry_historical_data_service_listener;
+    }
+
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of ServiceContext class
+template<typename T>
+ServiceContext<T>::ServiceContext(const string &input_directory,
+        const string &output_directory) :
+        security_master(input_directory + "securities.txt"),
+        pricing_service_connector(&pricing_service, input_directory + "prices.txt"),
+        algo_streaming_service(&position_service),
+        algo_streaming_service_listener(&algo_streaming_service),
+        streaming_service_listener(&streaming_service),
+        streaming_historical_data_service_connector(output_directory + "streaming.txt"),
+        streaming_historical_data_service(&streaming_historical_data_service_connector),
+        streaming_historical_data_service_listener(&streaming_historical_data_service),
+        gui_service_connector(output_directory + "gui.txt"),
+        gui_service(&gui_service_connector),
+        gui_service_listener(&gui_service),
+        trade_booking_service_connector(&trade_booking_service, input_directory + "trades.txt"),
+        position_service_listener(&position_service),
+        position_historical_data_service_connector(output_directory + "positions.txt"),
+        position_historical_data_service(&position_historical_data_service_connector),
+        position_historical_data_service_listener(&position_historical_data_service),
+        risk_service_listener(&risk_service),
+        risk_historical_data_service_connector(output_directory + "risk.txt", &risk_service),
+        risk_historical_data_service(&risk_historical_data_service_connector),
+        risk_historical_data_service_listener(&risk_historical_data_service),
+        scenario_service_listener(&scenario_service),
+        market_data_service_connector(&market_data_service, input_directory + "marketdata.txt"),
+        algo_execution_service_listener(&algo_execution_service),
+        execution_service_listener(&execution_service),
+        execution_historical_data_service_connector(output_directory + "executions.txt"),
+        execution_historical_data_service(&execution_historical_data_service_connector),
+        execution_historical_data_service_listener(&execution_historical_data_service),
+        trade_booking_service_listener(&trade_booking_service),
+        inquiry_service(&pricing_service, &position_service),
+        inquiry_service_connector(&inquiry_service, input_directory + "inquiries.txt"),
+        inquiry_historical_data_service_connector(output_directory + "allinquiries.txt"),
+        inquiry_historical_data_service(&inquiry_historical_data_service_connector),
+        inquiry_historical_data_service_listener(&inquiry_historical_data_service){
+    // reference data
+    pricing_service_connector.SetSecurityMaster(&security_master);
+    trade_booking_service_connector.SetSecurityMaster(&security_master);
+    market_data_service_connector.SetSecurityMaster(&security_master);
+    inquiry_service_connector.SetSecurityMaster(&security_master);
+    risk_service.SetSecurityMaster(&security_master);
+
+    // pricing and streaming
+    pricing_service.AddListener(&algo_streaming_service_listener);
+    algo_streaming_service.AddListener(&streaming_service_listener);
+    streaming_service.AddListener(&streaming_historical_data_service_listener);
+    pricing_service.AddListener(&gui_service_listener);
+
+    // trades, positions and risk
+    trade_booking_service.AddListener(&position_service_listener);
+    position_service.AddListener(&position_historical_data_service_listener);
+    position_service.AddListener(&risk_service_listener);
+    risk_service.AddListener(&risk_historical_data_service_listener);
+    position_service.AddListener(&scenario_service_listener);
+
+    // market data and executions
+    market_data_service.AddListener(&algo_execution_service_listener);
+    algo_execution_service.AddListener(&execution_service_listener);
+    execution_service.AddListener(&execution_historical_data_service_listener);
+    execution_service.AddListener(&trade_booking_service_listener);
+
+    // inquiries
+    inquiry_service.SetConnector(&inquiry_service_connector);
+    inquiry_service.AddListener(&inquiry_historical_data_service_listener);
+}
+
+template<typename T>
+ServiceContext<T>& ServiceContext<T>::Default(){
+    static ServiceContext instance;
+    return instance;
+}
+
+template<typename T>
+void ServiceContext<T>::Subscribe(){
+    pricing_service_connector.Subscribe();
+    trade_booking_service_connector.Subscribe();
+    DrainShards();
+    market_data_service_connector.Subscribe();
+    DrainShards();
+    if (order_gateway) {
+        order_gateway->Subscribe();
+    }
+    inquiry_service_connector.Subscribe();
+}
+
+template<typename T>
+void ServiceContext<T>::Subscribe(FeedHandler<Price<T>> &price_feed,
+        FeedHandler<OrderBook<T>> &market_data_feed){
+    trade_booking_service_connector.Subscribe();
+    pollfd feeds[2] = {{price_feed.GetDescriptor(), POLLIN, 0},
+                       {market_data_feed.GetDescriptor(), POLLIN, 0}};
+    while (!price_feed.IsFinished() || !market_data_feed.IsFinished()) {
+        // Polled on timeouts too, so a quiet UDP feed can recover its tail
+        poll(feeds, 2, 10);
+        pricing_service_connector.Poll(price_feed);
+        market_data_service_connector.Poll(market_data_feed);
+        streaming_service.FlushExpired();
+    }
+    DrainShards();
+    if (order_gateway) {
+        order_gateway->Subscribe();
+    }
+    inquiry_service_connector.Subscribe();
+}
+
+template<typename T>
+void ServiceContext<T>::Follow(LiveFeed &feed, LiveSourceType type){
+    pricing_service_connector.Follow(feed, type);
+    trade_booking_service_connector.Follow(feed, type);
+    market_data_service_connector.Follow(feed, type);
+    inquiry_service_connector.Follow(feed, type);
+    feed.SetTick(LIVE_TICK_INTERVAL, [this]{
+        if (sharded_pipeline) {
+            sharded_pipeline->PollOutputs();
+        }
+        streaming_service.FlushExpired();
+    });
+}
+
+template<typename T>
+void ServiceContext<T>::EnableJournal(const string &journal_directory){
+    streaming_journal.reset(new JournalWriter(journal_directory, "streaming"));
+    position_journal.reset(new JournalWriter(journal_directory, "positions"));
+    risk_journal.reset(new JournalWriter(journal_directory, "risk"));
+    execution_journal.reset(new JournalWriter(journal_directory, "executions"));
+    inquiry_journal.reset(new JournalWriter(journal_directory, "inquiries"));
+    streaming_historical_data_service_connector.SetJournal(streaming_journal.get());
+    position_historical_data_service_connector.SetJournal(position_journal.get(),
+            [this](Position<T> &position){ position_service.RestorePosition(position); });
+    risk_historical_data_service_connector.SetJournal(risk_journal.get(),
+            [this](PV01<T> &pv01){ risk_service.RestorePV01(pv01); });
+    execution_historical_data_service_connector.SetJournal(execution_journal.get(),
+            [this](ExecutionOrder<T> &order){ execution_service.RestoreExecutionOrder(order); });
+    inquiry_historical_data_service_connector.SetJournal(inquiry_journal.get(),
+            [this](Inquiry<T> &inquiry){ inquiry_service.RestoreInquiry(inquiry); });
+}
+
+template<typename T>
+void ServiceContext<T>::EnableSnapshots(const string &snapshot_directory, size_t interval){
+    snapshot_store.reset(new SnapshotStore<T>(snapshot_directory, &position_service,
+            &risk_service, &execution_service, &inquiry_service));
+    // Added last, so the position and its risk are journaled before a snapshot
+    snapshot_listener.reset(new PeriodicActionListener<Position<T>>(
+            [this](){ Snapshot(); }, interval));
+    position_service.AddListener(snapshot_listener.get());
+}
+
+template<typename T>
+void ServiceContext<T>::EnableTimeSeries(const string &time_series_directory){
+    mkdir(time_series_directory.c_str(), 0755);
+    streaming_time_series.reset(new TimeSeriesStore(time_series_directory + "streaming/",
+            TimeSeriesCodec<PriceStream<T>>::Columns()));
+    position_time_series.reset(new TimeSeriesStore(time_series_directory + "positions/",
+            TimeSeriesCodec<Position<T>>::Columns()));
+    risk_time_series.reset(new TimeSeriesStore(time_series_directory + "risk/",
+            TimeSeriesCodec<PV01<T>>::Columns()));
+    streaming_historical_data_service.SetTimeSeries(streaming_time_series.get());
+    position_historical_data_service.SetTimeSeries(position_time_series.get());
+    risk_historical_data_service.SetTimeSeries(risk_time_series.get());
+}
+
+template<typename T>
+void ServiceContext<T>::EnableAsyncLogging(LogFormat format, PriceNotation notation){
+    async_logger.reset(new AsyncLogger());
+    streaming_historical_data_service_connector.SetLogger(async_logger.get(), format, notation);
+    position_historical_data_service_connector.SetLogger(async_logger.get(), format, notation);
+    risk_historical_data_service_connector.SetLogger(async_logger.get(), format, notation);
+    execution_historical_data_service_connector.SetLogger(async_logger.get(), format, notation);
+    inquiry_historical_data_service_connector.SetLogger(async_logger.get(), format, notation);
+}
+
+template<typename T>
+void ServiceContext<T>::EnableOrderGateway(const string &address, uint16_t port, bool simulate){
+    if (simulate) {
+        counterparty.reset(new SimulatedCounterparty(address, port));
+    }
+    order_gateway.reset(new OrderGatewayConnector<T>(&execution_service, &market_data_service,
+                                                     address, port));
+    execution_service.SetConnector(order_gateway.get());
+}
+
+template<typename T>
+void ServiceContext<T>::EnableSharedMemoryPublishing(const string &prefix, size_t capacity){
+    price_publisher.reset(new SharedMemoryPublisher<Price<T>>(
+            prefix + "prices", &security_master, capacity));
+    market_data_publisher.reset(new SharedMemoryPublisher<OrderBook<T>>(
+            prefix + "marketdata", &security_master, capacity));
+    trade_publisher.reset(new SharedMemoryPublisher<Trade<T>>(
+            prefix + "trades", &security_master, capacity));
+    position_publisher.reset(new SharedMemoryPublisher<Position<T>>(
+            prefix + "positions", &security_master, capacity));
+    risk_publisher.reset(new SharedMemoryPublisher<PV01<T>>(
+            prefix + "risk", &security_master, capacity));
+    price_publisher_listener.reset(new ConnectorListener<Price<T>>(price_publisher.get()));
+    market_data_publisher_listener.reset(
+            new ConnectorListener<OrderBook<T>>(market_data_publisher.get()));
+    trade_publisher_listener.reset(new ConnectorListener<Trade<T>>(trade_publisher.get()));
+    position_publisher_listener.reset(
+            new ConnectorListener<Position<T>>(position_publisher.get()));
+    risk_publisher_listener.reset(new ConnectorListener<PV01<T>>(risk_publisher.get()));
+    pricing_service.AddListener(price_publisher_listener.get());
+    market_data_service.AddListener(market_data_publisher_listener.get());
+    trade_booking_service.AddListener(trade_publisher_listener.get());
+    position_service.AddListener(position_publisher_listener.get());
+    risk_service.AddListener(risk_publisher_listener.get());
+}
+
+template<typename T>
+void ServiceContext<T>::FinishSharedMemoryPublishing(){
+    if (!price_publisher) {
+        return;
+    }
+    price_publisher->Finish();
+    market_data_publisher->Finish();
+    trade_publisher->Finish();
+    position_publisher->Finish();
+    risk_publisher->Finish();
+}
+
+template<typename T>
+void ServiceContext<T>::EnableSharding(size_t shard_count){
+    sharded_pipeline.reset(new ShardedPipeline<T>(shard_count, &security_master));
+    // The shards own the prices, books, positions and risk, the services here
+    // only keep the latest of each for the lookups of the services downstream
+    // and hand the outputs to their listeners
+    sharded_pipeline->SetDownstream(
+        [this](Price<T> &price){
+            pricing_service.RestorePrice(price);
+            for (auto& listener : pricing_service.GetListeners()) {
+                listener->ProcessAdd(price);
+            }
+        },
+        [this](OrderBook<T> &order_book){
+            market_data_service.RestoreOrderBook(order_book);
+            for (auto& listener : market_data_service.GetListeners()) {
+                listener->ProcessAdd(order_book);
+            }
+        },
+        [this](Position<T> &position){
+            // The risk of the position was taken on its shard
+            position_service.RestorePosition(position);
+            Position<T>& stored = position_service.GetData(position.GetProduct().GetProductId());
+            for (auto& listener : position_service.GetListeners()) {
+                if (listener != &risk_service_listener) {
+                    listener->ProcessAdd(stored);
+                }
+            }
+        },
+        [this](PV01<T> &pv01){
+            risk_service.RestorePV01(pv01);
+            PV01<T>& stored = risk_service.GetData(pv01.GetProduct().GetProductId());
+            for (auto& listener : risk_service.GetListeners()) {
+                listener->ProcessAdd(stored);
+            }
+        });
+    risk_service.SetShardedPipeline(sharded_pipeline.get());
+    pricing_service_connector.SetShardedPipeline(sharded_pipeline.get());
+    market_data_service_connector.SetShardedPipeline(sharded_pipeline.get());
+    position_service_listener.SetShardedPipeline(sharded_pipeline.get());
+}
+
+template<typename T>
+void ServiceContext<T>::DrainShards(){
+    if (sharded_pipeline) {
+        sharded_pipeline->Drain();
+    }
+}
+
+template<typename T>
+void ServiceContext<T>::FlushLogs(){
+    if (async_logger) {
+        async_logger->Flush();
+    }
+}
+
+template<typename T>
+void ServiceContext<T>::Snapshot(){
+    if (!snapshot_store || !position_journal) {
+        return;
+    }
+    map<string, uint64_t> sequences;
+    sequences[streaming_journal->GetName()] = streaming_journal->GetSequence();
+    sequences[position_journal->GetName()] = position_journal->GetSequence();
+    sequences[risk_journal->GetName()] = risk_journal->GetSequence();
+    sequences[execution_journal->GetName()] = execution_journal->GetSequence();
+    sequences[inquiry_journal->GetName()] = inquiry_journal->GetSequence();
+    // The logger thread is held off its files and allocations while forking
+    if (async_logger) {
+        async_logger->Pause();
+    }
+    snapshot_store->Save(sequences);
+    if (async_logger) {
+        async_logger->Resume();
+    }
+}
+
+template<typename T>
+void ServiceContext<T>::Restore(){
+    map<string, uint64_t> sequences;
+    if (snapshot_store) {
+        sequences = snapshot_store->Load();
+    }
+    if (!position_journal) {
+        return;
+    }
+    // Only the tail written after the snapshot is read, the journals are left
+    // as they are and appended to from there
+    position_historical_data_service_connector.Replay(
+            sequences[position_journal->GetName()]);
+    risk_historical_data_service_connector.Replay(sequences[risk_journal->GetName()]);
+    execution_historical_data_service_connector.Replay(
+            sequences[execution_journal->GetName()]);
+    inquiry_historical_data_service_connector.Replay(
+            sequences[inquiry_journal->GetName()]);
+    // The shards own the positions and risk once sharded
+    if (sharded_pipeline) {
+        sharded_pipeline->Restore(position_service.GetPositions(), risk_service.GetPV01s());
+    }
+}
+
+
+//
+// Default-context instances of every class
+template<typename T>
+PricingService<T>* PricingService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPricingService();
+}
+
+template<typename T>
+PricingServiceConnector<T>* PricingServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPricingServiceConnector();
+}
+
+template<typename T>
+AlgoStreamingService<T>* AlgoStreamingService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetAlgoStreamingService();
+}
+
+template<typename T>
+AlgoStreamingServiceListener<T>* AlgoStreamingServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetAlgoStreamingServiceListener();
+}
+
+template<typename T>
+StreamingService<T>* StreamingService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetStreamingService();
+}
+
+template<typename T>
+StreamingServiceListener<T>* StreamingServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetStreamingServiceListener();
+}
+
+template<typename T>
+StreamingHistoricalDataServiceConnector<T>* StreamingHistoricalDataServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetStreamingHistoricalDataServiceConnector();
+}
+
+template<typename T>
+StreamingHistoricalDataService<T>* StreamingHistoricalDataService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetStreamingHistoricalDataService();
+}
+
+template<typename T>
+StreamingHistoricalDataServiceListener<T>* StreamingHistoricalDataServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetStreamingHistoricalDataServiceListener();
+}
+
+template<typename T>
+GUIServiceConnector<T>* GUIServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetGUIServiceConnector();
+}
+
+template<typename T>
+GUIService<T>* GUIService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetGUIService();
+}
+
+template<typename T>
+GUIServiceListener<T>* GUIServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetGUIServiceListener();
+}
+
+template<typename T>
+TradeBookingService<T>* TradeBookingService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetTradeBookingService();
+}
+
+template<typename T>
+TradeBookingServiceConnector<T>* TradeBookingServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetTradeBookingServiceConnector();
+}
+
+template<typename T>
+PositionService<T>* PositionService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPositionService();
+}
+
+template<typename T>
+PositionServiceListener<T>* PositionServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPositionServiceListener();
+}
+
+template<typename T>
+PositionHistoricalDataServiceConnector<T>* PositionHistoricalDataServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPositionHistoricalDataServiceConnector();
+}
+
+template<typename T>
+PositionHistoricalDataService<T>* PositionHistoricalDataService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPositionHistoricalDataService();
+}
+
+template<typename T>
+PositionHistoricalDataServiceListener<T>* PositionHistoricalDataServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetPositionHistoricalDataServiceListener();
+}
+
+template<typename T>
+RiskService<T>* RiskService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetRiskService();
+}
+
+template<typename T>
+RiskServiceListener<T>* RiskServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetRiskServiceListener();
+}
+
+template<typename T>
+RiskHistoricalDataServiceConnector<T>* RiskHistoricalDataServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetRiskHistoricalDataServiceConnector();
+}
+
+template<typename T>
+RiskHistoricalDataService<T>* RiskHistoricalDataService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetRiskHistoricalDataService();
+}
+
+template<typename T>
+RiskHistoricalDataServiceListener<T>* RiskHistoricalDataServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetRiskHistoricalDataServiceListener();
+}
+
+template<typename T>
+ScenarioService<T>* ScenarioService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetScenarioService();
+}
+
+template<typename T>
+ScenarioServiceListener<T>* ScenarioServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetScenarioServiceListener();
+}
+
+template<typename T>
+MarketDataService<T>* MarketDataService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetMarketDataService();
+}
+
+template<typename T>
+MarketDataServiceConnector<T>* MarketDataServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetMarketDataServiceConnector();
+}
+
+template<typename T>
+AlgoExecutionService<T>* AlgoExecutionService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetAlgoExecutionService();
+}
+
+template<typename T>
+AlgoExecutionServiceListener<T>* AlgoExecutionServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetAlgoExecutionServiceListener();
+}
+
+template<typename T>
+ExecutionService<T>* ExecutionService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetExecutionService();
+}
+
+template<typename T>
+ExecutionServiceListener<T>* ExecutionServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetExecutionServiceListener();
+}
+
+template<typename T>
+ExecutionHistoricalDataServiceConnector<T>* ExecutionHistoricalDataServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetExecutionHistoricalDataServiceConnector();
+}
+
+template<typename T>
+ExecutionHistoricalDataService<T>* ExecutionHistoricalDataService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetExecutionHistoricalDataService();
+}
+
+template<typename T>
+ExecutionHistoricalDataServiceListener<T>* ExecutionHistoricalDataServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetExecutionHistoricalDataServiceListener();
+}
+
+template<typename T>
+TradeBookingServiceListener<T>* TradeBookingServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetTradeBookingServiceListener();
+}
+
+template<typename T>
+InquiryService<T>* InquiryService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetInquiryService();
+}
+
+template<typename T>
+InquiryServiceConnector<T>* InquiryServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetInquiryServiceConnector();
+}
+
+template<typename T>
+InquiryHistoricalDataServiceConnector<T>* InquiryHistoricalDataServiceConnector<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetInquiryHistoricalDataServiceConnector();
+}
+
+template<typename T>
+InquiryHistoricalDataService<T>* InquiryHistoricalDataService<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetInquiryHistoricalDataService();
+}
+
+template<typename T>
+InquiryHistoricalDataServiceListener<T>* InquiryHistoricalDataServiceListener<T>::GenerateInstance(){
+    return ServiceContext<T>::Default().GetInquiryHistoricalDataServiceListener();
+}
+
+#endif //TRADING_SYSTEM_SERVICE_CONTEXT_HPP
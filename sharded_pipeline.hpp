@@ -0,0 +1,610 @@
+/**
+ * sharded_pipeline.hpp
+ * Defines a pipeline sharding the pricing, market data, position and risk
+ * services by product across worker threads.
+ *
+ * The shards own the state of their products and do the work on it. What
+ * the shard services publish, prices, order books, positions and risk, comes
+ * back through a per-shard output queue and is handed to the downstream
+ * handlers on the routing thread, so the listeners further down the chain
+ * keep running on a single thread, in order per product. Each shard buckets
+ * the risk of its own products, the pipeline merges those partial sums.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SHARDED_PIPELINE_HPP
+#define TRADING_SYSTEM_SHARDED_PIPELINE_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include <functional>
+#include <map>
+#include "soa.hpp"
+#include "spsc_queue.hpp"
+#include "products.hpp"
+#include "pricing_service.hpp"
+#include "market_data_service.hpp"
+#include "position_service.hpp"
+#include "risk_service.hpp"
+
+using namespace std;
+
+
+/**
+ * An event routed to a shard: a price, an order book or a trade.
+ * Type T is the product type.
+ */
+template<typename T>
+using ShardEvent = variant<Price<T>, OrderBook<T>, Trade<T>>;
+
+
+/**
+ * Risk per sector bucket over the products of one shard.
+ */
+struct ShardBucketRisk{
+    size_t shard_index;
+    double pv01[SECTOR_BUCKETS];
+    long quantity[SECTOR_BUCKETS];
+};
+
+
+/**
+ * An output of a shard: a price, an order book, a position, a pv01 or the
+ * bucketed risk of the shard.
+ * Type T is the product type.
+ */
+template<typename T>
+using ShardOutput = variant<Price<T>, OrderBook<T>, Position<T>, PV01<T>, ShardBucketRisk>;
+
+
+/**
+ * Listener queueing what a shard service publishes as shard output.
+ * Type T is the product type, V the message type.
+ */
+template<typename T, typename V>
+class ShardOutputListener : public ServiceListener<V>{
+private:
+    SpscQueue<ShardOutput<T>>* output_queue;
+
+public:
+    // ctor
+    ShardOutputListener(SpscQueue<ShardOutput<T>>* _output_queue);
+
+    // Queue the message, spins while the queue is full
+    void ProcessAdd(V &data) override;
+
+    void ProcessRemove(V &) override;
+
+    void ProcessUpdate(V &) override;
+
+};
+
+
+/**
+ * Listener queueing the bucketed risk of a shard each time its risk changes.
+ * Type T is the product type.
+ */
+template<typename T>
+class ShardBucketListener : public ServiceListener<PV01<T>>{
+private:
+    const RiskService<T>* risk_service;
+    SpscQueue<ShardOutput<T>>* output_queue;
+    size_t shard_index;
+
+public:
+    // ctor
+    ShardBucketListener(const RiskService<T>* _risk_service,
+                        SpscQueue<ShardOutput<T>>* _output_queue, size_t _shard_index);
+
+    // Queue the bucket sums, spins while the queue is full
+    void ProcessAdd(PV01<T> &) override;
+
+    void ProcessRemove(PV01<T> &) override;
+
+    void ProcessUpdate(PV01<T> &) override;
+
+};
+
+
+/**
+ * One shard of the pipeline. It owns its own pricing, market data, position
+ * and risk services, touched only by its worker thread, so no locks are taken.
+ * Type T is the product type.
+ */
+template<typename T>
+class ServiceShard{
+private:
+    PricingService<T> pricing_service;
+    MarketDataService<T> market_data_service;
+    PositionService<T> position_service;
+    RiskService<T> risk_service;
+    RiskServiceListener<T> risk_service_listener;
+    SpscQueue<ShardEvent<T>> event_queue;
+    SpscQueue<ShardOutput<T>> output_queue;
+    ShardOutputListener<T, Price<T>> price_output_listener;
+    ShardOutputListener<T, OrderBook<T>> order_book_output_listener;
+    ShardOutputListener<T, Position<T>> position_output_listener;
+    ShardOutputListener<T, PV01<T>> pv01_output_listener;
+    ShardBucketListener<T> bucket_listener;
+    size_t shard_index;
+    size_t shard_count;
+    atomic<size_t> routed_count;
+    atomic<size_t> processed_count;
+    atomic<bool> running;
+    thread worker;
+
+    void Run();
+
+    void Process(ShardEvent<T> &event);
+
+public:
+    // ctor, starts the worker thread, the risk is bucketed by security_master
+    // unless it is null
+    ServiceShard(size_t _shard_index, size_t _shard_count, size_t queue_capacity,
+                 const SecurityMaster* security_master);
+    ~ServiceShard();
+
+    // Hand an event to the shard, false if the queue is full
+    bool TryRoute(const ShardEvent<T> &event);
+
+    // Take the next output of the shard, false if there is none
+    bool TryPopOutput(ShardOutput<T> &output);
+
+    // Has every routed event been processed?
+    bool IsIdle() const;
+
+    // Is the product routed to this shard?
+    bool Owns(const string &product_id) const;
+
+    // Partial sums of pv01 and quantity over the products this shard owns
+    pair<double, long> GetBucketedRisk(const BucketedSector<T> &sector);
+
+    // The shard services, only to be touched once idle
+    PricingService<T>* GetPricingService();
+    MarketDataService<T>* GetMarketDataService();
+    PositionService<T>* GetPositionService();
+    RiskService<T>* GetRiskService();
+
+};
+
+
+/**
+ * Pipeline sharding the services by product identifier across worker threads.
+ * Connectors route parsed events to the owning shard.
+ * Type T is the product type.
+ */
+template<typename T>
+class ShardedPipeline{
+private:
+    vector<unique_ptr<ServiceShard<T>>> shards;
+    function<void(Price<T>&)> price_handler;
+    function<void(OrderBook<T>&)> order_book_handler;
+    function<void(Position<T>&)> position_handler;
+    function<void(PV01<T>&)> pv01_handler;
+    // Latest bucketed risk of each shard
+    vector<ShardBucketRisk> bucket_risk;
+    // Outputs taken from the shards but not yet handed downstream, a handler
+    // routing events of its own only queues here so outputs keep their order
+    vector<ShardOutput<T>> deferred;
+    size_t deferred_head;
+    bool polling;
+
+    template<typename E>
+    void Route(ServiceShard<T>* shard, const E &event);
+
+    // Hand one output to its downstream handler
+    void Handle(ShardOutput<T> &output);
+
+public:
+    // ctor, one worker thread per shard, each bucketing the risk of its
+    // products by security_master unless it is null
+    ShardedPipeline(size_t shard_count, const SecurityMaster* security_master = nullptr,
+                    size_t queue_capacity = 1 << 16);
+
+    // dtor, drains the shards first
+    ~ShardedPipeline();
+
+    // Handlers of the shard outputs, called on the routing thread
+    void SetDownstream(function<void(Price<T>&)> _price_handler,
+                       function<void(OrderBook<T>&)> _order_book_handler,
+                       function<void(Position<T>&)> _position_handler,
+                       function<void(PV01<T>&)> _pv01_handler);
+
+    // Hand the outputs waiting to the downstream handlers, returns how many
+    size_t PollOutputs();
+
+    size_t GetShardCount() const;
+
+    // Index of the shard owning a product
+    size_t GetShardIndex(const string &product_id) const;
+
+    ServiceShard<T>* GetShard(const string &product_id);
+
+    // Route parsed events to the owning shard
+    void Route(const Price<T> &price);
+    void Route(const OrderBook<T> &order_book);
+    void Route(const Trade<T> &trade);
+
+    // Wait until every shard has processed all routed events and their
+    // outputs were handed downstream
+    void Drain();
+
+    // Merge the per-shard partial sums of the bucketed risk
+    PV01<BucketedSector<T>> GetBucketedRisk(const BucketedSector<T> &sector);
+
+    // Risk of a sector bucket, merged from the bucket sums of the shards as
+    // of the outputs handed downstream so far
+    double GetBucketPV01(SectorBucket bucket) const;
+    long GetBucketQuantity(SectorBucket bucket) const;
+
+    // Restore positions and pv01s saved earlier into the owning shards,
+    // listeners are not notified
+    void Restore(const map<string, Position<T>> &positions,
+                 const map<string, PV01<T>> &pv01s);
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of ShardOutputListener class
+template<typename T, typename V>
+ShardOutputListener<T, V>::ShardOutputListener(SpscQueue<ShardOutput<T>>* _output_queue){
+    output_queue = _output_queue;
+}
+
+template<typename T, typename V>
+void ShardOutputListener<T, V>::ProcessAdd(V &data){
+    ShardOutput<T> output(data);
+    while(!output_queue->TryPush(output)){
+        this_thread::yield();
+    }
+}
+
+template<typename T, typename V>
+void ShardOutputListener<T, V>::ProcessRemove(V &){
+}
+
+template<typename T, typename V>
+void ShardOutputListener<T, V>::ProcessUpdate(V &){
+}
+
+
+//
+// Implementation of ShardBucketListener class
+template<typename T>
+ShardBucketListener<T>::ShardBucketListener(const RiskService<T>* _risk_service,
+        SpscQueue<ShardOutput<T>>* _output_queue, size_t _shard_index){
+    risk_service = _risk_service;
+    output_queue = _output_queue;
+    shard_index = _shard_index;
+}
+
+template<typename T>
+void ShardBucketListener<T>::ProcessAdd(PV01<T> &){
+    ShardBucketRisk bucket_risk;
+    bucket_risk.shard_index = shard_index;
+    for(int bucket = 0; bucket < SECTOR_BUCKETS; ++bucket){
+        bucket_risk.pv01[bucket] = risk_service->GetBucketPV01((SectorBucket) bucket);
+        bucket_risk.quantity[bucket] = risk_service->GetBucketQuantity((SectorBucket) bucket);
+    }
+    ShardOutput<T> output(bucket_risk);
+    while(!output_queue->TryPush(output)){
+        this_thread::yield();
+    }
+}
+
+template<typename T>
+void ShardBucketListener<T>::ProcessRemove(PV01<T> &){
+}
+
+template<typename T>
+void ShardBucketListener<T>::ProcessUpdate(PV01<T> &){
+}
+
+
+//
+// Implementation of ServiceShard class
+template<typename T>
+ServiceShard<T>::ServiceShard(size_t _shard_index, size_t _shard_count,
+        size_t queue_capacity, const SecurityMaster* security_master) :
+        risk_service_listener(&risk_service),
+        event_queue(queue_capacity), output_queue(queue_capacity),
+        price_output_listener(&output_queue), order_book_output_listener(&output_queue),
+        position_output_listener(&output_queue), pv01_output_listener(&output_queue),
+        bucket_listener(&risk_service, &output_queue, _shard_index),
+        shard_index(_shard_index), shard_count(_shard_count), routed_count(0),
+        processed_count(0), running(true){
+    if(security_master != nullptr){
+        risk_service.SetSecurityMaster(security_master);
+    }
+    pricing_service.AddListener(&price_output_listener);
+    market_data_service.AddListener(&order_book_output_listener);
+    // Same order as the unsharded services, the position goes out before its risk
+    position_service.AddListener(&position_output_listener);
+    position_service.AddListener(&risk_service_listener);
+    // The bucket sums go out ahead of the pv01, so they include it by the
+    // time the pv01 reaches the listeners downstream
+    risk_service.AddListener(&bucket_listener);
+    risk_service.AddListener(&pv01_output_listener);
+    worker = thread(&ServiceShard<T>::Run, this);
+}
+
+template<typename T>
+ServiceShard<T>::~ServiceShard(){
+    running.store(false, memory_order_release);
+    worker.join();
+}
+
+template<typename T>
+void ServiceShard<T>::Run(){
+    ShardEvent<T> event;
+    while(running.load(memory_order_acquire)){
+        if(event_queue.TryPop(event)){
+            Process(event);
+            processed_count.fetch_add(1, memory_order_release);
+        }
+        else{
+            this_thread::yield();
+        }
+    }
+}
+
+template<typename T>
+void ServiceShard<T>::Process(ShardEvent<T> &event){
+    if(auto price = get_if<Price<T>>(&event)){
+        pricing_service.OnMessage(*price);
+    }
+    else if(auto order_book = get_if<OrderBook<T>>(&event)){
+        market_data_service.OnMessage(*order_book);
+    }
+    else if(auto trade = get_if<Trade<T>>(&event)){
+        position_service.AddTrade(*trade);
+    }
+}
+
+template<typename T>
+bool ServiceShard<T>::TryRoute(const ShardEvent<T> &event){
+    if(!event_queue.TryPush(event)){
+        return false;
+    }
+    routed_count.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+template<typename T>
+bool ServiceShard<T>::TryPopOutput(ShardOutput<T> &output){
+    return output_queue.TryPop(output);
+}
+
+template<typename T>
+bool ServiceShard<T>::IsIdle() const{
+    return processed_count.load(memory_order_acquire) ==
+           routed_count.load(memory_order_relaxed);
+}
+
+template<typename T>
+bool ServiceShard<T>::Owns(const string &product_id) const{
+    return hash<string>()(product_id) % shard_count == shard_index;
+}
+
+template<typename T>
+pair<double, long> ServiceShard<T>::GetBucketedRisk(
+        const BucketedSector<T> &sector){
+    pair<double, long> partial_sum(0.0, 0);
+    for(auto& product : sector.GetProducts()){
+        const string& product_id = product.GetProductId();
+        if(Owns(product_id)){
+            partial_sum.first += risk_service.GetData(product_id).GetPV01();
+            partial_sum.second += risk_service.GetData(product_id).GetQuantity();
+        }
+    }
+    return partial_sum;
+}
+
+template<typename T>
+PricingService<T>* ServiceShard<T>::GetPricingService(){
+    return &pricing_service;
+}
+
+template<typename T>
+MarketDataService<T>* ServiceShard<T>::GetMarketDataService(){
+    return &market_data_service;
+}
+
+template<typename T>
+PositionService<T>* ServiceShard<T>::GetPositionService(){
+    return &position_service;
+}
+
+template<typename T>
+RiskService<T>* ServiceShard<T>::GetRiskService(){
+    return &risk_service;
+}
+
+
+//
+// Implementation of ShardedPipeline class
+template<typename T>
+ShardedPipeline<T>::ShardedPipeline(size_t shard_count, const SecurityMaster* security_master,
+        size_t queue_capacity){
+    deferred_head = 0;
+    polling = false;
+    shard_count = max<size_t>(1, shard_count);
+    for(size_t i = 0; i < shard_count; ++i){
+        shards.emplace_back(new ServiceShard<T>(i, shard_count, queue_capacity,
+                                                security_master));
+    }
+    bucket_risk.assign(shard_count, ShardBucketRisk{0, {0.0}, {0}});
+}
+
+template<typename T>
+ShardedPipeline<T>::~ShardedPipeline(){
+    Drain();
+}
+
+template<typename T>
+void ShardedPipeline<T>::SetDownstream(function<void(Price<T>&)> _price_handler,
+        function<void(OrderBook<T>&)> _order_book_handler,
+        function<void(Position<T>&)> _position_handler,
+        function<void(PV01<T>&)> _pv01_handler){
+    price_handler = move(_price_handler);
+    order_book_handler = move(_order_book_handler);
+    position_handler = move(_position_handler);
+    pv01_handler = move(_pv01_handler);
+}
+
+template<typename T>
+size_t ShardedPipeline<T>::PollOutputs(){
+    ShardOutput<T> output;
+    for(auto& shard : shards){
+        while(shard->TryPopOutput(output)){
+            deferred.push_back(move(output));
+        }
+    }
+    if(polling){
+        return 0;
+    }
+    polling = true;
+    size_t handled = 0;
+    while(deferred_head < deferred.size()){
+        output = move(deferred[deferred_head++]);
+        Handle(output);
+        ++handled;
+    }
+    deferred.clear();
+    deferred_head = 0;
+    polling = false;
+    return handled;
+}
+
+template<typename T>
+void ShardedPipeline<T>::Handle(ShardOutput<T> &output){
+    if(auto price = get_if<Price<T>>(&output)){
+        if(price_handler) price_handler(*price);
+    }
+    else if(auto order_book = get_if<OrderBook<T>>(&output)){
+        if(order_book_handler) order_book_handler(*order_book);
+    }
+    else if(auto position = get_if<Position<T>>(&output)){
+        if(position_handler) position_handler(*position);
+    }
+    else if(auto pv01 = get_if<PV01<T>>(&output)){
+        if(pv01_handler) pv01_handler(*pv01);
+    }
+    else if(auto shard_bucket_risk = get_if<ShardBucketRisk>(&output)){
+        bucket_risk[shard_bucket_risk->shard_index] = *shard_bucket_risk;
+    }
+}
+
+template<typename T>
+size_t ShardedPipeline<T>::GetShardCount() const{
+    return shards.size();
+}
+
+template<typename T>
+size_t ShardedPipeline<T>::GetShardIndex(const string &product_id) const{
+    return hash<string>()(product_id) % shards.size();
+}
+
+template<typename T>
+ServiceShard<T>* ShardedPipeline<T>::GetShard(const string &product_id){
+    return shards[GetShardIndex(product_id)].get();
+}
+
+template<typename T>
+template<typename E>
+void ShardedPipeline<T>::Route(ServiceShard<T>* shard, const E &event){
+    ShardEvent<T> routed(event);
+    // Outputs are taken in while waiting, a shard may be waiting on them
+    while(!shard->TryRoute(routed)){
+        PollOutputs();
+        this_thread::yield();
+    }
+    PollOutputs();
+}
+
+template<typename T>
+void ShardedPipeline<T>::Route(const Price<T> &price){
+    Route(GetShard(price.GetProduct().GetProductId()), price);
+}
+
+template<typename T>
+void ShardedPipeline<T>::Route(const OrderBook<T> &order_book){
+    Route(GetShard(order_book.GetProduct().GetProductId()), order_book);
+}
+
+template<typename T>
+void ShardedPipeline<T>::Route(const Trade<T> &trade){
+    Route(GetShard(trade.GetProduct().GetProductId()), trade);
+}
+
+template<typename T>
+void ShardedPipeline<T>::Drain(){
+    for(auto& shard : shards){
+        while(!shard->IsIdle()){
+            PollOutputs();
+            this_thread::yield();
+        }
+    }
+    PollOutputs();
+}
+
+template<typename T>
+PV01<BucketedSector<T>> ShardedPipeline<T>::GetBucketedRisk(
+        const BucketedSector<T> &sector){
+    Drain();
+    PV01<BucketedSector<T>> bucketed_risk(sector, 0.0, 0);
+    for(auto& shard : shards){
+        pair<double, long> partial_sum = shard->GetBucketedRisk(sector);
+        bucketed_risk.UpdatePV01(partial_sum.first);
+        bucketed_risk.UpdateQuantity(partial_sum.second);
+    }
+    return bucketed_risk;
+}
+
+template<typename T>
+double ShardedPipeline<T>::GetBucketPV01(SectorBucket bucket) const{
+    double pv01 = 0.0;
+    for(const ShardBucketRisk& shard_bucket_risk : bucket_risk){
+        pv01 += shard_bucket_risk.pv01[bucket];
+    }
+    return pv01;
+}
+
+template<typename T>
+long ShardedPipeline<T>::GetBucketQuantity(SectorBucket bucket) const{
+    long quantity = 0;
+    for(const ShardBucketRisk& shard_bucket_risk : bucket_risk){
+        quantity += shard_bucket_risk.quantity[bucket];
+    }
+    return quantity;
+}
+
+template<typename T>
+void ShardedPipeline<T>::Restore(const map<string, Position<T>> &positions,
+        const map<string, PV01<T>> &pv01s){
+    // The shards are idle once drained, their services are safe to touch
+    Drain();
+    for(auto& position : positions){
+        GetShard(position.first)->GetPositionService()->RestorePosition(position.second);
+    }
+    for(auto& pv01 : pv01s){
+        GetShard(pv01.first)->GetRiskService()->RestorePV01(pv01.second);
+    }
+    for(size_t i = 0; i < shards.size(); ++i){
+        RiskService<T>* risk_service = shards[i]->GetRiskService();
+        for(int bucket = 0; bucket < SECTOR_BUCKETS; ++bucket){
+            bucket_risk[i].pv01[bucket] = risk_service->GetBucketPV01((SectorBucket) bucket);
+            bucket_risk[i].quantity[bucket] =
+                    risk_service->GetBucketQuantity((SectorBucket) bucket);
+        }
+    }
+}
+
+#endif //TRADING_SYSTEM_SHARDED_PIPELINE_HPP
@@ -0,0 +1,542 @@
+/**
+ * shared_memory_ring.hpp
+ * Defines the shared-memory transport between SOA processes: a bounded
+ * single producer, single consumer ring of fixed-size records in a POSIX
+ * shared memory object, with a publishing connector in one process and a
+ * subscribing connector in another.
+ *
+ * Each slot holds the send time of a message and its binary record, as laid
+ * out by the message's RecordSchema (record_parser.hpp). The publisher
+ * encodes straight into the slot and releases it by advancing the tail; the
+ * subscriber decodes in place and gives slots back by advancing the head.
+ * Head and tail sit on cache lines of their own and each side keeps a copy
+ * of the other's, read again only when the ring looks full or empty, so a
+ * hop costs a few cache line transfers and no system call while messages
+ * flow. An idle subscriber spins, yielding the CPU after a while.
+ *
+ * The subscriber leaves its pid in the header while it is attached, so a
+ * publisher waiting on a full ring can tell it exited and throw rather than
+ * wait for it forever.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SHARED_MEMORY_RING_HPP
+#define TRADING_SYSTEM_SHARED_MEMORY_RING_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "soa.hpp"
+#include "record_parser.hpp"
+#include "feed_handler.hpp"
+
+using namespace std;
+
+// Slots of a ring unless asked otherwise
+const size_t SHARED_RING_CAPACITY = 16384;
+
+// Empty polls an idle subscriber spins through before yielding the CPU
+const size_t SHARED_RING_SPINS = 4096;
+
+// Longest a publisher waits on a full ring the subscriber takes nothing from
+const int SHARED_RING_FULL_TIMEOUT_MILLIS = 10000;
+
+// Marks a ring whose header is set up
+const uint64_t SHARED_RING_MAGIC = 0x53484d52494e4731ULL;
+
+static_assert(atomic<uint64_t>::is_always_lock_free,
+              "shared memory rings need lock-free 64 bit atomics");
+
+
+/**
+ * Header of a ring, at the start of its shared memory object, followed by
+ * its slots.
+ */
+struct SharedRingHeader{
+    atomic<uint64_t> magic;
+    uint64_t capacity;
+    uint64_t slot_bytes;
+    uint64_t record_bytes;
+    // Next slot the publisher writes, written by the publisher only
+    alignas(64) atomic<uint64_t> tail;
+    // Next slot the subscriber reads, written by the subscriber only
+    alignas(64) atomic<uint64_t> head;
+    // Process of the subscriber attached, 0 while there is none
+    atomic<int32_t> subscriber_pid;
+    // Set by the publisher once it sends no more
+    alignas(64) atomic<uint32_t> finished;
+};
+
+
+/**
+ * A ring mapped into this process, created by the publisher and opened by
+ * the subscriber.
+ */
+class SharedMemoryRing{
+private:
+    string name;
+    bool owner;
+    void* mapping;
+    size_t mapping_size;
+    SharedRingHeader* header;
+    char* slots;
+    uint64_t mask;
+
+    void Map(int fd, size_t size);
+
+public:
+    // ctor, creates the ring called name, replacing a stale one, with
+    // capacity slots rounded up to a power of two for records of
+    // record_bytes. Throws if it cannot.
+    SharedMemoryRing(const string &_name, size_t capacity, size_t record_bytes);
+
+    // ctor, opens the ring called name for records of record_bytes, waiting
+    // up to timeout for its publisher to create it. Throws if it does not
+    // show up or holds other records.
+    SharedMemoryRing(const string &_name, size_t record_bytes, chrono::milliseconds timeout);
+
+    // dtor, the creator removes the name, the mapping stays valid for the
+    // other side until it goes too
+    ~SharedMemoryRing();
+    SharedMemoryRing(const SharedMemoryRing &) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing &) = delete;
+
+    SharedRingHeader& GetHeader();
+
+    // Slot of a sequence number
+    char* GetSlot(uint64_t sequence);
+
+    uint64_t GetCapacity() const;
+
+    const string& GetName() const;
+};
+
+
+/**
+ * Connector publishing messages of type V on a ring, for a subscriber in
+ * another process. Publish waits while the ring is full, and throws once
+ * the subscriber exited or took nothing for SHARED_RING_FULL_TIMEOUT_MILLIS,
+ * as does every Publish after.
+ * Type V is the message type.
+ */
+template<typename V>
+class SharedMemoryPublisher : public Connector<V>{
+private:
+    SharedMemoryRing ring;
+    const SecurityMaster* security_master;
+    uint64_t tail;
+    uint64_t cached_head;
+    uint64_t message_count;
+    uint64_t full_count;
+    bool subscriber_lost;
+
+    // Throw if the subscriber exited or the deadline passed
+    void CheckSubscriber(chrono::steady_clock::time_point deadline);
+
+public:
+    // ctor, creates the ring called name
+    SharedMemoryPublisher(const string &name, const SecurityMaster* _security_master,
+                          size_t capacity = SHARED_RING_CAPACITY);
+
+    // dtor, finishes the ring
+    ~SharedMemoryPublisher();
+
+    // Publish a message, skipped if its product is unknown
+    void Publish(V &data) override;
+
+    // Publish-only connector
+    void Subscribe() override;
+
+    // Tell the subscriber no more messages follow
+    void Finish();
+
+    uint64_t GetMessageCount() const;
+
+    // Publishes that found the ring full and waited
+    uint64_t GetFullCount() const;
+};
+
+
+/**
+ * Connector subscribing to messages of type V on a ring published by
+ * another process and passing them to a service's OnMessage.
+ * Type V is the message type.
+ */
+template<typename V>
+class SharedMemorySubscriber : public Connector<V>{
+private:
+    SharedMemoryRing ring;
+    Service<string, V>* service;
+    RecordParser<V> parser;
+    uint64_t head;
+    uint64_t cached_tail;
+    uint64_t message_count;
+    // Publish to receipt of each message, in nanoseconds
+    LatencyHistogram hop_latency;
+
+public:
+    // ctor, opens the ring called name, waiting up to timeout for it
+    SharedMemorySubscriber(const string &name, Service<string, V>* _service,
+                           const SecurityMaster* security_master,
+                           chrono::milliseconds timeout = chrono::milliseconds(10000));
+
+    // dtor, detaches from the ring
+    ~SharedMemorySubscriber();
+
+    // Subscribe-only connector
+    void Publish(V &data) override;
+
+    // Take in messages until the publisher finishes
+    void Subscribe() override;
+
+    // Take in the messages waiting without blocking, returns how many
+    size_t Poll();
+
+    // True once the publisher finished and every message was taken in
+    bool IsFinished();
+
+    uint64_t GetMessageCount() const;
+
+    const LatencyHistogram& GetHopLatency() const;
+
+    // Write the message count and hop latency percentiles as one line
+    void PrintStatistics(ostream &stream, const string &name) const;
+};
+
+
+/**
+ * Listener publishing every message a service adds to a connector, e.g.
+ * to hand a service's output to another process.
+ * Type V is the message type.
+ */
+template<typename V>
+class ConnectorListener : public ServiceListener<V>{
+private:
+    Connector<V>* connector;
+
+public:
+    // ctor
+    ConnectorListener(Connector<V>* _connector);
+
+    void ProcessAdd(V &data) override;
+
+    void ProcessRemove(V &data) override;
+
+    void ProcessUpdate(V &data) override;
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of SharedMemoryRing class
+SharedMemoryRing::SharedMemoryRing(const string &_name, size_t capacity, size_t record_bytes){
+    name = _name;
+    owner = true;
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    // Slots are whole cache lines, so the two sides never share one
+    size_t slot_bytes = (sizeof(int64_t) + record_bytes + 63) / 64 * 64;
+    size_t total = sizeof(SharedRingHeader) + size * slot_bytes;
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+    // Truncated first, so a stale ring of the same name starts from zero
+    if (fd < 0 || ftruncate(fd, 0) < 0 || ftruncate(fd, total) < 0) {
+        int error = errno;
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw runtime_error("SharedMemoryRing: cannot create " + name + ": " + strerror(error));
+    }
+    Map(fd, total);
+    header = new (mapping) SharedRingHeader();
+    header->capacity = size;
+    header->slot_bytes = slot_bytes;
+    header->record_bytes = record_bytes;
+    header->tail.store(0, memory_order_relaxed);
+    header->head.store(0, memory_order_relaxed);
+    header->subscriber_pid.store(0, memory_order_relaxed);
+    header->finished.store(0, memory_order_relaxed);
+    header->magic.store(SHARED_RING_MAGIC, memory_order_release);
+    slots = (char*) mapping + sizeof(SharedRingHeader);
+}
+
+SharedMemoryRing::SharedMemoryRing(const string &_name, size_t record_bytes,
+        chrono::milliseconds timeout){
+    name = _name;
+    owner = false;
+    auto deadline = chrono::steady_clock::now() + timeout;
+    while (true) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+        struct stat status;
+        if (fd >= 0 && fstat(fd, &status) == 0 &&
+            (size_t) status.st_size >= sizeof(SharedRingHeader)) {
+            Map(fd, status.st_size);
+            header = (SharedRingHeader*) mapping;
+            if (header->magic.load(memory_order_acquire) == SHARED_RING_MAGIC) {
+                break;
+            }
+            munmap(mapping, mapping_size);
+        }
+        else if (fd >= 0) {
+            close(fd);
+        }
+        if (chrono::steady_clock::now() > deadline) {
+            throw runtime_error("SharedMemoryRing: no ring " + name);
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    if (header->record_bytes != record_bytes) {
+        munmap(mapping, mapping_size);
+        throw runtime_error("SharedMemoryRing: " + name + " holds other records");
+    }
+    mask = header->capacity - 1;
+    slots = (char*) mapping + sizeof(SharedRingHeader);
+}
+
+void SharedMemoryRing::Map(int fd, size_t size){
+    mapping_size = size;
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw runtime_error("SharedMemoryRing: cannot map " + name + ": " + strerror(errno));
+    }
+}
+
+SharedMemoryRing::~SharedMemoryRing(){
+    munmap(mapping, mapping_size);
+    if (owner) {
+        shm_unlink(name.c_str());
+    }
+}
+
+SharedRingHeader& SharedMemoryRing::GetHeader(){
+    return *header;
+}
+
+char* SharedMemoryRing::GetSlot(uint64_t sequence){
+    return slots + (sequence & mask) * header->slot_bytes;
+}
+
+uint64_t SharedMemoryRing::GetCapacity() const{
+    return header->capacity;
+}
+
+const string& SharedMemoryRing::GetName() const{
+    return name;
+}
+
+
+//
+// Implementation of SharedMemoryPublisher class
+template<typename V>
+SharedMemoryPublisher<V>::SharedMemoryPublisher(const string &name,
+        const SecurityMaster* _security_master, size_t capacity)
+        : ring(name, capacity, RecordParser<V>::RECORD_BYTES){
+    security_master = _security_master;
+    tail = 0;
+    cached_head = 0;
+    message_count = 0;
+    full_count = 0;
+    subscriber_lost = false;
+}
+
+template<typename V>
+SharedMemoryPublisher<V>::~SharedMemoryPublisher(){
+    Finish();
+}
+
+template<typename V>
+void SharedMemoryPublisher<V>::Publish(V &data){
+    if (subscriber_lost) {
+        throw runtime_error("SharedMemoryPublisher: " + ring.GetName() + " lost its subscriber");
+    }
+    SharedRingHeader& header = ring.GetHeader();
+    if (tail - cached_head == header.capacity) {
+        cached_head = header.head.load(memory_order_acquire);
+        if (tail - cached_head == header.capacity) {
+            ++full_count;
+            auto deadline = chrono::steady_clock::now() +
+                            chrono::milliseconds(SHARED_RING_FULL_TIMEOUT_MILLIS);
+            size_t spins = 0;
+            while (tail - cached_head == header.capacity) {
+                // The subscriber is looked for once per round of spins
+                if (++spins % SHARED_RING_SPINS == 0) {
+                    CheckSubscriber(deadline);
+                }
+                if (spins > SHARED_RING_SPINS) {
+                    this_thread::yield();
+                }
+                cached_head = header.head.load(memory_order_acquire);
+            }
+        }
+    }
+    char* slot = ring.GetSlot(tail);
+    if (!RecordParser<V>::EncodeBinary(data, *security_master, slot + sizeof(int64_t))) {
+        return;
+    }
+    int64_t send_time = FeedClockNanos();
+    memcpy(slot, &send_time, sizeof(send_time));
+    ++tail;
+    ++message_count;
+    header.tail.store(tail, memory_order_release);
+}
+
+template<typename V>
+void SharedMemoryPublisher<V>::CheckSubscriber(chrono::steady_clock::time_point deadline){
+    // No pid yet means no subscriber attached, which only the deadline ends
+    pid_t pid = ring.GetHeader().subscriber_pid.load(memory_order_acquire);
+    bool exited = pid != 0 && kill(pid, 0) < 0 && errno == ESRCH;
+    if (exited || chrono::steady_clock::now() > deadline) {
+        subscriber_lost = true;
+        throw runtime_error("SharedMemoryPublisher: subscriber of " + ring.GetName() +
+                            (exited ? " exited" : " takes no messages"));
+    }
+}
+
+template<typename V>
+void SharedMemoryPublisher<V>::Subscribe(){
+}
+
+template<typename V>
+void SharedMemoryPublisher<V>::Finish(){
+    ring.GetHeader().finished.store(1, memory_order_release);
+}
+
+template<typename V>
+uint64_t SharedMemoryPublisher<V>::GetMessageCount() const{
+    return message_count;
+}
+
+template<typename V>
+uint64_t SharedMemoryPublisher<V>::GetFullCount() const{
+    return full_count;
+}
+
+
+//
+// Implementation of SharedMemorySubscriber class
+template<typename V>
+SharedMemorySubscriber<V>::SharedMemorySubscriber(const string &name,
+        Service<string, V>* _service, const SecurityMaster* security_master,
+        chrono::milliseconds timeout)
+        : ring(name, RecordParser<V>::RECORD_BYTES, timeout),
+          parser(security_master, BINARY_RECORDS, false){
+    service = _service;
+    head = ring.GetHeader().head.load(memory_order_relaxed);
+    cached_tail = head;
+    message_count = 0;
+    ring.GetHeader().subscriber_pid.store((int32_t) getpid(), memory_order_release);
+}
+
+template<typename V>
+SharedMemorySubscriber<V>::~SharedMemorySubscriber(){
+    ring.GetHeader().subscriber_pid.store(0, memory_order_release);
+}
+
+template<typename V>
+void SharedMemorySubscriber<V>::Publish(V &){
+}
+
+template<typename V>
+size_t SharedMemorySubscriber<V>::Poll(){
+    SharedRingHeader& header = ring.GetHeader();
+    if (head == cached_tail) {
+        cached_tail = header.tail.load(memory_order_acquire);
+        if (head == cached_tail) {
+            return 0;
+        }
+    }
+    size_t taken = 0;
+    for (; head != cached_tail; ++head) {
+        const char* slot = ring.GetSlot(head);
+        int64_t send_time;
+        memcpy(&send_time, slot, sizeof(send_time));
+        parser.Parse(slot + sizeof(int64_t), RecordParser<V>::RECORD_BYTES, [&](V &message){
+            hop_latency.Record((uint64_t) max<int64_t>(0, FeedClockNanos() - send_time));
+            service->OnMessage(message);
+        });
+        ++taken;
+    }
+    // Slots handed back once per batch
+    header.head.store(head, memory_order_release);
+    message_count += taken;
+    return taken;
+}
+
+template<typename V>
+bool SharedMemorySubscriber<V>::IsFinished(){
+    SharedRingHeader& header = ring.GetHeader();
+    // Finished is read before tail, so messages sent before it are not missed
+    return header.finished.load(memory_order_acquire) != 0 &&
+           head == header.tail.load(memory_order_acquire);
+}
+
+template<typename V>
+void SharedMemorySubscriber<V>::Subscribe(){
+    size_t spins = 0;
+    while (!IsFinished()) {
+        if (Poll() > 0) {
+            spins = 0;
+        }
+        else if (++spins > SHARED_RING_SPINS) {
+            this_thread::yield();
+        }
+    }
+}
+
+template<typename V>
+uint64_t SharedMemorySubscriber<V>::GetMessageCount() const{
+    return message_count;
+}
+
+template<typename V>
+const LatencyHistogram& SharedMemorySubscriber<V>::GetHopLatency() const{
+    return hop_latency;
+}
+
+template<typename V>
+void SharedMemorySubscriber<V>::PrintStatistics(ostream &stream, const string &name) const{
+    stream << name << " , Messages: " << message_count
+           << " , P50(ns): " << hop_latency.GetPercentile(0.50)
+           << " , P99(ns): " << hop_latency.GetPercentile(0.99)
+           << " , Max(ns): " << hop_latency.GetMax() << endl;
+}
+
+
+//
+// Implementation of ConnectorListener class
+template<typename V>
+ConnectorListener<V>::ConnectorListener(Connector<V>* _connector){
+    connector = _connector;
+}
+
+template<typename V>
+void ConnectorListener<V>::ProcessAdd(V &data){
+    connector->Publish(data);
+}
+
+template<typename V>
+void ConnectorListener<V>::ProcessRemove(V &){
+}
+
+template<typename V>
+void ConnectorListener<V>::ProcessUpdate(V &data){
+    connector->Publish(data);
+}
+
+#endif //TRADING_SYSTEM_SHARED_MEMORY_RING_HPP
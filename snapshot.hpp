@@ -0,0 +1,305 @@
+/**
+ * snapshot.hpp
+ * Defines snapshots of the position, risk, execution and inquiry state,
+ * written by a forked child from its copy-on-write image of the process and
+ * loaded back on startup ahead of the journal tail.
+ *
+ * A snapshot is a directory <directory>/snapshot.<id> holding a journal of
+ * the full state, led by a record of the journal sequences it covers.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SNAPSHOT_HPP
+#define TRADING_SYSTEM_SNAPSHOT_HPP
+
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "soa.hpp"
+#include "journal.hpp"
+#include "position_service.hpp"
+#include "risk_service.hpp"
+#include "execution_service.hpp"
+#include "inquiry_service.hpp"
+
+using namespace std;
+
+
+/**
+ * Writes and loads snapshots of the services of one pipeline.
+ * Type T is the product type.
+ */
+template<typename T>
+class SnapshotStore{
+private:
+    string directory;
+    PositionService<T>* position_service;
+    RiskService<T>* risk_service;
+    ExecutionService<T>* execution_service;
+    InquiryService<T>* inquiry_service;
+    pid_t writer_pid;
+
+    // Snapshot directories, oldest first
+    vector<string> ListSnapshots() const;
+
+    static void RemoveSnapshot(const string &path);
+
+    // Write the state into path, done in the forked child
+    void Write(const string &path, const map<string, uint64_t> &sequences) const;
+
+public:
+    // ctor
+    SnapshotStore(const string &_directory, PositionService<T>* _position_service,
+                  RiskService<T>* _risk_service, ExecutionService<T>* _execution_service,
+                  InquiryService<T>* _inquiry_service);
+
+    // Waits for a snapshot still being written
+    ~SnapshotStore();
+
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+    // Fork a child writing a snapshot covering the journals up to the given
+    // sequences, and return straight away. Waits for the previous snapshot
+    // first. Meant for the thread driving the services, while no other
+    // thread holds the allocator.
+    bool Save(const map<string, uint64_t> &sequences);
+
+    // Wait until the snapshot being written is complete
+    void Wait();
+
+    // Restore the services from the latest complete snapshot and return the
+    // journal sequences it covers, empty if there is none
+    map<string, uint64_t> Load();
+
+};
+
+
+/**
+ * Listener running an action once every interval events, e.g. to snapshot
+ * the services periodically.
+ * Type V is the data type listened to.
+ */
+template<typename V>
+class PeriodicActionListener : public ServiceListener<V>{
+private:
+    function<void()> action;
+    size_t interval;
+    size_t event_count;
+
+public:
+    // ctor
+    PeriodicActionListener(function<void()> _action, size_t _interval);
+
+    // Override virtual functions in base class Service
+    void ProcessAdd(V &data) override;
+
+    void ProcessRemove(V &data) override;
+
+    void ProcessUpdate(V &data) override;
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of SnapshotStore class
+template<typename T>
+SnapshotStore<T>::SnapshotStore(const string &_directory,
+        PositionService<T>* _position_service, RiskService<T>* _risk_service,
+        ExecutionService<T>* _execution_service, InquiryService<T>* _inquiry_service){
+    directory = _directory;
+    position_service = _position_service;
+    risk_service = _risk_service;
+    execution_service = _execution_service;
+    inquiry_service = _inquiry_service;
+    writer_pid = -1;
+    mkdir(directory.c_str(), 0755);
+}
+
+template<typename T>
+SnapshotStore<T>::~SnapshotStore(){
+    Wait();
+}
+
+template<typename T>
+vector<string> SnapshotStore<T>::ListSnapshots() const{
+    vector<string> snapshots;
+    DIR* dir = opendir(directory.c_str());
+    if(dir == nullptr){
+        return snapshots;
+    }
+    while(dirent* entry = readdir(dir)){
+        string name = entry->d_name;
+        // Complete snapshots only, not the temporary directories
+        if(name.compare(0, 9, "snapshot.") == 0 && name.find(".tmp") == string::npos){
+            snapshots.push_back(name);
+        }
+    }
+    closedir(dir);
+    // Ids are zero padded, so the names sort by age
+    sort(snapshots.begin(), snapshots.end());
+    return snapshots;
+}
+
+template<typename T>
+void SnapshotStore<T>::RemoveSnapshot(const string &path){
+    DIR* dir = opendir(path.c_str());
+    if(dir != nullptr){
+        while(dirent* entry = readdir(dir)){
+            string name = entry->d_name;
+            if(name != "." && name != ".."){
+                unlink((path + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path.c_str());
+}
+
+template<typename T>
+void SnapshotStore<T>::Write(const string &path,
+        const map<string, uint64_t> &sequences) const{
+    JournalWriter writer(path + "/", "state", 1 << 20);
+    JournalEncoder encoder;
+    encoder.Put<uint32_t>(sequences.size());
+    for(auto& sequence : sequences){
+        encoder.PutString(sequence.first);
+        encoder.Put<uint64_t>(sequence.second);
+    }
+    writer.Append(SNAPSHOT_RECORD, encoder.GetBytes().data(), encoder.GetBytes().size());
+    for(auto& position : position_service->GetPositions()){
+        writer.Append(position.second);
+    }
+    for(auto& pv01 : risk_service->GetPV01s()){
+        writer.Append(pv01.second);
+    }
+    for(auto& order : execution_service->GetExecutionOrders()){
+        writer.Append(order.second);
+    }
+    for(auto& inquiry : inquiry_service->GetInquiries()){
+        writer.Append(inquiry);
+    }
+    writer.Sync();
+}
+
+template<typename T>
+bool SnapshotStore<T>::Save(const map<string, uint64_t> &sequences){
+    Wait();
+    uint64_t id = 0;
+    for(auto& sequence : sequences){
+        id += sequence.second;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "snapshot.%020llu", (unsigned long long) id);
+    string path = directory + name;
+    vector<string> older = ListSnapshots();
+    pid_t pid = fork();
+    if(pid < 0){
+        return false;
+    }
+    if(pid == 0){
+        // Child: write under a temporary name, publish with an atomic rename
+        // and keep only the previous snapshot besides the new one
+        string temporary_path = path + ".tmp";
+        RemoveSnapshot(temporary_path);
+        Write(temporary_path, sequences);
+        if(rename(temporary_path.c_str(), path.c_str()) != 0){
+            _exit(1);
+        }
+        for(size_t i = 0; i + 1 < older.size(); ++i){
+            if(directory + older[i] != path){
+                RemoveSnapshot(directory + older[i]);
+            }
+        }
+        _exit(0);
+    }
+    writer_pid = pid;
+    return true;
+}
+
+template<typename T>
+void SnapshotStore<T>::Wait(){
+    if(writer_pid > 0){
+        int status = 0;
+        waitpid(writer_pid, &status, 0);
+        writer_pid = -1;
+    }
+}
+
+template<typename T>
+map<string, uint64_t> SnapshotStore<T>::Load(){
+    map<string, uint64_t> sequences;
+    vector<string> snapshots = ListSnapshots();
+    if(snapshots.empty()){
+        return sequences;
+    }
+    JournalReader reader(directory + snapshots.back() + "/", "state");
+    reader.Read([&](const JournalRecordHeader &header, const char *payload){
+        JournalDecoder decoder(payload, header.length);
+        switch(header.type){
+            case SNAPSHOT_RECORD:{
+                uint32_t count = decoder.Get<uint32_t>();
+                for(uint32_t i = 0; i < count; ++i){
+                    string name = decoder.GetString();
+                    sequences[name] = decoder.Get<uint64_t>();
+                }
+                break;
+            }
+            case POSITION_RECORD:
+                position_service->RestorePosition(
+                        RecordCodec<Position<T>>::Decode(decoder));
+                break;
+            case RISK_RECORD:
+                risk_service->RestorePV01(RecordCodec<PV01<T>>::Decode(decoder));
+                break;
+            case EXECUTION_RECORD:
+                execution_service->RestoreExecutionOrder(
+                        RecordCodec<ExecutionOrder<T>>::Decode(decoder));
+                break;
+            case INQUIRY_RECORD:
+                inquiry_service->RestoreInquiry(RecordCodec<Inquiry<T>>::Decode(decoder));
+                break;
+            default:
+                break;
+        }
+    });
+    return sequences;
+}
+
+
+//
+// Implementation of PeriodicActionListener class
+template<typename V>
+PeriodicActionListener<V>::PeriodicActionListener(function<void()> _action,
+                                                  size_t _interval){
+    action = _action;
+    interval = max<size_t>(1, _interval);
+    event_count = 0;
+}
+
+template<typename V>
+void PeriodicActionListener<V>::ProcessAdd(V &data){
+    if(++event_count % interval == 0){
+        action();
+    }
+}
+
+template<typename V>
+void PeriodicActionListener<V>::ProcessRemove(V &data){
+
+}
+
+template<typename V>
+void PeriodicActionListener<V>::ProcessUpdate(V &data){
+
+}
+
+#endif //TRADING_SYSTEM_SNAPSHOT_HPP
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <string>
+#include "instrumentation.hpp"
 
 using namespace std;
 
@@ -33,6 +34,14 @@ public:
     // Listener callback to process an update event to the Service
     virtual void ProcessUpdate(V &data) = 0;
 
+    // Listener callback to process a batch of add events to the Service
+    virtual void ProcessAddBatch(vector<V> &data)
+    {
+        for (auto& element : data) {
+            ProcessAdd(element);
+        }
+    }
+
 };
 
 /**
@@ -46,7 +55,7 @@ class Service
 public:
 
     // Get data on our service given a key
-    virtual V& GetData(K key) = 0;
+    virtual V& GetData(const K &key) = 0;
 
     // The callback that a Connector should invoke for any new or updated data
     virtual void OnMessage(V &data) = 0;
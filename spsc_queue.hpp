@@ -0,0 +1,85 @@
+/**
+ * spsc_queue.hpp
+ * Defines a bounded lock-free queue with a single producer and a single
+ * consumer.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_SPSC_QUEUE_HPP
+#define TRADING_SYSTEM_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * Bounded lock-free queue with a single producer and a single consumer.
+ * Type E is the element type.
+ */
+template<typename E>
+class SpscQueue{
+private:
+    vector<E> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> head;
+    alignas(64) atomic<size_t> tail;
+
+public:
+    // ctor, capacity is rounded up to a power of two
+    SpscQueue(size_t capacity);
+
+    // Producer side, returns false if the queue is full
+    bool TryPush(const E &element);
+
+    // Consumer side, returns false if the queue is empty
+    bool TryPop(E &element);
+
+    bool Empty() const;
+
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of SpscQueue class
+template<typename E>
+SpscQueue<E>::SpscQueue(size_t capacity) : head(0), tail(0){
+    size_t size = 1;
+    while(size < capacity){
+        size <<= 1;
+    }
+    slots.resize(size);
+    mask = size - 1;
+}
+
+template<typename E>
+bool SpscQueue<E>::TryPush(const E &element){
+    size_t current_tail = tail.load(memory_order_relaxed);
+    if(current_tail - head.load(memory_order_acquire) == slots.size()){
+        return false;
+    }
+    slots[current_tail & mask] = element;
+    tail.store(current_tail + 1, memory_order_release);
+    return true;
+}
+
+template<typename E>
+bool SpscQueue<E>::TryPop(E &element){
+    size_t current_head = head.load(memory_order_relaxed);
+    if(current_head == tail.load(memory_order_acquire)){
+        return false;
+    }
+    element = move(slots[current_head & mask]);
+    head.store(current_head + 1, memory_order_release);
+    return true;
+}
+
+template<typename E>
+bool SpscQueue<E>::Empty() const{
+    return head.load(memory_order_acquire) == tail.load(memory_order_acquire);
+}
+
+#endif //TRADING_SYSTEM_SPSC_QUEUE_HPP
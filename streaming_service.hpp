@@ -8,6 +8,8 @@
 #ifndef TRADING_SYSTEM_STREAMING_SERVICE_HPP
 #define TRADING_SYSTEM_STREAMING_SERVICE_HPP
 
+#include <chrono>
+#include <cmath>
 #include <map>
 #include <vector>
 
@@ -15,6 +17,12 @@
 #include "products.hpp"
 #include "pricing_service.hpp"
 #include "market_data_service.hpp"
+#include "position_service.hpp"
+
+// Decay of the EWMA of squared mid changes used to widen algo streams
+const double ALGO_STREAM_EWMA_DECAY = 0.94;
+// Algo stream prices are kept on the 1/256th grid
+const double ALGO_STREAM_TICK = 1.0 / 256.0;
 
 
 /**
@@ -43,6 +51,11 @@ public:
     
     long GetHiddenQuantity() const;
 
+    // modifiers
+    void Update(double _price, long _visibleQuantity, long _hiddenQuantity);
+
+    bool operator==(const PriceStreamOrder &other) const;
+
 };
 
 
@@ -71,17 +84,27 @@ public:
     
     const PriceStreamOrder& GetOfferOrder() const;
 
+    // Update both orders in place, returns true if either of them changed
+    bool Update(const PriceStreamOrder &_bidOrder,
+                const PriceStreamOrder &_offerOrder);
+
+    // Same product quoted at the same prices and sizes
+    bool operator==(const PriceStream<T> &other) const;
+
 };
 
 
 /**
- * AlgoStream with a reference to PriceStream
+ * AlgoStream with a reference to PriceStream, quoted around the mid and
+ * widened by an EWMA estimate of the mid volatility.
  * Type T is the product type.
  */
 template<typename T>
 class AlgoStream{
 private:
     PriceStream<T> price_stream;
+    double last_mid;
+    double ewma_variance;
 
 public:
     // ctors
@@ -91,14 +114,24 @@ public:
     // getters
     const PriceStream<T>& GetPriceStream() const;
 
-    // modifiers
-    void UpdateAlgoStream(const Price<T> &price);
+    double GetVolatility() const;
+
+    // modifiers, requote in place shifting both sides down by skew and
+    // widening each side by volatility_multiple volatilities, returns true if
+    // the quoted prices or sizes changed
+    bool UpdateAlgoStream(const Price<T> &price, double skew = 0.0,
+                          double volatility_multiple = 0.0,
+                          long bid_size = 1000000, long offer_size = 1000000);
 
 };
 
 
 /**
  * Streaming service to publish two-way prices.
+ * Quotes identical to the last one published for the product are dropped,
+ * and quotes arriving within the conflation window of the last publication
+ * are held back, only the latest of them being published once the window
+ * has passed, on the next quote for any product or FlushExpired().
  * Keyed on product identifier.
  * Type T is the product type.
  */
@@ -106,17 +139,28 @@ template<typename T>
 class StreamingService : public Service<string, PriceStream <T> >{
 private:
     map<string, PriceStream<T>> streaming_data;
+    map<string, PriceStream<T>> pending_data;
+    map<string, chrono::steady_clock::time_point> publish_times;
     vector<ServiceListener<PriceStream<T>>*> service_listeners;
-    StreamingService();
+    chrono::steady_clock::duration conflation_window;
+    // Earliest end of a window a quote is held back for, max if none
+    chrono::steady_clock::time_point next_deadline;
+
+    // Store the quote and pass the stored copy to the listeners
+    void Notify(const PriceStream<T>& price_stream);
+
+    // Publish the quotes held back whose window has passed by now
+    void FlushExpired(chrono::steady_clock::time_point now);
 
 public:
-    static StreamingService* GenerateInstance(){
-        static StreamingService instance;
-        return &instance;
-    }
+    // ctor
+    StreamingService();
+
+    // Instance owned by the default ServiceContext
+    static StreamingService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    PriceStream<T>& GetData(string key) override;
+    PriceStream<T>& GetData(const string &key) override;
 
     void OnMessage(PriceStream<T> &data) override;
 
@@ -124,7 +168,18 @@ public:
 
     const vector<ServiceListener<PriceStream<T>>* >& GetListeners() const override;
 
-    void PublishPrice(PriceStream<T>& price_stream);
+    void PublishPrice(const PriceStream<T>& price_stream);
+
+    // Hold back quotes for window after each publication, zero only
+    // suppresses unchanged quotes
+    void SetConflationWindow(chrono::steady_clock::duration window);
+
+    // Publish the quotes held back whose window has passed, for timer ticks
+    // while no quotes arrive
+    void FlushExpired();
+
+    // Publish every quote still held back
+    void Flush();
 
 };
 
@@ -138,15 +193,20 @@ class AlgoStreamingService : public Service<string, AlgoStream<T>>{
 private:
     map<string, AlgoStream<T>> algo_streaming_data;
     vector<ServiceListener<AlgoStream<T>>*> service_listeners;
-    AlgoStreamingService();
+    PositionService<T>* position_service;
+    double skew_per_million;
+    double volatility_multiple;
+    long quote_size;
+    long position_limit;
 
 public:
-    static AlgoStreamingService* GenerateInstance(){
-        static AlgoStreamingService instance;
-        return &instance;
-    }
+    // ctor, quotes are skewed by the positions in position_service
+    AlgoStreamingService(PositionService<T>* _position_service);
+
+    // Instance owned by the default ServiceContext
+    static AlgoStreamingService* GenerateInstance();
     // Override virtual functions in base class Service
-    AlgoStream<T>& GetData(string key) override;
+    AlgoStream<T>& GetData(const string &key) override;
 
     void OnMessage(AlgoStream<T> &data) override;
 
@@ -154,8 +214,18 @@ public:
 
     const vector<ServiceListener<AlgoStream<T>>*>& GetListeners()const override;
 
+    // Requote the product, listeners are only notified if the stream changed
     void AddPrice(const Price<T>& price);
 
+    // Price move applied against each million of aggregate position
+    void SetSkew(double _skew_per_million);
+
+    // Volatilities added to each side of the stream
+    void SetVolatilityMultiple(double _volatility_multiple);
+
+    // The side adding to inventory shrinks linearly to nothing at the limit
+    void SetSizes(long _quote_size, long _position_limit);
+
 };
 
 
@@ -167,13 +237,13 @@ template<typename T>
 class AlgoStreamingServiceListener : public ServiceListener<Price<T> >{
 private:
     AlgoStreamingService<T>* algo_streaming_service;
-    AlgoStreamingServiceListener();
 
 public:
-    static AlgoStreamingServiceListener* GenerateInstance() {
-        static AlgoStreamingServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    AlgoStreamingServiceListener(AlgoStreamingService<T>* _algo_streaming_service);
+
+    // Instance owned by the default ServiceContext
+    static AlgoStreamingServiceListener* GenerateInstance();
 
     // Override virtual functions in base class Service
     void ProcessAdd(Price<T> & data) override;
@@ -195,13 +265,13 @@ template<typename T>
 class StreamingServiceListener : public ServiceListener<AlgoStream<T> >{
 private:
     StreamingService<T>* streaming_service;
-    StreamingServiceListener();
 
 public:
-    static StreamingServiceListener* GenerateInstance() {
-        static StreamingServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    StreamingServiceListener(StreamingService<T>* _streaming_service);
+
+    // Instance owned by the default ServiceContext
+    static StreamingServiceListener* GenerateInstance();
 
     // Override virtual functions in base class Service
     void ProcessAdd(AlgoStream<T> & data) override;
@@ -245,6 +315,18 @@ long PriceStreamOrder::GetHiddenQuantity() const{
     return hiddenQuantity;
 }
 
+void PriceStreamOrder::Update(double _price, long _visibleQuantity,
+                              long _hiddenQuantity){
+    price = _price;
+    visibleQuantity = _visibleQuantity;
+    hiddenQuantity = _hiddenQuantity;
+}
+
+bool PriceStreamOrder::operator==(const PriceStreamOrder &other) const{
+    return price == other.price && visibleQuantity == other.visibleQuantity &&
+           hiddenQuantity == other.hiddenQuantity && side == other.side;
+}
+
 
 //
 // Implementation of PriceStream
@@ -274,16 +356,34 @@ const PriceStreamOrder& PriceStream<T>::GetOfferOrder() const{
     return offerOrder;
 }
 
+template<typename T>
+bool PriceStream<T>::operator==(const PriceStream<T> &other) const{
+    return product.GetProductId() == other.product.GetProductId() &&
+           bidOrder == other.bidOrder && offerOrder == other.offerOrder;
+}
+
+template<typename T>
+bool PriceStream<T>::Update(const PriceStreamOrder &_bidOrder,
+                            const PriceStreamOrder &_offerOrder){
+    if (bidOrder == _bidOrder && offerOrder == _offerOrder) {
+        return false;
+    }
+    bidOrder = _bidOrder;
+    offerOrder = _offerOrder;
+    return true;
+}
+
 
 //
 // Implementation of StreamingService
 template<typename T>
 StreamingService<T>::StreamingService(){
-
+    conflation_window = chrono::steady_clock::duration::zero();
+    next_deadline = chrono::steady_clock::time_point::max();
 }
 
 template<typename T>
-PriceStream<T>& StreamingService<T>::GetData(string key){
+PriceStream<T>& StreamingService<T>::GetData(const string &key){
     return streaming_data[key];
 }
 
@@ -306,41 +406,108 @@ StreamingService<T>::GetListeners() const {
 
 
 template<typename T>
-void StreamingService<T>::PublishPrice(PriceStream<T>& price_stream){
-    const string product_id = price_stream.GetProduct().GetProductId();
-    if (streaming_data.find(product_id) == streaming_data.end()) {
-        streaming_data.insert(make_pair(product_id, price_stream));
+void StreamingService<T>::SetConflationWindow(chrono::steady_clock::duration window){
+    conflation_window = window;
+}
+
+template<typename T>
+void StreamingService<T>::Notify(const PriceStream<T>& price_stream){
+    const string& product_id = price_stream.GetProduct().GetProductId();
+    auto stored = streaming_data.find(product_id);
+    if (stored == streaming_data.end()) {
+        stored = streaming_data.insert(make_pair(product_id, price_stream)).first;
     }
     else {
-        streaming_data[product_id] = price_stream;
+        stored->second.Update(price_stream.GetBidOrder(), price_stream.GetOfferOrder());
     }
     for (auto& listener : service_listeners) {
-        listener->ProcessAdd(price_stream);
+        listener->ProcessAdd(stored->second);
+    }
+}
+
+template<typename T>
+void StreamingService<T>::PublishPrice(const PriceStream<T>& price_stream){
+    INSTRUMENT_SCOPE("StreamingService");
+    const string& product_id = price_stream.GetProduct().GetProductId();
+    auto published = streaming_data.find(product_id);
+    if (conflation_window == chrono::steady_clock::duration::zero()) {
+        if (published == streaming_data.end() || !(published->second == price_stream)) {
+            Notify(price_stream);
+        }
+        return;
+    }
+    // A newer quote always supersedes the one held back, dropped before the
+    // flush so the stale one is not published ahead of it
+    pending_data.erase(product_id);
+    auto now = chrono::steady_clock::now();
+    FlushExpired(now);
+    if (published != streaming_data.end() && published->second == price_stream) {
+        return;
+    }
+    auto last_publish = publish_times.find(product_id);
+    if (last_publish != publish_times.end() &&
+        now - last_publish->second < conflation_window) {
+        pending_data.insert_or_assign(product_id, price_stream);
+        next_deadline = min(next_deadline, last_publish->second + conflation_window);
+        return;
+    }
+    publish_times[product_id] = now;
+    Notify(price_stream);
+}
+
+template<typename T>
+void StreamingService<T>::FlushExpired(){
+    if (!pending_data.empty()) {
+        FlushExpired(chrono::steady_clock::now());
+    }
+}
+
+template<typename T>
+void StreamingService<T>::FlushExpired(chrono::steady_clock::time_point now){
+    if (now < next_deadline) {
+        return;
+    }
+    next_deadline = chrono::steady_clock::time_point::max();
+    for (auto pending = pending_data.begin(); pending != pending_data.end();) {
+        auto& publish_time = publish_times[pending->first];
+        if (now - publish_time >= conflation_window) {
+            publish_time = now;
+            Notify(pending->second);
+            pending = pending_data.erase(pending);
+        }
+        else {
+            next_deadline = min(next_deadline, publish_time + conflation_window);
+            ++pending;
+        }
     }
 }
 
+template<typename T>
+void StreamingService<T>::Flush(){
+    auto now = chrono::steady_clock::now();
+    for (auto& pending : pending_data) {
+        publish_times[pending.first] = now;
+        Notify(pending.second);
+    }
+    pending_data.clear();
+    next_deadline = chrono::steady_clock::time_point::max();
+}
+
 
 //
 // Implementation of AlgoStream class
 template<typename T>
 AlgoStream<T>::AlgoStream() :  price_stream(PriceStream<T>()){
-
+    last_mid = 0.0;
+    ewma_variance = 0.0;
 }
 
 template<typename T>
-AlgoStream<T>::AlgoStream(const Price<T>& price){
-    T new_product = price.GetProduct();
-    double new_mid = price.GetMid();
-    double new_spread = price.GetBidOfferSpread();
-    double new_bid = new_mid - 0.5 * new_spread;
-    double new_ask = new_mid + 0.5 * new_spread;
-    long new_visible_size = (1 + rand() % 2) * 1000000;
-    long new_hidden_size = new_visible_size * 2;
-    PriceStreamOrder new_bid_order(new_bid, new_visible_size,
-                                   new_hidden_size, BID);
-    PriceStreamOrder new_ask_order(new_ask, new_visible_size,
-                                   new_hidden_size, OFFER);
-    price_stream = PriceStream<T>(new_product, new_bid_order, new_ask_order);
+AlgoStream<T>::AlgoStream(const Price<T>& price) : price_stream(
+        price.GetProduct(), PriceStreamOrder(0.0, 0, 0, BID),
+        PriceStreamOrder(0.0, 0, 0, OFFER)){
+    last_mid = price.GetMid().ToDouble();
+    ewma_variance = 0.0;
 }
 
 template<typename T>
@@ -349,36 +516,49 @@ const PriceStream<T>& AlgoStream<T>::GetPriceStream() const{
 }
 
 template<typename T>
-void AlgoStream<T>::UpdateAlgoStream(const Price<T> &price) {
+double AlgoStream<T>::GetVolatility() const{
+    return sqrt(ewma_variance);
+}
+
+template<typename T>
+bool AlgoStream<T>::UpdateAlgoStream(const Price<T> &price, double skew,
+        double volatility_multiple, long bid_size, long offer_size) {
     // If update with different id, do nothing
     if(price.GetProduct().GetProductId() !=
        price_stream.GetProduct().GetProductId()){
-        return;
+        return false;
     }
-    double new_mid = price.GetMid();
-    double new_spread = price.GetBidOfferSpread();
-    double new_bid = new_mid - 0.5 * new_spread;
-    double new_ask = new_mid + 0.5 * new_spread;
-    long new_visible_size = (1 + rand() % 2) * 1000000;
-    long new_hidden_size = new_visible_size * 2;
-    PriceStreamOrder new_bid_order(new_bid, new_visible_size,
-                                   new_hidden_size, BID);
-    PriceStreamOrder new_ask_order(new_ask, new_visible_size,
-                                   new_hidden_size, OFFER);
-    price_stream = PriceStream<T>(price.GetProduct(), new_bid_order,
-                                    new_ask_order);
+    double new_mid = price.GetMid().ToDouble();
+    double change = new_mid - last_mid;
+    ewma_variance = ALGO_STREAM_EWMA_DECAY * ewma_variance +
+                    (1.0 - ALGO_STREAM_EWMA_DECAY) * change * change;
+    last_mid = new_mid;
+    double half_width = 0.5 * price.GetBidOfferSpread().ToDouble() +
+                        volatility_multiple * GetVolatility();
+    // Round outwards onto the tick grid so small moves do not requote
+    double new_bid = floor((new_mid - half_width - skew) / ALGO_STREAM_TICK
+                           + 1e-9) * ALGO_STREAM_TICK;
+    double new_ask = ceil((new_mid + half_width - skew) / ALGO_STREAM_TICK
+                          - 1e-9) * ALGO_STREAM_TICK;
+    PriceStreamOrder new_bid_order(new_bid, bid_size, bid_size * 2, BID);
+    PriceStreamOrder new_ask_order(new_ask, offer_size, offer_size * 2, OFFER);
+    return price_stream.Update(new_bid_order, new_ask_order);
 }
 
 
 //
 // Implementation of AlgoStreamingService class
 template<typename T>
-AlgoStreamingService<T>::AlgoStreamingService() {
-
+AlgoStreamingService<T>::AlgoStreamingService(PositionService<T>* _position_service) {
+    position_service = _position_service;
+    skew_per_million = 1.0 / 2560.0;
+    volatility_multiple = 1.0;
+    quote_size = 1000000;
+    position_limit = 50000000;
 }
 
 template<typename T>
-AlgoStream<T> & AlgoStreamingService<T>::GetData(string key){
+AlgoStream<T> & AlgoStreamingService<T>::GetData(const string &key){
     return algo_streaming_data[key];
 }
 
@@ -395,17 +575,45 @@ const vector<ServiceListener<AlgoStream<T>> *>& AlgoStreamingService<T>::GetList
     return service_listeners;
 }
 
+template<typename T>
+void AlgoStreamingService<T>::SetSkew(double _skew_per_million){
+    skew_per_million = _skew_per_million;
+}
+
+template<typename T>
+void AlgoStreamingService<T>::SetVolatilityMultiple(double _volatility_multiple){
+    volatility_multiple = _volatility_multiple;
+}
+
+template<typename T>
+void AlgoStreamingService<T>::SetSizes(long _quote_size, long _position_limit){
+    quote_size = _quote_size;
+    position_limit = _position_limit;
+}
+
 template<typename T>
 void AlgoStreamingService<T>::AddPrice(const Price<T>& price){
-    const string product_id = price.GetProduct().GetProductId();
-    if (algo_streaming_data.find(product_id) == algo_streaming_data.end()) {
-        algo_streaming_data.insert(make_pair(product_id, AlgoStream<T>(price)));
+    INSTRUMENT_SCOPE("AlgoStreamingService");
+    const string& product_id = price.GetProduct().GetProductId();
+    auto it = algo_streaming_data.find(product_id);
+    if (it == algo_streaming_data.end()) {
+        it = algo_streaming_data.insert(make_pair(product_id, AlgoStream<T>(price))).first;
     }
-    else {
-        algo_streaming_data[product_id].UpdateAlgoStream(price);
+    long position = 0;
+    if (position_service != nullptr) {
+        position = position_service->GetAggregatePosition(product_id);
     }
-    for (auto& listener : service_listeners) {
-        listener->ProcessAdd(algo_streaming_data[product_id]);
+    double skew = skew_per_million * position / 1000000.0;
+    // Shrink the side that would add to the position, in lots of 100,000
+    double usage = min(1.0, labs(position) / (double) position_limit);
+    long reduced_size = (long) (quote_size * (1.0 - usage) / 100000) * 100000;
+    long bid_size = (position > 0) ? reduced_size : quote_size;
+    long offer_size = (position < 0) ? reduced_size : quote_size;
+    if (it->second.UpdateAlgoStream(price, skew, volatility_multiple,
+                                    bid_size, offer_size)) {
+        for (auto& listener : service_listeners) {
+            listener->ProcessAdd(it->second);
+        }
     }
 }
 
@@ -413,8 +621,8 @@ void AlgoStreamingService<T>::AddPrice(const Price<T>& price){
 //
 // Implementation of AlgoStreamingServiceListener class
 template<typename T>
-AlgoStreamingServiceListener<T>::AlgoStreamingServiceListener(){
-    algo_streaming_service = AlgoStreamingService<T>::GenerateInstance();
+AlgoStreamingServiceListener<T>::AlgoStreamingServiceListener(AlgoStreamingService<T>* _algo_streaming_service){
+    algo_streaming_service = _algo_streaming_service;
 }
 
 template<typename T>
@@ -441,14 +649,13 @@ AlgoStreamingService<T>* AlgoStreamingServiceListener<T>::GetService(){
 //
 // Implementation of StreamingServiceListener class
 template<typename T>
-StreamingServiceListener<T>::StreamingServiceListener(){
-    streaming_service = StreamingService<T>::GenerateInstance();
+StreamingServiceListener<T>::StreamingServiceListener(StreamingService<T>* _streaming_service){
+    streaming_service = _streaming_service;
 }
 
 template<typename T>
 void StreamingServiceListener<T>::ProcessAdd(AlgoStream<T> & data){
-    auto price_stream = data.GetPriceStream();
-    streaming_service->PublishPrice(price_stream);
+    streaming_service->PublishPrice(data.GetPriceStream());
 }
 
 template<typename T>
@@ -0,0 +1,156 @@
+/**
+ * allocation_test.cpp
+ * Counts the calls to the global operator new while the pricing, market
+ * data, trade booking and inquiry connectors parse and dispatch their inputs. Once the arenas and the
+ * services are warm, a run over twice the events must allocate no more than
+ * a run over the events once, what is left being the opening of the file.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include "../pricing_service.hpp"
+#include "../market_data_service.hpp"
+#include "../trade_booking_service.hpp"
+#include "../inquiry_service.hpp"
+#include "../sharded_pipeline.hpp"
+
+using namespace std;
+
+static atomic<size_t> allocations(0);
+
+void* operator new(size_t size){
+    ++allocations;
+    void* pointer = malloc((size > 0) ? size : 1);
+    if (pointer == nullptr) {
+        throw bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept{
+    free(pointer);
+}
+
+const char* CUSIPS[] = {"9128285Q9", "9128285R7", "9128285P1"};
+
+// Write count records of each CUSIP to path, after the header, the CUSIP
+// between the leading fields and the others
+void WriteInput(const string &path, const string &header, const string &fields, int count,
+                const string &leading = ""){
+    ofstream out(path);
+    out << header << "\n";
+    for (int i = 0; i < count; ++i) {
+        for (const char* cusip : CUSIPS) {
+            out << leading << cusip << "," << fields << "\n";
+        }
+    }
+}
+
+// Calls to operator new made by one Subscribe of the connector
+template<typename Connector>
+size_t CountAllocations(Connector &connector){
+    size_t before = allocations.load();
+    connector.Subscribe();
+    return allocations.load() - before;
+}
+
+// Subscribes the connector to the short input, to warm it up and to count,
+// then to the long one, false if the long one allocates more
+template<typename Connector>
+bool CheckSteadyState(const string &name, Connector &short_connector,
+                      Connector &long_connector){
+    CountAllocations(short_connector);
+    size_t short_count = CountAllocations(short_connector);
+    size_t long_count = CountAllocations(long_connector);
+    cout << name << ": " << short_count << " allocations over the short input, "
+         << long_count << " over twice as many events" << endl;
+    return long_count <= short_count;
+}
+
+int main(){
+    {
+        ofstream securities("allocation_test_securities.txt");
+        securities << "CUSIP, ISIN, Ticker, Coupon, Maturity, IssueDate, Bucket\n"
+                   << "9128285Q9,US9128285Q95,T,2.750,2020-11-30,2018-11-30,FrontEnd\n"
+                   << "9128285R7,US9128285R78,T,2.625,2021-12-15,2018-12-17,FrontEnd\n"
+                   << "9128285P1,US9128285P13,T,2.875,2023-11-30,2018-11-30,Belly\n";
+    }
+    SecurityMaster master("allocation_test_securities.txt");
+
+    string book;
+    for (int level = 1; level <= 5; ++level) {
+        book += "100-00" + to_string(level) + "," + to_string(level * 1000000) + ",100-01" +
+                to_string(level) + "," + to_string(level * 1000000) + ",";
+    }
+    WriteInput("allocation_test_prices_1.txt", "CUSIP, Mid, Spread", "100-287,0-003", 1000);
+    WriteInput("allocation_test_prices_2.txt", "CUSIP, Mid, Spread", "100-287,0-003", 2000);
+    WriteInput("allocation_test_marketdata_1.txt", "CUSIP, Bid1, QB1, Ask1, QA1", book, 1000);
+    WriteInput("allocation_test_marketdata_2.txt", "CUSIP, Bid1, QB1, Ask1, QA1", book, 2000);
+    // Ids repeat, each trade and inquiry replaces the one before it
+    const string trade_header = "CUSIP, Trade ID, Price, Quantity, Book, Side";
+    WriteInput("allocation_test_trades_1.txt", trade_header, "7,100-251,1000000,TRSY1,SELL", 1000);
+    WriteInput("allocation_test_trades_2.txt", trade_header, "7,100-251,1000000,TRSY1,SELL", 2000);
+    const string inquiry_header = "InquiryID, CUSIP, Quantity, Side, Price, InquiryState";
+    WriteInput("allocation_test_inquiries_1.txt", inquiry_header,
+               "2000000,BUY,100-292,RECEIVED", 1000, "7,");
+    WriteInput("allocation_test_inquiries_2.txt", inquiry_header,
+               "2000000,BUY,100-292,RECEIVED", 2000, "7,");
+
+    PricingService<Bond> pricing_service;
+    PricingServiceConnector<Bond> short_prices(&pricing_service, "allocation_test_prices_1.txt");
+    PricingServiceConnector<Bond> long_prices(&pricing_service, "allocation_test_prices_2.txt");
+    short_prices.SetSecurityMaster(&master);
+    long_prices.SetSecurityMaster(&master);
+
+    MarketDataService<Bond> market_data_service;
+    MarketDataServiceConnector<Bond> short_books(&market_data_service,
+                                                 "allocation_test_marketdata_1.txt");
+    MarketDataServiceConnector<Bond> long_books(&market_data_service,
+                                                "allocation_test_marketdata_2.txt");
+    short_books.SetSecurityMaster(&master);
+    long_books.SetSecurityMaster(&master);
+
+    TradeBookingService<Bond> trade_booking_service;
+    TradeBookingServiceConnector<Bond> short_trades(&trade_booking_service,
+                                                    "allocation_test_trades_1.txt");
+    TradeBookingServiceConnector<Bond> long_trades(&trade_booking_service,
+                                                   "allocation_test_trades_2.txt");
+    short_trades.SetSecurityMaster(&master);
+    long_trades.SetSecurityMaster(&master);
+
+    // Quoted off the prices above
+    PositionService<Bond> position_service;
+    InquiryService<Bond> inquiry_service(&pricing_service, &position_service);
+    InquiryServiceConnector<Bond> short_inquiries(&inquiry_service,
+                                                  "allocation_test_inquiries_1.txt");
+    InquiryServiceConnector<Bond> long_inquiries(&inquiry_service,
+                                                 "allocation_test_inquiries_2.txt");
+    short_inquiries.SetSecurityMaster(&master);
+    long_inquiries.SetSecurityMaster(&master);
+    short_inquiries.SetBatchSize(64);
+    long_inquiries.SetBatchSize(64);
+
+    bool passed = CheckSteadyState("PricingServiceConnector", short_prices, long_prices) &&
+                  CheckSteadyState("MarketDataServiceConnector", short_books, long_books) &&
+                  CheckSteadyState("TradeBookingServiceConnector", short_trades, long_trades) &&
+                  CheckSteadyState("InquiryServiceConnector", short_inquiries, long_inquiries);
+    // Every input got through to the services
+    if (pricing_service.GetData("9128285Q9").GetProduct().GetProductId() != "9128285Q9" ||
+        market_data_service.GetData("9128285P1").GetProduct().GetProductId() != "9128285P1" ||
+        trade_booking_service.GetData("7").GetProduct().GetProductId() != "9128285P1" ||
+        inquiry_service.GetData("7").GetState() != DONE) {
+        passed = false;
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/**
+ * copy_count_test.cpp
+ * Counts the copies of the product made while an order book goes through
+ * the algo execution and execution services to the listeners of the
+ * executed orders, and while a price goes through the pricing, algo
+ * streaming and streaming services to the streaming history. Building the
+ * order and keeping the price take one copy of the product each, nothing on
+ * the way to the listeners may take another. The first event of a product
+ * copies it into every service keeping it and is not counted.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#include <iostream>
+#include "../execution_service.hpp"
+#include "../pricing_service.hpp"
+#include "../streaming_service.hpp"
+#include "../historical_data_service.hpp"
+
+using namespace std;
+
+static size_t copies = 0;
+
+/**
+ * Bond counting its copies, moves are free.
+ */
+class CountedBond : public Bond{
+public:
+    CountedBond(){}
+    explicit CountedBond(const Bond &bond) : Bond(bond){}
+    CountedBond(const CountedBond &other) : Bond(other){ ++copies; }
+    CountedBond(CountedBond &&other) = default;
+    CountedBond& operator=(const CountedBond &other){
+        Bond::operator=(other);
+        ++copies;
+        return *this;
+    }
+    CountedBond& operator=(CountedBond &&other) = default;
+};
+
+/**
+ * A counted bond is journaled as the bond it is.
+ */
+template<>
+class ProductCodec<CountedBond>{
+public:
+    static void Encode(JournalEncoder &encoder, const CountedBond &bond){
+        ProductCodec<Bond>::Encode(encoder, bond);
+    }
+
+    static CountedBond Decode(JournalDecoder &decoder){
+        return CountedBond(ProductCodec<Bond>::Decode(decoder));
+    }
+};
+
+/**
+ * Listener checking the executed orders it is handed.
+ */
+class ExecutedOrderCheck : public ServiceListener<ExecutionOrder<CountedBond>>{
+public:
+    size_t executed = 0;
+    string last_product_id;
+
+    void ProcessAdd(ExecutionOrder<CountedBond> &data) override{
+        ++executed;
+        last_product_id = data.GetProduct().GetProductId();
+    }
+
+    void ProcessRemove(ExecutionOrder<CountedBond> &) override{}
+
+    void ProcessUpdate(ExecutionOrder<CountedBond> &) override{}
+};
+
+// Product copies made by each event after the first, false if any is above one
+template<typename F>
+bool CheckCopies(const string &name, F event){
+    event(0);
+    bool passed = true;
+    for (int i = 1; i <= 3; ++i) {
+        size_t before = copies;
+        event(i);
+        size_t event_copies = copies - before;
+        cout << name << " event " << i << ": " << event_copies << " product copies" << endl;
+        if (event_copies > 1) {
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+int main(){
+    AlgoExecutionService<CountedBond> algo_execution_service;
+    ExecutionService<CountedBond> execution_service;
+    ExecutionServiceListener<CountedBond> execution_service_listener(&execution_service);
+    ExecutedOrderCheck check;
+    algo_execution_service.AddListener(&execution_service_listener);
+    execution_service.AddListener(&check);
+
+    CountedBond bond(Bond("9128285Q9", CUSIP, "T", 2.75f, date(2020, 11, 30)));
+    // A spread of 1/256th, crossed on every book
+    vector<Order> bids{Order(PriceTicks(25600), 1000000, BID)};
+    vector<Order> offers{Order(PriceTicks(25601), 1000000, OFFER)};
+    OrderBook<CountedBond> order_book(bond, bids, offers);
+
+    bool passed = CheckCopies("execution", [&](int){
+        algo_execution_service.ExecuteAlgo(order_book);
+    });
+    if (check.executed != 4 || check.last_product_id != "9128285Q9") {
+        passed = false;
+    }
+
+    PricingService<CountedBond> pricing_service;
+    AlgoStreamingService<CountedBond> algo_streaming_service(nullptr);
+    AlgoStreamingServiceListener<CountedBond> algo_streaming_service_listener(
+            &algo_streaming_service);
+    StreamingService<CountedBond> streaming_service;
+    StreamingServiceListener<CountedBond> streaming_service_listener(&streaming_service);
+    StreamingHistoricalDataServiceConnector<CountedBond> streaming_historical_connector(
+            "copy_count_streaming.txt");
+    StreamingHistoricalDataService<CountedBond> streaming_historical_data_service(
+            &streaming_historical_connector);
+    StreamingHistoricalDataServiceListener<CountedBond> streaming_historical_listener(
+            &streaming_historical_data_service);
+    pricing_service.AddListener(&algo_streaming_service_listener);
+    algo_streaming_service.AddListener(&streaming_service_listener);
+    streaming_service.AddListener(&streaming_historical_listener);
+
+    // Mids a quarter point apart, requoting the stream on every price
+    vector<Price<CountedBond>> prices;
+    for (int i = 0; i <= 3; ++i) {
+        prices.emplace_back(bond, PriceTicks(25600 + 64 * i), PriceTicks(2));
+    }
+    passed = CheckCopies("streaming", [&](int i){
+        pricing_service.OnMessage(prices[i]);
+    }) && passed;
+    if (streaming_historical_data_service.GetData("9128285Q9").GetBidOrder().GetPrice() <= 100.5) {
+        passed = false;
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+/**
+ * multi_product_risk_test.cpp
+ * Books a bond trade and a swap trade into one MultiProductRisk and checks
+ * that each lands in the pipeline of its product type and that the total
+ * PV01 of the book is the sum of the two. The swap PV01 is checked against
+ * its annuity worked out by hand.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#include <cmath>
+#include <iostream>
+#include "../multi_product_risk.hpp"
+
+using namespace std;
+
+int main(){
+    MultiProductRisk<Bond, IRSwap> book;
+
+    Bond bond("9128285Q9", CUSIP, "T", 2.75f, date(2020, 11, 30));
+    IRSwap swap("USD5Y", THIRTY_THREE_SIXTY, ACT_THREE_SIXTY, SEMI_ANNUAL, LIBOR, TENOR_3M,
+                date(2018, 12, 20), date(2023, 12, 20), USD, 5, STANDARD, OUTRIGHT);
+    MultiProductRisk<Bond, IRSwap>::TradeEvent bond_trade =
+            Trade<Bond>(bond, "T1", PriceTicks(25600), "TRSY1", 1000000, BUY);
+    book.AddTrade(bond_trade);
+    book.AddTrade(Trade<IRSwap>(swap, "S1", PriceTicks(0), "SWAP1", 10000000, BUY));
+
+    bool passed = true;
+    const auto& bond_positions = book.GetPipeline<Bond>().GetPositionService()->GetPositions();
+    const auto& swap_positions = book.GetPipeline<IRSwap>().GetPositionService()->GetPositions();
+    if (bond_positions.size() != 1 || swap_positions.size() != 1 ||
+        bond_positions.count("9128285Q9") != 1 || swap_positions.count("USD5Y") != 1) {
+        passed = false;
+    }
+
+    // Ten 30/360 half-year periods paying on the 20th of June and December
+    // 2019 to 2023, each 0.5 times exp(-3% * days from 18 December 2018 / 365)
+    const double SWAP_ANNUITY = 4.607371073838544;
+    PV01Calculator<Bond> bond_calculator;
+    PV01Calculator<IRSwap> swap_calculator;
+    double swap_pv01 = swap_calculator.GetUnitPV01(swap);
+    cout << "swap unit PV01 " << swap_pv01 << ", annuity " << SWAP_ANNUITY * 0.0001 << endl;
+    if (fabs(swap_pv01 - SWAP_ANNUITY * 0.0001) > 1e-12) {
+        passed = false;
+    }
+    double expected = bond_calculator.GetUnitPV01(bond) * 1000000 +
+                      swap_calculator.GetUnitPV01(swap) * 10000000;
+    double total = book.GetTotalPV01();
+    cout << "total PV01 " << total << ", expected " << expected << endl;
+    if (fabs(total - expected) > 1e-9 * expected) {
+        passed = false;
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+/**
+ * warm_restart_test.cpp
+ * Books trades into a context journaling and snapshotting its services,
+ * then warm restarts a second context from the snapshot and the journal
+ * tail after it, and a third from the journals alone. Both must come back
+ * with the positions and risk of the first, the trades after the snapshot
+ * included, without reading any trade again. A fourth, sharded, restores
+ * into its shards and books on from there.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
+#include "../service_context.hpp"
+
+using namespace std;
+
+const string DIRECTORY = "warm_restart_test_data/";
+
+// Book a trade of quantity on the product into the context
+void BookTrade(ServiceContext<Bond> &context, const char* product_id, const string &trade_id,
+               long quantity, Side side){
+    const Security* security = context.GetSecurityMaster()->Find(product_id);
+    Trade<Bond> trade(security->bond, trade_id, PriceTicks(25600), "TRSY1", quantity, side);
+    context.GetTradeBookingService()->OnMessage(trade);
+}
+
+/**
+ * Positions and risk of a context, kept past its end.
+ */
+struct State{
+    map<string, map<string, long>> positions;
+    map<string, pair<long, double>> pv01s;
+    double bucket_pv01[SECTOR_BUCKETS];
+
+    explicit State(ServiceContext<Bond> &context){
+        for (const auto& position : context.GetPositionService()->GetPositions()) {
+            positions[position.first] = position.second.GetPositions();
+        }
+        for (const auto& pv01 : context.GetRiskService()->GetPV01s()) {
+            pv01s[pv01.first] = make_pair(pv01.second.GetQuantity(), pv01.second.GetPV01());
+        }
+        for (SectorBucket bucket : {FRONT_END, BELLY, LONG_END}) {
+            bucket_pv01[bucket] = context.GetRiskService()->GetBucketPV01(bucket);
+        }
+    }
+
+    bool operator==(const State &other) const{
+        if (positions != other.positions || pv01s.size() != other.pv01s.size()) {
+            return false;
+        }
+        for (const auto& pv01 : pv01s) {
+            auto found = other.pv01s.find(pv01.first);
+            if (found == other.pv01s.end() || found->second.first != pv01.second.first ||
+                fabs(found->second.second - pv01.second.second) > 1e-9) {
+                return false;
+            }
+        }
+        for (int bucket = 0; bucket < SECTOR_BUCKETS; ++bucket) {
+            if (fabs(bucket_pv01[bucket] - other.bucket_pv01[bucket]) > 1e-9) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+int main(){
+    system(("rm -rf " + DIRECTORY).c_str());
+    mkdir(DIRECTORY.c_str(), 0755);
+    mkdir((DIRECTORY + "output/").c_str(), 0755);
+    {
+        ofstream securities(DIRECTORY + "securities.txt");
+        securities << "CUSIP, ISIN, Ticker, Coupon, Maturity, IssueDate, Bucket\n"
+                   << "9128285Q9,US9128285Q95,T,2.750,2020-11-30,2018-11-30,FrontEnd\n"
+                   << "9128285P1,US9128285P13,T,2.875,2023-11-30,2018-11-30,Belly\n"
+                   << "912810SE9,US912810SE91,T,3.375,2048-11-15,2018-11-15,LongEnd\n";
+    }
+
+    // The snapshot is complete once the context that took it is gone
+    unique_ptr<State> expected;
+    {
+        ServiceContext<Bond> original(DIRECTORY, DIRECTORY + "output/");
+        original.EnableJournal(DIRECTORY + "journal/");
+        original.EnableSnapshots(DIRECTORY + "snapshots/", 1000000);
+        BookTrade(original, "9128285Q9", "T1", 1000000, BUY);
+        BookTrade(original, "9128285P1", "T2", 2000000, BUY);
+        original.Snapshot();
+        // The tail the snapshot does not cover
+        BookTrade(original, "9128285Q9", "T3", 3000000, SELL);
+        BookTrade(original, "912810SE9", "T4", 4000000, BUY);
+        expected.reset(new State(original));
+    }
+
+    bool passed = expected->positions.size() == 3;
+    {
+        ServiceContext<Bond> restored(DIRECTORY, DIRECTORY + "output/");
+        restored.EnableJournal(DIRECTORY + "journal/");
+        restored.EnableSnapshots(DIRECTORY + "snapshots/", 1000000);
+        restored.Restore();
+        bool same = State(restored) == *expected;
+        cout << "snapshot and journal tail: " << (same ? "restored" : "differs") << endl;
+        passed = passed && same;
+    }
+    {
+        ServiceContext<Bond> restored(DIRECTORY, DIRECTORY + "output/");
+        restored.EnableJournal(DIRECTORY + "journal/");
+        restored.Restore();
+        bool same = State(restored) == *expected;
+        cout << "journal alone: " << (same ? "restored" : "differs") << endl;
+        passed = passed && same;
+    }
+    {
+        ServiceContext<Bond> restored(DIRECTORY, DIRECTORY + "output/");
+        restored.EnableSharding(2);
+        restored.EnableJournal(DIRECTORY + "journal/");
+        restored.EnableSnapshots(DIRECTORY + "snapshots/", 1000000);
+        restored.Restore();
+        bool same = State(restored) == *expected;
+        // Short 2000000 after T1 and T3, the shard must book on from there,
+        // each position adding its aggregate to the risk of 1000000 - 3000000
+        BookTrade(restored, "9128285Q9", "T5", 5000000, BUY);
+        restored.GetShardedPipeline()->Drain();
+        same = same && restored.GetPositionService()->GetAggregatePosition("9128285Q9") == 3000000 &&
+               restored.GetRiskService()->GetBucketQuantity(FRONT_END) == 2000000;
+        cout << "sharded: " << (same ? "restored" : "differs") << endl;
+        passed = passed && same;
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
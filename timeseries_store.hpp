@@ -0,0 +1,556 @@
+/**
+ * timeseries_store.hpp
+ * Defines a columnar time-series store of the historical data, partitioned
+ * by product and day, and the codecs turning price streams, PV01s and
+ * positions into its rows.
+ *
+ * A partition is a set of memory-mapped column files
+ * <directory>/<product>/<day>.<column>.col, one holding the time stamps and
+ * one per value column, plus a sparse index of every 1024th time stamp.
+ *
+ * @author Wei Mao
+ * October 18th, 2026
+ */
+#ifndef TRADING_SYSTEM_TIMESERIES_STORE_HPP
+#define TRADING_SYSTEM_TIMESERIES_STORE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "position_service.hpp"
+#include "risk_service.hpp"
+#include "streaming_service.hpp"
+
+using namespace std;
+
+// Nanoseconds in a day, the length of a partition
+const int64_t TIMESERIES_NANOS_PER_DAY = 86400LL * 1000000000LL;
+// Rows between two entries of the sparse time index
+const size_t TIMESERIES_INDEX_STRIDE = 1024;
+
+
+/**
+ * Growable array of fixed-size elements in a memory-mapped file, led by a
+ * header holding the element count.
+ * Type E is the element type.
+ */
+template<typename E>
+class MappedColumn{
+private:
+    static const size_t HEADER_SIZE = 64;
+    string path;
+    int fd;
+    char* mapped;
+    size_t capacity;
+
+    // Map the file grown to hold _capacity elements, throws if it cannot
+    void Map(size_t _capacity);
+
+    void Unmap();
+
+public:
+    // ctor, opens or creates the column file, throws if it cannot
+    MappedColumn(const string &path);
+
+    ~MappedColumn();
+
+    MappedColumn(const MappedColumn&) = delete;
+    MappedColumn& operator=(const MappedColumn&) = delete;
+
+    void Append(const E &element);
+
+    size_t Size() const;
+
+    const E* Data() const;
+
+    const E& operator[](size_t index) const;
+
+};
+
+
+/**
+ * Columns of one product over one day, rows in time order.
+ */
+class TimeSeriesPartition{
+private:
+    MappedColumn<int64_t> times;
+    MappedColumn<int64_t> time_index;
+    vector<unique_ptr<MappedColumn<double>>> columns;
+
+    // First row whose time is not less (upper: greater) than time
+    size_t Search(int64_t time, bool upper) const;
+
+public:
+    // ctor, opens or creates the files of the partition
+    TimeSeriesPartition(const string &path_prefix, const vector<string> &column_names);
+
+    // Append a row, time stamps going backwards are clamped to the last one
+    void Append(int64_t time, const double *values);
+
+    size_t Size() const;
+
+    int64_t GetTime(size_t row) const;
+
+    double GetValue(size_t column, size_t row) const;
+
+    // First row at or after time
+    size_t LowerBound(int64_t time) const;
+
+    // First row after time
+    size_t UpperBound(int64_t time) const;
+
+};
+
+
+/**
+ * Rows of one product returned by a range query, column by column.
+ */
+struct TimeSeriesSlice{
+    vector<int64_t> times;
+    vector<vector<double>> columns;
+};
+
+
+/**
+ * One bar of a downsampled series.
+ */
+struct OHLCBar{
+    int64_t start;
+    double open;
+    double high;
+    double low;
+    double close;
+    size_t count;
+};
+
+
+/**
+ * Columnar time-series store, partitioned by product and by day. A partition
+ * is mapped only once a query or append reaches its day.
+ */
+class TimeSeriesStore{
+private:
+    string directory;
+    vector<string> column_names;
+    // day -> partition, per product, null until a query or append needs it
+    map<string, map<int64_t, unique_ptr<TimeSeriesPartition>>> partitions;
+
+    string PathPrefix(const string &product_id, int64_t day) const;
+
+    // Days of a product found on disk or written since
+    map<int64_t, unique_ptr<TimeSeriesPartition>>& GetPartitions(const string &product_id);
+
+    // The partition of a product and day, mapped on first use
+    TimeSeriesPartition& OpenPartition(const string &product_id, int64_t day,
+                                       unique_ptr<TimeSeriesPartition> &partition);
+
+public:
+    // ctor, the store lives under directory
+    TimeSeriesStore(const string &_directory, const vector<string> &_column_names);
+
+    // Nanoseconds since the epoch on the system clock
+    static int64_t Now();
+
+    const vector<string>& GetColumnNames() const;
+
+    // Index of a column by name, -1 if there is none
+    int GetColumnIndex(const string &column_name) const;
+
+    // Append a row of a product, one value per column
+    void Append(const string &product_id, int64_t time, const double *values);
+
+    // Rows of a product with from <= time < to
+    TimeSeriesSlice Range(const string &product_id, int64_t from, int64_t to);
+
+    // Last row of a product at or before time, false if there is none
+    bool AsOf(const string &product_id, int64_t time, int64_t &row_time,
+              vector<double> &values);
+
+    // Open, high, low and close of a column per interval over from <= time < to,
+    // intervals without rows are left out
+    vector<OHLCBar> Downsample(const string &product_id, int64_t from, int64_t to,
+                               int64_t interval, size_t column);
+
+};
+
+
+/**
+ * Columns and row of each type kept in a TimeSeriesStore, Encode fills
+ * WIDTH values.
+ * Type V is the data type.
+ */
+template<typename V>
+struct TimeSeriesCodec;
+
+template<typename T>
+struct TimeSeriesCodec<PriceStream<T>>{
+    static const size_t WIDTH = 6;
+
+    static vector<string> Columns(){
+        return {"bid", "offer", "bid_visible", "bid_hidden", "offer_visible", "offer_hidden"};
+    }
+
+    static void Encode(const PriceStream<T> &data, double *values){
+        const PriceStreamOrder& bid = data.GetBidOrder();
+        const PriceStreamOrder& offer = data.GetOfferOrder();
+        values[0] = bid.GetPrice();
+        values[1] = offer.GetPrice();
+        values[2] = bid.GetVisibleQuantity();
+        values[3] = bid.GetHiddenQuantity();
+        values[4] = offer.GetVisibleQuantity();
+        values[5] = offer.GetHiddenQuantity();
+    }
+};
+
+template<typename T>
+struct TimeSeriesCodec<PV01<T>>{
+    static const size_t WIDTH = 2;
+
+    static vector<string> Columns(){
+        return {"pv01", "quantity"};
+    }
+
+    static void Encode(const PV01<T> &data, double *values){
+        values[0] = data.GetPV01();
+        values[1] = data.GetQuantity();
+    }
+};
+
+template<typename T>
+struct TimeSeriesCodec<Position<T>>{
+    static const size_t WIDTH = 1;
+
+    static vector<string> Columns(){
+        return {"aggregate_position"};
+    }
+
+    static void Encode(const Position<T> &data, double *values){
+        values[0] = data.GetAggregatePosition();
+    }
+};
+
+
+/* ----------------------------- Implementation ----------------------------- */
+//
+// Implementation of MappedColumn class
+template<typename E>
+MappedColumn<E>::MappedColumn(const string &_path){
+    path = _path;
+    mapped = nullptr;
+    capacity = 0;
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0){
+        throw runtime_error("MappedColumn: cannot open " + path + ": " + strerror(errno));
+    }
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) < 0){
+        int error = errno;
+        close(fd);
+        throw runtime_error("MappedColumn: cannot stat " + path + ": " + strerror(error));
+    }
+    size_t existing = (file_stat.st_size > (off_t) HEADER_SIZE) ?
+            (file_stat.st_size - HEADER_SIZE) / sizeof(E) : 0;
+    try{
+        Map(max<size_t>(existing, 4096));
+    }
+    catch(...){
+        close(fd);
+        throw;
+    }
+}
+
+template<typename E>
+MappedColumn<E>::~MappedColumn(){
+    Unmap();
+    if(fd >= 0){
+        close(fd);
+    }
+}
+
+template<typename E>
+void MappedColumn<E>::Map(size_t _capacity){
+    Unmap();
+    capacity = _capacity;
+    size_t size = HEADER_SIZE + capacity * sizeof(E);
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) < 0){
+        throw runtime_error("MappedColumn: cannot stat " + path + ": " + strerror(errno));
+    }
+    if((size_t) file_stat.st_size < size && ftruncate(fd, size) < 0){
+        throw runtime_error("MappedColumn: cannot extend " + path + ": " + strerror(errno));
+    }
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(address == MAP_FAILED){
+        throw runtime_error("MappedColumn: cannot map " + path + ": " + strerror(errno));
+    }
+    mapped = (char*) address;
+}
+
+template<typename E>
+void MappedColumn<E>::Unmap(){
+    if(mapped != nullptr){
+        munmap(mapped, HEADER_SIZE + capacity * sizeof(E));
+        mapped = nullptr;
+    }
+}
+
+template<typename E>
+void MappedColumn<E>::Append(const E &element){
+    uint64_t count = Size();
+    if(count == capacity){
+        Map(capacity * 2);
+    }
+    memcpy(mapped + HEADER_SIZE + count * sizeof(E), &element, sizeof(E));
+    // Count last, so a reader never sees a row that is not written yet
+    ++count;
+    memcpy(mapped, &count, sizeof(count));
+}
+
+template<typename E>
+size_t MappedColumn<E>::Size() const{
+    uint64_t count;
+    memcpy(&count, mapped, sizeof(count));
+    return count;
+}
+
+template<typename E>
+const E* MappedColumn<E>::Data() const{
+    return (const E*) (mapped + HEADER_SIZE);
+}
+
+template<typename E>
+const E& MappedColumn<E>::operator[](size_t index) const{
+    return Data()[index];
+}
+
+
+//
+// Implementation of TimeSeriesPartition class
+TimeSeriesPartition::TimeSeriesPartition(const string &path_prefix,
+        const vector<string> &column_names) :
+        times(path_prefix + ".time.col"), time_index(path_prefix + ".index.col"){
+    for(auto& column_name : column_names){
+        columns.emplace_back(new MappedColumn<double>(
+                path_prefix + "." + column_name + ".col"));
+    }
+}
+
+void TimeSeriesPartition::Append(int64_t time, const double *values){
+    size_t row = times.Size();
+    if(row > 0){
+        time = max(time, times[row - 1]);
+    }
+    for(size_t i = 0; i < columns.size(); ++i){
+        columns[i]->Append(values[i]);
+    }
+    if(row % TIMESERIES_INDEX_STRIDE == 0){
+        time_index.Append(time);
+    }
+    // Times last, their count is the row count of the partition
+    times.Append(time);
+}
+
+size_t TimeSeriesPartition::Size() const{
+    return times.Size();
+}
+
+int64_t TimeSeriesPartition::GetTime(size_t row) const{
+    return times[row];
+}
+
+double TimeSeriesPartition::GetValue(size_t column, size_t row) const{
+    return (*columns[column])[row];
+}
+
+size_t TimeSeriesPartition::Search(int64_t time, bool upper) const{
+    size_t size = times.Size();
+    // The index narrows the search down to the rows between two entries
+    const int64_t* index_begin = time_index.Data();
+    const int64_t* index_end = index_begin + min(time_index.Size(),
+            (size + TIMESERIES_INDEX_STRIDE - 1) / TIMESERIES_INDEX_STRIDE);
+    size_t entry = (upper ? upper_bound(index_begin, index_end, time) :
+                            lower_bound(index_begin, index_end, time)) - index_begin;
+    size_t first = (entry == 0) ? 0 : (entry - 1) * TIMESERIES_INDEX_STRIDE;
+    size_t last = min(size, entry * TIMESERIES_INDEX_STRIDE);
+    const int64_t* data = times.Data();
+    return (upper ? upper_bound(data + first, data + last, time) :
+                    lower_bound(data + first, data + last, time)) - data;
+}
+
+size_t TimeSeriesPartition::LowerBound(int64_t time) const{
+    return Search(time, false);
+}
+
+size_t TimeSeriesPartition::UpperBound(int64_t time) const{
+    return Search(time, true);
+}
+
+
+//
+// Implementation of TimeSeriesStore class
+TimeSeriesStore::TimeSeriesStore(const string &_directory,
+                                 const vector<string> &_column_names){
+    directory = _directory;
+    column_names = _column_names;
+    mkdir(directory.c_str(), 0755);
+}
+
+int64_t TimeSeriesStore::Now(){
+    return chrono::duration_cast<chrono::nanoseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const vector<string>& TimeSeriesStore::GetColumnNames() const{
+    return column_names;
+}
+
+int TimeSeriesStore::GetColumnIndex(const string &column_name) const{
+    for(size_t i = 0; i < column_names.size(); ++i){
+        if(column_names[i] == column_name){
+            return i;
+        }
+    }
+    return -1;
+}
+
+string TimeSeriesStore::PathPrefix(const string &product_id, int64_t day) const{
+    return directory + product_id + "/" + to_string(day);
+}
+
+map<int64_t, unique_ptr<TimeSeriesPartition>>& TimeSeriesStore::GetPartitions(
+        const string &product_id){
+    auto found = partitions.find(product_id);
+    if(found != partitions.end()){
+        return found->second;
+    }
+    map<int64_t, unique_ptr<TimeSeriesPartition>>& product_partitions =
+            partitions[product_id];
+    string product_directory = directory + product_id;
+    mkdir(product_directory.c_str(), 0755);
+    DIR* dir = opendir(product_directory.c_str());
+    if(dir == nullptr){
+        return product_partitions;
+    }
+    while(dirent* entry = readdir(dir)){
+        string name = entry->d_name;
+        size_t suffix = name.find(".time.col");
+        if(suffix == string::npos || suffix == 0 || suffix + 9 != name.size()){
+            continue;
+        }
+        // Files not named after a day are none of the store's
+        string day_name = name.substr(0, suffix);
+        char* end = nullptr;
+        errno = 0;
+        long long day = strtoll(day_name.c_str(), &end, 10);
+        if(errno == 0 && *end == '\0'){
+            product_partitions[day];
+        }
+    }
+    closedir(dir);
+    return product_partitions;
+}
+
+TimeSeriesPartition& TimeSeriesStore::OpenPartition(const string &product_id, int64_t day,
+        unique_ptr<TimeSeriesPartition> &partition){
+    if(!partition){
+        partition.reset(new TimeSeriesPartition(PathPrefix(product_id, day), column_names));
+    }
+    return *partition;
+}
+
+void TimeSeriesStore::Append(const string &product_id, int64_t time,
+                             const double *values){
+    int64_t day = time / TIMESERIES_NANOS_PER_DAY;
+    OpenPartition(product_id, day, GetPartitions(product_id)[day]).Append(time, values);
+}
+
+TimeSeriesSlice TimeSeriesStore::Range(const string &product_id, int64_t from, int64_t to){
+    TimeSeriesSlice slice;
+    slice.columns.resize(column_names.size());
+    auto& product_partitions = GetPartitions(product_id);
+    auto partition = product_partitions.lower_bound(from / TIMESERIES_NANOS_PER_DAY);
+    for(; partition != product_partitions.end() &&
+          partition->first <= (to - 1) / TIMESERIES_NANOS_PER_DAY; ++partition){
+        const TimeSeriesPartition& rows = OpenPartition(product_id, partition->first,
+                                                        partition->second);
+        size_t first = rows.LowerBound(from);
+        size_t last = rows.LowerBound(to);
+        for(size_t row = first; row < last; ++row){
+            slice.times.push_back(rows.GetTime(row));
+        }
+        for(size_t column = 0; column < column_names.size(); ++column){
+            for(size_t row = first; row < last; ++row){
+                slice.columns[column].push_back(rows.GetValue(column, row));
+            }
+        }
+    }
+    return slice;
+}
+
+bool TimeSeriesStore::AsOf(const string &product_id, int64_t time, int64_t &row_time,
+                           vector<double> &values){
+    auto& product_partitions = GetPartitions(product_id);
+    auto partition = product_partitions.upper_bound(time / TIMESERIES_NANOS_PER_DAY);
+    // Walk back from the day of time to the first partition with an earlier row
+    while(partition != product_partitions.begin()){
+        --partition;
+        const TimeSeriesPartition& rows = OpenPartition(product_id, partition->first,
+                                                        partition->second);
+        size_t row = rows.UpperBound(time);
+        if(row == 0){
+            continue;
+        }
+        --row;
+        row_time = rows.GetTime(row);
+        values.resize(column_names.size());
+        for(size_t column = 0; column < column_names.size(); ++column){
+            values[column] = rows.GetValue(column, row);
+        }
+        return true;
+    }
+    return false;
+}
+
+vector<OHLCBar> TimeSeriesStore::Downsample(const string &product_id, int64_t from,
+        int64_t to, int64_t interval, size_t column){
+    vector<OHLCBar> bars;
+    if(interval <= 0 || column >= column_names.size()){
+        return bars;
+    }
+    auto& product_partitions = GetPartitions(product_id);
+    auto partition = product_partitions.lower_bound(from / TIMESERIES_NANOS_PER_DAY);
+    for(; partition != product_partitions.end() &&
+          partition->first <= (to - 1) / TIMESERIES_NANOS_PER_DAY; ++partition){
+        const TimeSeriesPartition& rows = OpenPartition(product_id, partition->first,
+                                                        partition->second);
+        size_t last = rows.LowerBound(to);
+        for(size_t row = rows.LowerBound(from); row < last; ++row){
+            int64_t start = from + (rows.GetTime(row) - from) / interval * interval;
+            double value = rows.GetValue(column, row);
+            if(bars.empty() || bars.back().start != start){
+                bars.push_back(OHLCBar{start, value, value, value, value, 0});
+            }
+            OHLCBar& bar = bars.back();
+            bar.high = max(bar.high, value);
+            bar.low = min(bar.low, value);
+            bar.close = value;
+            ++bar.count;
+        }
+    }
+    return bars;
+}
+
+#endif //TRADING_SYSTEM_TIMESERIES_STORE_HPP
@@ -14,11 +14,19 @@
 #include <vector>
 #include "soa.hpp"
 #include "products.hpp"
+#include "live_feed.hpp"
+#include "security_master.hpp"
 #include "execution_service.hpp"
 
 // Trade sides
 enum Side { BUY, SELL };
 
+// Names of the sides in input records
+template<>
+struct EnumNames<Side>{
+    static constexpr const char* NAMES[] = {"BUY", "SELL"};
+};
+
 
 /**
  * Trade object with a price, side, and quantity on a particular book.
@@ -29,7 +37,7 @@ class Trade{
 private:
     T product;
     string tradeId;
-    double price;
+    PriceTicks price;
     string book;
     long quantity;
     Side side;
@@ -37,14 +45,14 @@ private:
 public:
     // ctors
     Trade();
-    Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side);
+    Trade(const T &_product, string _tradeId, PriceTicks _price, string _book, long _quantity, Side _side);
     
     // getters
     const T& GetProduct() const;
     
     const string& GetTradeId() const;
     
-    double GetPrice() const;
+    PriceTicks GetPrice() const;
     
     const string& GetBook() const;
     
@@ -55,6 +63,24 @@ public:
 };
 
 
+/**
+ * Record of a bond trade: CUSIP, trade id, price, quantity, book, side.
+ */
+template<>
+struct RecordSchema<Trade<Bond>>{
+    using Fields = tuple<SecurityField, TextField<16>, PriceField, IntegerField,
+                         TextField<16>, EnumField<Side>>;
+
+    static Trade<Bond> Build(pmr::memory_resource* resource, const Security* security,
+                             string_view trade_id, PriceTicks price, long quantity,
+                             string_view book, Side side);
+
+    static bool Extract(const Trade<Bond> &trade, const SecurityMaster &master,
+                        const Security*& security, string_view &trade_id, PriceTicks &price,
+                        long &quantity, string_view &book, Side &side);
+};
+
+
 /**
  * Trade Booking Service to book trades to a particular book.
  * Keyed on trade id.
@@ -66,16 +92,17 @@ class TradeBookingService : public Service<string,Trade <T> >
 private:
     map<string, Trade<T>> trade_data;
     vector<ServiceListener<Trade<T>> *> service_listeners;
-    TradeBookingService();
+    int order_count;
 
 public:
-    static TradeBookingService<T>* GenerateInstance(){
-        static TradeBookingService<T> instance;
-        return &instance;
-    }
+    // ctor
+    TradeBookingService();
+
+    // Instance owned by the default ServiceContext
+    static TradeBookingService* GenerateInstance();
 
     // Override virtual functions in base class Service
-    Trade<T>& GetData(string key) override;
+    Trade<T>& GetData(const string &key) override;
 
     void OnMessage(Trade<T> &data) override;
 
@@ -96,13 +123,21 @@ template<typename T>
 class TradeBookingServiceConnector : public Connector<Trade<T>>{
 private:
     TradeBookingService<T>* trade_booking_service;
-    TradeBookingServiceConnector();
+    string path;
+    // Resolves the CUSIP of each record, the default master when not set
+    const SecurityMaster* security_master;
+    RecordFormat format;
+
+    // The master to resolve CUSIPs against
+    const SecurityMaster* GetSecurityMaster() const;
 
 public:
-    static TradeBookingServiceConnector<T>* GenerateInstance(){
-        static TradeBookingServiceConnector<T> instance;
-        return &instance;
-    }
+    // ctor
+    TradeBookingServiceConnector(TradeBookingService<T>* _trade_booking_service,
+            const string &_path = "../input/trades.txt");
+
+    // Instance owned by the default ServiceContext
+    static TradeBookingServiceConnector* GenerateInstance();
 
     // Override virtual functions in base class Service
     void Publish(Trade<T>& data) override;
@@ -111,6 +146,16 @@ public:
     
     TradeBookingService<T>* GetService();
 
+    // Resolve CUSIPs against _security_master instead of the default one
+    void SetSecurityMaster(const SecurityMaster* _security_master);
+
+    // Read the records at _path, in CSV or binary
+    void SetInput(const string &_path, RecordFormat _format = CSV_RECORDS);
+
+    // Follow the input on a live feed instead of reading it once, the
+    // messages flow while the feed runs
+    void Follow(LiveFeed &feed, LiveSourceType type = FOLLOW_FILE);
+
 };
 
 
@@ -122,13 +167,13 @@ template <typename T>
 class TradeBookingServiceListener : public ServiceListener<ExecutionOrder<T> > {
 private:
     TradeBookingService<T>* trade_booking_service;
-    TradeBookingServiceListener();
 
 public:
-    static TradeBookingServiceListener* GenerateInstance(){
-        static TradeBookingServiceListener instance;
-        return &instance;
-    }
+    // ctor
+    TradeBookingServiceListener(TradeBookingService<T>* _trade_booking_service);
+
+    // Instance owned by the default ServiceContext
+    static TradeBookingServiceListener* GenerateInstance();
  
     // Override virtual functions in base class Service
     void ProcessAdd(ExecutionOrder<T> & data) override;
@@ -150,11 +195,11 @@ Trade<T>::Trade() : product(T()){
 }
 
 template<typename T>
-Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book,
+Trade<T>::Trade(const T &_product, string _tradeId, PriceTicks _price, string _book,
         long _quantity, Side _side) : product(_product){
-    tradeId = _tradeId;
+    tradeId = move(_tradeId);
     price = _price;
-    book = _book;
+    book = move(_book);
     quantity = _quantity;
     side = _side;
 }
@@ -170,7 +215,7 @@ const string& Trade<T>::GetTradeId() const{
 }
 
 template<typename T>
-double Trade<T>::GetPrice() const{
+PriceTicks Trade<T>::GetPrice() const{
     return price;
 }
 
@@ -190,27 +235,44 @@ Side Trade<T>::GetSide() const{
 }
 
 
+//
+// Implementation of RecordSchema<Trade<Bond>>
+Trade<Bond> RecordSchema<Trade<Bond>>::Build(pmr::memory_resource*,
+        const Security* security, string_view trade_id, PriceTicks price, long quantity,
+        string_view book, Side side){
+    return Trade<Bond>(security->bond, string(trade_id), price, string(book), quantity, side);
+}
+
+bool RecordSchema<Trade<Bond>>::Extract(const Trade<Bond> &trade, const SecurityMaster &master,
+        const Security*& security, string_view &trade_id, PriceTicks &price, long &quantity,
+        string_view &book, Side &side){
+    security = master.Find(trade.GetProduct().GetProductId());
+    trade_id = trade.GetTradeId();
+    price = trade.GetPrice();
+    quantity = trade.GetQuantity();
+    book = trade.GetBook();
+    side = trade.GetSide();
+    return security != nullptr;
+}
+
+
 //
 // Implementation of TradeBookingService class
 template<typename T>
 TradeBookingService<T>::TradeBookingService(){
-
+    order_count = 0;
 }
 
 template<typename T>
-Trade<T>& TradeBookingService<T>::GetData(string key){
+Trade<T>& TradeBookingService<T>::GetData(const string &key){
     return trade_data[key];
 }
 
 template<typename T>
 void TradeBookingService<T>::OnMessage(Trade<T> &data){
-    const string trade_id = data.GetTradeId();
-    if (trade_data.find(trade_id) == trade_data.end()){
-        trade_data.insert(make_pair(trade_id, data));
-    }
-    else{
-        trade_data[trade_id] = data;
-    }
+    INSTRUMENT_SCOPE("TradeBookingService");
+    const string& trade_id = data.GetTradeId();
+    trade_data.insert_or_assign(trade_id, data);
     for(auto listener : service_listeners) {
         listener->ProcessAdd(data);
     }
@@ -228,13 +290,12 @@ const vector<ServiceListener<Trade<T>>* >& TradeBookingService<T>::GetListeners(
 
 template<typename T>
 void TradeBookingService<T>::BookTrade(const ExecutionOrder<T> &execution_order){
-    static int order_count = 0;
     order_count ++;
     T product = execution_order.GetProduct();
     Side side = (execution_order.GetSide() == BID) ? BUY : SELL;
     long quantity = execution_order.GetVisibleQuantity() +
             execution_order.GetHiddenQuantity();
-    double price = execution_order.GetPrice();
+    PriceTicks price = execution_order.GetPrice();
     string book = "TSY" + to_string(order_count % 3 + 1);
     string trade_id = "ETrade"+to_string(order_count);
     Trade<T> trade(product, trade_id, price, book, quantity, side);
@@ -245,8 +306,12 @@ void TradeBookingService<T>::BookTrade(const ExecutionOrder<T> &execution_order)
 //
 // Implementation of TradeBookingServiceConnector class
 template<typename T>
-TradeBookingServiceConnector<T>::TradeBookingServiceConnector() {
-    trade_booking_service = TradeBookingService<T>::GenerateInstance();
+TradeBookingServiceConnector<T>::TradeBookingServiceConnector(TradeBookingService<T>* _trade_booking_service,
+        const string &_path) {
+    trade_booking_service = _trade_booking_service;
+    security_master = nullptr;
+    path = _path;
+    format = CSV_RECORDS;
 }
 
 template<typename T>
@@ -255,57 +320,20 @@ void TradeBookingServiceConnector<T>::Publish(Trade<T>& data){
 
 template<typename T>
 void TradeBookingServiceConnector<T>::Subscribe(){
-    auto SplitLine = [](string line, char delimiter){
-        vector<string> tokens;
-        string token;
-        istringstream tokenStream(line);
-        while (getline(tokenStream, token, delimiter)){
-            tokens.push_back(token);
-        }
-        return tokens;
-    };
-    auto String2Price = [&](string s){
-        vector<string> split = SplitLine(s, '-');
-        double price = stoi(split[0]);
-        if(split[1][2] == '+')
-            split[1][2] = '4';
-        price += stoi(split[1].substr(0,2)) / 32.0;
-        price += stoi(split[1].substr(2,3)) / 256.0;
-        return price;
-    };
-    auto FindMaturity = [](string cusip){
-        vector<string> cusip_codes = {"9128285Q9", "9128285R7", "9128285P1",
-                                      "9128285N6", "9128285M8", "912810SE9"};
-        vector<date> dates = {date(2020, 11, 30), date(2021, 12, 15),
-                              date(2023, 11, 30), date(2025, 11, 30),
-                              date(2028, 12, 15), date(2048, 11, 15)};
-        for(int i = 0; i < 6; ++i){
-            if(cusip == cusip_codes[i])
-                return dates[i];
-        }
-    };
-    ifstream data;
-    data.open("../input/trades.txt", ios::in);
-    string line;
-    getline(data, line);
-    while(getline(data, line)){
-        vector<string> line_fragments = SplitLine(line, ',');
-        // Construction of Bond
-        string cusip = line_fragments[0];
-        string ticker = "NoTicker";
-        float coupon = 0.0;
-        date maturity_date = FindMaturity(cusip);
-        Bond bond(cusip, CUSIP, ticker, coupon, maturity_date);
-        // Construction of Trade<Bond>
-        string trade_id = line_fragments[1];
-        double trade_price = String2Price(line_fragments[2]);
-        long trade_quantity = stol(line_fragments[3]);
-        string trade_book = line_fragments[4];
-        Side trade_side = (line_fragments[5] == "SELL") ? SELL : BUY;
-        Trade<Bond> bond_trade(bond, trade_id, trade_price,
-                    trade_book, trade_quantity, trade_side);
-        trade_booking_service->OnMessage(bond_trade);
-    }
+    // Records of unknown CUSIPs or sides are skipped
+    RecordParser<Trade<T>> parser(GetSecurityMaster(), format);
+    parser.ParseFile(path, [this](Trade<T> &trade){ trade_booking_service->OnMessage(trade); });
+}
+
+template<typename T>
+void TradeBookingServiceConnector<T>::Follow(LiveFeed &feed, LiveSourceType type) {
+    feed.Add(path, type, MakeRecordConsumer<Trade<T>>(type, GetSecurityMaster(), format,
+            [this](Trade<T> &trade){ trade_booking_service->OnMessage(trade); }));
+}
+
+template<typename T>
+const SecurityMaster* TradeBookingServiceConnector<T>::GetSecurityMaster() const {
+    return (security_master != nullptr) ? security_master : &SecurityMaster::Default();
 }
 
 template<typename T>
@@ -313,12 +341,23 @@ TradeBookingService<T>* TradeBookingServiceConnector<T>::GetService(){
     return trade_booking_service;
 }
 
+template<typename T>
+void TradeBookingServiceConnector<T>::SetSecurityMaster(const SecurityMaster* _security_master){
+    security_master = _security_master;
+}
+
+template<typename T>
+void TradeBookingServiceConnector<T>::SetInput(const string &_path, RecordFormat _format){
+    path = _path;
+    format = _format;
+}
+
 
 //
 // Implementation of TradeBookingServiceListener class
 template<typename T>
-TradeBookingServiceListener<T>::TradeBookingServiceListener(){
-    trade_booking_service = TradeBookingService<T>::GenerateInstance();
+TradeBookingServiceListener<T>::TradeBookingServiceListener(TradeBookingService<T>* _trade_booking_service){
+    trade_booking_service = _trade_booking_service;
 }
 
 template<typename T>